@@ -2,23 +2,44 @@
 #include <fmt/format.h>
 
 #include "Application.h"
+#include "VulkanHelpers.h"
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <map>
 #include <set>
 #include <algorithm>
-#include <fstream>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
 //----------------------------------------------------------------------------------------
 constexpr int WINDOW_WIDTH  = 800;
 constexpr int WINDOW_HEIGHT = 600;
+constexpr int WINDOW_OFFSET = 40;    // cascade of extra windows
+
+constexpr char WINDOW_TITLE[] = "Vulkan hello triangle";
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Longer digit strings can't be a device index (and would overflow std::stoul)
+constexpr size_t MAX_DEVICE_INDEX_DIGITS = 9;
+
+// Per image of the GPU driven scene, after the frame's pair: the scene pass's start and
+// end, then the occlusion pass's
+constexpr uint32_t SCENE_TIMESTAMPS = 4;
+
+// Frames drawn before a benchmark starts timing: pipelines compiled, caches and clocks
+// warmed up, dynamic resolution settled
+constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 100;
+
+// What chooseSwapSurfaceFormat() prefers; every device must support it as a colour
+// attachment and blit destination
+constexpr VkFormat REPLAY_IMAGE_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+
 const std::vector<const char*> DEVICE_EXTENSIONS = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 const std::vector<const char*> VALIDATION_LAYERS = {"VK_LAYER_KHRONOS_validation"};
 
@@ -32,30 +53,8 @@ constexpr bool ENABLE_VALIDATION_LAYERS = true;
 static VkDebugUtilsMessengerEXT sg_debugMessenger;
 
 //----------------------------------------------------------------------------------------
-static std::vector<char>
-readFile(const std::string& filename)
-{
-  try
-  {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    if (!file.is_open())
-    {
-      throw std::runtime_error(fmt::format("failed to open file: {}", filename));
-    }
-
-    size_t fileSize = file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    return buffer;
-  }
-  catch (const std::exception& ex)
-  {
-    throw ex;
-  }
-}
-
-//----------------------------------------------------------------------------------------
+// Called on whichever thread the driver or layer is on; the Logger queues the message
+// and prints it from its own thread
 static VKAPI_ATTR VkBool32 VKAPI_CALL
 debugCallback(
   VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -63,13 +62,13 @@ debugCallback(
   const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
   void* pUserData)
 {
-  UNREFERENCED_PARAMETER(messageType);
-  UNREFERENCED_PARAMETER(pUserData);
-
-  if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
-  {
-    fmt::print("VALIDATION LAYER: {}\n", pCallbackData->pMessage);
-  }
+  auto* logger = static_cast<Logger*>(pUserData);
+  logger->log(
+    messageSeverity,
+    messageType,
+    pCallbackData->messageIdNumber,
+    pCallbackData->pMessageIdName,
+    pCallbackData->pMessage);
   return VK_FALSE;
 }
 
@@ -109,21 +108,143 @@ DestroyDebugUtilsMessengerEXT(
 }
 
 //----------------------------------------------------------------------------------------
+// Every message goes to the logger, which counts them all and filters what it prints
 static void
-populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo)
+populateDebugMessengerCreateInfo(
+  VkDebugUtilsMessengerCreateInfoEXT& createInfo,
+  Logger& logger)
 {
   createInfo                 = {};
   createInfo.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-  createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
-                               | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
-                               | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-  createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
-                           | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
-                           | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+  createInfo.messageSeverity = Logger::ALL_SEVERITIES;
+  createInfo.messageType     = Logger::ALL_TYPES;
   createInfo.pfnUserCallback = debugCallback;
+  createInfo.pUserData       = &logger;
+}
+
+//----------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------
+static const char*
+deviceTypeName(VkPhysicalDeviceType type)
+{
+  switch (type)
+  {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return "cpu";
+    default:
+      return "other";
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The UUID is printed 8-4-4-4-12, as vulkaninfo does
+static PhysicalDeviceInfo
+describePhysicalDevice(VkPhysicalDevice device, uint32_t index)
+{
+  VkPhysicalDeviceIDProperties idProperties = {};
+  idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+  VkPhysicalDeviceProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &idProperties;
+  vkGetPhysicalDeviceProperties2(device, &properties);
+
+  PhysicalDeviceInfo info;
+  info.index = index;
+  info.name  = properties.properties.deviceName;
+  info.type  = deviceTypeName(properties.properties.deviceType);
+  for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+  {
+    if (i == 4 || i == 6 || i == 8 || i == 10)
+    {
+      info.uuid += '-';
+    }
+    info.uuid += fmt::format("{:02x}", idProperties.deviceUUID[i]);
+  }
+  return info;
+}
+
+//----------------------------------------------------------------------------------------
+// selector: a device index, or its UUID in either case with or without the dashes. A
+// UUID may be all digits too, so digits that aren't the index are tried as one
+static bool
+matchesDevice(const std::string& selector, const PhysicalDeviceInfo& info)
+{
+  auto isDigit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+  const bool index = !selector.empty() && selector.size() <= MAX_DEVICE_INDEX_DIGITS
+                     && std::all_of(selector.begin(), selector.end(), isDigit);
+  if (index && std::stoul(selector) == info.index)
+  {
+    return true;
+  }
+
+  auto normalise = [](const std::string& text) {
+    std::string result;
+    for (char c : text)
+    {
+      if (c != '-')
+      {
+        result += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      }
+    }
+    return result;
+  };
+  return normalise(selector) == normalise(info.uuid);
+}
+
+//----------------------------------------------------------------------------------------
+static CaptureSettings
+captureSettings(const ApplicationConfig& config)
+{
+  CaptureSettings settings    = {};
+  settings.gpuDriven          = config.gpuDriven;
+  settings.bindless           = config.bindless;
+  settings.occlusionCulling   = config.occlusionCulling;
+  settings.denseScene         = config.denseScene;
+  settings.objectCount        = config.objectCount;
+  settings.particleCount      = config.particleCount;
+  settings.windowCount        = config.windowCount;
+  settings.targetFrameTime    = config.targetFrameTime;
+  settings.minResolutionScale = config.minResolutionScale;
+  settings.maxResolutionScale = config.maxResolutionScale;
+  settings.meshPath           = config.meshPath;
+  settings.texturePath        = config.texturePath;
+  return settings;
+}
+
+//----------------------------------------------------------------------------------------
+static void
+applyCaptureSettings(const CaptureSettings& settings, ApplicationConfig& config)
+{
+  config.gpuDriven          = settings.gpuDriven;
+  config.bindless           = settings.bindless;
+  config.occlusionCulling   = settings.occlusionCulling;
+  config.denseScene         = settings.denseScene;
+  config.objectCount        = settings.objectCount;
+  config.particleCount      = settings.particleCount;
+  config.windowCount        = settings.windowCount;
+  config.targetFrameTime    = settings.targetFrameTime;
+  config.minResolutionScale = settings.minResolutionScale;
+  config.maxResolutionScale = settings.maxResolutionScale;
+  config.meshPath           = settings.meshPath;
+  config.texturePath        = settings.texturePath;
 }
 
 //----------------------------------------------------------------------------------------
+// The first of an image's SCENE_TIMESTAMPS in its window's timestamp pool
+static uint32_t
+sceneTimestamp(const AppWindow& window, size_t imageIndex)
+{
+  const auto imageCount = static_cast<uint32_t>(window.commandBuffers.size());
+  return 2 * imageCount + SCENE_TIMESTAMPS * static_cast<uint32_t>(imageIndex);
+}
 
 //----------------------------------------------------------------------------------------
 // Application Implementation
@@ -139,7 +260,7 @@ Application::setupDebugMessenger()
   }
 
   VkDebugUtilsMessengerCreateInfoEXT createInfo;
-  populateDebugMessengerCreateInfo(createInfo);
+  populateDebugMessengerCreateInfo(createInfo, m_logger);
 
   if (
     CreateDebugUtilsMessengerEXT(m_instance, &createInfo, nullptr, &sg_debugMessenger)
@@ -150,26 +271,126 @@ Application::setupDebugMessenger()
 }
 
 //----------------------------------------------------------------------------------------
-static void
-framebufferResizeCallback(GLFWwindow* window, int width, int height)
+// The glfw callbacks run on the main thread, within glfwWaitEvents(). The new sizes are
+// published before the event that tells the render thread to look at them
+void
+Application::framebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
-  UNREFERENCED_PARAMETER(width);
-  UNREFERENCED_PARAMETER(height);
+  auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+  app->publishFramebufferSizes();
+
+  WindowEvent event = {};
+  event.type        = WindowEventType::Resize;
+  event.width       = width;
+  event.height      = height;
+  app->pushWindowEvent(window, event);
+}
 
+//----------------------------------------------------------------------------------------
+void
+Application::keyCallback(GLFWwindow* window, int key, int, int action, int)
+{
+  if (action != GLFW_PRESS)
+  {
+    return;
+  }
   auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-  app->setFramebufferResized();
+
+  WindowEvent event = {};
+  event.type        = WindowEventType::Key;
+  event.key         = key;
+  app->pushWindowEvent(window, event);
 }
 
 //----------------------------------------------------------------------------------------
+// Main thread. The render thread drains the queue every frame, so it only fills up
+// while a frame is blocked, which won't be for long: wait for room rather than lose a
+// resize or close
 void
-Application::createInstance()
+Application::pushWindowEvent(GLFWwindow* window, WindowEvent event)
+{
+  for (const AppWindow& appWindow : m_windows)
+  {
+    if (appWindow.window == window)
+    {
+      event.window = appWindow.index;
+    }
+  }
+  while (!m_windowEvents.push(event) && m_rendering)
+  {
+    std::this_thread::yield();
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_windowEventMutex);
+    m_windowEventPending = true;
+  }
+  m_windowEventPushed.notify_one();
+}
+
+//----------------------------------------------------------------------------------------
+// Main thread: glfw only reports framebuffer sizes there
+void
+Application::publishFramebufferSizes()
+{
+  std::vector<VkExtent2D>& sizes = m_framebufferSizes.back();
+  sizes.resize(m_windows.size());
+  for (const AppWindow& window : m_windows)
+  {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window.window, &width, &height);
+    sizes[window.index] = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+  }
+  m_framebufferSizes.publish();
+}
+
+//----------------------------------------------------------------------------------------
+// The latest size the main thread published, 0 x 0 while minimised
+VkExtent2D
+Application::framebufferSize(const AppWindow& window) const
+{
+  return m_framebufferSizes.front()[window.index];
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::createWindows()
 {
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);    // not using OpenGL
-  m_window = glfwCreateWindow(
-    WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan hello triangle", nullptr, nullptr);
-  glfwSetWindowUserPointer(m_window, this);
-  glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+  for (AppWindow& window : m_windows)
+  {
+    const int i = static_cast<int>(window.index);
+    window.window =
+      glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
+    if (i > 0)
+    {
+      int x = 0, y = 0;
+      glfwGetWindowPos(m_windows[0].window, &x, &y);
+      glfwSetWindowPos(window.window, x + i * WINDOW_OFFSET, y + i * WINDOW_OFFSET);
+    }
+    glfwSetWindowUserPointer(window.window, this);
+    glfwSetFramebufferSizeCallback(window.window, framebufferResizeCallback);
+    glfwSetKeyCallback(window.window, keyCallback);
+  }
+
+  // The first swap chains are created before there is a render thread
+  publishFramebufferSizes();
+  m_framebufferSizes.update();
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::createInstance()
+{
+  m_windows.resize(std::max(m_config.windowCount, 1u));
+  for (uint32_t i = 0; i < m_windows.size(); ++i)
+  {
+    m_windows[i].index = i;
+  }
+  if (!m_config.headless())
+  {
+    createWindows();
+  }
 
   if (ENABLE_VALIDATION_LAYERS && !checkValidationLayerSupport())
   {
@@ -197,7 +418,7 @@ Application::createInstance()
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName        = "No Engine";
   appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion         = VK_API_VERSION_1_0;
+  appInfo.apiVersion         = VK_API_VERSION_1_1;    // vkGetPhysicalDeviceFeatures2
 
   VkInstanceCreateInfo createInfo    = {};
   createInfo.sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -212,7 +433,7 @@ Application::createInstance()
     createInfo.enabledLayerCount   = static_cast<uint32_t>(VALIDATION_LAYERS.size());
     createInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
 
-    populateDebugMessengerCreateInfo(debugCreateInfo);
+    populateDebugMessengerCreateInfo(debugCreateInfo, m_logger);
     createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
   }
 
@@ -255,11 +476,14 @@ Application::checkValidationLayerSupport()
 std::vector<const char*>
 Application::getRequiredExtensions()
 {
-  uint32_t glfwExtensionCount = 0;
-  const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char*> extensions(
-    glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char*> extensions;
+  if (!m_config.headless())
+  {
+    uint32_t glfwExtensionCount = 0;
+    const char** glfwExtensions =
+      glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
   if (ENABLE_VALIDATION_LAYERS)
   {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -272,8 +496,12 @@ QueueFamilyIndices
 Application::findQueueFamilies(const VkPhysicalDevice& device)
 {
   assert(device != VK_NULL_HANDLE);
-  assert(m_surface != VK_NULL_HANDLE);
+  assert(
+    m_config.headless()
+    || (!m_windows.empty() && m_windows[0].surface != VK_NULL_HANDLE));
 
+  // Picked for the first window; createSwapChain() checks the others can use it.
+  // Replay presents nothing, the graphics family stands in
   QueueFamilyIndices indices;
 
   uint32_t queueFamilyCount = 0;
@@ -287,7 +515,11 @@ Application::findQueueFamilies(const VkPhysicalDevice& device)
   for (const auto& queueFamily : queueFamilies)
   {
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+    if (!m_config.headless())
+    {
+      vkGetPhysicalDeviceSurfaceSupportKHR(
+        device, i, m_windows[0].surface, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport)
     {
       indices.presentFamily = i;
@@ -296,6 +528,10 @@ Application::findQueueFamilies(const VkPhysicalDevice& device)
     if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
     {
       indices.graphicsFamily = i;
+      if (m_config.headless())
+      {
+        indices.presentFamily = i;
+      }
     }
 
     if (indices.isComplete())
@@ -310,14 +546,18 @@ Application::findQueueFamilies(const VkPhysicalDevice& device)
 
 //----------------------------------------------------------------------------------------
 void
-Application::createSurface()
+Application::createSurfaces()
 {
   assert(m_instance != VK_NULL_HANDLE);
-  assert(m_window != nullptr);
 
-  if (glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
+  for (AppWindow& window : m_windows)
   {
-    throw std::runtime_error("failed to create window surface!");
+    if (
+      glfwCreateWindowSurface(m_instance, window.window, nullptr, &window.surface)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create window surface!");
+    }
   }
 }
 
@@ -338,21 +578,83 @@ Application::pickPhysicalDevice()
   std::vector<VkPhysicalDevice> devices(deviceCount);
   vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
 
-  std::multimap<int, VkPhysicalDevice> devicesByScore;
-  for (const auto& device : devices)
+  // Pinned: that device or nothing, the rating is only a guess at which is fastest
+  if (!m_config.device.empty())
+  {
+    for (uint32_t i = 0; i < deviceCount && m_physicalDevice == VK_NULL_HANDLE; ++i)
+    {
+      const PhysicalDeviceInfo info = describePhysicalDevice(devices[i], i);
+      if (matchesDevice(m_config.device, info))
+      {
+        if (rateDeviceSuitability(devices[i]) == 0)
+        {
+          throw std::runtime_error(
+            fmt::format("device {} ({}) is not suitable", info.index, info.name));
+        }
+        m_physicalDevice   = devices[i];
+        m_benchmark.device = info;
+      }
+    }
+    if (m_physicalDevice == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error(fmt::format("no device matches {}", m_config.device));
+    }
+  }
+  else
   {
-    int score = rateDeviceSuitability(device);
-    devicesByScore.insert(std::make_pair(score, device));
+    std::multimap<int, uint32_t> devicesByScore;
+    for (uint32_t i = 0; i < deviceCount; ++i)
+    {
+      int score = rateDeviceSuitability(devices[i]);
+      devicesByScore.insert(std::make_pair(score, i));
+    }
+
+    if (!devicesByScore.empty() && devicesByScore.rbegin()->first > 0)
+    {
+      const uint32_t index = devicesByScore.rbegin()->second;
+      m_physicalDevice     = devices[index];
+      m_benchmark.device   = describePhysicalDevice(devices[index], index);
+    }
+    else
+    {
+      throw std::runtime_error("failed to find a suitable GPU!");
+    }
   }
 
-  if (!devicesByScore.empty() && devicesByScore.rbegin()->first > 0)
+  const PhysicalDeviceInfo& info = m_benchmark.device;
+  fmt::print("device {}: {} ({}, {})\n", info.index, info.name, info.type, info.uuid);
+}
+
+//----------------------------------------------------------------------------------------
+std::vector<PhysicalDeviceInfo>
+Application::listPhysicalDevices()
+{
+  VkApplicationInfo appInfo = {};
+  appInfo.sType             = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  appInfo.apiVersion        = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo createInfo = {};
+  createInfo.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  createInfo.pApplicationInfo     = &appInfo;
+
+  VkInstance instance = VK_NULL_HANDLE;
+  if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
   {
-    m_physicalDevice = devicesByScore.rbegin()->second;
+    throw std::runtime_error("Couldn't create VkInstance!");
   }
-  else
+
+  uint32_t deviceCount = 0;
+  vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+  std::vector<VkPhysicalDevice> devices(deviceCount);
+  vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+  std::vector<PhysicalDeviceInfo> infos;
+  for (uint32_t i = 0; i < deviceCount; ++i)
   {
-    throw std::runtime_error("failed to find a suitable GPU!");
+    infos.push_back(describePhysicalDevice(devices[i], i));
   }
+  vkDestroyInstance(instance, nullptr);
+  return infos;
 }
 
 //----------------------------------------------------------------------------------------
@@ -373,14 +675,18 @@ Application::rateDeviceSuitability(const VkPhysicalDevice& device)
   {
     return 0;
   }
-  if (!checkDeviceExtensionSupport(device))
-  {
-    return 0;
-  }
-  SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-  if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
+  if (!m_config.headless())
   {
-    return 0;
+    if (!checkDeviceExtensionSupport(device))
+    {
+      return 0;
+    }
+    SwapChainSupportDetails swapChainSupport =
+      querySwapChainSupport(device, m_windows[0].surface);
+    if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
+    {
+      return 0;
+    }
   }
 
   // Optional features weighted by value
@@ -446,20 +752,99 @@ Application::createLogicalDevice()
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures = {};
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
+  // Optional texture features; TextureManager checks what ended up enabled
+  m_enabledFeatures                      = {};
+  m_enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  m_enabledFeatures.textureCompressionASTC_LDR =
+    supportedFeatures.textureCompressionASTC_LDR;
+  m_enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
+  std::vector<const char*> extensions;
+  if (!m_config.headless())
+  {
+    extensions = DEVICE_EXTENSIONS;    // replay has no swap chains
+  }
+
+  if (m_config.gpuDriven)
+  {
+    // Each indirect draw passes its object index through firstInstance
+    if (!supportedFeatures.drawIndirectFirstInstance)
+    {
+      throw std::runtime_error("GPU driven mode requires drawIndirectFirstInstance!");
+    }
+    m_enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+    m_enabledFeatures.multiDrawIndirect         = supportedFeatures.multiDrawIndirect;
+    m_multiDrawIndirectSupported                = supportedFeatures.multiDrawIndirect;
+
+    // Counts the scene pass's fragments, see printSceneSummary(). The query is active
+    // while the cached secondaries execute, so they must inherit it
+    m_pipelineStatisticsSupported =
+      supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+    m_enabledFeatures.pipelineStatisticsQuery = m_pipelineStatisticsSupported;
+    m_enabledFeatures.inheritedQueries        = m_pipelineStatisticsSupported;
+
+    m_drawIndirectCountSupported = isDeviceExtensionSupported(
+      m_physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (m_drawIndirectCountSupported)
+    {
+      extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+  }
+
+  // Driver reported budgets; without it MemoryTelemetry counts our own allocations
+  m_memoryBudgetSupported = MemoryTelemetry::isBudgetSupported(m_physicalDevice);
+  if (m_memoryBudgetSupported)
+  {
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+  if (m_config.bindless)
+  {
+    if (!BindlessDescriptors::isSupported(
+          m_physicalDevice, m_enabledFeatures, descriptorIndexingFeatures))
+    {
+      throw std::runtime_error("bindless mode requires VK_EXT_descriptor_indexing!");
+    }
+    extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+  }
+
+  // Graphics pipeline libraries: pipelines are compiled in parts and linked
+  VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures = {};
+  m_pipelineLibrarySupported =
+    m_config.pipelineLibrary
+    && PipelineLibrary::isSupported(m_physicalDevice, libraryFeatures);
+  if (m_pipelineLibrarySupported)
+  {
+    extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+  }
 
   VkDeviceCreateInfo createInfo      = {};
   createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos       = queueCreateInfos.data();
-  createInfo.pEnabledFeatures        = &deviceFeatures;
-  createInfo.enabledExtensionCount   = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-  createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+  createInfo.pEnabledFeatures        = &m_enabledFeatures;
+  createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
   if (ENABLE_VALIDATION_LAYERS)
   {
     createInfo.enabledLayerCount   = static_cast<uint32_t>(VALIDATION_LAYERS.size());
     createInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
   }
+  if (m_config.bindless)
+  {
+    createInfo.pNext = &descriptorIndexingFeatures;
+  }
+  if (m_pipelineLibrarySupported)
+  {
+    libraryFeatures.pNext = const_cast<void*>(createInfo.pNext);
+    createInfo.pNext      = &libraryFeatures;
+  }
 
   if (vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS)
   {
@@ -470,17 +855,84 @@ Application::createLogicalDevice()
   vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
 }
 
+//----------------------------------------------------------------------------------------
+// Frames are measured with timestamps around each command buffer on the graphics queue,
+// for dynamic resolution, to compare the post-processing modes and for the overlay. The
+// GPU driven scene's passes are timed too, to compare occlusion culling on and off
+void
+Application::initFrameTimestamps()
+{
+  const bool dynamicResolution = m_config.targetFrameTime > 0.0f;
+  const bool hud               = m_config.hud && !m_config.headless();
+  if (
+    !dynamicResolution && m_config.postProcess == PostProcessMode::Off && !hud
+    && !m_config.gpuDriven)
+  {
+    return;
+  }
+
+  QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
+  uint32_t queueFamilyCount  = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+    m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+  const uint32_t validBits =
+    queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+  if (validBits == 0)
+  {
+    fmt::print(
+      "WARNING: no timestamps on the graphics queue, {} off\n",
+      dynamicResolution ? "dynamic resolution" : "GPU frame timing");
+    return;
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+  m_timestampPeriod = properties.limits.timestampPeriod;
+  m_timestampMask   = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  if (dynamicResolution)
+  {
+    m_dynamicResolution.init(
+      m_config.targetFrameTime,
+      m_config.minResolutionScale,
+      m_config.maxResolutionScale,
+      MAX_FRAMES_IN_FLIGHT);
+  }
+}
+
 //----------------------------------------------------------------------------------------
 void
-Application::createSwapChain()
+Application::createSwapChain(AppWindow& window)
 {
   assert(m_physicalDevice != VK_NULL_HANDLE);
-  assert(m_surface != VK_NULL_HANDLE);
+  if (m_config.headless())
+  {
+    createReplayImages(window);
+    return;
+  }
+  assert(window.surface != VK_NULL_HANDLE);
 
-  SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
+  // One present queue serves every window
+  QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
+  VkBool32 presentSupport    = false;
+  vkGetPhysicalDeviceSurfaceSupportKHR(
+    m_physicalDevice, indices.presentFamily.value(), window.surface, &presentSupport);
+  if (!presentSupport)
+  {
+    throw std::runtime_error(
+      fmt::format("window {} can't present from the device's queue!", window.index));
+  }
+
+  SwapChainSupportDetails swapChainSupport =
+    querySwapChainSupport(m_physicalDevice, window.surface);
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
   VkPresentModeKHR presentMode     = chooseSwapPresentMode(swapChainSupport.presentModes);
-  VkExtent2D extent                = chooseSwapExtent(swapChainSupport.capabilities);
+  VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, window);
+  m_benchmark.vsync = presentMode == VK_PRESENT_MODE_FIFO_KHR;
+  m_presentMode     = presentMode;
 
   uint32_t imageCount = std::min(
     swapChainSupport.capabilities.minImageCount + 1,
@@ -488,7 +940,7 @@ Application::createSwapChain()
 
   VkSwapchainCreateInfoKHR createInfo = {};
   createInfo.sType                    = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-  createInfo.surface                  = m_surface;
+  createInfo.surface                  = window.surface;
   createInfo.minImageCount            = imageCount;
   createInfo.imageFormat              = surfaceFormat.format;
   createInfo.imageColorSpace          = surfaceFormat.colorSpace;
@@ -496,8 +948,26 @@ Application::createSwapChain()
   createInfo.imageArrayLayers         = 1;
   createInfo.imageUsage               = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+  // Dynamic resolution upscales the scene into the swap chain image with a linear blit
+  if (m_dynamicResolution.enabled())
+  {
+    const VkFormatFeatureFlags required =
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+      | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(
+      m_physicalDevice, surfaceFormat.format, &properties);
+    if (
+      (properties.optimalTilingFeatures & required) != required
+      || !(swapChainSupport.capabilities.supportedUsageFlags
+           & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+    {
+      throw std::runtime_error("dynamic resolution needs blits to the swap chain!");
+    }
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
   // QueueFamily sharing
-  QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
   // NB. must remain in scope of createInfo
   uint32_t queueFamilyIndices[]
     = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -518,53 +988,126 @@ Application::createSwapChain()
   createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   createInfo.presentMode    = presentMode;
   createInfo.clipped        = VK_TRUE;
-  createInfo.oldSwapchain   = VK_NULL_HANDLE;
+  createInfo.oldSwapchain   = window.swapChain;    // lets in flight presents finish
 
-  if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS)
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+  if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
   {
     throw std::runtime_error("failed to create swap chain!");
   }
+  if (window.swapChain != VK_NULL_HANDLE)
+  {
+    m_deletionQueue.push([device = m_device, oldSwapChain = window.swapChain]() {
+      vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+    });
+  }
+  window.swapChain = swapChain;
 
   // Get Images: (find actual imageCount of created swap chain)
-  vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-  m_swapChainImages.resize(imageCount);
-  vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, m_swapChainImages.data());
+  vkGetSwapchainImagesKHR(m_device, window.swapChain, &imageCount, nullptr);
+  window.images.resize(imageCount);
+  vkGetSwapchainImagesKHR(m_device, window.swapChain, &imageCount, window.images.data());
+  window.imagesInFlight.assign(imageCount, VK_NULL_HANDLE);
 
   m_swapChainImageFormat = surfaceFormat.format;
-  m_swapChainExtent      = extent;
+  window.extent          = extent;
+
+  if (m_captureWriter.isOpen())
+  {
+    CapturedResize resize = {};
+    resize.window         = window.index;
+    resize.width          = extent.width;
+    resize.height         = extent.height;
+    resize.imageCount     = imageCount;
+    m_captureWriter.writeResize(resize);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Replay draws into images standing in for the captured swap chain: its size (set from
+// the capture) and image count, in the format a swap chain would most likely have had.
+// Nothing presents or reads them.
+void
+Application::createReplayImages(AppWindow& window)
+{
+  m_swapChainImageFormat = REPLAY_IMAGE_FORMAT;
+
+  VkImageCreateInfo imageInfo = {};
+  imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+  imageInfo.format            = REPLAY_IMAGE_FORMAT;
+  imageInfo.extent            = {window.extent.width, window.extent.height, 1};
+  imageInfo.mipLevels         = 1;
+  imageInfo.arrayLayers       = 1;
+  imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage             = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+  if (m_dynamicResolution.enabled())
+  {
+    imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;    // the upscale blit
+  }
+
+  window.images.resize(window.replayImageCount);
+  window.imageMemory.resize(window.replayImageCount);
+  for (uint32_t i = 0; i < window.replayImageCount; ++i)
+  {
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &window.images[i]) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create replay image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device, window.images[i], &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memRequirements.size;
+    allocInfo.memoryTypeIndex      = findMemoryType(
+      m_physicalDevice,
+      memRequirements.memoryTypeBits,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (
+      allocateDeviceMemory(m_device, allocInfo, window.imageMemory[i]) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to allocate replay image memory!");
+    }
+    vkBindImageMemory(m_device, window.images[i], window.imageMemory[i], 0);
+  }
+  window.imagesInFlight.assign(window.replayImageCount, VK_NULL_HANDLE);
 }
 
 //----------------------------------------------------------------------------------------
 SwapChainSupportDetails
-Application::querySwapChainSupport(VkPhysicalDevice device)
+Application::querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
   assert(device != VK_NULL_HANDLE);
-  assert(m_surface != VK_NULL_HANDLE);
+  assert(surface != VK_NULL_HANDLE);
 
   SwapChainSupportDetails details;
 
   // Surface Caps
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, m_surface, &details.capabilities);
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
 
   // Surface Formats
   uint32_t formatCount;
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
   if (formatCount != 0)
   {
     details.formats.resize(formatCount);
     vkGetPhysicalDeviceSurfaceFormatsKHR(
-      device, m_surface, &formatCount, details.formats.data());
+      device, surface, &formatCount, details.formats.data());
   }
 
   // Presentation Modes
   uint32_t presentModeCount;
-  vkGetPhysicalDeviceSurfacePresentModesKHR(
-    device, m_surface, &presentModeCount, nullptr);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
   if (presentModeCount != 0)
   {
     details.presentModes.resize(presentModeCount);
     vkGetPhysicalDeviceSurfacePresentModesKHR(
-      device, m_surface, &presentModeCount, details.presentModes.data());
+      device, surface, &presentModeCount, details.presentModes.data());
   }
 
   return details;
@@ -575,6 +1118,19 @@ VkSurfaceFormatKHR
 Application::chooseSwapSurfaceFormat(
   const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
+  // Windows share the render pass and pipelines, so later ones take the first's format
+  if (m_swapChainImageFormat != VK_FORMAT_UNDEFINED)
+  {
+    for (const auto& availableFormat : availableFormats)
+    {
+      if (availableFormat.format == m_swapChainImageFormat)
+      {
+        return availableFormat;
+      }
+    }
+    throw std::runtime_error("windows need a common swap chain format!");
+  }
+
   for (const auto& availableFormat : availableFormats)
   {
     if (
@@ -617,7 +1173,9 @@ Application::chooseSwapPresentMode(
 
 //----------------------------------------------------------------------------------------
 VkExtent2D
-Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
+Application::chooseSwapExtent(
+  const VkSurfaceCapabilitiesKHR& capabilities,
+  const AppWindow& window) const
 {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
   {
@@ -625,10 +1183,7 @@ Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
   }
   else
   {
-    int width, height;
-    glfwGetFramebufferSize(m_window, &width, &height);
-    VkExtent2D actualExtent
-      = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    VkExtent2D actualExtent = framebufferSize(window);
 
     actualExtent.width = std::max(
       capabilities.minImageExtent.width,
@@ -643,14 +1198,14 @@ Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 
 //----------------------------------------------------------------------------------------
 void
-Application::createImageViews()
+Application::createImageViews(AppWindow& window)
 {
-  m_swapChainImageViews.resize(m_swapChainImages.size());
-  for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+  window.imageViews.resize(window.images.size());
+  for (size_t i = 0; i < window.images.size(); ++i)
   {
     VkImageViewCreateInfo createInfo = {};
     createInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image                 = m_swapChainImages[i];
+    createInfo.image                 = window.images[i];
     createInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
     createInfo.format                = m_swapChainImageFormat;
 
@@ -666,7 +1221,7 @@ Application::createImageViews()
     createInfo.subresourceRange.layerCount     = 1;
 
     if (
-      vkCreateImageView(m_device, &createInfo, nullptr, &m_swapChainImageViews[i])
+      vkCreateImageView(m_device, &createInfo, nullptr, &window.imageViews[i])
       != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create image views!");
@@ -678,177 +1233,92 @@ Application::createImageViews()
 void
 Application::createRenderPass()
 {
+  // The GPU driven objects are depth tested, against a render graph image that the
+  // pass clears and drops
+  if (m_config.gpuDriven)
+  {
+    m_sceneDepthFormat = findDepthFormat(m_physicalDevice);
+  }
+
+  if (m_config.postProcess == PostProcessMode::Subpasses)
+  {
+    m_renderPass = PostProcess::createSubpassRenderPass(
+      m_device, m_swapChainImageFormat, m_sceneDepthFormat);
+    return;
+  }
+
+  // Post-processing passes: the scene is drawn in HDR for the tonemap to sample
+  const bool hdr = m_config.postProcess == PostProcessMode::Passes;
+
   VkAttachmentDescription colorAttachment = {};
-  colorAttachment.format                  = m_swapChainImageFormat;
+  colorAttachment.format = hdr ? PostProcess::SCENE_FORMAT : m_swapChainImageFormat;
   colorAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
   colorAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  colorAttachment.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout             = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // The render graph transitions the image into and out of the pass, and orders it
+  // after the acquire, so the render pass needs no layout changes or dependencies
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.finalLayout   = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment            = 0;
   colorAttachmentRef.layout                = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+  VkAttachmentDescription attachments[2] = {colorAttachment};
+  uint32_t attachmentCount               = 1;
+
   VkSubpassDescription subpass = {};
   subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments    = &colorAttachmentRef;
 
-  VkSubpassDependency dependency = {};
-  dependency.srcSubpass          = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass          = 0;
-  dependency.srcStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcAccessMask       = 0;
-  dependency.dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstAccessMask
-    = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  VkAttachmentReference depthAttachmentRef = {};
+  if (m_sceneDepthFormat != VK_FORMAT_UNDEFINED)
+  {
+    VkAttachmentDescription& depthAttachment = attachments[attachmentCount];
+    depthAttachment.format                   = m_sceneDepthFormat;
+    depthAttachment.samples                  = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp                   = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp                  = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp            = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp           = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout   = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    depthAttachmentRef.attachment   = attachmentCount++;
+    depthAttachmentRef.layout       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+  }
 
   VkRenderPassCreateInfo renderPassInfo = {};
   renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-  renderPassInfo.attachmentCount        = 1;
-  renderPassInfo.pAttachments           = &colorAttachment;
+  renderPassInfo.attachmentCount        = attachmentCount;
+  renderPassInfo.pAttachments           = attachments;
   renderPassInfo.subpassCount           = 1;
   renderPassInfo.pSubpasses             = &subpass;
-  renderPassInfo.dependencyCount        = 1;
-  renderPassInfo.pDependencies          = &dependency;
   if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
   {
     throw std::runtime_error("failed to create render pass!");
   }
 }
 
-//----------------------------------------------------------------------------------------
-VkShaderModule
-Application::createShaderModule(const std::vector<char>& code)
-{
-  VkShaderModuleCreateInfo createInfo = {};
-  createInfo.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  createInfo.codeSize                 = code.size();
-  createInfo.pCode                    = reinterpret_cast<const uint32_t*>(code.data());
-
-  VkShaderModule shaderModule;
-  if (vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-  {
-    throw std::runtime_error("failed to create shader module!");
-  }
-  return shaderModule;
-}
-
 //----------------------------------------------------------------------------------------
 void
 Application::createGraphicsPipeline()
 {
-  auto vertShaderCode = readFile("shaders/vert.spv");
-  auto fragShaderCode = readFile("shaders/frag.spv");
-
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-  VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-  VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-  vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = vertShaderModule;
-  vertShaderStageInfo.pName  = "main";
-
-  VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-  fragShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  fragShaderStageInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragShaderStageInfo.module = fragShaderModule;
-  fragShaderStageInfo.pName  = "main";
-
-  VkPipelineShaderStageCreateInfo shaderStages[]
-    = {vertShaderStageInfo, fragShaderStageInfo};
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.vertexBindingDescriptionCount   = 0;
-  vertexInputInfo.pVertexBindingDescriptions      = nullptr;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
-  vertexInputInfo.pVertexAttributeDescriptions    = nullptr;
-
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-  VkViewport viewport = {};
-  viewport.x          = 0.0f;
-  viewport.y          = 0.0f;
-  viewport.width      = static_cast<float>(m_swapChainExtent.width);
-  viewport.height     = static_cast<float>(m_swapChainExtent.height);
-  viewport.minDepth   = 0.0f;
-  viewport.maxDepth   = 1.0f;
-
-  VkRect2D scissor = {};
-  scissor.offset   = {0, 0};
-  scissor.extent   = m_swapChainExtent;
-
-  VkPipelineViewportStateCreateInfo viewportState = {};
-  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.pViewports    = &viewport;
-  viewportState.scissorCount  = 1;
-  viewportState.pScissors     = &scissor;
-
-  VkPipelineRasterizationStateCreateInfo rasterizer = {};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.depthClampEnable        = VK_FALSE;
-  rasterizer.rasterizerDiscardEnable = VK_FALSE;
-  rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth               = 1.0f;
-  rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
-  rasterizer.depthBiasEnable         = VK_FALSE;
-  rasterizer.depthBiasConstantFactor = 0.0f;
-  rasterizer.depthBiasClamp          = 0.0f;
-  rasterizer.depthBiasSlopeFactor    = 0.0f;
-
-  VkPipelineMultisampleStateCreateInfo multisampling = {};
-  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.sampleShadingEnable   = VK_FALSE;
-  multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
-  multisampling.minSampleShading      = 1.0f;
-  multisampling.pSampleMask           = nullptr;
-  multisampling.alphaToCoverageEnable = VK_FALSE;
-  multisampling.alphaToOneEnable      = VK_FALSE;
-
-  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-  colorBlendAttachment.colorWriteMask
-    = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
-      | VK_COLOR_COMPONENT_A_BIT;
-  colorBlendAttachment.blendEnable         = VK_FALSE;
-  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-  colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
-  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-  colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
-
-  VkPipelineColorBlendStateCreateInfo colorBlending = {};
-  colorBlending.sType         = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.logicOpEnable = VK_FALSE;
-  colorBlending.logicOp       = VK_LOGIC_OP_COPY;
-  colorBlending.attachmentCount   = 1;
-  colorBlending.pAttachments      = &colorBlendAttachment;
-  colorBlending.blendConstants[0] = 0.0f;
-  colorBlending.blendConstants[1] = 0.0f;
-  colorBlending.blendConstants[2] = 0.0f;
-  colorBlending.blendConstants[3] = 0.0f;
-
-  VkDynamicState dynamicStates[]
-    = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
-  VkPipelineDynamicStateCreateInfo dynamicState = {};
-  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates    = dynamicStates;
-
   VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
   pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 0;
   pipelineLayoutInfo.pSetLayouts    = nullptr;
+  VkDescriptorSetLayout bindlessLayout = m_bindless.layout();
+  if (m_config.bindless)
+  {
+    // Draws find their resources by index in the global set, bound once per frame
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts    = &bindlessLayout;
+  }
   pipelineLayoutInfo.pushConstantRangeCount = 0;
   pipelineLayoutInfo.pPushConstantRanges    = nullptr;
   if (
@@ -858,65 +1328,594 @@ Application::createGraphicsPipeline()
     throw std::runtime_error("failed to create pipeline layout!");
   }
 
-  VkGraphicsPipelineCreateInfo pipelineInfo = {};
-  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount          = 2;
-  pipelineInfo.pStages             = shaderStages;
-  pipelineInfo.pVertexInputState   = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState      = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState   = &multisampling;
-  pipelineInfo.pDepthStencilState  = nullptr;
-  pipelineInfo.pColorBlendState    = &colorBlending;
-  pipelineInfo.pDynamicState       = nullptr;
-  pipelineInfo.layout              = m_pipelineLayout;
-  pipelineInfo.renderPass          = m_renderPass;
-  pipelineInfo.subpass             = 0;
-  pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
-  pipelineInfo.basePipelineIndex   = -1;
-
-  VkPipeline graphicsPipeline;
-  if (
-    vkCreateGraphicsPipelines(
-      m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline)
-    != VK_SUCCESS)
+  // No vertex buffers, the triangle's vertices are in the shader
+  GraphicsPipelineDesc desc = {};
+  desc.topology             = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  desc.vertexShader         = "shaders/shader_vert.spv";
+  desc.polygonMode          = VK_POLYGON_MODE_FILL;
+  desc.cullMode             = VK_CULL_MODE_BACK_BIT;
+  desc.frontFace            = VK_FRONT_FACE_CLOCKWISE;
+  desc.fragmentShader       = "shaders/shader_frag.spv";
+  desc.blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                              | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  desc.blend.blendEnable    = VK_FALSE;
+  desc.layout               = m_pipelineLayout;
+  desc.renderPass           = m_renderPass;
+  desc.subpass              = 0;
+
+  // The parts are compiled up front, in parallel; the pipeline is fast linked from them
+  // and swapped for an optimised link once the background thread has one
+  m_pipelineLibrary.compile({desc});
+  m_scenePipeline = m_pipelineLibrary.create(desc);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::createFramebuffers(AppWindow& window)
+{
+  // Post-processing subpasses: the transient attachments, then the swap chain image.
+  // Passes: the swap chain image is written by the last effect's render pass
+  std::vector<VkImageView> attachments;
+  VkRenderPass renderPass = m_renderPass;
+  if (m_postProcess.mode() == PostProcessMode::Subpasses)
+  {
+    m_postProcess.createAttachments(window.post, window.extent);
+    attachments = window.post.imageViews;
+  }
+  else if (m_postProcess.mode() == PostProcessMode::Passes)
+  {
+    renderPass = m_postProcess.effectRenderPass();
+  }
+  // The GPU driven scene's also have the render graph's depth image, so
+  // createRenderGraph() makes them (window.sceneFramebuffers)
+  if (m_config.gpuDriven && !sceneOffscreen())
   {
-    throw std::runtime_error("failed to create graphics pipeline!");
+    return;
+  }
+
+  window.framebuffers.resize(window.imageViews.size());
+  attachments.push_back(VK_NULL_HANDLE);
+  for (size_t i = 0; i < window.imageViews.size(); i++)
+  {
+    attachments.back() = window.imageViews[i];
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass              = renderPass;
+    framebufferInfo.attachmentCount         = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments            = attachments.data();
+    framebufferInfo.width                   = window.extent.width;
+    framebufferInfo.height                  = window.extent.height;
+    framebufferInfo.layers                  = 1;
+
+    if (
+      vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &window.framebuffers[i])
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
   }
+}
 
-  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
-  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+//----------------------------------------------------------------------------------------
+// Frame resources of the GPU driven renderer are indexed by image over all windows
+void
+Application::createGpuDrivenFrames()
+{
+  std::vector<uint32_t> viewFrameCounts;
+  uint32_t frameCount = 0;
+  for (AppWindow& window : m_windows)
+  {
+    window.firstFrameResource = frameCount;
+    viewFrameCounts.push_back(static_cast<uint32_t>(window.images.size()));
+    frameCount += viewFrameCounts.back();
+  }
+  m_gpuDrivenRenderer.createSwapChainResources(m_renderPass, viewFrameCounts);
 }
 
 //----------------------------------------------------------------------------------------
 void
-Application::createFramebuffers()
+Application::createRenderGraph(AppWindow& window)
 {
-  m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
+  RenderGraph& graph = window.renderGraph;
+
+  RenderImageDesc backbufferDesc = {};
+  backbufferDesc.format          = m_swapChainImageFormat;
+  backbufferDesc.extent          = window.extent;
+  backbufferDesc.usage           = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (m_dynamicResolution.enabled())
+  {
+    backbufferDesc.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
+  // A replay image is left as drawn, there is no present to hand it to
+  window.backbuffer = graph.importImage(
+    "backbuffer",
+    backbufferDesc,
+    ACCESS_ACQUIRED_IMAGE,
+    m_config.headless() ? ACCESS_COLOR_ATTACHMENT : ACCESS_PRESENT);
+  graph.markOutput(window.backbuffer);
+
+  // Passes are handed the window's image index; the window is looked up again as
+  // m_windows never moves
+  const uint32_t windowIndex = window.index;
+
+  // GPU culling writes each image's indirect draws (and draw counts), which the
+  // previous submission of the same command buffer may still be reading
+  RenderResource drawCommands = INVALID_RENDER_RESOURCE;
+  if (m_config.gpuDriven)
+  {
+    drawCommands = graph.importBuffer("draw commands", ACCESS_INDIRECT_READ);
+
+    RenderPassHandle cull = graph.addPass(
+      "cull", [this, windowIndex](VkCommandBuffer commandBuffer, size_t imageIndex) {
+        m_gpuDrivenRenderer.recordCulling(
+          commandBuffer, m_windows[windowIndex].firstFrameResource + imageIndex);
+      });
+    ResourceAccess cullWrite = {};
+    cullWrite.stages
+      = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    cullWrite.access = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT
+                       | VK_ACCESS_SHADER_WRITE_BIT;
+    graph.write(cull, drawCommands, cullWrite);
+  }
+
+  // Occlusion culling: the cull reads the visibility the last frame's occlusion pass
+  // copied out, then this frame's pass tests every object's box against the depth of
+  // the objects the cull kept
+  RenderResource occlusionDepth = INVALID_RENDER_RESOURCE;
+  if (m_config.gpuDriven && m_gpuDrivenRenderer.occlusionCulling())
+  {
+    RenderImageDesc depthDesc = {};
+    depthDesc.format          = m_gpuDrivenRenderer.occlusionDepthFormat();
+    depthDesc.extent          = window.extent;
+    depthDesc.usage           = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depthDesc.aspect          = VK_IMAGE_ASPECT_DEPTH_BIT;
+    occlusionDepth            = graph.createImage("occlusion depth", depthDesc);
+
+    RenderResource visibility =
+      graph.importBuffer("occlusion results", ACCESS_TRANSFER_WRITE);
+    graph.read(cull, visibility, ACCESS_COMPUTE_READ);
+
+    RenderPassHandle occlusion = graph.addPass(
+      "occlusion", [this, windowIndex](VkCommandBuffer commandBuffer, size_t imageIndex) {
+        const AppWindow& target  = m_windows[windowIndex];
+        const uint32_t timestamp = sceneTimestamp(target, imageIndex) + 2;
+        if (target.timestampPool != VK_NULL_HANDLE)
+        {
+          vkCmdWriteTimestamp(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            target.timestampPool,
+            timestamp);
+        }
+        m_gpuDrivenRenderer.recordOcclusion(
+          commandBuffer,
+          target.firstFrameResource + imageIndex,
+          target.occlusionFramebuffer,
+          target.extent);
+        if (target.timestampPool != VK_NULL_HANDLE)
+        {
+          vkCmdWriteTimestamp(
+            commandBuffer,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            target.timestampPool,
+            timestamp + 1);
+        }
+      });
+    graph.read(occlusion, drawCommands, ACCESS_INDIRECT_READ);
+    graph.write(occlusion, occlusionDepth, ACCESS_DEPTH_ATTACHMENT);
+    graph.write(occlusion, visibility, ACCESS_TRANSFER_WRITE);
+    graph.setSideEffects(occlusion);
+  }
+
+  // One buffer is the particles' storage buffer and their vertex buffer. The first
+  // window steps the simulation, after every window's draws of the last frame; the
+  // other windows are submitted after it and only draw (the particles hold still
+  // while the first window is minimised)
+  RenderResource particles = INVALID_RENDER_RESOURCE;
+  if (m_particles.enabled())
+  {
+    const bool simulate = window.index == 0;
+    particles           = graph.importBuffer(
+      "particles", simulate ? ACCESS_VERTEX_ATTRIBUTE_READ : ACCESS_COMPUTE_WRITE);
+    if (simulate)
+    {
+      RenderPassHandle simulation = graph.addPass(
+        "simulate particles", [this](VkCommandBuffer commandBuffer, size_t) {
+          m_particles.recordSimulation(commandBuffer);
+        });
+      graph.write(simulation, particles, ACCESS_COMPUTE_WRITE);
+    }
+  }
+
+  // With dynamic resolution the scene goes to an offscreen image big enough for the
+  // largest scale, of which it uses the top left corner, and is then upscaled into the
+  // swap chain image. The scale is read when the command buffers are recorded.
+  // Post-processing passes also draw the scene offscreen, in HDR, for the tonemap to
+  // sample (dynamic resolution is off, the scale stays 1)
+  const bool postPasses     = m_postProcess.mode() == PostProcessMode::Passes;
+  const bool offscreen      = sceneOffscreen();
+  RenderResource sceneColor = window.backbuffer;
+  if (offscreen)
+  {
+    RenderImageDesc sceneDesc = {};
+    sceneDesc.format          = m_swapChainImageFormat;
+    sceneDesc.extent          = sceneExtent(window, m_dynamicResolution.maxScale());
+    sceneDesc.usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (postPasses)
+    {
+      sceneDesc.format = PostProcess::SCENE_FORMAT;
+      sceneDesc.usage  = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+    sceneColor = graph.createImage("scene color", sceneDesc);
+  }
+
+  // The GPU driven objects' depth, as big as the scene target
+  RenderResource sceneDepth = INVALID_RENDER_RESOURCE;
+  if (m_sceneDepthFormat != VK_FORMAT_UNDEFINED)
+  {
+    RenderImageDesc depthDesc = {};
+    depthDesc.format          = m_sceneDepthFormat;
+    depthDesc.extent          = window.extent;
+    depthDesc.usage           = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depthDesc.aspect          = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (offscreen)
+    {
+      depthDesc.extent = sceneExtent(window, m_dynamicResolution.maxScale());
+    }
+    sceneDepth = graph.createImage("scene depth", depthDesc);
+  }
+
+  RenderPassHandle scene = graph.addPass(
+    "scene",
+    [this, windowIndex, offscreen](VkCommandBuffer commandBuffer, size_t imageIndex) {
+      const AppWindow& target = m_windows[windowIndex];
+
+      // Clear values are indexed by attachment; the depth image is the last one
+      std::vector<VkClearValue> clearValues(1);
+      clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+      if (m_sceneDepthFormat != VK_FORMAT_UNDEFINED)
+      {
+        if (m_postProcess.mode() == PostProcessMode::Subpasses)
+        {
+          clearValues.resize(PostProcess::EFFECT_COUNT + 1);
+        }
+        clearValues.push_back({});
+        clearValues.back().depthStencil = {1.0f, 0};
+      }
+
+      VkRenderPassBeginInfo renderPassInfo = {};
+      renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+      renderPassInfo.renderPass            = m_renderPass;
+      renderPassInfo.framebuffer           = target.sceneFramebuffers.empty()
+                                               ? target.framebuffers[imageIndex]
+                                               : target.sceneFramebuffers[imageIndex];
+      renderPassInfo.renderArea.offset     = {0, 0};
+      renderPassInfo.renderArea.extent     = target.extent;
+      renderPassInfo.clearValueCount       = static_cast<uint32_t>(clearValues.size());
+      renderPassInfo.pClearValues          = clearValues.data();
+      if (offscreen)
+      {
+        renderPassInfo.framebuffer = target.sceneFramebuffer;
+        renderPassInfo.renderArea.extent =
+          sceneExtent(target, m_dynamicResolution.scale());
+      }
+
+      // The GPU driven scene is timed and its fragments counted, for
+      // printSceneSummary()
+      const bool measured = m_config.gpuDriven;
+      const auto query    = static_cast<uint32_t>(imageIndex);
+      if (measured && target.timestampPool != VK_NULL_HANDLE)
+      {
+        vkCmdWriteTimestamp(
+          commandBuffer,
+          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+          target.timestampPool,
+          sceneTimestamp(target, imageIndex));
+      }
+      if (measured && target.statisticsPool != VK_NULL_HANDLE)
+      {
+        vkCmdBeginQuery(commandBuffer, target.statisticsPool, query, 0);
+      }
+      vkCmdBeginRenderPass(
+        commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+      // The GPU driven draws differ per image (each has its own frame resources), the
+      // triangle and the particles are one buffer for every image of the same size
+      const VkExtent2D extent = renderPassInfo.renderArea.extent;
+      uint32_t variant        = 0;
+      if (m_config.gpuDriven)
+      {
+        variant = target.firstFrameResource + static_cast<uint32_t>(imageIndex);
+      }
+      VkCommandBuffer contents[2] = {m_commandCache.get(m_sceneBucket, variant, extent)};
+      uint32_t contentCount       = 1;
+      if (m_particles.enabled())
+      {
+        contents[contentCount++] = m_commandCache.get(m_particleBucket, 0, extent);
+      }
+      vkCmdExecuteCommands(commandBuffer, contentCount, contents);
+      if (m_postProcess.mode() == PostProcessMode::Subpasses)
+      {
+        m_postProcess.recordSubpasses(commandBuffer, target.post, extent);
+      }
+
+      vkCmdEndRenderPass(commandBuffer);
+      if (measured && target.statisticsPool != VK_NULL_HANDLE)
+      {
+        vkCmdEndQuery(commandBuffer, target.statisticsPool, query);
+      }
+      if (measured && target.timestampPool != VK_NULL_HANDLE)
+      {
+        vkCmdWriteTimestamp(
+          commandBuffer,
+          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+          target.timestampPool,
+          sceneTimestamp(target, imageIndex) + 1);
+      }
+    });
+  if (drawCommands != INVALID_RENDER_RESOURCE)
+  {
+    graph.read(scene, drawCommands, ACCESS_INDIRECT_READ);
+  }
+  if (particles != INVALID_RENDER_RESOURCE)
+  {
+    graph.read(scene, particles, ACCESS_VERTEX_ATTRIBUTE_READ);
+  }
+  graph.write(scene, sceneColor, ACCESS_COLOR_ATTACHMENT);
+  if (sceneDepth != INVALID_RENDER_RESOURCE)
+  {
+    graph.write(scene, sceneDepth, ACCESS_DEPTH_ATTACHMENT);
+  }
+
+  if (m_dynamicResolution.enabled())
+  {
+    RenderPassHandle upscale = graph.addPass(
+      "upscale",
+      [this, windowIndex, sceneColor](VkCommandBuffer commandBuffer, size_t imageIndex) {
+        const AppWindow& target = m_windows[windowIndex];
+        const VkExtent2D from   = sceneExtent(target, m_dynamicResolution.scale());
+
+        VkImageBlit blit                   = {};
+        blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.layerCount     = 1;
+        blit.srcOffsets[1].x               = static_cast<int32_t>(from.width);
+        blit.srcOffsets[1].y               = static_cast<int32_t>(from.height);
+        blit.srcOffsets[1].z               = 1;
+        blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.layerCount     = 1;
+        blit.dstOffsets[1].x               = static_cast<int32_t>(target.extent.width);
+        blit.dstOffsets[1].y               = static_cast<int32_t>(target.extent.height);
+        blit.dstOffsets[1].z               = 1;
+        vkCmdBlitImage(
+          commandBuffer,
+          target.renderGraph.image(sceneColor),
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          target.images[imageIndex],
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          1,
+          &blit,
+          VK_FILTER_LINEAR);
+      });
+    graph.read(upscale, sceneColor, ACCESS_TRANSFER_READ);
+    graph.write(upscale, window.backbuffer, ACCESS_TRANSFER_WRITE);
+  }
+
+  // Post-processing passes: every effect samples the previous one's result, the last
+  // writes the swap chain image
+  std::vector<RenderResource> postInputs;
+  if (postPasses)
+  {
+    RenderImageDesc resultDesc = {};
+    resultDesc.format          = m_swapChainImageFormat;
+    resultDesc.extent          = window.extent;
+    resultDesc.usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    postInputs.push_back(sceneColor);
+    for (uint32_t effect = 0; effect < PostProcess::EFFECT_COUNT; ++effect)
+    {
+      const bool last       = effect + 1 == PostProcess::EFFECT_COUNT;
+      RenderResource result = window.backbuffer;
+      if (!last)
+      {
+        result = graph.createImage(
+          fmt::format("{} result", PostProcess::effectName(effect)), resultDesc);
+      }
+
+      RenderPassHandle pass = graph.addPass(
+        PostProcess::effectName(effect),
+        [this, windowIndex, effect, last](
+          VkCommandBuffer commandBuffer, size_t imageIndex) {
+          const AppWindow& target = m_windows[windowIndex];
+          m_postProcess.recordPass(
+            commandBuffer,
+            effect,
+            target.post,
+            last ? target.framebuffers[imageIndex] : target.post.framebuffers[effect],
+            target.extent);
+        });
+      graph.read(pass, postInputs.back(), ACCESS_FRAGMENT_SAMPLED);
+      graph.write(pass, result, ACCESS_COLOR_ATTACHMENT);
+      if (!last)
+      {
+        postInputs.push_back(result);
+      }
+    }
+  }
+
+  // The overlay goes over whatever wrote the swap chain image last
+  if (m_hud.enabled())
+  {
+    RenderPassHandle pass = graph.addPass(
+      "hud", [this, windowIndex](VkCommandBuffer commandBuffer, size_t imageIndex) {
+        const AppWindow& target = m_windows[windowIndex];
+        m_hud.record(commandBuffer, target.hud, imageIndex, target.extent);
+      });
+    graph.write(pass, window.backbuffer, ACCESS_COLOR_ATTACHMENT);
+  }
+
+  graph.compile(m_physicalDevice, m_device);
+  if (window.index == 0)
+  {
+    graph.printSummary();    // the same for every window
+  }
 
-  for (size_t i = 0; i < m_swapChainImageViews.size(); i++)
+  if (offscreen)
   {
-    VkImageView attachments[]               = {m_swapChainImageViews[i]};
+    const VkExtent2D extent = sceneExtent(window, m_dynamicResolution.maxScale());
+    std::vector<VkImageView> attachments = {graph.imageView(sceneColor)};
+    if (sceneDepth != INVALID_RENDER_RESOURCE)
+    {
+      attachments.push_back(graph.imageView(sceneDepth));
+    }
+
     VkFramebufferCreateInfo framebufferInfo = {};
     framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
     framebufferInfo.renderPass              = m_renderPass;
-    framebufferInfo.attachmentCount         = 1;
-    framebufferInfo.pAttachments            = attachments;
-    framebufferInfo.width                   = m_swapChainExtent.width;
-    framebufferInfo.height                  = m_swapChainExtent.height;
+    framebufferInfo.attachmentCount         = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments            = attachments.data();
+    framebufferInfo.width                   = extent.width;
+    framebufferInfo.height                  = extent.height;
     framebufferInfo.layers                  = 1;
+    if (
+      vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &window.sceneFramebuffer)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
+  }
+  else if (sceneDepth != INVALID_RENDER_RESOURCE)
+  {
+    // As createFramebuffers() would make them, with the depth image last
+    std::vector<VkImageView> attachments;
+    if (m_postProcess.mode() == PostProcessMode::Subpasses)
+    {
+      attachments = window.post.imageViews;
+    }
+    attachments.push_back(VK_NULL_HANDLE);
+    attachments.push_back(graph.imageView(sceneDepth));
+
+    window.sceneFramebuffers.resize(window.imageViews.size());
+    for (size_t i = 0; i < window.imageViews.size(); i++)
+    {
+      attachments[attachments.size() - 2] = window.imageViews[i];
+
+      VkFramebufferCreateInfo framebufferInfo = {};
+      framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebufferInfo.renderPass              = m_renderPass;
+      framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+      framebufferInfo.pAttachments    = attachments.data();
+      framebufferInfo.width           = window.extent.width;
+      framebufferInfo.height          = window.extent.height;
+      framebufferInfo.layers          = 1;
+      if (
+        vkCreateFramebuffer(
+          m_device, &framebufferInfo, nullptr, &window.sceneFramebuffers[i])
+        != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create framebuffer!");
+      }
+    }
+  }
+
+  if (postPasses)
+  {
+    std::vector<VkImageView> inputs;
+    for (RenderResource input : postInputs)
+    {
+      inputs.push_back(graph.imageView(input));
+    }
+    m_postProcess.createPassTargets(window.post, inputs, window.extent);
+  }
 
+  if (occlusionDepth != INVALID_RENDER_RESOURCE)
+  {
+    VkImageView attachment = graph.imageView(occlusionDepth);
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass              = m_gpuDrivenRenderer.occlusionRenderPass();
+    framebufferInfo.attachmentCount         = 1;
+    framebufferInfo.pAttachments            = &attachment;
+    framebufferInfo.width                   = window.extent.width;
+    framebufferInfo.height                  = window.extent.height;
+    framebufferInfo.layers                  = 1;
     if (
       vkCreateFramebuffer(
-        m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i])
+        m_device, &framebufferInfo, nullptr, &window.occlusionFramebuffer)
       != VK_SUCCESS)
     {
-      throw std::runtime_error("failed to create framebuffer!");
+      throw std::runtime_error("failed to create occlusion framebuffer!");
     }
   }
 }
 
+//----------------------------------------------------------------------------------------
+// Dynamic resolution and post-processing passes draw the scene to a render graph image
+// rather than the swap chain image (see createRenderGraph())
+bool
+Application::sceneOffscreen() const
+{
+  return m_dynamicResolution.enabled() || m_postProcess.mode() == PostProcessMode::Passes;
+}
+
+//----------------------------------------------------------------------------------------
+// The window's extent times scale, at least one pixel
+VkExtent2D
+Application::sceneExtent(const AppWindow& window, float scale) const
+{
+  const auto width  = static_cast<uint32_t>(std::lround(window.extent.width * scale));
+  const auto height = static_cast<uint32_t>(std::lround(window.extent.height * scale));
+  return {std::max(width, 1u), std::max(height, 1u)};
+}
+
+//----------------------------------------------------------------------------------------
+// Everything the scene pass draws, recorded once per variant and extent (see the scene
+// pass in createRenderGraph)
+void
+Application::createCommandBuckets()
+{
+  if (m_config.gpuDriven)
+  {
+    m_sceneBucket = m_commandCache.addBucket(
+      "GPU driven objects",
+      m_renderPass,
+      [this](VkCommandBuffer commandBuffer, uint32_t frameResource, VkExtent2D) {
+        m_gpuDrivenRenderer.recordDraws(commandBuffer, frameResource);
+      });
+  }
+  else
+  {
+    m_sceneBucket = m_commandCache.addBucket(
+      "triangle",
+      m_renderPass,
+      [this](VkCommandBuffer commandBuffer, uint32_t, VkExtent2D) {
+        vkCmdBindPipeline(
+          commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          m_pipelineLibrary.pipeline(m_scenePipeline));
+        if (m_config.bindless)
+        {
+          m_bindless.bind(
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0);
+        }
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+      });
+  }
+  if (m_particles.enabled())
+  {
+    m_particleBucket = m_commandCache.addBucket(
+      "particles",
+      m_renderPass,
+      [this](VkCommandBuffer commandBuffer, uint32_t, VkExtent2D extent) {
+        m_particles.recordDraw(commandBuffer, extent);
+      });
+  }
+}
+
 //----------------------------------------------------------------------------------------
 void
 Application::createCommandPool()
@@ -926,7 +1925,7 @@ Application::createCommandPool()
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   poolInfo.queueFamilyIndex        = queueFamilyIndices.graphicsFamily.value();
-  poolInfo.flags                   = 0;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;    // see drawFrame()
 
   if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
   {
@@ -936,72 +1935,139 @@ Application::createCommandPool()
 
 //----------------------------------------------------------------------------------------
 void
-Application::createCommandBuffers()
+Application::createCommandBuffers(AppWindow& window)
 {
-  m_commandBuffers.resize(m_swapChainFramebuffers.size());
+  window.commandBuffers.resize(window.imageViews.size());
+  if (m_hud.enabled())
+  {
+    m_hud.createTargets(window.hud, window.imageViews, window.extent);
+  }
+
+  const auto bufferCount = static_cast<uint32_t>(window.commandBuffers.size());
 
   VkCommandBufferAllocateInfo allocInfo = {};
   allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.commandPool                 = m_commandPool;
   allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount          = static_cast<uint32_t>(m_commandBuffers.size());
+  allocInfo.commandBufferCount          = bufferCount;
 
   if (
-    vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+    vkAllocateCommandBuffers(m_device, &allocInfo, window.commandBuffers.data())
+    != VK_SUCCESS)
   {
     throw std::runtime_error("failed to allocate command buffers!");
   }
 
-  // Add commands
-  for (size_t i = 0; i < m_commandBuffers.size(); i++)
+  if (m_timestampMask != 0)
   {
-    // Begin commands
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    beginInfo.pInheritanceInfo         = nullptr;
-    if (vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo) != VK_SUCCESS)
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount            = 2 * bufferCount;
+    if (m_config.gpuDriven)
     {
-      throw std::runtime_error("failed to begin recording command buffer!");
+      queryPoolInfo.queryCount += SCENE_TIMESTAMPS * bufferCount;
     }
+    if (
+      vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &window.timestampPool)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+  }
+  if (m_pipelineStatisticsSupported)
+  {
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType             = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolInfo.queryCount            = bufferCount;
+    queryPoolInfo.pipelineStatistics =
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    if (
+      vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &window.statisticsPool)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+  }
 
-    // Begin render pass
-    VkClearValue clearColor              = {0.0f, 0.0f, 0.0f, 1.0f};
-    VkRenderPassBeginInfo renderPassInfo = {};
-    renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass            = m_renderPass;
-    renderPassInfo.framebuffer           = m_swapChainFramebuffers[i];
-    renderPassInfo.renderArea.offset     = {0, 0};
-    renderPassInfo.renderArea.extent     = m_swapChainExtent;
-    renderPassInfo.clearValueCount       = 1;
-    renderPassInfo.pClearValues          = &clearColor;
-    vkCmdBeginRenderPass(
-      m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    vkCmdBindPipeline(
-      m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-
-    // Draw
-    vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
+  window.recordedGenerations.assign(bufferCount, 0);
+  for (size_t i = 0; i < window.commandBuffers.size(); i++)
+  {
+    recordCommandBuffer(window, i);
+  }
+}
 
-    // End render pass
-    vkCmdEndRenderPass(m_commandBuffers[i]);
+//----------------------------------------------------------------------------------------
+// The image's primary: the render graph's passes, with the scene pass executing the
+// cached secondaries. The image's last submission must have completed
+void
+Application::recordCommandBuffer(AppWindow& window, size_t imageIndex)
+{
+  VkCommandBuffer commandBuffer = window.commandBuffers[imageIndex];
+
+  // Begin commands
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+  beginInfo.pInheritanceInfo         = nullptr;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
 
-    // End of commands
-    if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS)
+  const auto query = static_cast<uint32_t>(2 * imageIndex);
+  if (window.timestampPool != VK_NULL_HANDLE)
+  {
+    vkCmdResetQueryPool(commandBuffer, window.timestampPool, query, 2);
+    if (m_config.gpuDriven)
     {
-      throw std::runtime_error("failed to record command buffer!");
+      vkCmdResetQueryPool(
+        commandBuffer,
+        window.timestampPool,
+        sceneTimestamp(window, imageIndex),
+        SCENE_TIMESTAMPS);
     }
+    vkCmdWriteTimestamp(
+      commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, window.timestampPool, query);
+  }
+  if (window.statisticsPool != VK_NULL_HANDLE)
+  {
+    vkCmdResetQueryPool(
+      commandBuffer, window.statisticsPool, static_cast<uint32_t>(imageIndex), 1);
+  }
+
+  RenderGraph& graph = window.renderGraph;
+  graph.bindImage(
+    window.backbuffer, window.images[imageIndex], window.imageViews[imageIndex]);
+  graph.execute(commandBuffer, imageIndex);
+
+  if (window.timestampPool != VK_NULL_HANDLE)
+  {
+    vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      window.timestampPool,
+      query + 1);
+  }
+
+  // End of commands
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to record command buffer!");
   }
+  window.recordedGenerations[imageIndex] = m_commandCache.generation();
 }
 
 //----------------------------------------------------------------------------------------
 void
 Application::createSyncObjects()
 {
-  m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  m_inFlightFrames.assign(MAX_FRAMES_IN_FLIGHT, 0);
+  m_frameTimestamps.resize(MAX_FRAMES_IN_FLIGHT);
+  m_sceneQueries.resize(MAX_FRAMES_IN_FLIGHT);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1010,23 +2076,68 @@ Application::createSyncObjects()
   fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
 
+  // Each window acquires on its own semaphore; one submit renders them all, so one
+  // semaphore per frame covers the batched present
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
   {
     if (
       (vkCreateSemaphore(
-         m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i])
+         m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i])
        != VK_SUCCESS)
-      || (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS)
       || (vkCreateFence(m_device, &fenceInfo, nullptr, &m_inFlightFences[i])))
     {
       throw std::runtime_error("failed to create synchronization objects!");
     }
   }
+  for (AppWindow& window : m_windows)
+  {
+    window.imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    for (auto& semaphore : window.imageAvailableSemaphores)
+    {
+      if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create synchronization objects!");
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static float
+secondsSinceStart()
+{
+  static auto startTime = std::chrono::high_resolution_clock::now();
+
+  auto currentTime = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<float, std::chrono::seconds::period>(
+           currentTime - startTime)
+    .count();
+}
+
+//----------------------------------------------------------------------------------------
+// Camera sits in the middle of the object grid and slowly turns around
+glm::mat4
+Application::computeViewProjection(VkExtent2D extent, float cameraYaw) const
+{
+  const float farPlane = m_gpuDrivenRenderer.sceneExtent();
+  const glm::vec3 eye(0.0f);
+  const glm::vec3 forward(std::sin(cameraYaw), 0.0f, std::cos(cameraYaw));
+
+  glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 proj = glm::perspective(
+    glm::radians(60.0f),
+    extent.width / static_cast<float>(extent.height),
+    0.1f,
+    std::max(farPlane, 1.0f));
+  proj[1][1] *= -1;    // glm is OpenGL (Y up) clip space
+
+  return proj * view;
 }
 
 //----------------------------------------------------------------------------------------
+// Waits for the oldest frame in flight, then what it used can be released or reused
 void
-Application::drawFrame()
+Application::beginFrame()
 {
   vkWaitForFences(
     m_device,
@@ -1034,175 +2145,1186 @@ Application::drawFrame()
     &m_inFlightFences[m_currentFrame],
     VK_TRUE,
     std::numeric_limits<uint64_t>::max());
-
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-    m_device,
-    m_swapChain,
-    std::numeric_limits<uint64_t>::max(),
-    m_imageAvailableSemaphores[m_currentFrame],
-    VK_NULL_HANDLE,
-    &imageIndex);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR)
-  {
-    recreateSwapChain();
-    return;
-  }
-  else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+  readFrameTimestamps();    // before the completed frame's query pools can go
+  readSceneQueries();
+  if (m_hud.enabled())
   {
-    throw std::runtime_error("failed to acquire swap chain image!");
+    m_hud.readTimestamps(static_cast<uint32_t>(m_currentFrame));
   }
-
-  VkSubmitInfo submitInfo           = {};
-  submitInfo.sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  VkSemaphore waitSemaphores[]      = {m_imageAvailableSemaphores[m_currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount     = 1;
-  submitInfo.pWaitSemaphores        = waitSemaphores;
-  submitInfo.pWaitDstStageMask      = waitStages;
-  submitInfo.commandBufferCount     = 1;
-  submitInfo.pCommandBuffers        = &m_commandBuffers[imageIndex];
-  VkSemaphore signalSemaphores[]    = {m_renderFinishedSemaphores[m_currentFrame]};
-  submitInfo.signalSemaphoreCount   = 1;
-  submitInfo.pSignalSemaphores      = signalSemaphores;
-
-  vkResetFences(m_device, 1, &m_inFlightFences[m_currentFrame]);
-  if (
-    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame])
-    != VK_SUCCESS)
-  {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
-
-  VkSwapchainKHR swapChains[]    = {m_swapChain};
-  VkPresentInfoKHR presentInfo   = {};
-  presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores    = signalSemaphores;
-  presentInfo.swapchainCount     = 1;
-  presentInfo.pSwapchains        = swapChains;
-  presentInfo.pImageIndices      = &imageIndex;
-  presentInfo.pResults           = nullptr;
-  result                         = vkQueuePresentKHR(m_presentQueue, &presentInfo);
-  if (
-    result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR
-    || m_framebufferResized)
+  m_deletionQueue.frameCompleted(m_inFlightFrames[m_currentFrame]);
+  if (m_pipelineLibrary.update() && !m_config.gpuDriven)
   {
-    recreateSwapChain();
-    return;
+    m_commandCache.invalidate(m_sceneBucket);    // binds the optimised triangle pipeline
   }
-  else if (result != VK_SUCCESS)
+  if (m_config.bindless)
   {
-    throw std::runtime_error("failed to present swap chain image!");
+    m_bindless.nextFrame();
   }
-
-  m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  m_memoryTelemetry.update(secondsSinceStart());
 }
 
 //----------------------------------------------------------------------------------------
+// One submission renders every target's image of scene. Signals the frame's render
+// finished semaphore for the present, except in a replay
 void
-Application::recreateSwapChain()
+Application::submitFrame(
+  const std::vector<AppWindow*>& targets,
+  const std::vector<uint32_t>& imageIndices,
+  const std::vector<VkSemaphore>& waitSemaphores,
+  const SceneState& scene)
 {
-  // Wait while window is minimized
-  int width = 0, height = 0;
-  while (width == 0 || height == 0)
+  std::vector<VkCommandBuffer> commandBuffers;
+  for (size_t i = 0; i < targets.size(); ++i)
   {
-    glfwGetFramebufferSize(m_window, &width, &height);
-    glfwWaitEvents();
-  }
+    AppWindow& window       = *targets[i];
+    const size_t imageIndex = imageIndices[i];
 
-  vkDeviceWaitIdle(m_device);
-
-  cleanupSwapChain();
+    // The previous frame using this image must finish before we touch its resources
+    if (window.imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+    {
+      vkWaitForFences(
+        m_device,
+        1,
+        &window.imagesInFlight[imageIndex],
+        VK_TRUE,
+        std::numeric_limits<uint64_t>::max());
+    }
+    window.imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrame];
+    if (m_hud.enabled())
+    {
+      m_hud.submitDraw(
+        window.hud,
+        static_cast<uint32_t>(imageIndex),
+        static_cast<uint32_t>(m_currentFrame));
+    }
 
-  createSwapChain();
-  createImageViews();
-  createRenderPass();
-  createGraphicsPipeline();
-  createFramebuffers();
-  createCommandBuffers();
-}
+    // Only primaries that may execute a replaced bucket (or draw at an old scale) are
+    // recorded again, now that the image's last submission is done with them
+    if (window.recordedGenerations[imageIndex] != m_commandCache.generation())
+    {
+      recordCommandBuffer(window, imageIndex);
+    }
 
-//----------------------------------------------------------------------------------------
+    commandBuffers.push_back(window.commandBuffers[imageIndex]);
+    if (window.timestampPool != VK_NULL_HANDLE)
+    {
+      m_frameTimestamps[m_currentFrame].push_back(
+        {window.timestampPool, static_cast<uint32_t>(2 * imageIndex)});
+    }
+    if (m_config.gpuDriven)
+    {
+      SceneQuery query     = {};
+      query.view           = window.index;
+      query.timestampPool  = window.timestampPool;
+      query.firstTimestamp = sceneTimestamp(window, imageIndex);
+      query.statisticsPool = window.statisticsPool;
+      query.statistics     = static_cast<uint32_t>(imageIndex);
+      m_sceneQueries[m_currentFrame].push_back(query);
+    }
+  }
+
+  if (m_config.gpuDriven)
+  {
+    m_gpuDrivenRenderer.updateScene(scene.spin);
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+      m_gpuDrivenRenderer.updateFrame(
+        targets[i]->firstFrameResource + imageIndices[i],
+        computeViewProjection(targets[i]->extent, scene.cameraYaw));
+    }
+  }
+
+  const std::vector<VkPipelineStageFlags> waitStages(
+    waitSemaphores.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+  VkSubmitInfo submitInfo        = {};
+  submitInfo.sType               = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.waitSemaphoreCount  = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores     = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask   = waitStages.data();
+  submitInfo.commandBufferCount  = static_cast<uint32_t>(commandBuffers.size());
+  submitInfo.pCommandBuffers     = commandBuffers.data();
+  VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphores[m_currentFrame]};
+  if (!m_config.headless())
+  {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = signalSemaphores;
+  }
+
+  vkResetFences(m_device, 1, &m_inFlightFences[m_currentFrame]);
+  if (
+    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame])
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to submit draw command buffer!");
+  }
+  m_inFlightFrames[m_currentFrame] = m_deletionQueue.frameSubmitted();
+}
+
+//----------------------------------------------------------------------------------------
+// Every visible window acquires its own image, then one submission renders all of them
+// and one vkQueuePresentKHR presents them together
 void
-Application::cleanupSwapChain()
+Application::drawFrame()
 {
-  for (auto framebuffer : m_swapChainFramebuffers)
+  beginFrame();
+  if (m_hud.enabled())
   {
-    vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+    updateHud();
   }
+  const SceneState scene = m_simulation.sample(Simulation::Clock::now());
 
-  vkFreeCommandBuffers(
-    m_device,
-    m_commandPool,
-    static_cast<uint32_t>(m_commandBuffers.size()),
-    m_commandBuffers.data());
+  std::vector<AppWindow*> targets;
+  std::vector<VkSwapchainKHR> swapChains;
+  std::vector<uint32_t> imageIndices;
+  std::vector<VkSemaphore> waitSemaphores;
+  for (AppWindow& window : m_windows)
+  {
+    if (window.minimized || window.resized)
+    {
+      window.lastPresentTime = 0.0;    // don't count the gap in its frame time
+      continue;
+    }
 
-  vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
-  vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-  vkDestroyRenderPass(m_device, m_renderPass, nullptr);
-  for (auto imageView : m_swapChainImageViews)
+    uint32_t imageIndex;
+    VkResult result = vkAcquireNextImageKHR(
+      m_device,
+      window.swapChain,
+      std::numeric_limits<uint64_t>::max(),
+      window.imageAvailableSemaphores[m_currentFrame],
+      VK_NULL_HANDLE,
+      &imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+      window.resized = true;
+      continue;
+    }
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+      throw std::runtime_error("failed to acquire swap chain image!");
+    }
+
+    targets.push_back(&window);
+    swapChains.push_back(window.swapChain);
+    imageIndices.push_back(imageIndex);
+    waitSemaphores.push_back(window.imageAvailableSemaphores[m_currentFrame]);
+  }
+  if (targets.empty())
   {
-    vkDestroyImageView(m_device, imageView, nullptr);
+    recreateSwapChains();
+    return;
   }
-  vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+
+  submitFrame(targets, imageIndices, waitSemaphores, scene);
+
+  if (m_captureWriter.isOpen())
+  {
+    CapturedFrame frame   = {};
+    frame.scene           = scene;
+    frame.resolutionScale = m_dynamicResolution.scale();
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+      frame.targets.push_back({targets[i]->index, imageIndices[i]});
+    }
+    m_captureWriter.writeFrame(frame);
+  }
+
+  std::vector<VkResult> results(targets.size(), VK_SUCCESS);
+  VkPresentInfoKHR presentInfo   = {};
+  presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  presentInfo.waitSemaphoreCount = 1;
+  presentInfo.pWaitSemaphores    = &m_renderFinishedSemaphores[m_currentFrame];
+  presentInfo.swapchainCount     = static_cast<uint32_t>(swapChains.size());
+  presentInfo.pSwapchains        = swapChains.data();
+  presentInfo.pImageIndices      = imageIndices.data();
+  presentInfo.pResults           = results.data();
+  VkResult result                = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+  if (
+    result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR
+    && result != VK_ERROR_OUT_OF_DATE_KHR)
+  {
+    throw std::runtime_error("failed to present swap chain image!");
+  }
+
+  m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+  const double now = glfwGetTime();
+  for (size_t i = 0; i < targets.size(); ++i)
+  {
+    if (results[i] == VK_ERROR_OUT_OF_DATE_KHR || results[i] == VK_SUBOPTIMAL_KHR)
+    {
+      targets[i]->resized = true;
+    }
+    else if (results[i] != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to present swap chain image!");
+    }
+    reportFrameTime(*targets[i], now);
+  }
+
+  recreateSwapChains();
 }
 
 //----------------------------------------------------------------------------------------
+// A captured frame drawn again: the same images at the same scene state and resolution
+// scale, with nothing to acquire or present
 void
-Application::cleanup()
+Application::replayFrame(const CapturedFrame& frame)
 {
-  cleanupSwapChain();
+  beginFrame();
+  if (
+    m_dynamicResolution.enabled()
+    && m_dynamicResolution.setScale(frame.resolutionScale))
+  {
+    m_commandCache.invalidatePrimaries();    // the cached buckets are kept per extent
+  }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+  std::vector<AppWindow*> targets;
+  std::vector<uint32_t> imageIndices;
+  for (const CapturedTarget& target : frame.targets)
+  {
+    if (
+      target.window >= m_windows.size()
+      || target.image >= m_windows[target.window].images.size())
+    {
+      throw std::runtime_error(fmt::format(
+        "capture {} draws window {} image {}, which it never created",
+        m_config.replayPath,
+        target.window,
+        target.image));
+    }
+    targets.push_back(&m_windows[target.window]);
+    imageIndices.push_back(target.image);
+  }
+  if (targets.empty())
+  {
+    return;
+  }
+
+  submitFrame(targets, imageIndices, {}, frame.scene);
+  m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+//----------------------------------------------------------------------------------------
+// The window takes the captured swap chain's size and image count; its images are
+// created (again) by the next createSwapChain()
+AppWindow&
+Application::resizeReplayWindow(const CapturedResize& resize)
+{
+  if (resize.window >= m_windows.size() || resize.imageCount == 0)
+  {
+    throw std::runtime_error(fmt::format(
+      "capture {} resizes window {} to {} images, it has {} windows",
+      m_config.replayPath,
+      resize.window,
+      resize.imageCount,
+      m_windows.size()));
+  }
+  AppWindow& window       = m_windows[resize.window];
+  window.extent           = {resize.width, resize.height};
+  window.replayImageCount = resize.imageCount;
+  return window;
+}
+
+//----------------------------------------------------------------------------------------
+// Shown in the window's title once a second, the last average is printed on exit
+void
+Application::reportFrameTime(AppWindow& window, double now)
+{
+  if (window.lastPresentTime > 0.0)
+  {
+    window.frameTimeSum += now - window.lastPresentTime;
+    window.frameTimeCount += 1;
+  }
+  window.lastPresentTime = now;
+  window.presentCount += 1;
+
+  if (window.frameTimeSum < 1.0)
+  {
+    return;
+  }
+  window.averageFrameTime = window.frameTimeSum / window.frameTimeCount;
+  window.frameTimeSum     = 0.0;
+  window.frameTimeCount   = 0;
+
+  window.title = fmt::format(
+    "{} [{}]: {:.2f} ms ({:.0f} fps)",
+    WINDOW_TITLE,
+    window.index,
+    window.averageFrameTime * 1000.0,
+    1.0 / window.averageFrameTime);
+  if (m_dynamicResolution.enabled())
+  {
+    window.title += fmt::format(
+      ", GPU {:.2f} ms at {:.0f}% scale",
+      m_dynamicResolution.averageTime(),
+      m_dynamicResolution.scale() * 100.0f);
+  }
+  if (m_config.gpuDriven && m_gpuDrivenRenderer.occlusionCulling())
+  {
+    window.title +=
+      fmt::format(", {} occluded", m_gpuDrivenRenderer.occludedCount(window.index));
+  }
+
+  // Only the main thread can set it
+  std::vector<std::string>& titles = m_windowTitles.back();
+  titles.resize(m_windows.size());
+  for (const AppWindow& other : m_windows)
+  {
+    titles[other.index] = other.title;
+  }
+  m_windowTitles.publish();
+  glfwPostEmptyEvent();
+}
+
+//----------------------------------------------------------------------------------------
+// GPU time of the frame whose fence was just waited on: from the first of its command
+// buffers starting to the last one finishing. A new scale means recording every
+// window's command buffers again; the render graphs and offscreen targets stay. A
+// replay draws at the captured scales, its timings only go into the average
+void
+Application::readFrameTimestamps()
+{
+  std::vector<TimestampQuery>& queries = m_frameTimestamps[m_currentFrame];
+  if (queries.empty())
+  {
+    return;
+  }
+
+  uint64_t start = std::numeric_limits<uint64_t>::max();
+  uint64_t end   = 0;
+  for (const TimestampQuery& query : queries)
+  {
+    uint64_t timestamps[2] = {};
+    if (
+      vkGetQueryPoolResults(
+        m_device,
+        query.pool,
+        query.first,
+        2,
+        sizeof(timestamps),
+        timestamps,
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT)
+      != VK_SUCCESS)
+    {
+      queries.clear();
+      return;
+    }
+    start = std::min(start, timestamps[0] & m_timestampMask);
+    end   = std::max(end, timestamps[1] & m_timestampMask);
+  }
+  queries.clear();
+  if (end < start)
+  {
+    return;    // the counter wrapped
+  }
+
+  const float gpuTime = (end - start) * m_timestampPeriod * 1e-6f;
+  m_lastGpuTime        = gpuTime;
+  m_gpuTimeSum += gpuTime;
+  ++m_gpuTimeCount;
+  if (
+    m_dynamicResolution.enabled() && !m_config.headless()
+    && m_dynamicResolution.addFrameTime(gpuTime))
+  {
+    m_commandCache.invalidatePrimaries();    // the cached buckets are kept per extent
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The GPU driven scene's timings and fragment counts of the frame whose fence was just
+// waited on. The occluded objects are each window's from its last finished frame
+void
+Application::readSceneQueries()
+{
+  const bool occlusion = m_gpuDrivenRenderer.occlusionCulling();
+
+  // -1 if the counter wrapped
+  auto milliseconds = [this](uint64_t start, uint64_t end) {
+    start &= m_timestampMask;
+    end &= m_timestampMask;
+    return end < start ? -1.0 : (end - start) * m_timestampPeriod * 1e-6;
+  };
+
+  std::vector<SceneQuery>& queries = m_sceneQueries[m_currentFrame];
+  for (const SceneQuery& query : queries)
+  {
+    ++m_sceneFrames;
+    if (occlusion)
+    {
+      m_occludedSum += m_gpuDrivenRenderer.occludedCount(query.view);
+    }
+
+    uint64_t timestamps[SCENE_TIMESTAMPS] = {};
+    const uint32_t timestampCount         = occlusion ? SCENE_TIMESTAMPS : 2;
+    if (
+      query.timestampPool != VK_NULL_HANDLE
+      && vkGetQueryPoolResults(
+           m_device,
+           query.timestampPool,
+           query.firstTimestamp,
+           timestampCount,
+           sizeof(timestamps),
+           timestamps,
+           sizeof(uint64_t),
+           VK_QUERY_RESULT_64_BIT)
+           == VK_SUCCESS)
+    {
+      const double sceneTime     = milliseconds(timestamps[0], timestamps[1]);
+      const double occlusionTime = occlusion ? milliseconds(timestamps[2], timestamps[3])
+                                             : 0.0;
+      if (sceneTime >= 0.0 && occlusionTime >= 0.0)
+      {
+        m_sceneTimeSum += sceneTime;
+        m_occlusionTimeSum += occlusionTime;
+        ++m_sceneTimeCount;
+      }
+    }
+
+    uint64_t fragments = 0;
+    if (
+      query.statisticsPool != VK_NULL_HANDLE
+      && vkGetQueryPoolResults(
+           m_device,
+           query.statisticsPool,
+           query.statistics,
+           1,
+           sizeof(fragments),
+           &fragments,
+           sizeof(uint64_t),
+           VK_QUERY_RESULT_64_BIT)
+           == VK_SUCCESS)
+    {
+      m_fragmentSum += fragments;
+      ++m_fragmentCount;
+    }
+  }
+  queries.clear();
+}
+
+//----------------------------------------------------------------------------------------
+// What the post-processing chain costs, to compare its two modes (run the same scene,
+// or replay the same capture, with each): the GPU time of whole frames as measured by
+// the timestamps, and the attachment traffic as estimated from the load and store ops,
+// core Vulkan having no bandwidth counters. The memory backing the intermediate
+// attachments is measured: lazily allocated memory only commits what left the tiles
+void
+Application::printPostProcessSummary() const
+{
+  if (!m_postProcess.enabled())
+  {
+    return;
+  }
+
+  uint64_t traffic       = 0;
+  VkDeviceSize committed = 0;
+  for (const AppWindow& window : m_windows)
+  {
+    traffic += m_postProcess.estimatedTraffic(window.extent);
+    committed += m_postProcess.mode() == PostProcessMode::Subpasses
+                   ? m_postProcess.committedMemory(window.post)
+                   : window.renderGraph.transientMemorySize();
+  }
+  fmt::print(
+    "post-processing: {}, GPU {:.3f} ms per frame, ~{:.1f} MB attachment traffic per "
+    "frame (estimated), {} KiB committed to transient attachments\n",
+    PostProcess::modeName(m_postProcess.mode()),
+    m_gpuTimeCount > 0 ? m_gpuTimeSum / m_gpuTimeCount : 0.0,
+    traffic / (1024.0 * 1024.0),
+    committed / 1024);
+}
+
+//----------------------------------------------------------------------------------------
+// What occlusion culling saves the GPU driven scene, to compare runs with and without
+// --occlusion (the same options otherwise, --dense for overdraw): per window frame, the
+// GPU time of the scene pass and of the occlusion pass it costs, from the timestamps,
+// and the fragments the scene pass shaded (particles and post-processing subpasses
+// included), from a pipeline statistics query
+void
+Application::printSceneSummary() const
+{
+  if (!m_config.gpuDriven || m_sceneFrames == 0)
+  {
+    return;
+  }
+
+  const bool occlusion = m_gpuDrivenRenderer.occlusionCulling();
+  std::string summary =
+    fmt::format("scene: occlusion culling {}", occlusion ? "on" : "off");
+  if (m_sceneTimeCount > 0)
+  {
+    summary +=
+      fmt::format(", GPU {:.3f} ms scene pass", m_sceneTimeSum / m_sceneTimeCount);
+    if (occlusion)
+    {
+      summary += fmt::format(
+        " + {:.3f} ms occlusion pass", m_occlusionTimeSum / m_sceneTimeCount);
+    }
+  }
+  if (m_fragmentCount > 0)
+  {
+    summary += fmt::format(
+      ", {:.2f} M fragments shaded",
+      static_cast<double>(m_fragmentSum) / m_fragmentCount * 1e-6);
+  }
+  else if (!m_pipelineStatisticsSupported)
+  {
+    summary +=
+      ", fragments not counted (needs pipelineStatisticsQuery and inheritedQueries)";
+  }
+  if (occlusion)
+  {
+    summary += fmt::format(
+      ", {:.0f} of {} objects occluded",
+      static_cast<double>(m_occludedSum) / m_sceneFrames,
+      m_config.objectCount);
+  }
+  fmt::print("{} per frame\n", summary);
+}
+
+//----------------------------------------------------------------------------------------
+// Render thread, once a frame after beginFrame(): what the overlay shows this frame.
+// The GPU time and occlusion are from the last finished frame
+void
+Application::updateHud()
+{
+  const double now = glfwGetTime();
+
+  HudStats stats     = {};
+  stats.cpuFrameTime = m_lastFrameStart > 0.0 ? float((now - m_lastFrameStart) * 1000.0)
+                                              : 0.0f;
+  stats.gpuFrameTime = m_lastGpuTime;
+  stats.drawCount    = m_config.gpuDriven ? m_config.objectCount : 1;
+  if (m_config.gpuDriven && m_gpuDrivenRenderer.occlusionCulling())
+  {
+    stats.occludedCount = m_gpuDrivenRenderer.occludedCount(m_windows[0].index);
+  }
+  stats.particleCount   = m_particles.enabled() ? m_particles.particleCount() : 0;
+  stats.resolutionScale = m_dynamicResolution.scale();    // 1 without
+  for (const HeapTelemetry& heap : m_memoryTelemetry.heaps())
+  {
+    if (heap.deviceLocal)
+    {
+      stats.memoryUsage += heap.usage;
+      stats.memoryBudget += heap.budget;
+    }
+  }
+  stats.presentMode = m_presentMode;
+  m_lastFrameStart  = now;
+
+  m_hud.update(static_cast<uint32_t>(m_currentFrame), stats);
+}
+
+//----------------------------------------------------------------------------------------
+// Rebuilds the swap chains of windows flagged as resized. Doesn't wait for the GPU: the
+// frames in flight carry on with the old swap chains and their resources, which are
+// destroyed once their fences have been waited on
+void
+Application::recreateSwapChains()
+{
+  std::vector<bool> rebuilt(m_windows.size(), false);
+  for (AppWindow& window : m_windows)
+  {
+    if (!window.resized)
+    {
+      continue;
+    }
+
+    // Minimised: skipped until restored, whose resize brings us back. A replay only
+    // resizes to what was drawn
+    if (!m_config.headless())
+    {
+      const VkExtent2D size = framebufferSize(window);
+      if (size.width == 0 || size.height == 0)
+      {
+        window.minimized = true;
+        continue;
+      }
+    }
+    window.resized   = false;
+    window.minimized = false;
+
+    retireSwapChain(window);
+    createSwapChain(window);
+    createImageViews(window);
+    createFramebuffers(window);
+    rebuilt[window.index] = true;
+  }
+  if (std::find(rebuilt.begin(), rebuilt.end(), true) == rebuilt.end())
   {
-    vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
+    return;
   }
 
-  vkDestroyCommandPool(m_device, m_commandPool, nullptr);
-  vkDestroyDevice(m_device, nullptr);
+  // The GPU driven frame resources span every window's images, so all windows are
+  // recorded again when any image count may have changed
+  if (m_config.gpuDriven)
+  {
+    m_gpuDrivenRenderer.retireSwapChainResources(m_deletionQueue);
+    createGpuDrivenFrames();
+    m_commandCache.invalidate(m_sceneBucket);    // new pipeline and descriptor sets
+  }
+  for (AppWindow& window : m_windows)
+  {
+    if (m_config.gpuDriven || rebuilt[window.index])
+    {
+      retireCommandBuffers(window);
+      retireRenderGraph(window);
+      createRenderGraph(window);
+      createCommandBuffers(window);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::retireSwapChain(AppWindow& window)
+{
+  // Swap chain images belong to the swap chain, replay images are our own
+  std::vector<VkImage> ownedImages;
+  if (m_config.headless())
+  {
+    ownedImages = std::move(window.images);
+  }
+  m_deletionQueue.push([device       = m_device,
+                        framebuffers = std::move(window.framebuffers),
+                        imageViews   = std::move(window.imageViews),
+                        images       = std::move(ownedImages),
+                        imageMemory  = std::move(window.imageMemory)]() {
+    for (auto framebuffer : framebuffers)
+    {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (auto imageView : imageViews)
+    {
+      vkDestroyImageView(device, imageView, nullptr);
+    }
+    for (auto image : images)
+    {
+      vkDestroyImage(device, image, nullptr);
+    }
+    for (auto memory : imageMemory)
+    {
+      freeDeviceMemory(device, memory);
+    }
+  });
+  window.framebuffers.clear();
+  window.imageViews.clear();
+  window.imageMemory.clear();
+  if (m_postProcess.mode() == PostProcessMode::Subpasses)
+  {
+    m_postProcess.retireTargets(window.post, m_deletionQueue);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::retireCommandBuffers(AppWindow& window)
+{
+  m_deletionQueue.push([device         = m_device,
+                        commandPool    = m_commandPool,
+                        commandBuffers = std::move(window.commandBuffers),
+                        timestampPool  = window.timestampPool,
+                        statisticsPool = window.statisticsPool]() {
+    vkFreeCommandBuffers(
+      device,
+      commandPool,
+      static_cast<uint32_t>(commandBuffers.size()),
+      commandBuffers.data());
+    vkDestroyQueryPool(device, timestampPool, nullptr);
+    vkDestroyQueryPool(device, statisticsPool, nullptr);
+  });
+  window.commandBuffers.clear();
+  window.timestampPool  = VK_NULL_HANDLE;
+  window.statisticsPool = VK_NULL_HANDLE;
+  if (m_hud.enabled())
+  {
+    m_hud.retireTargets(window.hud, m_deletionQueue);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::retireRenderGraph(AppWindow& window)
+{
+  m_deletionQueue.push([device               = m_device,
+                        sceneFramebuffer     = window.sceneFramebuffer,
+                        sceneFramebuffers    = std::move(window.sceneFramebuffers),
+                        occlusionFramebuffer = window.occlusionFramebuffer]() {
+    vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
+    for (auto framebuffer : sceneFramebuffers)
+    {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    vkDestroyFramebuffer(device, occlusionFramebuffer, nullptr);
+  });
+  window.sceneFramebuffer = VK_NULL_HANDLE;
+  window.sceneFramebuffers.clear();
+  window.occlusionFramebuffer = VK_NULL_HANDLE;
+  if (m_postProcess.mode() == PostProcessMode::Passes)
+  {
+    m_postProcess.retireTargets(window.post, m_deletionQueue);
+  }
+  window.renderGraph.retire(m_deletionQueue);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Application::cleanup()
+{
+  // The device is idle (see run()). A device that was pinned but turned out unsuitable
+  // stops init() before there is one
+  if (m_device != VK_NULL_HANDLE)
+  {
+    for (AppWindow& window : m_windows)
+    {
+      retireCommandBuffers(window);
+      retireRenderGraph(window);
+      retireSwapChain(window);
+      if (window.swapChain != VK_NULL_HANDLE)
+      {
+        vkDestroySwapchainKHR(m_device, window.swapChain, nullptr);
+      }
+    }
+    if (m_config.gpuDriven)
+    {
+      m_gpuDrivenRenderer.retireSwapChainResources(m_deletionQueue);
+    }
+    m_deletionQueue.flush();
+    m_commandCache.cleanup();
+
+    m_pipelineLibrary.cleanup();
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+
+    for (size_t i = 0; i < m_inFlightFences.size(); ++i)
+    {
+      vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
+      vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
+    }
+    for (AppWindow& window : m_windows)
+    {
+      for (auto semaphore : window.imageAvailableSemaphores)
+      {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+      }
+    }
+
+    m_gpuDrivenRenderer.cleanup();
+    m_particles.cleanup();
+    m_postProcess.cleanup();
+    m_hud.cleanup();
+    m_layoutCache.cleanup();
+    m_bindless.cleanup();
+    m_textureManager.cleanup();
+    m_geometryPacker.cleanup();
+
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+  }
 
   if (ENABLE_VALIDATION_LAYERS)
   {
     DestroyDebugUtilsMessengerEXT(m_instance, sg_debugMessenger, nullptr);
+    sg_debugMessenger = VK_NULL_HANDLE;
+  }
+  if (!m_config.headless())
+  {
+    for (AppWindow& window : m_windows)
+    {
+      vkDestroySurfaceKHR(m_instance, window.surface, nullptr);
+    }
   }
-  vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
   vkDestroyInstance(m_instance, nullptr);
-  glfwDestroyWindow(m_window);
-  glfwTerminate();
+  if (!m_config.headless())
+  {
+    for (AppWindow& window : m_windows)
+    {
+      glfwDestroyWindow(window.window);
+    }
+    glfwTerminate();
+  }
+
+  m_logger.stop();
+  m_logger.printSummary();
 }
 
 //----------------------------------------------------------------------------------------
 void
 Application::init()
 {
+  if (ENABLE_VALIDATION_LAYERS)
+  {
+    m_logger.setFilter(m_config.logSeverities, m_config.logTypes);
+    m_logger.start();
+  }
+  if (m_config.headless())
+  {
+    // The capture's scene, whatever the command line asked for
+    m_captureReader.open(m_config.replayPath);
+    applyCaptureSettings(m_captureReader.settings(), m_config);
+    if (m_config.postProcess != PostProcessMode::Off && m_config.targetFrameTime > 0.0f)
+    {
+      throw std::runtime_error(fmt::format(
+        "capture {} uses dynamic resolution, which --post-process can't be combined with",
+        m_config.replayPath));
+    }
+  }
+  else if (!m_config.capturePath.empty())
+  {
+    m_captureWriter.open(m_config.capturePath, captureSettings(m_config));
+  }
   createInstance();
   setupDebugMessenger();
-  createSurface();
+  if (!m_config.headless())
+  {
+    createSurfaces();
+  }
   pickPhysicalDevice();
   createLogicalDevice();
-  createSwapChain();
-  createImageViews();
+  initFrameTimestamps();
+  m_memoryTelemetry.init(
+    m_physicalDevice,
+    m_memoryBudgetSupported,
+    m_config.memoryHeadroom,
+    m_config.memorySummaryInterval);
+  m_layoutCache.init(m_device);
+  if (m_config.bindless)
+  {
+    m_bindless.init(m_physicalDevice, m_device, MAX_FRAMES_IN_FLIGHT);
+  }
+  // A capture starts with every window's first swap chain
+  while (m_config.headless() && m_captureReader.peek() == CaptureRecord::Resize)
+  {
+    resizeReplayWindow(m_captureReader.readResize());
+  }
+  for (AppWindow& window : m_windows)
+  {
+    if (m_config.headless() && window.replayImageCount == 0)
+    {
+      throw std::runtime_error(fmt::format(
+        "capture {} has no swap chain for window {}", m_config.replayPath, window.index));
+    }
+    createSwapChain(window);
+    createImageViews(window);
+  }
   createRenderPass();
+  m_pipelineLibrary.init(
+    m_physicalDevice, m_device, m_pipelineLibrarySupported, m_deletionQueue);
   createGraphicsPipeline();
-  createFramebuffers();
+  if (m_config.postProcess != PostProcessMode::Off)
+  {
+    m_postProcess.init(
+      m_physicalDevice,
+      m_device,
+      m_layoutCache,
+      m_config.postProcess,
+      m_swapChainImageFormat,
+      m_renderPass);
+  }
+  for (AppWindow& window : m_windows)
+  {
+    createFramebuffers(window);
+  }
   createCommandPool();
-  createCommandBuffers();
+  m_commandCache.init(
+    m_device,
+    m_commandPool,
+    m_deletionQueue,
+    m_pipelineStatisticsSupported
+      ? VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+      : 0);
+  m_geometryPacker.init(m_physicalDevice, m_device, m_commandPool, m_graphicsQueue);
+  m_textureManager.init(
+    m_physicalDevice, m_device, m_commandPool, m_graphicsQueue, m_enabledFeatures);
+  if (m_config.hud && !m_config.headless())
+  {
+    m_hud.init(
+      m_physicalDevice,
+      m_device,
+      m_textureManager,
+      m_layoutCache,
+      m_swapChainImageFormat,
+      MAX_FRAMES_IN_FLIGHT,
+      m_timestampPeriod,
+      m_timestampMask);
+  }
+  if (m_config.gpuDriven)
+  {
+    m_gpuDrivenRenderer.init(
+      m_physicalDevice,
+      m_device,
+      m_geometryPacker,
+      m_textureManager,
+      m_config.bindless ? &m_bindless : nullptr,
+      m_commandPool,
+      m_graphicsQueue,
+      m_config.objectCount,
+      m_config.meshPath,
+      m_config.texturePath,
+      m_drawIndirectCountSupported,
+      m_multiDrawIndirectSupported,
+      m_config.occlusionCulling,
+      m_config.denseScene);
+    createGpuDrivenFrames();
+  }
+  if (m_config.particleCount > 0)
+  {
+    m_particles.init(
+      m_physicalDevice,
+      m_device,
+      m_commandPool,
+      m_graphicsQueue,
+      m_renderPass,
+      m_layoutCache,
+      m_config.particleCount);
+  }
+  createCommandBuckets();
+  for (AppWindow& window : m_windows)
+  {
+    createRenderGraph(window);
+    createCommandBuffers(window);
+  }
   createSyncObjects();
+
+  m_memoryTelemetry.refresh();
+  m_memoryTelemetry.printSummary();
 }
 
 //----------------------------------------------------------------------------------------
 void
 Application::run()
 {
-  while (!glfwWindowShouldClose(m_window))
+  if (m_config.headless())
+  {
+    runReplay();
+    return;
+  }
+
+  auto shouldClose = [](const AppWindow& window) {
+    return glfwWindowShouldClose(window.window) != 0;
+  };
+
+  // Only the GPU driven scene moves
+  if (m_config.gpuDriven)
   {
-    glfwPollEvents();
-    drawFrame();
+    m_simulation.start(m_config.tickRate);
   }
+  m_rendering = true;
+  std::thread renderThread(&Application::renderLoop, this);
+
+  // Waits for events, until the render thread stops after a close (or a benchmark).
+  // The render thread posts an empty event to wake this loop for new titles and when
+  // it stops
+  bool closing = false;
+  while (m_rendering)
+  {
+    glfwWaitEvents();
+    if (m_windowTitles.update())
+    {
+      const std::vector<std::string>& titles = m_windowTitles.front();
+      for (const AppWindow& window : m_windows)
+      {
+        if (!titles[window.index].empty())
+        {
+          glfwSetWindowTitle(window.window, titles[window.index].c_str());
+        }
+      }
+    }
+
+    auto closed = std::find_if(m_windows.begin(), m_windows.end(), shouldClose);
+    if (!closing && closed != m_windows.end())
+    {
+      WindowEvent event = {};
+      event.type        = WindowEventType::Close;
+      pushWindowEvent(closed->window, event);
+      closing = true;
+    }
+  }
+  renderThread.join();
+  m_simulation.stop();
   vkDeviceWaitIdle(m_device);
+  if (m_renderError)
+  {
+    std::rethrow_exception(m_renderError);
+  }
+
+  for (const AppWindow& window : m_windows)
+  {
+    fmt::print(
+      "window {}: {}x{}, {} presents, {:.2f} ms per frame\n",
+      window.index,
+      window.extent.width,
+      window.extent.height,
+      window.presentCount,
+      window.averageFrameTime * 1000.0);
+  }
+  if (m_particles.enabled() && m_windows[0].averageFrameTime > 0.0)
+  {
+    fmt::print(
+      "particles: {} simulated and drawn per frame, {:.1f} M per second\n",
+      m_particles.particleCount(),
+      m_particles.particleCount() / m_windows[0].averageFrameTime * 1e-6);
+  }
+  if (m_simulation.tickCount() > 0)
+  {
+    fmt::print(
+      "simulation: {} ticks at {:.0f} Hz, {} dropped catching up\n",
+      m_simulation.tickCount(),
+      m_simulation.tickRate(),
+      m_simulation.droppedTicks());
+  }
+  m_commandCache.printSummary();
+  m_pipelineLibrary.printSummary();
+  printPostProcessSummary();
+  printSceneSummary();
+  m_hud.printSummary();
+  if (m_captureWriter.isOpen())
+  {
+    m_captureWriter.close();
+    fmt::print(
+      "capture: {} frames written to {}\n",
+      m_captureWriter.frameCount(),
+      m_config.capturePath);
+  }
+  if (m_benchmark.frames > 0)
+  {
+    fmt::print(
+      "benchmark: {} frames in {:.3f} s, {:.3f} ms per frame{}\n",
+      m_benchmark.frames,
+      m_benchmark.seconds,
+      m_benchmark.seconds * 1000.0 / m_benchmark.frames,
+      m_benchmark.vsync ? " (vsync)" : "");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The render thread of a windowed run: draws until a window is closed, Escape is
+// pressed or the benchmark is done. Whatever it throws is rethrown by run()
+void
+Application::renderLoop()
+{
+  auto isMinimized = [](const AppWindow& window) { return window.minimized; };
+
+  try
+  {
+    const uint32_t benchmarkEnd = BENCHMARK_WARMUP_FRAMES + m_config.benchmarkFrames;
+    uint32_t frameCount         = 0;
+    double benchmarkStart       = 0.0;
+    while (processWindowEvents())
+    {
+      // Nothing to draw while every window is minimised: sleep until the next resize,
+      // key or close. An event pushed since the last look is still pending, so this
+      // can't miss it
+      if (std::all_of(m_windows.begin(), m_windows.end(), isMinimized))
+      {
+        std::unique_lock<std::mutex> lock(m_windowEventMutex);
+        m_windowEventPushed.wait(lock, [this] { return m_windowEventPending; });
+        m_windowEventPending = false;
+        continue;
+      }
+      drawFrame();
+
+      if (m_config.benchmarkFrames > 0)
+      {
+        ++frameCount;
+        if (frameCount == BENCHMARK_WARMUP_FRAMES)
+        {
+          vkDeviceWaitIdle(m_device);
+          benchmarkStart = glfwGetTime();
+        }
+        else if (frameCount == benchmarkEnd)
+        {
+          // Time the GPU's work too, not just its submission
+          vkDeviceWaitIdle(m_device);
+          m_benchmark.frames  = m_config.benchmarkFrames;
+          m_benchmark.seconds = glfwGetTime() - benchmarkStart;
+          break;
+        }
+      }
+    }
+  }
+  catch (...)
+  {
+    m_renderError = std::current_exception();
+  }
+  m_rendering = false;
+  glfwPostEmptyEvent();
+}
+
+//----------------------------------------------------------------------------------------
+// Render thread: applies the events queued since the last frame, then takes the latest
+// framebuffer sizes (published before their resize events). Returns false once a window
+// was closed or Escape pressed
+bool
+Application::processWindowEvents()
+{
+  bool open = true;
+  WindowEvent event;
+  while (m_windowEvents.pop(event))
+  {
+    AppWindow& window = m_windows[event.window];
+    switch (event.type)
+    {
+      case WindowEventType::Resize:
+        window.resized   = true;
+        window.minimized = event.width == 0 || event.height == 0;
+        break;
+      case WindowEventType::Key:
+        open = open && event.key != GLFW_KEY_ESCAPE;
+        if (event.key == GLFW_KEY_F1 && m_hud.enabled())
+        {
+          m_hud.setVisible(!m_hud.visible());
+        }
+        break;
+      case WindowEventType::Close:
+        open = false;
+        break;
+    }
+  }
+  m_framebufferSizes.update();
+  return open;
+}
+
+//----------------------------------------------------------------------------------------
+// The captured frames back to back, as fast as the device draws them: nothing waits on
+// a display, so two replays of one capture on different devices or builds do the same
+// work. Timed like a benchmark, so --bench-devices can compare replays too
+void
+Application::runReplay()
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  CapturedFrame frame;
+  uint32_t frameCount = 0;
+  const auto start    = Clock::now();
+  while (m_captureReader.peek() != CaptureRecord::End)
+  {
+    if (m_captureReader.peek() == CaptureRecord::Resize)
+    {
+      resizeReplayWindow(m_captureReader.readResize()).resized = true;
+      continue;
+    }
+    m_captureReader.readFrame(frame);
+    recreateSwapChains();
+    replayFrame(frame);
+    ++frameCount;
+  }
+  vkDeviceWaitIdle(m_device);    // time the GPU's work too, not just its submission
+
+  m_benchmark.frames  = frameCount;
+  m_benchmark.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  m_benchmark.vsync   = false;
+
+  m_commandCache.printSummary();
+  m_pipelineLibrary.printSummary();
+  printPostProcessSummary();
+  printSceneSummary();
+  fmt::print(
+    "replay: {} frames in {:.3f} s, {:.3f} ms per frame\n",
+    frameCount,
+    m_benchmark.seconds,
+    frameCount > 0 ? m_benchmark.seconds * 1000.0 / frameCount : 0.0);
 }
 
 //----------------------------------------------------------------------------------------
@@ -3,6 +3,31 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>    // NB. don't include windows.h (or fmt) after glfw
 
+#include "BindlessDescriptors.h"
+#include "CommandBufferCache.h"
+#include "DeletionQueue.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "GeometryPacker.h"
+#include "GpuDrivenRenderer.h"
+#include "Hud.h"
+#include "Logger.h"
+#include "MemoryTelemetry.h"
+#include "ParticleSystem.h"
+#include "PipelineLibrary.h"
+#include "PostProcess.h"
+#include "RenderGraph.h"
+#include "ShaderReflection.h"
+#include "Simulation.h"
+#include "SpscQueue.h"
+#include "TextureManager.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <optional>
 
@@ -24,82 +49,340 @@ struct SwapChainSupportDetails
 };
 
 //----------------------------------------------------------------------------------------
+// A window and the swap chain presenting to it. Every window shares the device, render
+// pass and pipelines; only what is here is rebuilt when its swap chain is.
+struct AppWindow
+{
+  uint32_t index           = 0;
+  GLFWwindow* window       = nullptr;
+  VkSurfaceKHR surface     = VK_NULL_HANDLE;
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+  VkExtent2D extent        = {0, 0};
+  std::vector<VkImage> images;
+  std::vector<VkDeviceMemory> imageMemory;    // replay only, swap chains own theirs
+  std::vector<VkImageView> imageViews;
+  std::vector<VkFramebuffer> framebuffers;
+  std::vector<VkCommandBuffer> commandBuffers;
+  std::vector<uint64_t> recordedGenerations;    // per image, see CommandBufferCache
+  std::vector<VkFence> imagesInFlight;
+  std::vector<VkSemaphore> imageAvailableSemaphores;    // per frame in flight
+  uint32_t firstFrameResource = 0;    // GpuDrivenRenderer frame of its first image
+  RenderGraph renderGraph;
+  RenderResource backbuffer = INVALID_RENDER_RESOURCE;
+  uint32_t replayImageCount = 0;    // replay only: the captured swap chain's
+
+  // Dynamic resolution or post-processing passes only: the offscreen scene target
+  // (sized for the largest scale). Either, post-processing subpasses, the overlay or the
+  // GPU driven scene: a start and end timestamp around each image's commands, then for
+  // the GPU driven scene a start and end around each image's scene and occlusion passes
+  VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+  VkQueryPool timestampPool      = VK_NULL_HANDLE;
+  // GPU driven scene drawn straight to the swap chain only: each image's framebuffer of
+  // the scene pass, with the render graph's depth image (framebuffers goes unused)
+  std::vector<VkFramebuffer> sceneFramebuffers;
+  // GPU driven scene with pipelineStatisticsQuery and inheritedQueries only: the
+  // fragment shader invocations of each image's scene pass
+  VkQueryPool statisticsPool = VK_NULL_HANDLE;
+
+  // Post-processing only: the subpasses' transient attachments or the passes' targets
+  PostProcessTargets post;
+
+  // Occlusion culling only: the depth only pass's target (the render graph's image)
+  VkFramebuffer occlusionFramebuffer = VK_NULL_HANDLE;
+
+  // ApplicationConfig::hud only: the overlay's framebuffers, draws and timestamps
+  HudTargets hud;
+
+  // Render thread only, from window events (see Application::run())
+  bool resized   = false;    // swap chain is rebuilt at the end of the frame
+  bool minimized = false;
+
+  // CPU time between this window's presents, averaged over about a second
+  double lastPresentTime  = 0.0;
+  double frameTimeSum     = 0.0;
+  uint32_t frameTimeCount = 0;
+  double averageFrameTime = 0.0;
+  uint64_t presentCount   = 0;
+  std::string title;    // with the averages, the main thread shows it
+};
+
+//----------------------------------------------------------------------------------------
+// What the glfw callbacks on the main thread tell the render thread
+enum class WindowEventType : uint8_t
+{
+  Resize,    // new framebuffer size, 0 x 0 when minimised
+  Key,       // pressed (repeats aren't sent)
+  Close
+};
+
+struct WindowEvent
+{
+  WindowEventType type = WindowEventType::Resize;
+  uint32_t window      = 0;
+  int width            = 0;    // Resize
+  int height           = 0;
+  int key              = 0;    // Key: GLFW_KEY_*
+};
+
+//----------------------------------------------------------------------------------------
+// Options chosen on the command line (see main.cpp)
+struct ApplicationConfig
+{
+  bool gpuDriven       = false;
+  bool bindless        = false;    // descriptor indexing instead of per draw sets
+  uint32_t objectCount = 10000;
+  std::string meshPath;       // GPU driven scene mesh, empty for the built in shapes
+  std::string texturePath;    // GPU driven scene texture, empty for a checker
+  bool occlusionCulling       = false;    // GPU driven: skip objects hidden last frame
+  bool denseScene             = false;    // GPU driven: objects packed for overdraw
+  float memoryHeadroom        = 0.1f;     // warn below this fraction of a heap's budget
+  float memorySummaryInterval = 30.0f;    // seconds, 0 for none
+  uint32_t windowCount        = 1;
+  uint32_t particleCount      = 0;    // compute simulated particles, 0 for none
+  float targetFrameTime       = 0.0f;    // GPU ms for dynamic resolution, 0 for off
+  float minResolutionScale    = 0.5f;
+  float maxResolutionScale    = 1.0f;
+  uint32_t benchmarkFrames    = 0;    // timed frames before exiting, 0 to run on
+  std::string device;    // index or UUID of the device to use, empty for the best rated
+  bool deviceSweep = false;    // main.cpp: benchmark every device in turn
+  std::string capturePath;    // record every frame's inputs to this file
+  std::string replayPath;     // draw a capture's frames instead, without windows
+  PostProcessMode postProcess = PostProcessMode::Off;    // not with dynamic resolution
+  float tickRate              = 60.0f;    // simulation steps per second
+  bool hud                    = false;    // windowed only: performance overlay, F1 hides
+  bool pipelineLibrary        = true;     // VK_EXT_graphics_pipeline_library if present
+
+  // Validation messages to print (all are counted)
+  VkDebugUtilsMessageSeverityFlagsEXT logSeverities = Logger::ALL_SEVERITIES;
+  VkDebugUtilsMessageTypeFlagsEXT logTypes          = Logger::ALL_TYPES;
+
+  // Replay renders offscreen: no glfw, surfaces, swap chains or presents
+  bool headless() const { return !replayPath.empty(); }
+};
+
+//----------------------------------------------------------------------------------------
+// A physical device as --device and the device benchmark name it
+struct PhysicalDeviceInfo
+{
+  uint32_t index = 0;    // in vkEnumeratePhysicalDevices order
+  std::string name;
+  std::string type;    // "discrete", "integrated", "virtual", "cpu" or "other"
+  std::string uuid;    // deviceUUID, stable across runs and device enumeration order
+};
+
+//----------------------------------------------------------------------------------------
+// Frames timed with ApplicationConfig::benchmarkFrames, after a warm up
+struct BenchmarkResult
+{
+  PhysicalDeviceInfo device;
+  uint32_t frames = 0;
+  double seconds  = 0.0;
+  bool vsync      = false;    // only FIFO presentation: capped at the display rate
+};
+
+//----------------------------------------------------------------------------------------
+// Timestamps written by a submitted command buffer, read back once its fence is waited
+struct TimestampQuery
+{
+  VkQueryPool pool = VK_NULL_HANDLE;
+  uint32_t first   = 0;    // start, first + 1 is the end
+};
+
+// The GPU driven scene's queries of a submitted command buffer, read back like the
+// TimestampQuery of its frame
+struct SceneQuery
+{
+  uint32_t view              = 0;
+  VkQueryPool timestampPool  = VK_NULL_HANDLE;
+  uint32_t firstTimestamp    = 0;    // scene pass start and end, occlusion pass the same
+  VkQueryPool statisticsPool = VK_NULL_HANDLE;    // null: fragments aren't counted
+  uint32_t statistics        = 0;
+};
 
 //----------------------------------------------------------------------------------------
 class Application
 {
-  GLFWwindow* m_window              = nullptr;
+  ApplicationConfig m_config;
+  Logger m_logger;    // stopped last, the debug messenger calls it until then
+
+  std::vector<AppWindow> m_windows;    // never resized, glfw holds pointers to them
   VkInstance m_instance             = VK_NULL_HANDLE;
-  VkSurfaceKHR m_surface            = VK_NULL_HANDLE;
   VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
   VkDevice m_device                 = VK_NULL_HANDLE;
-  VkQueue m_graphicsQueue;
-  VkQueue m_presentQueue;
-  VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
-  std::vector<VkImage> m_swapChainImages;
-  std::vector<VkImageView> m_swapChainImageViews;
-  VkFormat m_swapChainImageFormat;
-  VkExtent2D m_swapChainExtent;
-  VkRenderPass m_renderPass;
+  VkQueue m_graphicsQueue           = VK_NULL_HANDLE;
+  VkQueue m_presentQueue            = VK_NULL_HANDLE;
+  VkFormat m_swapChainImageFormat   = VK_FORMAT_UNDEFINED;    // shared by every window
+  VkPresentModeKHR m_presentMode    = VK_PRESENT_MODE_FIFO_KHR;
+  VkRenderPass m_renderPass         = VK_NULL_HANDLE;
+  VkFormat m_sceneDepthFormat       = VK_FORMAT_UNDEFINED;    // GPU driven scene only
   VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
-  VkPipeline m_graphicsPipeline;
-  std::vector<VkFramebuffer> m_swapChainFramebuffers;
-  VkCommandPool m_commandPool;
-  std::vector<VkCommandBuffer> m_commandBuffers;
-  std::vector<VkSemaphore> m_imageAvailableSemaphores;
+  VkCommandPool m_commandPool       = VK_NULL_HANDLE;
   std::vector<VkSemaphore> m_renderFinishedSemaphores;
   std::vector<VkFence> m_inFlightFences;
+  std::vector<uint64_t> m_inFlightFrames;    // frame last submitted with each fence
+  std::vector<std::vector<TimestampQuery>> m_frameTimestamps;    // per frame in flight
+  std::vector<std::vector<SceneQuery>> m_sceneQueries;           // per frame in flight
   size_t m_currentFrame = 0;
+  DeletionQueue m_deletionQueue;
+
+  VkPhysicalDeviceFeatures m_enabledFeatures = {};
+  bool m_drawIndirectCountSupported          = false;
+  bool m_multiDrawIndirectSupported          = false;
+  bool m_memoryBudgetSupported               = false;
+  bool m_pipelineLibrarySupported            = false;
+  bool m_pipelineStatisticsSupported         = false;    // GPU driven only
+  MemoryTelemetry m_memoryTelemetry;
+  DynamicResolution m_dynamicResolution;
+  float m_timestampPeriod  = 0.0f;    // ns per tick
+  uint64_t m_timestampMask = 0;       // 0: frames aren't timed
+  double m_gpuTimeSum      = 0.0;     // ms, over every timed frame
+  uint64_t m_gpuTimeCount  = 0;
+  float m_lastGpuTime      = 0.0f;    // ms, the last frame read back
+  double m_lastFrameStart  = 0.0;     // glfw time, for the overlay's CPU frame time
+
+  // The GPU driven scene, over every window's frames read back (printSceneSummary())
+  double m_sceneTimeSum     = 0.0;    // ms, scene passes
+  double m_occlusionTimeSum = 0.0;    // ms, occlusion passes
+  uint64_t m_sceneTimeCount = 0;
+  uint64_t m_fragmentSum    = 0;    // fragment shader invocations of the scene passes
+  uint64_t m_fragmentCount  = 0;
+  uint64_t m_occludedSum    = 0;    // objects skipped by the occlusion culling
+  uint64_t m_sceneFrames    = 0;
 
-  bool m_framebufferResized = false;
+  GeometryPacker m_geometryPacker;
+  TextureManager m_textureManager;
+  BindlessDescriptors m_bindless;
+  PipelineLayoutCache m_layoutCache;    // layouts generated from shader reflection
+  PipelineLibrary m_pipelineLibrary;
+  PipelineHandle m_scenePipeline = INVALID_PIPELINE;    // the triangle's
+  GpuDrivenRenderer m_gpuDrivenRenderer;
+  ParticleSystem m_particles;
+  PostProcess m_postProcess;
+  Hud m_hud;
+  Simulation m_simulation;    // windowed GPU driven runs, a replay has its states
+
+  // The scene pass's contents, shared by every window and image
+  CommandBufferCache m_commandCache;
+  CommandBucket m_sceneBucket    = 0;    // GPU driven objects (per frame) or triangle
+  CommandBucket m_particleBucket = 0;
+
+  // The device (from pickPhysicalDevice()) and, with benchmarkFrames or a replay, its
+  // timings
+  BenchmarkResult m_benchmark;
+
+  CaptureWriter m_captureWriter;    // ApplicationConfig::capturePath
+  CaptureReader m_captureReader;    // ApplicationConfig::replayPath
+
+  // Windowed runs keep the glfw event loop on the main thread and render on a thread of
+  // their own, so a blocking acquire, present or fence wait doesn't hold up events. The
+  // callbacks queue events for the render thread, which also reads the latest
+  // framebuffer sizes (glfw only answers on the main thread) and sends window titles
+  // back
+  static constexpr uint32_t WINDOW_EVENT_CAPACITY = 256;
+  SpscQueue<WindowEvent, WINDOW_EVENT_CAPACITY> m_windowEvents;
+  // Raised with every push, so the render thread can sleep while every window is
+  // minimised
+  std::mutex m_windowEventMutex;
+  std::condition_variable m_windowEventPushed;
+  bool m_windowEventPending = false;
+  TripleBuffer<std::vector<VkExtent2D>> m_framebufferSizes;
+  TripleBuffer<std::vector<std::string>> m_windowTitles;
+  std::atomic<bool> m_rendering{false};
+  std::exception_ptr m_renderError;
 
 private:
   void setupDebugMessenger();
 
   void createInstance();
+  void createWindows();
   bool checkValidationLayerSupport();
   std::vector<const char*> getRequiredExtensions();
+  static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+  static void
+  keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+  void pushWindowEvent(GLFWwindow* window, WindowEvent event);
+  void publishFramebufferSizes();
+  VkExtent2D framebufferSize(const AppWindow& window) const;
 
   QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device);
-  void createSurface();
+  void createSurfaces();
   void pickPhysicalDevice();
   int rateDeviceSuitability(const VkPhysicalDevice& device);
   bool checkDeviceExtensionSupport(const VkPhysicalDevice& device);
 
   void createLogicalDevice();
+  void initFrameTimestamps();
 
-  void createSwapChain();
-  SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  void createSwapChain(AppWindow& window);
+  void createReplayImages(AppWindow& window);
+  SwapChainSupportDetails
+  querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
   VkSurfaceFormatKHR
   chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
   VkPresentModeKHR
   chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
-  VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+  VkExtent2D
+  chooseSwapExtent(
+    const VkSurfaceCapabilitiesKHR& capabilities,
+    const AppWindow& window) const;
 
-  void createImageViews();
+  void createImageViews(AppWindow& window);
   void createRenderPass();
 
-  VkShaderModule createShaderModule(const std::vector<char>& code);
   void createGraphicsPipeline();
-  void createFramebuffers();
+  void createFramebuffers(AppWindow& window);
+  void createGpuDrivenFrames();
+  void createRenderGraph(AppWindow& window);
   void createCommandPool();
-  void createCommandBuffers();
+  void createCommandBuckets();
+  void createCommandBuffers(AppWindow& window);
+  void recordCommandBuffer(AppWindow& window, size_t imageIndex);
   void createSyncObjects();
+  bool sceneOffscreen() const;
+  VkExtent2D sceneExtent(const AppWindow& window, float scale) const;
 
+  glm::mat4 computeViewProjection(VkExtent2D extent, float cameraYaw) const;
+  void beginFrame();
+  void submitFrame(
+    const std::vector<AppWindow*>& targets,
+    const std::vector<uint32_t>& imageIndices,
+    const std::vector<VkSemaphore>& waitSemaphores,
+    const SceneState& scene);
   void drawFrame();
+  void replayFrame(const CapturedFrame& frame);
+  AppWindow& resizeReplayWindow(const CapturedResize& resize);
+  void runReplay();
+  void renderLoop();
+  bool processWindowEvents();
+  void reportFrameTime(AppWindow& window, double now);
+  void readFrameTimestamps();
+  void readSceneQueries();
+  void printPostProcessSummary() const;
+  void printSceneSummary() const;
+  void updateHud();
 
-  void recreateSwapChain();
-  void cleanupSwapChain();
+  void recreateSwapChains();
+  void retireSwapChain(AppWindow& window);
+  void retireCommandBuffers(AppWindow& window);
+  void retireRenderGraph(AppWindow& window);
 
   void cleanup();
 
 public:
+  explicit Application(const ApplicationConfig& config = {})
+      : m_config(config)
+  {
+  }
   ~Application() { cleanup(); }
 
   void init();
   void run();
 
-  void setFramebufferResized() { m_framebufferResized = true; }
+  // Valid after run() with ApplicationConfig::benchmarkFrames or replayPath set
+  const BenchmarkResult& benchmarkResult() const { return m_benchmark; }
+
+  // Every device the loader reports, through an instance of its own
+  static std::vector<PhysicalDeviceInfo> listPhysicalDevices();
 };
 
 //----------------------------------------------------------------------------------------
@@ -0,0 +1,375 @@
+#include <fmt/format.h>
+
+#include "BindlessDescriptors.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+// Array sizes we ask for (clamped to the device's update-after-bind limits)
+constexpr uint32_t MAX_BINDLESS_STORAGE_BUFFERS = 4096;
+constexpr uint32_t MAX_BINDLESS_SAMPLED_IMAGES  = 16384;
+constexpr uint32_t MAX_BINDLESS_SAMPLERS        = 64;
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::SlotAllocator::reset(uint32_t capacity)
+{
+  m_capacity = capacity;
+  m_next     = 0;
+  m_free.clear();
+  m_retired.clear();
+}
+
+//----------------------------------------------------------------------------------------
+BindlessIndex
+BindlessDescriptors::SlotAllocator::allocate()
+{
+  if (!m_free.empty())
+  {
+    BindlessIndex slot = m_free.back();
+    m_free.pop_back();
+    return slot;
+  }
+  if (m_next == m_capacity)
+  {
+    throw std::runtime_error(
+      fmt::format("bindless descriptor array is full ({} slots)!", m_capacity));
+  }
+  return m_next++;
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::SlotAllocator::release(BindlessIndex slot, uint64_t frame)
+{
+  assert(slot < m_next);
+  m_retired.emplace_back(slot, frame);
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::SlotAllocator::recycle(uint64_t completedFrame)
+{
+  // Retired in frame order, so the reusable ones are at the front
+  auto end = std::find_if(
+    m_retired.begin(), m_retired.end(), [completedFrame](const auto& retired) {
+      return retired.second > completedFrame;
+    });
+  for (auto it = m_retired.begin(); it != end; ++it)
+  {
+    m_free.push_back(it->first);
+  }
+  m_retired.erase(m_retired.begin(), end);
+}
+
+//----------------------------------------------------------------------------------------
+bool
+BindlessDescriptors::isSupported(
+  VkPhysicalDevice physicalDevice,
+  VkPhysicalDeviceFeatures& features,
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures)
+{
+  if (!isDeviceExtensionSupported(
+        physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported = {};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext                     = &supported;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+  // Push constant (dynamically uniform) indices into the buffer and sampler arrays
+  features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+  features.shaderSampledImageArrayDynamicIndexing  = VK_TRUE;
+
+  // Per instance (non-uniform) texture indices, and slot updates after binding
+  indexingFeatures = {};
+  indexingFeatures.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+  indexingFeatures.runtimeDescriptorArray                        = VK_TRUE;
+  indexingFeatures.descriptorBindingPartiallyBound               = VK_TRUE;
+  indexingFeatures.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+  indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  indexingFeatures.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+  indexingFeatures.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+
+  const VkPhysicalDeviceFeatures& core = features2.features;
+  return core.shaderStorageBufferArrayDynamicIndexing
+         && core.shaderSampledImageArrayDynamicIndexing
+         && supported.runtimeDescriptorArray && supported.descriptorBindingPartiallyBound
+         && supported.descriptorBindingUpdateUnusedWhilePending
+         && supported.descriptorBindingStorageBufferUpdateAfterBind
+         && supported.descriptorBindingSampledImageUpdateAfterBind
+         && supported.shaderSampledImageArrayNonUniformIndexing;
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  uint32_t framesInFlight)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+
+  m_device         = device;
+  m_framesInFlight = framesInFlight;
+  m_frame          = 0;
+
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT limits = {};
+  limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &limits;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+  // Every binding is visible to all stages, so the per stage limits apply
+  uint32_t bufferCount = std::min(
+    {MAX_BINDLESS_STORAGE_BUFFERS,
+     limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+     limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+  uint32_t samplerCount = std::min(
+    {MAX_BINDLESS_SAMPLERS,
+     limits.maxDescriptorSetUpdateAfterBindSamplers,
+     limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+  uint32_t imageCount = std::min(
+    {MAX_BINDLESS_SAMPLED_IMAGES,
+     limits.maxDescriptorSetUpdateAfterBindSampledImages,
+     limits.maxPerStageDescriptorUpdateAfterBindSampledImages});
+  const uint32_t maxResources = limits.maxPerStageUpdateAfterBindResources;
+  if (bufferCount + samplerCount + imageCount > maxResources)
+  {
+    imageCount = maxResources - std::min(maxResources, bufferCount + samplerCount);
+  }
+  m_storageBuffers.reset(bufferCount);
+  m_sampledImages.reset(imageCount);
+  m_samplers.reset(samplerCount);
+  fmt::print(
+    "Bindless descriptors: {} storage buffers, {} sampled images, {} samplers\n",
+    bufferCount,
+    imageCount,
+    samplerCount);
+
+  VkDescriptorSetLayoutBinding bindings[3] = {};
+  bindings[0].binding         = BINDLESS_STORAGE_BUFFER_BINDING;
+  bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[0].descriptorCount = bufferCount;
+  bindings[0].stageFlags      = VK_SHADER_STAGE_ALL;
+
+  bindings[1].binding         = BINDLESS_SAMPLED_IMAGE_BINDING;
+  bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  bindings[1].descriptorCount = imageCount;
+  bindings[1].stageFlags      = VK_SHADER_STAGE_ALL;
+
+  bindings[2].binding         = BINDLESS_SAMPLER_BINDING;
+  bindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLER;
+  bindings[2].descriptorCount = samplerCount;
+  bindings[2].stageFlags      = VK_SHADER_STAGE_ALL;
+
+  // Unwritten slots are fine as long as shaders don't use them, and slots can be
+  // written while the set is bound in pending command buffers that don't use them
+  const VkDescriptorBindingFlagsEXT bindingFlag =
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+    | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+    | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+  const VkDescriptorBindingFlagsEXT bindingFlags[3] = {
+    bindingFlag, bindingFlag, bindingFlag};
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo = {};
+  flagsInfo.sType =
+    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+  flagsInfo.bindingCount  = 3;
+  flagsInfo.pBindingFlags = bindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.pNext        = &flagsInfo;
+  layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+  layoutInfo.bindingCount = 3;
+  layoutInfo.pBindings    = bindings;
+
+  if (
+    vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_layout)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create bindless descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize poolSizes[3] = {};
+  poolSizes[0].type                 = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[0].descriptorCount      = bufferCount;
+  poolSizes[1].type                 = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  poolSizes[1].descriptorCount      = imageCount;
+  poolSizes[2].type                 = VK_DESCRIPTOR_TYPE_SAMPLER;
+  poolSizes[2].descriptorCount      = samplerCount;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+  poolInfo.poolSizeCount = 3;
+  poolInfo.pPoolSizes    = poolSizes;
+  poolInfo.maxSets       = 1;
+
+  if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create bindless descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool              = m_pool;
+  allocInfo.descriptorSetCount          = 1;
+  allocInfo.pSetLayouts                 = &m_layout;
+
+  if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_set) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate the bindless descriptor set!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+  m_pool   = VK_NULL_HANDLE;
+  m_layout = VK_NULL_HANDLE;
+  m_set    = VK_NULL_HANDLE;
+  m_device = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::write(
+  uint32_t binding,
+  BindlessIndex slot,
+  VkDescriptorType type,
+  const VkDescriptorBufferInfo* bufferInfo,
+  const VkDescriptorImageInfo* imageInfo)
+{
+  VkWriteDescriptorSet write = {};
+  write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet               = m_set;
+  write.dstBinding           = binding;
+  write.dstArrayElement      = slot;
+  write.descriptorCount      = 1;
+  write.descriptorType       = type;
+  write.pBufferInfo          = bufferInfo;
+  write.pImageInfo           = imageInfo;
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
+BindlessIndex
+BindlessDescriptors::addStorageBuffer(
+  VkBuffer buffer,
+  VkDeviceSize offset,
+  VkDeviceSize range)
+{
+  const BindlessIndex slot = m_storageBuffers.allocate();
+
+  VkDescriptorBufferInfo bufferInfo = {buffer, offset, range};
+  write(
+    BINDLESS_STORAGE_BUFFER_BINDING,
+    slot,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    &bufferInfo,
+    nullptr);
+  return slot;
+}
+
+//----------------------------------------------------------------------------------------
+BindlessIndex
+BindlessDescriptors::addSampledImage(VkImageView view, VkImageLayout layout)
+{
+  const BindlessIndex slot = m_sampledImages.allocate();
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.imageView             = view;
+  imageInfo.imageLayout           = layout;
+  write(
+    BINDLESS_SAMPLED_IMAGE_BINDING,
+    slot,
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    nullptr,
+    &imageInfo);
+  return slot;
+}
+
+//----------------------------------------------------------------------------------------
+BindlessIndex
+BindlessDescriptors::addSampler(VkSampler sampler)
+{
+  const BindlessIndex slot = m_samplers.allocate();
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.sampler               = sampler;
+  write(BINDLESS_SAMPLER_BINDING, slot, VK_DESCRIPTOR_TYPE_SAMPLER, nullptr, &imageInfo);
+  return slot;
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::removeStorageBuffer(BindlessIndex index)
+{
+  m_storageBuffers.release(index, m_frame);
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::removeSampledImage(BindlessIndex index)
+{
+  m_sampledImages.release(index, m_frame);
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::removeSampler(BindlessIndex index)
+{
+  m_samplers.release(index, m_frame);
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::nextFrame()
+{
+  ++m_frame;
+  if (m_frame < m_framesInFlight)
+  {
+    return;
+  }
+
+  // Every frame up to this one has had its fence waited on
+  const uint64_t completedFrame = m_frame - m_framesInFlight;
+  m_storageBuffers.recycle(completedFrame);
+  m_sampledImages.recycle(completedFrame);
+  m_samplers.recycle(completedFrame);
+}
+
+//----------------------------------------------------------------------------------------
+void
+BindlessDescriptors::bind(
+  VkCommandBuffer commandBuffer,
+  VkPipelineBindPoint bindPoint,
+  VkPipelineLayout pipelineLayout,
+  uint32_t set) const
+{
+  vkCmdBindDescriptorSets(
+    commandBuffer, bindPoint, pipelineLayout, set, 1, &m_set, 0, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
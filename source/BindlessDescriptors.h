@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+using BindlessIndex                            = uint32_t;
+constexpr BindlessIndex INVALID_BINDLESS_INDEX = ~0u;
+
+// Bindings of the bindless set; each is an array indexed with a BindlessIndex
+constexpr uint32_t BINDLESS_STORAGE_BUFFER_BINDING = 0;
+constexpr uint32_t BINDLESS_SAMPLED_IMAGE_BINDING  = 1;
+constexpr uint32_t BINDLESS_SAMPLER_BINDING        = 2;
+
+//----------------------------------------------------------------------------------------
+// One global descriptor set (VK_EXT_descriptor_indexing) holding every storage buffer,
+// sampled image and sampler in large partially bound, update-after-bind arrays.
+//  - The set is bound once per command buffer; shaders pick resources with indices
+//    from push constants or per instance data instead of per draw descriptor binds.
+//  - Slots can be added and removed while command buffers using the set are pending.
+//    A removed slot is only reused after framesInFlight calls to nextFrame(), so
+//    frames still in flight never see its descriptor replaced.
+//----------------------------------------------------------------------------------------
+class BindlessDescriptors
+{
+  class SlotAllocator
+  {
+    uint32_t m_capacity = 0;
+    uint32_t m_next     = 0;
+    std::vector<uint32_t> m_free;
+    std::vector<std::pair<uint32_t, uint64_t>> m_retired;    // slot, frame removed
+
+  public:
+    void reset(uint32_t capacity);
+    uint32_t capacity() const { return m_capacity; }
+    BindlessIndex allocate();
+    void release(BindlessIndex slot, uint64_t frame);
+    void recycle(uint64_t completedFrame);
+  };
+
+  VkDevice m_device              = VK_NULL_HANDLE;
+  VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+  VkDescriptorPool m_pool        = VK_NULL_HANDLE;
+  VkDescriptorSet m_set          = VK_NULL_HANDLE;
+  uint32_t m_framesInFlight      = 0;
+  uint64_t m_frame               = 0;
+  SlotAllocator m_storageBuffers;
+  SlotAllocator m_sampledImages;
+  SlotAllocator m_samplers;
+
+private:
+  void write(
+    uint32_t binding,
+    BindlessIndex slot,
+    VkDescriptorType type,
+    const VkDescriptorBufferInfo* bufferInfo,
+    const VkDescriptorImageInfo* imageInfo);
+
+public:
+  // Turns on the core features bindless indexing needs in `features` and fills
+  // `indexingFeatures` to chain into VkDeviceCreateInfo. Returns false if the device
+  // lacks any of them.
+  static bool isSupported(
+    VkPhysicalDevice physicalDevice,
+    VkPhysicalDeviceFeatures& features,
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures);
+
+  // The device must have been created with the features from isSupported()
+  void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight);
+  void cleanup();
+
+  BindlessIndex addStorageBuffer(
+    VkBuffer buffer,
+    VkDeviceSize offset = 0,
+    VkDeviceSize range  = VK_WHOLE_SIZE);
+  BindlessIndex addSampledImage(VkImageView view, VkImageLayout layout);
+  BindlessIndex addSampler(VkSampler sampler);
+
+  void removeStorageBuffer(BindlessIndex index);
+  void removeSampledImage(BindlessIndex index);
+  void removeSampler(BindlessIndex index);
+
+  // Call once per frame after waiting for the frame's fence
+  void nextFrame();
+
+  VkDescriptorSetLayout layout() const { return m_layout; }
+  void bind(
+    VkCommandBuffer commandBuffer,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set) const;
+};
+
+//----------------------------------------------------------------------------------------
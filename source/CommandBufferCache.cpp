@@ -0,0 +1,207 @@
+#include <fmt/format.h>
+
+#include "CommandBufferCache.h"
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+// Variants times extents kept per bucket; a window being resized or a dynamic resolution
+// scale that keeps moving would otherwise keep adding extents
+constexpr size_t MAX_BUCKET_ENTRIES = 32;
+
+//----------------------------------------------------------------------------------------
+void
+CommandBufferCache::init(
+  VkDevice device,
+  VkCommandPool commandPool,
+  DeletionQueue& deletionQueue,
+  VkQueryPipelineStatisticFlags pipelineStatistics)
+{
+  m_device             = device;
+  m_commandPool        = commandPool;
+  m_deletionQueue      = &deletionQueue;
+  m_pipelineStatistics = pipelineStatistics;
+}
+
+//----------------------------------------------------------------------------------------
+void
+CommandBufferCache::cleanup()
+{
+  for (Bucket& bucket : m_buckets)
+  {
+    for (const Entry& entry : bucket.entries)
+    {
+      vkFreeCommandBuffers(m_device, m_commandPool, 1, &entry.commandBuffer);
+    }
+  }
+  m_buckets.clear();
+}
+
+//----------------------------------------------------------------------------------------
+CommandBucket
+CommandBufferCache::addBucket(
+  const std::string& name,
+  VkRenderPass renderPass,
+  RecordFunction record)
+{
+  Bucket bucket;
+  bucket.name       = name;
+  bucket.renderPass = renderPass;
+  bucket.record     = std::move(record);
+  m_buckets.push_back(std::move(bucket));
+  return static_cast<CommandBucket>(m_buckets.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+void
+CommandBufferCache::invalidate(CommandBucket bucket)
+{
+  assert(bucket < m_buckets.size());
+  retire(m_buckets[bucket].entries);
+}
+
+//----------------------------------------------------------------------------------------
+VkCommandBuffer
+CommandBufferCache::get(CommandBucket bucket, uint32_t variant, VkExtent2D extent)
+{
+  assert(bucket < m_buckets.size());
+  std::vector<Entry>& entries = m_buckets[bucket].entries;
+
+  auto found = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+    return entry.variant == variant && entry.extent.width == extent.width
+           && entry.extent.height == extent.height;
+  });
+  if (found != entries.end())
+  {
+    found->lastUse = ++m_useCount;
+    ++m_reuseCount;
+    return found->commandBuffer;
+  }
+
+  // Drop the least recently used entry first; the caller's primary isn't using it
+  if (entries.size() >= MAX_BUCKET_ENTRIES)
+  {
+    auto oldest = std::min_element(
+      entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUse < b.lastUse;
+      });
+    std::vector<Entry> evicted = {*oldest};
+    entries.erase(oldest);
+    retire(evicted);
+  }
+
+  Entry entry         = {};
+  entry.commandBuffer = record(m_buckets[bucket], variant, extent);
+  entry.variant       = variant;
+  entry.extent        = extent;
+  entry.lastUse       = ++m_useCount;
+  entries.push_back(entry);
+  return entry.commandBuffer;
+}
+
+//----------------------------------------------------------------------------------------
+VkCommandBuffer
+CommandBufferCache::record(Bucket& bucket, uint32_t variant, VkExtent2D extent)
+{
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool                 = m_commandPool;
+  allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  allocInfo.commandBufferCount          = 1;
+
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate secondary command buffer!");
+  }
+
+  // No framebuffer: the buffer runs inside any framebuffer of a compatible render pass
+  VkCommandBufferInheritanceInfo inheritanceInfo = {};
+  inheritanceInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass         = bucket.renderPass;
+  inheritanceInfo.subpass            = 0;
+  inheritanceInfo.framebuffer        = VK_NULL_HANDLE;
+  inheritanceInfo.pipelineStatistics = m_pipelineStatistics;
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT
+                    | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+  {
+    throw std::runtime_error(
+      fmt::format("failed to begin recording command bucket {}!", bucket.name));
+  }
+
+  // Secondaries don't inherit dynamic state
+  VkViewport viewport = {};
+  viewport.width      = static_cast<float>(extent.width);
+  viewport.height     = static_cast<float>(extent.height);
+  viewport.minDepth   = 0.0f;
+  viewport.maxDepth   = 1.0f;
+  VkRect2D scissor    = {{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  bucket.record(commandBuffer, variant, extent);
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error(
+      fmt::format("failed to record command bucket {}!", bucket.name));
+  }
+  ++m_recordCount;
+  return commandBuffer;
+}
+
+//----------------------------------------------------------------------------------------
+// Primaries may still execute the buffers, so they go once the frames in flight are done
+// and every primary recorded before now has to be recorded again
+void
+CommandBufferCache::retire(std::vector<Entry>& entries)
+{
+  if (entries.empty())
+  {
+    return;
+  }
+
+  std::vector<VkCommandBuffer> commandBuffers;
+  for (const Entry& entry : entries)
+  {
+    commandBuffers.push_back(entry.commandBuffer);
+  }
+  m_deletionQueue->push([device         = m_device,
+                         commandPool    = m_commandPool,
+                         commandBuffers = std::move(commandBuffers)]() {
+    vkFreeCommandBuffers(
+      device,
+      commandPool,
+      static_cast<uint32_t>(commandBuffers.size()),
+      commandBuffers.data());
+  });
+  entries.clear();
+  ++m_generation;
+}
+
+//----------------------------------------------------------------------------------------
+void
+CommandBufferCache::printSummary() const
+{
+  size_t cached = 0;
+  for (const Bucket& bucket : m_buckets)
+  {
+    cached += bucket.entries.size();
+  }
+  fmt::print(
+    "command buffer cache: {} buckets, {} secondaries cached, {} recorded, {} reused\n",
+    m_buckets.size(),
+    cached,
+    m_recordCount,
+    m_reuseCount);
+}
+
+//----------------------------------------------------------------------------------------
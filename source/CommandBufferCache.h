@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class DeletionQueue;
+
+using CommandBucket = uint32_t;
+
+//----------------------------------------------------------------------------------------
+// Secondary command buffers for the contents of a render pass, recorded once and then
+// executed from any number of primaries.
+// The contents are split into buckets (e.g. the GPU driven objects, the particles).
+// A bucket is recorded per variant (whatever its commands depend on besides the
+// render area, e.g. a frame's descriptor set) and render area extent, and the result is
+// reused for as long as the bucket isn't invalidated, across frames, swap chain images
+// and windows. Invalidating a bucket only drops its own buffers, so a mostly static
+// scene with a small dynamic part records little more than that part.
+// Buffers are never recorded again in place, replaced ones go to the deletion queue as
+// the frames in flight may still execute them. Primaries that executed a replaced
+// buffer are invalid though: generation() changes whenever that can happen, and
+// primaries recorded at an older generation must be recorded again before they are
+// next submitted.
+//----------------------------------------------------------------------------------------
+class CommandBufferCache
+{
+public:
+  // Records the bucket's commands; the viewport and scissor are already set to extent
+  using RecordFunction =
+    std::function<void(VkCommandBuffer, uint32_t variant, VkExtent2D extent)>;
+
+private:
+  struct Entry
+  {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    uint32_t variant              = 0;
+    VkExtent2D extent             = {0, 0};
+    uint64_t lastUse              = 0;
+  };
+
+  struct Bucket
+  {
+    std::string name;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    RecordFunction record;
+    std::vector<Entry> entries;
+  };
+
+  VkDevice m_device                                  = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool                        = VK_NULL_HANDLE;
+  DeletionQueue* m_deletionQueue                     = nullptr;
+  VkQueryPipelineStatisticFlags m_pipelineStatistics = 0;
+  std::vector<Bucket> m_buckets;
+  uint64_t m_generation = 0;
+  uint64_t m_useCount   = 0;    // stamps Entry::lastUse
+
+  uint64_t m_recordCount = 0;
+  uint64_t m_reuseCount  = 0;
+
+private:
+  VkCommandBuffer record(Bucket& bucket, uint32_t variant, VkExtent2D extent);
+  void retire(std::vector<Entry>& entries);
+
+public:
+  // pipelineStatistics: what the primaries' pipeline statistics queries active around
+  // the buffers may count (needs the pipelineStatisticsQuery and inheritedQueries
+  // features), 0 for none
+  void init(
+    VkDevice device,
+    VkCommandPool commandPool,
+    DeletionQueue& deletionQueue,
+    VkQueryPipelineStatisticFlags pipelineStatistics);
+  // The device must be idle
+  void cleanup();
+
+  // The bucket's commands go in subpass 0 of renderPass (or a compatible render pass)
+  CommandBucket
+  addBucket(const std::string& name, VkRenderPass renderPass, RecordFunction record);
+  // Its contents, pipeline or descriptors changed: every variant is recorded again when
+  // next used
+  void invalidate(CommandBucket bucket);
+  // Something outside the buckets changed: only the primaries are recorded again
+  void invalidatePrimaries() { ++m_generation; }
+
+  uint64_t generation() const { return m_generation; }
+
+  // The bucket's buffer for this variant and extent, recorded now if there is none
+  VkCommandBuffer get(CommandBucket bucket, uint32_t variant, VkExtent2D extent);
+
+  void printSummary() const;
+};
+
+//----------------------------------------------------------------------------------------
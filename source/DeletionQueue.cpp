@@ -0,0 +1,39 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------
+void
+DeletionQueue::push(std::function<void()> destroy)
+{
+  if (m_completedFrames >= m_submittedFrames)
+  {
+    destroy();
+    return;
+  }
+  m_pending.emplace_back(m_submittedFrames, std::move(destroy));
+}
+
+//----------------------------------------------------------------------------------------
+void
+DeletionQueue::frameCompleted(uint64_t frame)
+{
+  m_completedFrames = std::max(m_completedFrames, frame);
+
+  // Pushed in frame order, so everything that can go is at the front
+  while (!m_pending.empty() && m_pending.front().first <= m_completedFrames)
+  {
+    auto destroy = std::move(m_pending.front().second);
+    m_pending.pop_front();
+    destroy();
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+DeletionQueue::flush()
+{
+  frameCompleted(m_submittedFrames);
+}
+
+//----------------------------------------------------------------------------------------
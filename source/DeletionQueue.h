@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+//----------------------------------------------------------------------------------------
+// Destroys GPU objects once the frames that may still use them have finished, instead
+// of waiting for the device to go idle.
+// Frames are numbered in submission order. Retiring an object tags it with the last
+// submitted frame; when the caller has waited on that frame's fence, frameCompleted()
+// runs its destroy function (work on one queue completes in submission order, so every
+// earlier frame is done too).
+//----------------------------------------------------------------------------------------
+class DeletionQueue
+{
+  std::deque<std::pair<uint64_t, std::function<void()>>> m_pending;    // frame, destroy
+  uint64_t m_submittedFrames = 0;
+  uint64_t m_completedFrames = 0;
+
+public:
+  // Runs destroy once every frame submitted so far has completed (straight away if
+  // nothing is in flight)
+  void push(std::function<void()> destroy);
+
+  // Returns the new frame's number, to hand back to frameCompleted()
+  uint64_t frameSubmitted() { return ++m_submittedFrames; }
+  void frameCompleted(uint64_t frame);
+
+  // Runs everything still pending; the device must be idle
+  void flush();
+
+  size_t pendingCount() const { return m_pending.size(); }
+};
+
+//----------------------------------------------------------------------------------------
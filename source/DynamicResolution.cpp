@@ -0,0 +1,101 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------
+constexpr uint32_t AVERAGED_FRAMES = 8;
+constexpr float SCALE_STEP         = 1.0f / 32.0f;
+constexpr float RAISE_BELOW        = 0.85f;    // of the target time
+constexpr float DAMPING            = 0.5f;     // of the way to the ideal scale per step
+
+//----------------------------------------------------------------------------------------
+void
+DynamicResolution::init(
+  float targetTime,
+  float minScale,
+  float maxScale,
+  uint32_t skipFrames)
+{
+  assert(minScale > 0.0f && minScale <= maxScale);
+
+  m_targetTime  = targetTime;
+  m_minScale    = minScale;
+  m_maxScale    = maxScale;
+  m_scale       = maxScale;
+  m_averageTime = 0.0f;
+  m_timeSum     = 0.0f;
+  m_sampleCount = 0;
+  m_skipCount   = skipFrames;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+DynamicResolution::addFrameTime(float gpuTime)
+{
+  if (!enabled())
+  {
+    return false;
+  }
+  if (m_sampleCount++ < m_skipCount)
+  {
+    return false;
+  }
+  m_timeSum += gpuTime;
+  if (m_sampleCount < m_skipCount + AVERAGED_FRAMES)
+  {
+    return false;
+  }
+
+  m_averageTime = m_timeSum / AVERAGED_FRAMES;
+  m_timeSum     = 0.0f;
+  m_sampleCount = m_skipCount;    // unchanged: keep measuring without skipping
+
+  // Between RAISE_BELOW and the target is close enough
+  const float ratio = m_targetTime / std::max(m_averageTime, 0.001f);
+  if (ratio >= 1.0f && ratio <= 1.0f / RAISE_BELOW)
+  {
+    return false;
+  }
+
+  // Move at least one step the right way, however small the error
+  const float ideal = m_scale * std::sqrt(ratio);
+  float scale       = m_scale + (ideal - m_scale) * DAMPING;
+  scale             = std::round(scale / SCALE_STEP) * SCALE_STEP;
+  if (ratio < 1.0f)
+  {
+    scale = std::min(scale, m_scale - SCALE_STEP);
+  }
+  else
+  {
+    scale = std::max(scale, m_scale + SCALE_STEP);
+  }
+  scale = std::min(std::max(scale, m_minScale), m_maxScale);
+  if (std::abs(scale - m_scale) < 0.5f * SCALE_STEP)
+  {
+    return false;    // already at the limit
+  }
+
+  m_scale       = scale;
+  m_sampleCount = 0;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+DynamicResolution::setScale(float scale)
+{
+  scale = std::min(std::max(scale, m_minScale), m_maxScale);
+  if (scale == m_scale)
+  {
+    return false;
+  }
+
+  m_scale       = scale;
+  m_sampleCount = 0;
+  m_timeSum     = 0.0f;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------
+// Picks the scale the scene is rendered at (a fraction of the window size on each axis)
+// to hold the measured GPU frame time near a target.
+// Times are averaged over a few frames; then, as the cost of a frame mostly goes with
+// its pixel count, the scale moves by sqrt(target / measured). Scales are quantised
+// and only raised once the frame is comfortably under budget, so the scale settles
+// instead of flickering between two values. Frames still in flight when the scale
+// changes were rendered at the old one and are left out of the next average.
+//----------------------------------------------------------------------------------------
+class DynamicResolution
+{
+  float m_targetTime = 0.0f;    // ms, 0: disabled
+  float m_minScale   = 1.0f;
+  float m_maxScale   = 1.0f;
+  float m_scale      = 1.0f;
+
+  float m_averageTime    = 0.0f;    // ms, of the last complete set of samples
+  float m_timeSum        = 0.0f;
+  uint32_t m_sampleCount = 0;    // since the last scale change
+  uint32_t m_skipCount   = 0;    // samples to ignore after a change
+
+public:
+  // targetTime: GPU milliseconds per frame, 0 to always render at maxScale
+  // skipFrames: frames that may be in flight when the scale changes
+  void init(float targetTime, float minScale, float maxScale, uint32_t skipFrames);
+
+  bool enabled() const { return m_targetTime > 0.0f; }
+  float scale() const { return m_scale; }
+  float maxScale() const { return m_maxScale; }
+  float averageTime() const { return m_averageTime; }
+
+  // Returns true when the scale changed and the scene must be recorded again
+  bool addFrameTime(float gpuTime);
+  // Replay: the scale a captured frame was drawn at, in place of a measured one.
+  // Returns true when the scale changed
+  bool setScale(float scale);
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,262 @@
+#include <fmt/format.h>
+
+#include "FrameCapture.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+//----------------------------------------------------------------------------------------
+constexpr uint32_t CAPTURE_MAGIC   = 0x50414346;    // "FCAP"
+constexpr uint32_t CAPTURE_VERSION = 2;
+
+constexpr uint8_t SETTING_GPU_DRIVEN = 1 << 0;
+constexpr uint8_t SETTING_BINDLESS   = 1 << 1;
+constexpr uint8_t SETTING_OCCLUSION  = 1 << 2;
+constexpr uint8_t SETTING_DENSE      = 1 << 3;
+
+//----------------------------------------------------------------------------------------
+template<typename T>
+void
+CaptureWriter::append(const T& value)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "records hold plain values");
+  const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+  m_record.insert(m_record.end(), bytes, bytes + sizeof(T));
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureWriter::flushRecord()
+{
+  if (m_file == nullptr)
+  {
+    m_record.clear();
+    return;
+  }
+  const bool written = fwrite(m_record.data(), 1, m_record.size(), m_file)
+                       == m_record.size();
+  m_record.clear();
+  if (!written)
+  {
+    fmt::print("WARNING: failed to write capture {}, capture stopped\n", m_filename);
+    close();
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureWriter::open(const std::string& filename, const CaptureSettings& settings)
+{
+  close();
+
+  m_file = fopen(filename.c_str(), "wb");
+  if (m_file == nullptr)
+  {
+    throw std::runtime_error(fmt::format("failed to open file: {}", filename));
+  }
+  m_filename   = filename;
+  m_frameCount = 0;
+
+  uint8_t flags = 0;
+  flags |= settings.gpuDriven ? SETTING_GPU_DRIVEN : 0;
+  flags |= settings.bindless ? SETTING_BINDLESS : 0;
+  flags |= settings.occlusionCulling ? SETTING_OCCLUSION : 0;
+  flags |= settings.denseScene ? SETTING_DENSE : 0;
+
+  append(CAPTURE_MAGIC);
+  append(CAPTURE_VERSION);
+  append(flags);
+  append(settings.objectCount);
+  append(settings.particleCount);
+  append(settings.windowCount);
+  append(settings.targetFrameTime);
+  append(settings.minResolutionScale);
+  append(settings.maxResolutionScale);
+  for (const std::string* path : {&settings.meshPath, &settings.texturePath})
+  {
+    append(static_cast<uint32_t>(path->size()));
+    m_record.insert(m_record.end(), path->begin(), path->end());
+  }
+  flushRecord();
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureWriter::close()
+{
+  if (m_file != nullptr)
+  {
+    if (fclose(m_file) != 0)
+    {
+      fmt::print("WARNING: failed to write capture {}\n", m_filename);
+    }
+    m_file = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureWriter::writeResize(const CapturedResize& resize)
+{
+  append(CaptureRecord::Resize);
+  append(resize.window);
+  append(resize.width);
+  append(resize.height);
+  append(resize.imageCount);
+  flushRecord();
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureWriter::writeFrame(const CapturedFrame& frame)
+{
+  append(CaptureRecord::Frame);
+  append(frame.scene.spin);
+  append(frame.scene.cameraYaw);
+  append(frame.resolutionScale);
+  append(static_cast<uint32_t>(frame.targets.size()));
+  for (const CapturedTarget& target : frame.targets)
+  {
+    append(target.window);
+    append(target.image);
+  }
+  flushRecord();
+  ++m_frameCount;
+}
+
+//----------------------------------------------------------------------------------------
+template<typename T>
+T
+CaptureReader::read()
+{
+  static_assert(std::is_trivially_copyable<T>::value, "records hold plain values");
+  if (m_file.size() - m_offset < sizeof(T))
+  {
+    throw std::runtime_error(fmt::format("capture {} is truncated", m_filename));
+  }
+  T value;
+  memcpy(&value, m_file.data() + m_offset, sizeof(T));
+  m_offset += sizeof(T);
+  return value;
+}
+
+//----------------------------------------------------------------------------------------
+std::string
+CaptureReader::readString()
+{
+  const auto length = read<uint32_t>();
+  if (m_file.size() - m_offset < length)
+  {
+    throw std::runtime_error(fmt::format("capture {} is truncated", m_filename));
+  }
+  std::string value(reinterpret_cast<const char*>(m_file.data() + m_offset), length);
+  m_offset += length;
+  return value;
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureReader::expect(CaptureRecord record)
+{
+  if (peek() != record)
+  {
+    throw std::runtime_error(
+      fmt::format("capture {}: unexpected record at {}", m_filename, m_offset));
+  }
+  ++m_offset;
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureReader::open(const std::string& filename)
+{
+  m_file     = MappedFile(filename);
+  m_filename = filename;
+  m_offset   = 0;
+
+  if (m_file.size() < 2 * sizeof(uint32_t) || read<uint32_t>() != CAPTURE_MAGIC)
+  {
+    throw std::runtime_error(fmt::format("{} is not a capture", filename));
+  }
+  const auto version = read<uint32_t>();
+  if (version != CAPTURE_VERSION)
+  {
+    throw std::runtime_error(fmt::format(
+      "capture {} is version {}, expected {}", filename, version, CAPTURE_VERSION));
+  }
+
+  const auto flags              = read<uint8_t>();
+  m_settings.gpuDriven          = (flags & SETTING_GPU_DRIVEN) != 0;
+  m_settings.bindless           = (flags & SETTING_BINDLESS) != 0;
+  m_settings.occlusionCulling   = (flags & SETTING_OCCLUSION) != 0;
+  m_settings.denseScene         = (flags & SETTING_DENSE) != 0;
+  m_settings.objectCount        = read<uint32_t>();
+  m_settings.particleCount      = read<uint32_t>();
+  m_settings.windowCount        = read<uint32_t>();
+  m_settings.targetFrameTime    = read<float>();
+  m_settings.minResolutionScale = read<float>();
+  m_settings.maxResolutionScale = read<float>();
+  m_settings.meshPath           = readString();
+  m_settings.texturePath        = readString();
+  if (m_settings.windowCount == 0)
+  {
+    throw std::runtime_error(fmt::format("capture {} has no windows", filename));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+CaptureRecord
+CaptureReader::peek() const
+{
+  if (m_offset == m_file.size())
+  {
+    return CaptureRecord::End;
+  }
+  const auto record = static_cast<CaptureRecord>(m_file.data()[m_offset]);
+  if (record != CaptureRecord::Resize && record != CaptureRecord::Frame)
+  {
+    throw std::runtime_error(
+      fmt::format("capture {}: unknown record at {}", m_filename, m_offset));
+  }
+  return record;
+}
+
+//----------------------------------------------------------------------------------------
+CapturedResize
+CaptureReader::readResize()
+{
+  expect(CaptureRecord::Resize);
+
+  CapturedResize resize = {};
+  resize.window         = read<uint32_t>();
+  resize.width          = read<uint32_t>();
+  resize.height         = read<uint32_t>();
+  resize.imageCount     = read<uint32_t>();
+  return resize;
+}
+
+//----------------------------------------------------------------------------------------
+void
+CaptureReader::readFrame(CapturedFrame& frame)
+{
+  expect(CaptureRecord::Frame);
+
+  frame.scene.spin      = read<float>();
+  frame.scene.cameraYaw = read<float>();
+  frame.resolutionScale = read<float>();
+
+  const auto targetCount = read<uint32_t>();
+  if ((m_file.size() - m_offset) / (2 * sizeof(uint32_t)) < targetCount)
+  {
+    throw std::runtime_error(fmt::format("capture {} is truncated", m_filename));
+  }
+  frame.targets.resize(targetCount);
+  for (CapturedTarget& target : frame.targets)
+  {
+    target.window = read<uint32_t>();
+    target.image  = read<uint32_t>();
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// The scene options a capture was made with; a replay builds the same scene from them
+struct CaptureSettings
+{
+  bool gpuDriven           = false;
+  bool bindless            = false;
+  bool occlusionCulling    = false;
+  bool denseScene          = false;
+  uint32_t objectCount     = 0;
+  uint32_t particleCount   = 0;
+  uint32_t windowCount     = 1;
+  float targetFrameTime    = 0.0f;    // dynamic resolution on when above 0
+  float minResolutionScale = 1.0f;
+  float maxResolutionScale = 1.0f;
+  std::string meshPath;
+  std::string texturePath;
+};
+
+// A window's swap chain was (re)created
+struct CapturedResize
+{
+  uint32_t window     = 0;
+  uint32_t width      = 0;
+  uint32_t height     = 0;
+  uint32_t imageCount = 0;
+};
+
+// A window image drawn by a frame
+struct CapturedTarget
+{
+  uint32_t window = 0;
+  uint32_t image  = 0;
+};
+
+// Everything a frame's commands depend on that isn't fixed at init: the interpolated
+// scene state (object transforms, camera), the resolution scale and the images drawn
+struct CapturedFrame
+{
+  SceneState scene;
+  float resolutionScale = 1.0f;
+  std::vector<CapturedTarget> targets;
+};
+
+enum class CaptureRecord : uint8_t
+{
+  End,
+  Resize,
+  Frame
+};
+
+//----------------------------------------------------------------------------------------
+// Appends a capture's records to a file as they happen. The file is a header with the
+// settings, then a stream of records each starting with its CaptureRecord type, in
+// native byte order. A failed write prints a warning and ends the capture; the records
+// written until then still replay.
+//----------------------------------------------------------------------------------------
+class CaptureWriter
+{
+  FILE* m_file = nullptr;
+  std::string m_filename;
+  uint64_t m_frameCount = 0;
+  std::vector<uint8_t> m_record;    // reused, written with one fwrite
+
+private:
+  template<typename T>
+  void append(const T& value);
+  void flushRecord();
+
+public:
+  CaptureWriter() = default;
+  ~CaptureWriter() { close(); }
+
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+  // Throws if the file can't be created
+  void open(const std::string& filename, const CaptureSettings& settings);
+  void close();
+
+  bool isOpen() const { return m_file != nullptr; }
+  uint64_t frameCount() const { return m_frameCount; }
+
+  void writeResize(const CapturedResize& resize);
+  void writeFrame(const CapturedFrame& frame);
+};
+
+//----------------------------------------------------------------------------------------
+// Reads a capture straight out of a memory mapping of the file, one record at a time.
+// Throws std::runtime_error on a file that isn't a capture or ends within a record.
+//----------------------------------------------------------------------------------------
+class CaptureReader
+{
+  MappedFile m_file;
+  std::string m_filename;
+  CaptureSettings m_settings;
+  size_t m_offset = 0;
+
+private:
+  template<typename T>
+  T read();
+  std::string readString();
+  void expect(CaptureRecord record);
+
+public:
+  void open(const std::string& filename);
+
+  const CaptureSettings& settings() const { return m_settings; }
+
+  // The type of the next record, End once they have all been read
+  CaptureRecord peek() const;
+  CapturedResize readResize();
+  // Reuses the frame's target storage
+  void readFrame(CapturedFrame& frame);
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,778 @@
+#include <fmt/format.h>
+
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CULL_TARGET_AVX2    // MSVC compiles intrinsics for any instruction set
+#else
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//----------------------------------------------------------------------------------------
+// Below this many objects the thread hand off costs more than the culling
+constexpr uint32_t PARALLEL_MIN_OBJECTS = 64 * 1024;
+constexpr uint32_t CHUNKS_PER_THREAD    = 4;
+constexpr uint32_t CHUNK_ALIGNMENT      = 8;    // SIMD tails only in the last chunk
+
+constexpr uint32_t BENCHMARK_RUNS      = 5;
+constexpr float BENCHMARK_SCENE_EXTENT = 1000.0f;
+
+using Clock = std::chrono::high_resolution_clock;
+
+//----------------------------------------------------------------------------------------
+void
+SphereBounds::resize(size_t count)
+{
+  centerX.resize(count);
+  centerY.resize(count);
+  centerZ.resize(count);
+  radius.resize(count);
+}
+
+//----------------------------------------------------------------------------------------
+void
+SphereBounds::set(size_t index, const glm::vec4& sphere)
+{
+  centerX[index] = sphere.x;
+  centerY[index] = sphere.y;
+  centerZ[index] = sphere.z;
+  radius[index]  = sphere.w;
+}
+
+//----------------------------------------------------------------------------------------
+void
+AabbBounds::resize(size_t count)
+{
+  centerX.resize(count);
+  centerY.resize(count);
+  centerZ.resize(count);
+  extentX.resize(count);
+  extentY.resize(count);
+  extentZ.resize(count);
+}
+
+//----------------------------------------------------------------------------------------
+void
+AabbBounds::set(size_t index, const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 center = (min + max) * 0.5f;
+  const glm::vec3 extent = (max - min) * 0.5f;
+  centerX[index]         = center.x;
+  centerY[index]         = center.y;
+  centerZ[index]         = center.z;
+  extentX[index]         = extent.x;
+  extentY[index]         = extent.y;
+  extentZ[index]         = extent.z;
+}
+
+//----------------------------------------------------------------------------------------
+// Frustum planes split into components (and their absolute values for boxes), so the
+// kernels can broadcast them once
+struct PlaneComponents
+{
+  float x[6];
+  float y[6];
+  float z[6];
+  float w[6];
+  float absX[6];
+  float absY[6];
+  float absZ[6];
+
+  explicit PlaneComponents(const Frustum& frustum)
+  {
+    for (int p = 0; p < 6; ++p)
+    {
+      x[p]    = frustum.planes[p].x;
+      y[p]    = frustum.planes[p].y;
+      z[p]    = frustum.planes[p].z;
+      w[p]    = frustum.planes[p].w;
+      absX[p] = std::abs(x[p]);
+      absY[p] = std::abs(y[p]);
+      absZ[p] = std::abs(z[p]);
+    }
+  }
+};
+
+// Kernels write the visible indices in [begin, end) to out and return how many there
+// were; out must have room for end - begin indices
+using SphereKernel = uint32_t (*)(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out);
+using AabbKernel = uint32_t (*)(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out);
+
+// All kernels evaluate dot(n, c) + d >= -r with the same operation order, so they
+// agree bit for bit (no FMA contraction: the AVX2 kernels don't enable FMA)
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullSpheresReference(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  uint32_t count = 0;
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+    bool visible = true;
+    for (const glm::vec4& plane : frustum.planes)
+    {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -bounds.radius[i])
+      {
+        visible = false;
+        break;
+      }
+    }
+    if (visible)
+    {
+      out[count++] = i;
+    }
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullAabbsReference(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  uint32_t count = 0;
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+    const glm::vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+    bool visible = true;
+    for (const glm::vec4& plane : frustum.planes)
+    {
+      // Projected half size of the box onto the plane normal
+      const float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+      {
+        visible = false;
+        break;
+      }
+    }
+    if (visible)
+    {
+      out[count++] = i;
+    }
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullSpheresScalar(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  uint32_t count = 0;
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const float x         = bounds.centerX[i];
+    const float y         = bounds.centerY[i];
+    const float z         = bounds.centerZ[i];
+    const float negRadius = -bounds.radius[i];
+    bool visible          = true;
+    for (int p = 0; p < 6; ++p)
+    {
+      visible &= planes.x[p] * x + planes.y[p] * y + planes.z[p] * z + planes.w[p]
+                 >= negRadius;
+    }
+    // Always write, only keep it if visible
+    out[count] = i;
+    count += visible ? 1 : 0;
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullAabbsScalar(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  uint32_t count = 0;
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const float x  = bounds.centerX[i];
+    const float y  = bounds.centerY[i];
+    const float z  = bounds.centerZ[i];
+    const float ex = bounds.extentX[i];
+    const float ey = bounds.extentY[i];
+    const float ez = bounds.extentZ[i];
+    bool visible   = true;
+    for (int p = 0; p < 6; ++p)
+    {
+      const float radius =
+        planes.absX[p] * ex + planes.absY[p] * ey + planes.absZ[p] * ez;
+      visible &= planes.x[p] * x + planes.y[p] * y + planes.z[p] * z + planes.w[p]
+                 >= -radius;
+    }
+    out[count] = i;
+    count += visible ? 1 : 0;
+  }
+  return count;
+}
+
+#ifdef CULL_X86
+//----------------------------------------------------------------------------------------
+static uint32_t
+lowestSetBit(uint32_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+// Appends first + the index of every set bit of mask
+static uint32_t
+appendVisible(uint32_t mask, uint32_t first, uint32_t* out)
+{
+  uint32_t count = 0;
+  while (mask != 0)
+  {
+    out[count++] = first + lowestSetBit(mask);
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullSpheresSSE(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  __m128 nx[6], ny[6], nz[6], nw[6];
+  for (int p = 0; p < 6; ++p)
+  {
+    nx[p] = _mm_set1_ps(planes.x[p]);
+    ny[p] = _mm_set1_ps(planes.y[p]);
+    nz[p] = _mm_set1_ps(planes.z[p]);
+    nw[p] = _mm_set1_ps(planes.w[p]);
+  }
+
+  uint32_t count = 0;
+  uint32_t i     = begin;
+  for (; i + 4 <= end; i += 4)
+  {
+    const __m128 x         = _mm_loadu_ps(&bounds.centerX[i]);
+    const __m128 y         = _mm_loadu_ps(&bounds.centerY[i]);
+    const __m128 z         = _mm_loadu_ps(&bounds.centerZ[i]);
+    const __m128 negRadius =
+      _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+    __m128 visible = _mm_cmpeq_ps(x, x);    // all ones (centres are never NaN)
+    for (int p = 0; p < 6; ++p)
+    {
+      const __m128 distance = _mm_add_ps(
+        _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)),
+        nw[p]);
+      visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+    }
+    count += appendVisible(_mm_movemask_ps(visible), i, out + count);
+  }
+  return count + cullSpheresScalar(frustum, bounds, i, end, out + count);
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+cullAabbsSSE(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+  for (int p = 0; p < 6; ++p)
+  {
+    nx[p] = _mm_set1_ps(planes.x[p]);
+    ny[p] = _mm_set1_ps(planes.y[p]);
+    nz[p] = _mm_set1_ps(planes.z[p]);
+    nw[p] = _mm_set1_ps(planes.w[p]);
+    ax[p] = _mm_set1_ps(planes.absX[p]);
+    ay[p] = _mm_set1_ps(planes.absY[p]);
+    az[p] = _mm_set1_ps(planes.absZ[p]);
+  }
+
+  uint32_t count = 0;
+  uint32_t i     = begin;
+  for (; i + 4 <= end; i += 4)
+  {
+    const __m128 x  = _mm_loadu_ps(&bounds.centerX[i]);
+    const __m128 y  = _mm_loadu_ps(&bounds.centerY[i]);
+    const __m128 z  = _mm_loadu_ps(&bounds.centerZ[i]);
+    const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+    const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+    const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+    __m128 visible = _mm_cmpeq_ps(x, x);
+    for (int p = 0; p < 6; ++p)
+    {
+      const __m128 radius = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+      const __m128 distance = _mm_add_ps(
+        _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)),
+        nw[p]);
+      visible = _mm_and_ps(
+        visible, _mm_cmpge_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+    }
+    count += appendVisible(_mm_movemask_ps(visible), i, out + count);
+  }
+  return count + cullAabbsScalar(frustum, bounds, i, end, out + count);
+}
+
+//----------------------------------------------------------------------------------------
+CULL_TARGET_AVX2 static uint32_t
+cullSpheresAVX2(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  __m256 nx[6], ny[6], nz[6], nw[6];
+  for (int p = 0; p < 6; ++p)
+  {
+    nx[p] = _mm256_set1_ps(planes.x[p]);
+    ny[p] = _mm256_set1_ps(planes.y[p]);
+    nz[p] = _mm256_set1_ps(planes.z[p]);
+    nw[p] = _mm256_set1_ps(planes.w[p]);
+  }
+
+  uint32_t count = 0;
+  uint32_t i     = begin;
+  for (; i + 8 <= end; i += 8)
+  {
+    const __m256 x = _mm256_loadu_ps(&bounds.centerX[i]);
+    const __m256 y = _mm256_loadu_ps(&bounds.centerY[i]);
+    const __m256 z = _mm256_loadu_ps(&bounds.centerZ[i]);
+    const __m256 negRadius =
+      _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+    __m256 visible = _mm256_cmp_ps(x, x, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; ++p)
+    {
+      const __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+          _mm256_mul_ps(nz[p], z)),
+        nw[p]);
+      visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+    }
+    count += appendVisible(_mm256_movemask_ps(visible), i, out + count);
+  }
+  return count + cullSpheresScalar(frustum, bounds, i, end, out + count);
+}
+
+//----------------------------------------------------------------------------------------
+CULL_TARGET_AVX2 static uint32_t
+cullAabbsAVX2(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  uint32_t begin,
+  uint32_t end,
+  uint32_t* out)
+{
+  const PlaneComponents planes(frustum);
+  __m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+  for (int p = 0; p < 6; ++p)
+  {
+    nx[p] = _mm256_set1_ps(planes.x[p]);
+    ny[p] = _mm256_set1_ps(planes.y[p]);
+    nz[p] = _mm256_set1_ps(planes.z[p]);
+    nw[p] = _mm256_set1_ps(planes.w[p]);
+    ax[p] = _mm256_set1_ps(planes.absX[p]);
+    ay[p] = _mm256_set1_ps(planes.absY[p]);
+    az[p] = _mm256_set1_ps(planes.absZ[p]);
+  }
+
+  uint32_t count = 0;
+  uint32_t i     = begin;
+  for (; i + 8 <= end; i += 8)
+  {
+    const __m256 x  = _mm256_loadu_ps(&bounds.centerX[i]);
+    const __m256 y  = _mm256_loadu_ps(&bounds.centerY[i]);
+    const __m256 z  = _mm256_loadu_ps(&bounds.centerZ[i]);
+    const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+    const __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+    const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+    __m256 visible = _mm256_cmp_ps(x, x, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; ++p)
+    {
+      const __m256 radius = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)),
+        _mm256_mul_ps(az[p], ez));
+      const __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+          _mm256_mul_ps(nz[p], z)),
+        nw[p]);
+      const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+      visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+    }
+    count += appendVisible(_mm256_movemask_ps(visible), i, out + count);
+  }
+  return count + cullAabbsScalar(frustum, bounds, i, end, out + count);
+}
+
+//----------------------------------------------------------------------------------------
+static bool
+cpuSupportsAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+  {
+    return false;
+  }
+  // The OS must also save the YMM registers
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx     = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+  {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+//----------------------------------------------------------------------------------------
+const char*
+cullKernelName(CullKernel kernel)
+{
+  switch (kernel)
+  {
+    case CullKernel::Reference: return "reference";
+    case CullKernel::Scalar: return "scalar";
+    case CullKernel::SSE: return "SSE";
+    case CullKernel::AVX2: return "AVX2";
+    case CullKernel::Best: return "best";
+  }
+  return "unknown";
+}
+
+//----------------------------------------------------------------------------------------
+bool
+isCullKernelSupported(CullKernel kernel)
+{
+  switch (kernel)
+  {
+#ifdef CULL_X86
+    case CullKernel::SSE: return true;
+    case CullKernel::AVX2:
+    {
+      static const bool supported = cpuSupportsAVX2();
+      return supported;
+    }
+#else
+    case CullKernel::SSE:
+    case CullKernel::AVX2: return false;
+#endif
+    default: return true;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static CullKernel
+resolveKernel(CullKernel kernel)
+{
+  if (kernel == CullKernel::Best)
+  {
+    for (CullKernel widest : {CullKernel::AVX2, CullKernel::SSE})
+    {
+      if (isCullKernelSupported(widest))
+      {
+        return widest;
+      }
+    }
+    return CullKernel::Scalar;
+  }
+  if (!isCullKernelSupported(kernel))
+  {
+    throw std::runtime_error(
+      fmt::format("{} culling isn't supported on this CPU", cullKernelName(kernel)));
+  }
+  return kernel;
+}
+
+//----------------------------------------------------------------------------------------
+// Runs the kernel over chunks on the pool, each compacting into its own part of
+// `visible`, then closes the gaps between the chunks' results (keeping their order)
+template<typename Bounds, typename Kernel>
+static void
+cullChunks(
+  const Frustum& frustum,
+  const Bounds& bounds,
+  std::vector<uint32_t>& visible,
+  Kernel kernel,
+  ThreadPool* pool)
+{
+  const auto count = static_cast<uint32_t>(bounds.size());
+  visible.resize(count);
+  if (pool == nullptr || pool->threadCount() == 1 || count < PARALLEL_MIN_OBJECTS)
+  {
+    visible.resize(kernel(frustum, bounds, 0, count, visible.data()));
+    return;
+  }
+
+  const uint32_t chunkCount = pool->threadCount() * CHUNKS_PER_THREAD;
+  uint32_t chunkSize        = (count + chunkCount - 1) / chunkCount;
+  chunkSize = (chunkSize + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+
+  std::vector<uint32_t> chunkVisible(chunkCount, 0);
+  pool->parallelFor(chunkCount, [&](uint32_t chunk) {
+    const uint32_t begin = std::min(chunk * chunkSize, count);
+    const uint32_t end   = std::min(begin + chunkSize, count);
+    chunkVisible[chunk]  = kernel(frustum, bounds, begin, end, visible.data() + begin);
+  });
+
+  uint32_t total = chunkVisible[0];
+  for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+  {
+    memmove(
+      visible.data() + total,
+      visible.data() + std::min(chunk * chunkSize, count),
+      chunkVisible[chunk] * sizeof(uint32_t));
+    total += chunkVisible[chunk];
+  }
+  visible.resize(total);
+}
+
+//----------------------------------------------------------------------------------------
+void
+cullSpheres(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  std::vector<uint32_t>& visible,
+  CullKernel kernel,
+  ThreadPool* pool)
+{
+  SphereKernel function = cullSpheresScalar;
+  switch (resolveKernel(kernel))
+  {
+    case CullKernel::Reference: function = cullSpheresReference; break;
+#ifdef CULL_X86
+    case CullKernel::SSE: function = cullSpheresSSE; break;
+    case CullKernel::AVX2: function = cullSpheresAVX2; break;
+#endif
+    default: break;
+  }
+  cullChunks(frustum, bounds, visible, function, pool);
+}
+
+//----------------------------------------------------------------------------------------
+void
+cullAabbs(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  std::vector<uint32_t>& visible,
+  CullKernel kernel,
+  ThreadPool* pool)
+{
+  AabbKernel function = cullAabbsScalar;
+  switch (resolveKernel(kernel))
+  {
+    case CullKernel::Reference: function = cullAabbsReference; break;
+#ifdef CULL_X86
+    case CullKernel::SSE: function = cullAabbsSSE; break;
+    case CullKernel::AVX2: function = cullAabbsAVX2; break;
+#endif
+    default: break;
+  }
+  cullChunks(frustum, bounds, visible, function, pool);
+}
+
+//----------------------------------------------------------------------------------------
+// Camera at the origin looking down +z with a 90 degree field of view, reaching the
+// faces of a cube of BENCHMARK_SCENE_EXTENT around it: about 1/6 of the cube is visible
+static Frustum
+benchmarkFrustum()
+{
+  const float s = 1.0f / std::sqrt(2.0f);
+
+  Frustum frustum;
+  frustum.planes[0] = glm::vec4(s, 0.0f, s, 0.0f);                      // left
+  frustum.planes[1] = glm::vec4(-s, 0.0f, s, 0.0f);                     // right
+  frustum.planes[2] = glm::vec4(0.0f, s, s, 0.0f);                      // bottom
+  frustum.planes[3] = glm::vec4(0.0f, -s, s, 0.0f);                     // top
+  frustum.planes[4] = glm::vec4(0.0f, 0.0f, 1.0f, -0.1f);               // near
+  frustum.planes[5] = glm::vec4(0.0f, 0.0f, -1.0f, BENCHMARK_SCENE_EXTENT);    // far
+  return frustum;
+}
+
+//----------------------------------------------------------------------------------------
+// Best time of BENCHMARK_RUNS in milliseconds; `visible` keeps the last result
+template<typename Cull>
+static double
+timeCulling(const Cull& cull)
+{
+  double bestMs = std::numeric_limits<double>::max();
+  for (uint32_t run = 0; run < BENCHMARK_RUNS; ++run)
+  {
+    const auto start = Clock::now();
+    cull();
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    bestMs = std::min(bestMs, elapsed.count());
+  }
+  return bestMs;
+}
+
+//----------------------------------------------------------------------------------------
+template<typename Bounds, typename CullFunction>
+static void
+benchmarkBounds(
+  const char* boundsName,
+  const Frustum& frustum,
+  const Bounds& bounds,
+  CullFunction cullFunction,
+  ThreadPool& pool)
+{
+  std::vector<uint32_t> reference;
+  cullFunction(frustum, bounds, reference, CullKernel::Reference, nullptr);
+
+  std::vector<uint32_t> visible;
+  visible.reserve(bounds.size());
+  auto report = [&](CullKernel kernel, uint32_t threads, double ms) {
+    if (visible != reference)
+    {
+      throw std::runtime_error(fmt::format(
+        "{} culling of {} {} disagrees with the reference",
+        cullKernelName(kernel),
+        bounds.size(),
+        boundsName));
+    }
+    fmt::print(
+      "{:8} {:>10} {:>9} {:7} {:>10} {:9.3f} {:12.1f}\n",
+      boundsName,
+      bounds.size(),
+      cullKernelName(kernel),
+      threads,
+      visible.size(),
+      ms,
+      bounds.size() / (ms * 1000.0));
+  };
+
+  for (CullKernel kernel :
+       {CullKernel::Reference, CullKernel::Scalar, CullKernel::SSE, CullKernel::AVX2})
+  {
+    if (isCullKernelSupported(kernel))
+    {
+      const double ms = timeCulling(
+        [&] { cullFunction(frustum, bounds, visible, kernel, nullptr); });
+      report(kernel, 1, ms);
+    }
+  }
+  if (pool.threadCount() > 1)
+  {
+    const double ms = timeCulling(
+      [&] { cullFunction(frustum, bounds, visible, CullKernel::Best, &pool); });
+    report(resolveKernel(CullKernel::Best), pool.threadCount(), ms);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+runCullingBenchmark()
+{
+  const Frustum frustum = benchmarkFrustum();
+  ThreadPool pool;
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> position(
+    -BENCHMARK_SCENE_EXTENT, BENCHMARK_SCENE_EXTENT);
+  std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+  fmt::print(
+    "Frustum culling benchmark (best of {} runs, AVX2 {}supported)\n",
+    BENCHMARK_RUNS,
+    isCullKernelSupported(CullKernel::AVX2) ? "" : "not ");
+  fmt::print("bounds      objects    kernel threads    visible        ms   Mobjects/s\n");
+  for (uint32_t count : {10'000u, 1'000'000u, 10'000'000u})
+  {
+    {
+      SphereBounds spheres;
+      spheres.resize(count);
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        const glm::vec4 sphere(
+          position(random), position(random), position(random), size(random));
+        spheres.set(i, sphere);
+      }
+      benchmarkBounds("spheres", frustum, spheres, cullSpheres, pool);
+    }
+    {
+      AabbBounds boxes;
+      boxes.resize(count);
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        const glm::vec3 min(position(random), position(random), position(random));
+        const glm::vec3 extent(size(random), size(random), size(random));
+        boxes.set(i, min, min + extent);
+      }
+      benchmarkBounds("boxes", frustum, boxes, cullAabbs, pool);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+//----------------------------------------------------------------------------------------
+// Bounding spheres in structure of arrays layout, so SIMD kernels test several objects
+// per instruction with plain loads
+struct SphereBounds
+{
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> radius;
+
+  size_t size() const { return radius.size(); }
+  void resize(size_t count);
+  // xyz = centre, w = radius (as in ObjectData::boundingSphere)
+  void set(size_t index, const glm::vec4& sphere);
+};
+
+// Axis aligned boxes in structure of arrays layout, stored as centre and half extent
+struct AabbBounds
+{
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> extentX;
+  std::vector<float> extentY;
+  std::vector<float> extentZ;
+
+  size_t size() const { return extentX.size(); }
+  void resize(size_t count);
+  void set(size_t index, const glm::vec3& min, const glm::vec3& max);
+};
+
+//----------------------------------------------------------------------------------------
+enum class CullKernel
+{
+  Reference,    // glm, one object and plane at a time; the ground truth for testing
+  Scalar,       // branchless SoA loop
+  SSE,          // 4 objects per iteration
+  AVX2,         // 8 objects per iteration
+  Best,         // widest kernel the CPU supports
+};
+
+const char* cullKernelName(CullKernel kernel);
+bool isCullKernelSupported(CullKernel kernel);
+
+// Replaces `visible` with the indices of the bounds that intersect the frustum, in
+// ascending order. Every kernel gives exactly the same result. With a pool, large sets
+// are split into chunks across its threads.
+void cullSpheres(
+  const Frustum& frustum,
+  const SphereBounds& bounds,
+  std::vector<uint32_t>& visible,
+  CullKernel kernel = CullKernel::Best,
+  ThreadPool* pool  = nullptr);
+void cullAabbs(
+  const Frustum& frustum,
+  const AabbBounds& bounds,
+  std::vector<uint32_t>& visible,
+  CullKernel kernel = CullKernel::Best,
+  ThreadPool* pool  = nullptr);
+
+// Times every supported kernel on 10k, 1M and 10M random spheres and boxes, checking
+// each against the reference kernel
+void runCullingBenchmark();
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,417 @@
+#include <fmt/format.h>
+
+#include "GeometryPacker.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+// RangeAllocator
+//----------------------------------------------------------------------------------------
+RangeAllocator::RangeAllocator(uint32_t capacity)
+    : m_capacity(capacity)
+{
+  if (capacity > 0)
+  {
+    m_freeRanges[0] = capacity;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+std::optional<uint32_t>
+RangeAllocator::allocate(uint32_t size)
+{
+  assert(size > 0);
+
+  for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+  {
+    if (it->second < size)
+    {
+      continue;
+    }
+
+    const uint32_t offset    = it->first;
+    const uint32_t remaining = it->second - size;
+    m_freeRanges.erase(it);
+    if (remaining > 0)
+    {
+      m_freeRanges[offset + size] = remaining;
+    }
+    m_used += size;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+  assert(offset + size <= m_capacity);
+  assert(m_used >= size);
+  m_used -= size;
+
+  auto next = m_freeRanges.lower_bound(offset);
+  assert(next == m_freeRanges.end() || offset + size <= next->first);
+
+  // Merge with the following range
+  if (next != m_freeRanges.end() && next->first == offset + size)
+  {
+    size += next->second;
+    next = m_freeRanges.erase(next);
+  }
+
+  // Merge with the preceding range
+  if (next != m_freeRanges.begin())
+  {
+    auto prev = std::prev(next);
+    assert(prev->first + prev->second <= offset);
+    if (prev->first + prev->second == offset)
+    {
+      prev->second += size;
+      return;
+    }
+  }
+
+  m_freeRanges.emplace_hint(next, offset, size);
+}
+
+//----------------------------------------------------------------------------------------
+uint32_t
+RangeAllocator::largestFreeRange() const
+{
+  uint32_t largest = 0;
+  for (const auto& range : m_freeRanges)
+  {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+//----------------------------------------------------------------------------------------
+// GeometryPacker
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  uint32_t pageVertexCapacity,
+  uint32_t pageIndexCapacity)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+
+  m_physicalDevice     = physicalDevice;
+  m_device             = device;
+  m_commandPool        = commandPool;
+  m_queue              = queue;
+  m_pageVertexCapacity = pageVertexCapacity;
+  m_pageIndexCapacity  = pageIndexCapacity;
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::createPage()
+{
+  Page page;
+  page.vertexRanges = RangeAllocator(m_pageVertexCapacity);
+  page.indexRanges  = RangeAllocator(m_pageIndexCapacity);
+
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    VkDeviceSize(m_pageVertexCapacity) * sizeof(PackedVertex),
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    page.vertexBuffer,
+    page.vertexBufferMemory);
+
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    VkDeviceSize(m_pageIndexCapacity) * sizeof(uint32_t),
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    page.indexBuffer,
+    page.indexBufferMemory);
+
+  reportPageUsage(page);
+  m_pages.push_back(page);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::reportPageUsage(const Page& page) const
+{
+  reportDeviceMemoryUsage(
+    page.vertexBufferMemory,
+    VkDeviceSize(page.vertexRanges.used()) * sizeof(PackedVertex),
+    VkDeviceSize(page.vertexRanges.largestFreeRange()) * sizeof(PackedVertex));
+  reportDeviceMemoryUsage(
+    page.indexBufferMemory,
+    VkDeviceSize(page.indexRanges.used()) * sizeof(uint32_t),
+    VkDeviceSize(page.indexRanges.largestFreeRange()) * sizeof(uint32_t));
+}
+
+//----------------------------------------------------------------------------------------
+MeshHandle
+GeometryPacker::addMesh(
+  const Vertex* vertices,
+  uint32_t vertexCount,
+  const uint32_t* indices,
+  uint32_t indexCount)
+{
+  return addMesh(
+    vertexCount, indexCount, [&](PackedVertex* dstVertices, uint32_t* dstIndices) {
+      std::transform(vertices, vertices + vertexCount, dstVertices, packVertex);
+      memcpy(dstIndices, indices, sizeof(uint32_t) * indexCount);
+    });
+}
+
+//----------------------------------------------------------------------------------------
+MeshHandle
+GeometryPacker::addMesh(
+  uint32_t vertexCount,
+  uint32_t indexCount,
+  const MeshWriter& write)
+{
+  assert(m_device != VK_NULL_HANDLE);
+
+  if (vertexCount == 0 || indexCount == 0)
+  {
+    throw std::runtime_error("cannot add an empty mesh");
+  }
+  if (vertexCount > m_pageVertexCapacity || indexCount > m_pageIndexCapacity)
+  {
+    throw std::runtime_error(fmt::format(
+      "mesh ({} vertices, {} indices) is larger than a geometry page",
+      vertexCount,
+      indexCount));
+  }
+
+  // Indices stay relative to the mesh; vertexOffset rebases them inside the page
+  MeshAllocation allocation;
+  bool placed = false;
+  for (uint32_t pageIndex = 0; pageIndex <= m_pages.size() && !placed; ++pageIndex)
+  {
+    if (pageIndex == m_pages.size())
+    {
+      createPage();
+    }
+
+    Page& page        = m_pages[pageIndex];
+    auto vertexOffset = page.vertexRanges.allocate(vertexCount);
+    if (!vertexOffset)
+    {
+      continue;
+    }
+    auto firstIndex = page.indexRanges.allocate(indexCount);
+    if (!firstIndex)
+    {
+      page.vertexRanges.free(*vertexOffset, vertexCount);
+      continue;
+    }
+
+    allocation.page         = pageIndex;
+    allocation.vertexOffset = static_cast<int32_t>(*vertexOffset);
+    allocation.vertexCount  = vertexCount;
+    allocation.firstIndex   = *firstIndex;
+    allocation.indexCount   = indexCount;
+    placed                  = true;
+  }
+
+  // One staging buffer: vertices followed by indices
+  const VkDeviceSize vertexBytes = VkDeviceSize(vertexCount) * sizeof(PackedVertex);
+  const VkDeviceSize indexBytes  = VkDeviceSize(indexCount) * sizeof(uint32_t);
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    vertexBytes + indexBytes,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    stagingBuffer,
+    stagingBufferMemory);
+
+  void* mapped;
+  vkMapMemory(m_device, stagingBufferMemory, 0, vertexBytes + indexBytes, 0, &mapped);
+  try
+  {
+    write(
+      static_cast<PackedVertex*>(mapped),
+      reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(mapped) + vertexBytes));
+  }
+  catch (...)
+  {
+    vkUnmapMemory(m_device, stagingBufferMemory);
+    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+    freeDeviceMemory(m_device, stagingBufferMemory);
+    m_pages[allocation.page].vertexRanges.free(
+      static_cast<uint32_t>(allocation.vertexOffset), vertexCount);
+    m_pages[allocation.page].indexRanges.free(allocation.firstIndex, indexCount);
+    throw;
+  }
+  vkUnmapMemory(m_device, stagingBufferMemory);
+
+  const Page& page              = m_pages[allocation.page];
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands(m_device, m_commandPool);
+
+  VkBufferCopy vertexCopy = {};
+  vertexCopy.srcOffset    = 0;
+  vertexCopy.dstOffset    = VkDeviceSize(allocation.vertexOffset) * sizeof(PackedVertex);
+  vertexCopy.size         = vertexBytes;
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, page.vertexBuffer, 1, &vertexCopy);
+
+  VkBufferCopy indexCopy = {};
+  indexCopy.srcOffset    = vertexBytes;
+  indexCopy.dstOffset    = VkDeviceSize(allocation.firstIndex) * sizeof(uint32_t);
+  indexCopy.size         = indexBytes;
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, page.indexBuffer, 1, &indexCopy);
+
+  endSingleTimeCommands(m_device, m_commandPool, m_queue, commandBuffer);
+
+  vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+  freeDeviceMemory(m_device, stagingBufferMemory);
+  reportPageUsage(page);
+
+  if (!m_freeHandles.empty())
+  {
+    MeshHandle handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+    m_meshes[handle] = allocation;
+    return handle;
+  }
+  m_meshes.push_back(allocation);
+  return static_cast<MeshHandle>(m_meshes.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::removeMesh(MeshHandle handle)
+{
+  assert(handle < m_meshes.size());
+
+  MeshAllocation& allocation = m_meshes[handle];
+  assert(allocation.vertexCount > 0);
+
+  Page& page = m_pages[allocation.page];
+  page.vertexRanges.free(
+    static_cast<uint32_t>(allocation.vertexOffset), allocation.vertexCount);
+  page.indexRanges.free(allocation.firstIndex, allocation.indexCount);
+  reportPageUsage(page);
+
+  allocation = MeshAllocation();
+  m_freeHandles.push_back(handle);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::bindPage(VkCommandBuffer commandBuffer, uint32_t page) const
+{
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_pages[page].vertexBuffer, &offset);
+  vkCmdBindIndexBuffer(commandBuffer, m_pages[page].indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::sortDraws(std::vector<MeshDraw>& draws) const
+{
+  std::sort(draws.begin(), draws.end(), [this](const MeshDraw& a, const MeshDraw& b) {
+    const MeshAllocation& meshA = m_meshes[a.mesh];
+    const MeshAllocation& meshB = m_meshes[b.mesh];
+    if (meshA.page != meshB.page)
+    {
+      return meshA.page < meshB.page;
+    }
+    return meshA.firstIndex < meshB.firstIndex;
+  });
+}
+
+//----------------------------------------------------------------------------------------
+std::vector<DrawBatch>
+GeometryPacker::buildIndirectCommands(
+  const std::vector<MeshDraw>& sortedDraws,
+  std::vector<VkDrawIndexedIndirectCommand>& commands) const
+{
+  std::vector<DrawBatch> batches;
+  for (const MeshDraw& draw : sortedDraws)
+  {
+    const MeshAllocation& mesh = m_meshes[draw.mesh];
+    if (batches.empty() || batches.back().page != mesh.page)
+    {
+      DrawBatch batch;
+      batch.page         = mesh.page;
+      batch.firstCommand = static_cast<uint32_t>(commands.size());
+      batches.push_back(batch);
+    }
+
+    VkDrawIndexedIndirectCommand command = {};
+    command.indexCount                   = mesh.indexCount;
+    command.instanceCount                = draw.instanceCount;
+    command.firstIndex                   = mesh.firstIndex;
+    command.vertexOffset                 = mesh.vertexOffset;
+    command.firstInstance                = draw.firstInstance;
+    commands.push_back(command);
+    batches.back().commandCount++;
+  }
+  return batches;
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::recordBatches(
+  VkCommandBuffer commandBuffer,
+  VkBuffer indirectBuffer,
+  VkDeviceSize indirectOffset,
+  const std::vector<DrawBatch>& batches,
+  bool multiDrawIndirect) const
+{
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  for (const DrawBatch& batch : batches)
+  {
+    bindPage(commandBuffer, batch.page);
+
+    VkDeviceSize offset = indirectOffset + VkDeviceSize(batch.firstCommand) * stride;
+    if (multiDrawIndirect)
+    {
+      vkCmdDrawIndexedIndirect(
+        commandBuffer, indirectBuffer, offset, batch.commandCount, stride);
+      continue;
+    }
+
+    // Without multiDrawIndirect, drawCount must be 0 or 1
+    for (uint32_t i = 0; i < batch.commandCount; ++i)
+    {
+      vkCmdDrawIndexedIndirect(
+        commandBuffer, indirectBuffer, offset + VkDeviceSize(i) * stride, 1, stride);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GeometryPacker::cleanup()
+{
+  for (auto& page : m_pages)
+  {
+    vkDestroyBuffer(m_device, page.indexBuffer, nullptr);
+    freeDeviceMemory(m_device, page.indexBufferMemory);
+    vkDestroyBuffer(m_device, page.vertexBuffer, nullptr);
+    freeDeviceMemory(m_device, page.vertexBufferMemory);
+  }
+  m_pages.clear();
+  m_meshes.clear();
+  m_freeHandles.clear();
+}
+
+//----------------------------------------------------------------------------------------
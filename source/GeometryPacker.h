@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// First fit allocator over [0, capacity) elements; freed ranges are coalesced with
+// their neighbours so unloading meshes doesn't fragment the page forever
+//----------------------------------------------------------------------------------------
+class RangeAllocator
+{
+  std::map<uint32_t, uint32_t> m_freeRanges;    // offset -> size
+  uint32_t m_capacity = 0;
+  uint32_t m_used     = 0;
+
+public:
+  explicit RangeAllocator(uint32_t capacity = 0);
+
+  std::optional<uint32_t> allocate(uint32_t size);
+  void free(uint32_t offset, uint32_t size);
+
+  uint32_t capacity() const { return m_capacity; }
+  uint32_t used() const { return m_used; }
+  size_t freeRangeCount() const { return m_freeRanges.size(); }
+  uint32_t largestFreeRange() const;
+};
+
+//----------------------------------------------------------------------------------------
+using MeshHandle                  = uint32_t;
+constexpr MeshHandle INVALID_MESH = ~0u;
+
+// Where a mesh lives inside the shared buffers (vertexOffset/firstIndex in elements)
+struct MeshAllocation
+{
+  uint32_t page        = 0;
+  int32_t vertexOffset = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex  = 0;
+  uint32_t indexCount  = 0;
+};
+
+struct MeshDraw
+{
+  MeshHandle mesh        = INVALID_MESH;
+  uint32_t firstInstance = 0;
+  uint32_t instanceCount = 1;
+};
+
+// A run of indirect commands that share one page (one vertex + index buffer bind)
+struct DrawBatch
+{
+  uint32_t page         = 0;
+  uint32_t firstCommand = 0;
+  uint32_t commandCount = 0;
+};
+
+//----------------------------------------------------------------------------------------
+// Packs static meshes into a few large shared vertex and index buffers ("pages") of
+// PackedVertex and 32 bit indices.
+// Meshes are just offsets and counts into a page; a new page is only created when no
+// existing page has room. Sorting draws by page means consecutive draws never rebind
+// buffers, and each page's draws can be issued as a single multi-draw.
+//----------------------------------------------------------------------------------------
+class GeometryPacker
+{
+  struct Page
+  {
+    VkBuffer vertexBuffer             = VK_NULL_HANDLE;
+    VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer              = VK_NULL_HANDLE;
+    VkDeviceMemory indexBufferMemory  = VK_NULL_HANDLE;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+  };
+
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkDevice m_device                 = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool       = VK_NULL_HANDLE;
+  VkQueue m_queue                   = VK_NULL_HANDLE;
+  uint32_t m_pageVertexCapacity     = 0;
+  uint32_t m_pageIndexCapacity      = 0;
+
+  std::vector<Page> m_pages;
+  std::vector<MeshAllocation> m_meshes;
+  std::vector<MeshHandle> m_freeHandles;
+
+private:
+  void createPage();
+  void reportPageUsage(const Page& page) const;
+
+public:
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkCommandPool commandPool,
+    VkQueue queue,
+    uint32_t pageVertexCapacity = 1 << 20,
+    uint32_t pageIndexCapacity  = 1 << 22);
+  void cleanup();
+
+  // Fills mapped staging memory directly: vertices[vertexCount], then indices[indexCount]
+  // which start right after the last vertex (so a blob in that layout is a single copy)
+  using MeshWriter = std::function<void(PackedVertex* vertices, uint32_t* indices)>;
+
+  // Uploads the mesh through a staging buffer (blocks on the transfer); Vertex input is
+  // packed on the way
+  MeshHandle addMesh(uint32_t vertexCount, uint32_t indexCount, const MeshWriter& write);
+  MeshHandle addMesh(
+    const Vertex* vertices,
+    uint32_t vertexCount,
+    const uint32_t* indices,
+    uint32_t indexCount);
+  MeshHandle
+  addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+  {
+    return addMesh(
+      vertices.data(),
+      static_cast<uint32_t>(vertices.size()),
+      indices.data(),
+      static_cast<uint32_t>(indices.size()));
+  }
+
+  // The caller must make sure no in flight frame still draws the mesh
+  void removeMesh(MeshHandle mesh);
+
+  const MeshAllocation& mesh(MeshHandle handle) const { return m_meshes[handle]; }
+  uint32_t pageCount() const { return static_cast<uint32_t>(m_pages.size()); }
+
+  void bindPage(VkCommandBuffer commandBuffer, uint32_t page) const;
+
+  // Orders draws by page, then by position in the page
+  void sortDraws(std::vector<MeshDraw>& draws) const;
+
+  // Turns draws (sorted with sortDraws) into indirect commands, one batch per page
+  std::vector<DrawBatch> buildIndirectCommands(
+    const std::vector<MeshDraw>& sortedDraws,
+    std::vector<VkDrawIndexedIndirectCommand>& commands) const;
+
+  // Binds each batch's page once and issues its draws from indirectBuffer
+  void recordBatches(
+    VkCommandBuffer commandBuffer,
+    VkBuffer indirectBuffer,
+    VkDeviceSize indirectOffset,
+    const std::vector<DrawBatch>& batches,
+    bool multiDrawIndirect) const;
+};
+
+//----------------------------------------------------------------------------------------
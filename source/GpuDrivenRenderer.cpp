@@ -0,0 +1,1224 @@
+#include <fmt/format.h>
+
+#include "GpuDrivenRenderer.h"
+#include "MemoryTelemetry.h"
+#include "MeshImporter.h"
+#include "ThreadPool.h"
+#include "VulkanHelpers.h"
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr float OBJECT_SPACING         = 3.0f;
+constexpr float DENSE_OBJECT_SPACING   = 1.5f;    // unit radius objects overlap
+constexpr uint32_t CULL_WORKGROUP_SIZE = 64;    // must match local_size_x in cull.comp
+constexpr uint32_t CHECKER_SIZE        = 256;
+constexpr uint32_t CHECKER_SQUARE      = 32;
+constexpr uint32_t OBJECT_GROUP_SIZE   = 64;     // objects per transform group node
+constexpr uint32_t SPINNING_GROUPS     = 64;     // at most 4096 moving objects
+constexpr uint32_t NO_OBJECT           = ~0u;    // group nodes in m_nodeObjects
+
+// Ranges a frame's buffer keeps before it gives up on them and rewrites every node: a
+// window that doesn't draw (minimised, out of date) would otherwise grow them each frame
+constexpr size_t MAX_PENDING_TRANSFORM_RANGES = 4 * SPINNING_GROUPS;
+
+// Every object's query is recorded into the command buffers, which bounds the count
+constexpr uint32_t MAX_OCCLUSION_OBJECTS = 1 << 16;
+constexpr uint32_t BOX_STRIP_VERTICES    = 14;    // see occlusion_box.vert
+
+// Bindless mode gives the objects a mix of checkers to show per object textures
+constexpr uint32_t BINDLESS_CHECKER_SQUARES[] = {8, 16, 32, 64};
+
+//----------------------------------------------------------------------------------------
+// Unit radius polygon fan, so an object's bounding sphere radius is also its scale
+static void
+createPolygonMesh(
+  uint32_t sides,
+  std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& indices)
+{
+  const glm::vec3 colors[] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  const float step         = glm::two_pi<float>() / sides;
+
+  vertices.clear();
+  indices.clear();
+  for (uint32_t i = 0; i < sides; ++i)
+  {
+    const float angle = i * step;
+    vertices.push_back({{std::sin(angle), -std::cos(angle), 0.0f}, colors[i % 3]});
+  }
+  // Both sides, as the camera sees objects from either: every triangle twice, wound
+  // both ways, and back face culling keeps the one facing the camera
+  for (uint32_t i = 1; i + 1 < sides; ++i)
+  {
+    indices.insert(indices.end(), {0, i, i + 1, 0, i + 1, i});
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Grey and white checker; its mip chain is generated on the GPU
+static TextureHandle
+createChecker(TextureManager& textures, uint32_t squareSize)
+{
+  std::vector<uint32_t> pixels(CHECKER_SIZE * CHECKER_SIZE);
+  for (uint32_t y = 0; y < CHECKER_SIZE; ++y)
+  {
+    for (uint32_t x = 0; x < CHECKER_SIZE; ++x)
+    {
+      const bool white = ((x / squareSize) + (y / squareSize)) % 2 == 0;
+      pixels[y * CHECKER_SIZE + x] = white ? 0xFFFFFFFF : 0xFF808080;
+    }
+  }
+  return textures.createTexture(
+    VK_FORMAT_R8G8B8A8_UNORM, CHECKER_SIZE, CHECKER_SIZE, pixels.data());
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  GeometryPacker& geometry,
+  TextureManager& textures,
+  BindlessDescriptors* bindless,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  uint32_t objectCount,
+  const std::string& meshPath,
+  const std::string& texturePath,
+  bool drawIndirectCount,
+  bool multiDrawIndirect,
+  bool occlusionCulling,
+  bool dense)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+
+  m_physicalDevice    = physicalDevice;
+  m_device            = device;
+  m_geometry          = &geometry;
+  m_textureManager    = &textures;
+  m_bindless          = bindless;
+  m_objectCount       = objectCount;
+  m_multiDrawIndirect = multiDrawIndirect;
+  m_occlusionCulling  = occlusionCulling;
+  m_objectSpacing     = dense ? DENSE_OBJECT_SPACING : OBJECT_SPACING;
+
+  if (m_occlusionCulling && m_objectCount > MAX_OCCLUSION_OBJECTS)
+  {
+    throw std::runtime_error(fmt::format(
+      "occlusion culling records a query per object, at most {} objects",
+      MAX_OCCLUSION_OBJECTS));
+  }
+
+  if (drawIndirectCount)
+  {
+    m_cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)
+      vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR");
+  }
+  fmt::print(
+    "GPU driven mode: {} objects{}, {}{}\n",
+    m_objectCount,
+    dense ? " (dense)" : "",
+    useDrawIndirectCount() ? "vkCmdDrawIndexedIndirectCount"
+                           : "vkCmdDrawIndexedIndirect fallback",
+    m_occlusionCulling ? ", occlusion culling" : "");
+
+  createTextures(texturePath);
+  createGeometry(commandPool, queue, meshPath);
+  createDescriptorSetLayout();
+
+  // Bindless: set 1 is the global set, the push constants index into it
+  VkDescriptorSetLayout setLayouts[2]   = {m_descriptorSetLayout, VK_NULL_HANDLE};
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags =
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size   = sizeof(BindlessPushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts    = setLayouts;
+  if (m_bindless)
+  {
+    setLayouts[1]                             = m_bindless->layout();
+    pipelineLayoutInfo.setLayoutCount         = 2;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  }
+  if (
+    vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  // The count path compacts visible draws, the fallback writes one draw per object
+  const VkBool32 specializationData[2] = {
+    useDrawIndirectCount() ? VK_TRUE : VK_FALSE, m_occlusionCulling ? VK_TRUE : VK_FALSE};
+  const VkSpecializationMapEntry specializationEntries[2] = {
+    {0, 0, sizeof(VkBool32)}, {1, sizeof(VkBool32), sizeof(VkBool32)}};
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount        = 2;
+  specializationInfo.pMapEntries          = specializationEntries;
+  specializationInfo.dataSize             = sizeof(specializationData);
+  specializationInfo.pData                = specializationData;
+
+  m_cullPipeline = createComputePipeline(
+    m_device, m_pipelineLayout, "shaders/cull.spv", &specializationInfo);
+
+  if (m_occlusionCulling)
+  {
+    createOcclusionPipelines();
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createGeometry(
+  VkCommandPool commandPool,
+  VkQueue queue,
+  const std::string& meshPath)
+{
+  if (!meshPath.empty())
+  {
+    ThreadPool pool;
+    m_meshes.push_back(loadMesh(meshPath, *m_geometry, pool));
+  }
+  else
+  {
+    // Triangles, squares and hexagons, all packed into the shared geometry pages
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t sides : {3u, 4u, 6u})
+    {
+      createPolygonMesh(sides, vertices, indices);
+      m_meshes.push_back(m_geometry->addMesh(vertices, indices));
+    }
+  }
+  if (m_geometry->pageCount() > MAX_GEOMETRY_PAGES)
+  {
+    throw std::runtime_error("GPU driven mode supports at most 4 geometry pages!");
+  }
+
+  auto objects = createObjectGrid(m_objectCount, m_objectSpacing);
+  for (size_t i = 0; i < objects.size(); ++i)
+  {
+    const MeshAllocation& mesh = m_geometry->mesh(m_meshes[i % m_meshes.size()]);
+    objects[i].indexCount      = mesh.indexCount;
+    objects[i].firstIndex      = mesh.firstIndex;
+    objects[i].vertexOffset    = mesh.vertexOffset;
+    objects[i].page            = mesh.page;
+    if (m_bindless)
+    {
+      objects[i].textureIndex = m_textureSlots[i % m_textureSlots.size()];
+    }
+  }
+
+  // Each page's objects (and so its draw command slots) are contiguous
+  std::stable_sort(
+    objects.begin(), objects.end(), [](const ObjectData& a, const ObjectData& b) {
+      return a.page < b.page;
+    });
+  createTransforms(objects);
+
+  m_pageBatches.clear();
+  for (uint32_t i = 0; i < m_objectCount; ++i)
+  {
+    if (m_pageBatches.empty() || m_pageBatches.back().page != objects[i].page)
+    {
+      DrawBatch batch;
+      batch.page         = objects[i].page;
+      batch.firstCommand = i;
+      m_pageBatches.push_back(batch);
+    }
+    m_pageBatches.back().commandCount++;
+  }
+
+  createDeviceLocalBuffer(
+    m_physicalDevice,
+    m_device,
+    commandPool,
+    queue,
+    objects.data(),
+    sizeof(objects[0]) * objects.size(),
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    m_objectBuffer,
+    m_objectBufferMemory);
+
+  if (m_bindless)
+  {
+    m_objectBufferSlot = m_bindless->addStorageBuffer(m_objectBuffer);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Each block of OBJECT_GROUP_SIZE objects gets a group node at its centre; the objects
+// are its children, keeping their grid placement
+void
+GpuDrivenRenderer::createTransforms(const std::vector<ObjectData>& objects)
+{
+  m_transforms = TransformHierarchy();
+  m_groups.clear();
+  m_nodeObjects.clear();
+
+  const uint32_t groupCount = (m_objectCount + OBJECT_GROUP_SIZE - 1) / OBJECT_GROUP_SIZE;
+  m_transforms.reserve(m_objectCount + groupCount);
+  m_nodeObjects.reserve(m_objectCount + groupCount);
+  for (uint32_t first = 0; first < m_objectCount; first += OBJECT_GROUP_SIZE)
+  {
+    const uint32_t end = std::min(first + OBJECT_GROUP_SIZE, m_objectCount);
+
+    Transform group;
+    for (uint32_t i = first; i < end; ++i)
+    {
+      group.position += glm::vec3(objects[i].boundingSphere);
+    }
+    group.position /= static_cast<float>(end - first);
+    m_groups.push_back(m_transforms.create(group));
+    m_nodeObjects.push_back(NO_OBJECT);
+
+    for (uint32_t i = first; i < end; ++i)
+    {
+      Transform object;
+      object.position = glm::vec3(objects[i].boundingSphere) - group.position;
+      object.scale    = objects[i].boundingSphere.w;
+      m_transforms.create(object, m_groups.back());
+      m_nodeObjects.push_back(i);
+    }
+  }
+  assert(m_nodeObjects.size() == m_transforms.size());
+  m_transforms.update();
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createTextures(const std::string& texturePath)
+{
+  if (!texturePath.empty())
+  {
+    m_textures.push_back(m_textureManager->loadTexture(texturePath));
+  }
+  else if (m_bindless)
+  {
+    for (uint32_t squareSize : BINDLESS_CHECKER_SQUARES)
+    {
+      m_textures.push_back(createChecker(*m_textureManager, squareSize));
+    }
+  }
+  else
+  {
+    m_textures.push_back(createChecker(*m_textureManager, CHECKER_SQUARE));
+  }
+
+  if (m_bindless)
+  {
+    for (TextureHandle texture : m_textures)
+    {
+      m_textureSlots.push_back(m_bindless->addSampledImage(
+        m_textureManager->texture(texture).view,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    }
+    m_samplerSlot = m_bindless->addSampler(m_textureManager->getSampler());
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createDescriptorSetLayout()
+{
+  // 0: objects, 1: frame uniforms, 2: draw commands, 3: draw count per page,
+  // 4: world bounds, 5: texture (not in bindless mode, which uses the global set),
+  // 6: last frame's occlusion results (bound even when occlusion culling is off)
+  VkDescriptorSetLayoutBinding bindings[7] = {};
+
+  bindings[0].binding         = 0;
+  bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[1].binding         = 1;
+  bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[2].binding         = 2;
+  bindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[2].descriptorCount = 1;
+  bindings[2].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[3].binding         = 3;
+  bindings[3].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[3].descriptorCount = 1;
+  bindings[3].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[4].binding         = 4;
+  bindings[4].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[4].descriptorCount = 1;
+  bindings[4].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[5].binding         = 6;
+  bindings[5].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[5].descriptorCount = 1;
+  bindings[5].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[6].binding         = 5;
+  bindings[6].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[6].descriptorCount = 1;
+  bindings[6].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = m_bindless ? 6 : 7;
+  layoutInfo.pBindings    = bindings;
+
+  if (
+    vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_descriptorSetLayout)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor set layout!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createSwapChainResources(
+  VkRenderPass renderPass,
+  const std::vector<uint32_t>& viewFrameCounts)
+{
+  createDrawPipeline(renderPass);
+  createFrameResources(viewFrameCounts);
+  createDescriptorSets();
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createDrawPipeline(VkRenderPass renderPass)
+{
+  // Bindless builds of the same shaders (-DBINDLESS) use the global set instead
+  const char* vertShader =
+    m_bindless ? "shaders/object_bindless_vert.spv" : "shaders/object_vert.spv";
+  const char* fragShader =
+    m_bindless ? "shaders/object_bindless_frag.spv" : "shaders/object_frag.spv";
+  VkShaderModule vertShaderModule = createShaderModule(m_device, readFile(vertShader));
+  VkShaderModule fragShaderModule = createShaderModule(m_device, readFile(fragShader));
+
+  VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+  shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+  shaderStages[0].module = vertShaderModule;
+  shaderStages[0].pName  = "main";
+  shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shaderStages[1].module = fragShaderModule;
+  shaderStages[1].pName  = "main";
+
+  auto bindingDescription    = PackedVertex::getBindingDescription();
+  auto attributeDescriptions = PackedVertex::getAttributeDescriptions();
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.pVertexBindingDescriptions    = &bindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount
+    = static_cast<uint32_t>(attributeDescriptions.size());
+  vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+  // Set by the caller's render pass, so windows of any size share the pipeline
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates    = dynamicStates;
+
+  // Front faces wind counter-clockwise, as in .obj and .glb files (the projection's Y
+  // flip keeps the winding the viewer sees); the built in shapes have both sides
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth   = 1.0f;
+  rasterizer.cullMode    = VK_CULL_MODE_BACK_BIT;
+  rasterizer.frontFace   = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading     = 1.0f;
+
+  // Against the scene pass's depth attachment, so early depth rejects hidden fragments
+  VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable  = VK_TRUE;
+  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthCompareOp   = VK_COMPARE_OP_LESS;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+  colorBlendAttachment.colorWriteMask
+    = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+      | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable = VK_FALSE;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable   = VK_FALSE;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments    = &colorBlendAttachment;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount          = 2;
+  pipelineInfo.pStages             = shaderStages;
+  pipelineInfo.pVertexInputState   = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState      = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState   = &multisampling;
+  pipelineInfo.pDepthStencilState  = &depthStencil;
+  pipelineInfo.pColorBlendState    = &colorBlending;
+  pipelineInfo.pDynamicState       = &dynamicState;
+  pipelineInfo.layout              = m_pipelineLayout;
+  pipelineInfo.renderPass          = renderPass;
+  pipelineInfo.subpass             = 0;
+  pipelineInfo.basePipelineIndex   = -1;
+
+  VkResult result = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_drawPipeline);
+
+  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create graphics pipeline!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Depth only render pass plus the occluder and bounding box pipelines; neither depends on
+// the swap chain, the depth image comes from the caller
+void
+GpuDrivenRenderer::createOcclusionPipelines()
+{
+  m_depthFormat = findDepthFormat(m_physicalDevice);
+
+  // The caller's render graph moves the image in and out of the attachment layout
+  VkAttachmentDescription depthAttachment = {};
+  depthAttachment.format                  = m_depthFormat;
+  depthAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.finalLayout   = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depthAttachmentRef = {};
+  depthAttachmentRef.attachment            = 0;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass    = {};
+  subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount        = 1;
+  renderPassInfo.pAttachments           = &depthAttachment;
+  renderPassInfo.subpassCount           = 1;
+  renderPassInfo.pSubpasses             = &subpass;
+  if (
+    vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_occlusionRenderPass)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create occlusion render pass!");
+  }
+
+  m_occluderPipeline = createDepthPipeline(
+    m_bindless ? "shaders/object_bindless_vert.spv" : "shaders/object_vert.spv",
+    VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+    true,
+    true);
+  m_boxPipeline = createDepthPipeline(
+    "shaders/occlusion_box_vert.spv", VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, false, false);
+}
+
+//----------------------------------------------------------------------------------------
+// Vertex shader only, depth tested against m_occlusionRenderPass
+// meshVertices: reads the packed mesh vertices, else draws without vertex input
+// depthWrite: occluders write depth, the query boxes only test against it
+VkPipeline
+GpuDrivenRenderer::createDepthPipeline(
+  const char* vertShader,
+  VkPrimitiveTopology topology,
+  bool meshVertices,
+  bool depthWrite)
+{
+  VkShaderModule vertShaderModule = createShaderModule(m_device, readFile(vertShader));
+
+  VkPipelineShaderStageCreateInfo shaderStage = {};
+  shaderStage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStage.stage  = VK_SHADER_STAGE_VERTEX_BIT;
+  shaderStage.module = vertShaderModule;
+  shaderStage.pName  = "main";
+
+  auto bindingDescription    = PackedVertex::getBindingDescription();
+  auto attributeDescriptions = PackedVertex::getAttributeDescriptions();
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  if (meshVertices)
+  {
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions    = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount
+      = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+  }
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = topology;
+  inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates    = dynamicStates;
+
+  // The camera can be inside a box, so neither pipeline culls faces
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth   = 1.0f;
+  rasterizer.cullMode    = VK_CULL_MODE_NONE;
+  rasterizer.frontFace   = VK_FRONT_FACE_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading     = 1.0f;
+
+  // A box touching an occluder's surface counts as visible
+  VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable  = VK_TRUE;
+  depthStencil.depthWriteEnable = depthWrite ? VK_TRUE : VK_FALSE;
+  depthStencil.depthCompareOp
+    = depthWrite ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount          = 1;
+  pipelineInfo.pStages             = &shaderStage;
+  pipelineInfo.pVertexInputState   = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState      = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState   = &multisampling;
+  pipelineInfo.pDepthStencilState  = &depthStencil;
+  pipelineInfo.pColorBlendState    = &colorBlending;
+  pipelineInfo.pDynamicState       = &dynamicState;
+  pipelineInfo.layout              = m_pipelineLayout;
+  pipelineInfo.renderPass          = m_occlusionRenderPass;
+  pipelineInfo.subpass             = 0;
+  pipelineInfo.basePipelineIndex   = -1;
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VkResult result     = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create depth pipeline!");
+  }
+  return pipeline;
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createFrameResources(const std::vector<uint32_t>& viewFrameCounts)
+{
+  // Nothing is hidden until the first occlusion results are in
+  m_views.resize(viewFrameCounts.size());
+  for (uint32_t view = 0; view < m_views.size(); ++view)
+  {
+    ViewResources& resources = m_views[view];
+    const VkDeviceSize size  = sizeof(uint32_t) * m_objectCount;
+    createBuffer(
+      m_physicalDevice,
+      m_device,
+      size,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      resources.visibilityBuffer,
+      resources.visibilityMemory);
+    void* mapped = nullptr;
+    vkMapMemory(m_device, resources.visibilityMemory, 0, size, 0, &mapped);
+    std::fill_n(static_cast<uint32_t*>(mapped), m_objectCount, 1u);
+    resources.visibilityMapped = static_cast<const uint32_t*>(mapped);
+
+    for (uint32_t i = 0; i < viewFrameCounts[view]; ++i)
+    {
+      FrameResources frame = {};
+      frame.view           = view;
+      m_frames.push_back(frame);
+    }
+  }
+
+  for (auto& frame : m_frames)
+  {
+    createBuffer(
+      m_physicalDevice,
+      m_device,
+      sizeof(FrameUniforms),
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.uniformBuffer,
+      frame.uniformBufferMemory);
+    vkMapMemory(
+      m_device, frame.uniformBufferMemory, 0, sizeof(FrameUniforms), 0, &frame.uniformMapped);
+
+    createBuffer(
+      m_physicalDevice,
+      m_device,
+      sizeof(VkDrawIndexedIndirectCommand) * m_objectCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      frame.drawBuffer,
+      frame.drawBufferMemory);
+
+    createBuffer(
+      m_physicalDevice,
+      m_device,
+      sizeof(uint32_t) * MAX_GEOMETRY_PAGES,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+        | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      frame.countBuffer,
+      frame.countBufferMemory);
+
+    const VkDeviceSize transformSize = sizeof(glm::vec4) * m_objectCount;
+    createBuffer(
+      m_physicalDevice,
+      m_device,
+      transformSize,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.transformBuffer,
+      frame.transformBufferMemory);
+    void* transformMapped = nullptr;
+    vkMapMemory(
+      m_device, frame.transformBufferMemory, 0, transformSize, 0, &transformMapped);
+    frame.transformMapped = static_cast<glm::vec4*>(transformMapped);
+
+    TransformRange everything;
+    everything.count = static_cast<uint32_t>(m_transforms.size());
+    writeTransforms(frame, everything);
+    frame.pendingTransforms.clear();
+
+    if (m_occlusionCulling)
+    {
+      VkQueryPoolCreateInfo queryPoolInfo = {};
+      queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      queryPoolInfo.queryType             = VK_QUERY_TYPE_OCCLUSION;
+      queryPoolInfo.queryCount            = m_objectCount;
+      if (
+        vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &frame.occlusionQueries)
+        != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create occlusion query pool!");
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::createDescriptorSets()
+{
+  const auto frameCount = static_cast<uint32_t>(m_frames.size());
+
+  VkDescriptorPoolSize poolSizes[3] = {};
+  poolSizes[0].type                 = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  poolSizes[0].descriptorCount      = frameCount;
+  poolSizes[1].type                 = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[1].descriptorCount      = 5 * frameCount;
+  poolSizes[2].type                 = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[2].descriptorCount      = frameCount;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount              = m_bindless ? 2 : 3;
+  poolInfo.pPoolSizes                 = poolSizes;
+  poolInfo.maxSets                    = frameCount;
+
+  if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(frameCount, m_descriptorSetLayout);
+  std::vector<VkDescriptorSet> descriptorSets(frameCount);
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool              = m_descriptorPool;
+  allocInfo.descriptorSetCount          = frameCount;
+  allocInfo.pSetLayouts                 = layouts.data();
+
+  if (vkAllocateDescriptorSets(m_device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate descriptor sets!");
+  }
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.sampler               = m_textureManager->getSampler();
+  imageInfo.imageView             = m_textureManager->texture(m_textures[0]).view;
+  imageInfo.imageLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  for (size_t i = 0; i < m_frames.size(); ++i)
+  {
+    FrameResources& frame = m_frames[i];
+    frame.descriptorSet   = descriptorSets[i];
+
+    const VkBuffer visibilityBuffer = m_views[frame.view].visibilityBuffer;
+
+    // Buffer bindings 0-4 and 6, then the texture
+    VkDescriptorBufferInfo bufferInfos[6] = {};
+    bufferInfos[0]                        = {m_objectBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[1]                        = {frame.uniformBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[2]                        = {frame.drawBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[3]                        = {frame.countBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[4]                        = {frame.transformBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[5]                        = {visibilityBuffer, 0, VK_WHOLE_SIZE};
+
+    VkWriteDescriptorSet writes[7] = {};
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+      writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet          = frame.descriptorSet;
+      writes[i].dstBinding      = (i == 5) ? 6 : i;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType  = (i == 1) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                           : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].pBufferInfo     = &bufferInfos[i];
+    }
+    writes[6].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[6].dstSet          = frame.descriptorSet;
+    writes[6].dstBinding      = 5;
+    writes[6].descriptorCount = 1;
+    writes[6].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[6].pImageInfo      = &imageInfo;
+    vkUpdateDescriptorSets(m_device, m_bindless ? 6 : 7, writes, 0, nullptr);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::recordCulling(VkCommandBuffer commandBuffer, size_t frameIndex)
+{
+  const FrameResources& frame = m_frames[frameIndex];
+
+  if (useDrawIndirectCount())
+  {
+    vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    VkBufferMemoryBarrier clearBarrier = {};
+    clearBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.buffer              = frame.countBuffer;
+    clearBarrier.offset              = 0;
+    clearBarrier.size                = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      1,
+      &clearBarrier,
+      0,
+      nullptr);
+  }
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    m_pipelineLayout,
+    0,
+    1,
+    &frame.descriptorSet,
+    0,
+    nullptr);
+  vkCmdDispatch(
+    commandBuffer, (m_objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::recordDraws(VkCommandBuffer commandBuffer, size_t frameIndex)
+{
+  const FrameResources& frame = m_frames[frameIndex];
+  bindDrawState(commandBuffer, frame, m_drawPipeline);
+  recordIndirectDraws(commandBuffer, frame);
+}
+
+//----------------------------------------------------------------------------------------
+// The pipeline, the frame's set and in bindless mode the global set and its indices
+void
+GpuDrivenRenderer::bindDrawState(
+  VkCommandBuffer commandBuffer,
+  const FrameResources& frame,
+  VkPipeline pipeline) const
+{
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_GRAPHICS,
+    m_pipelineLayout,
+    0,
+    1,
+    &frame.descriptorSet,
+    0,
+    nullptr);
+  if (m_bindless)
+  {
+    m_bindless->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1);
+
+    BindlessPushConstants indices = {m_objectBufferSlot, m_samplerSlot};
+    vkCmdPushConstants(
+      commandBuffer,
+      m_pipelineLayout,
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      0,
+      sizeof(indices),
+      &indices);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The culling's output: every object in view that wasn't hidden last frame
+void
+GpuDrivenRenderer::recordIndirectDraws(
+  VkCommandBuffer commandBuffer,
+  const FrameResources& frame)
+{
+  if (!useDrawIndirectCount())
+  {
+    m_geometry->recordBatches(
+      commandBuffer, frame.drawBuffer, 0, m_pageBatches, m_multiDrawIndirect);
+    return;
+  }
+
+  // One bind and one count draw per page; the page's count says how many slots are used
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  for (const DrawBatch& batch : m_pageBatches)
+  {
+    m_geometry->bindPage(commandBuffer, batch.page);
+    m_cmdDrawIndexedIndirectCount(
+      commandBuffer,
+      frame.drawBuffer,
+      VkDeviceSize(batch.firstCommand) * stride,
+      frame.countBuffer,
+      VkDeviceSize(batch.page) * sizeof(uint32_t),
+      batch.commandCount,
+      stride);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::recordOcclusion(
+  VkCommandBuffer commandBuffer,
+  size_t frameIndex,
+  VkFramebuffer framebuffer,
+  VkExtent2D extent)
+{
+  const FrameResources& frame = m_frames[frameIndex];
+
+  vkCmdResetQueryPool(commandBuffer, frame.occlusionQueries, 0, m_objectCount);
+
+  VkClearValue clearDepth = {};
+  clearDepth.depthStencil = {1.0f, 0};
+
+  VkRenderPassBeginInfo renderPassInfo = {};
+  renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass            = m_occlusionRenderPass;
+  renderPassInfo.framebuffer           = framebuffer;
+  renderPassInfo.renderArea.offset     = {0, 0};
+  renderPassInfo.renderArea.extent     = extent;
+  renderPassInfo.clearValueCount       = 1;
+  renderPassInfo.pClearValues          = &clearDepth;
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  VkViewport viewport = {};
+  viewport.width      = static_cast<float>(extent.width);
+  viewport.height     = static_cast<float>(extent.height);
+  viewport.maxDepth   = 1.0f;
+  VkRect2D scissor    = {{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  // Occluders: the objects the cull just kept, i.e. those visible last frame
+  bindDrawState(commandBuffer, frame, m_occluderPipeline);
+  recordIndirectDraws(commandBuffer, frame);
+
+  // Queries: every object's bounding box, so hidden objects can come back
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_boxPipeline);
+  for (uint32_t object = 0; object < m_objectCount; ++object)
+  {
+    vkCmdBeginQuery(commandBuffer, frame.occlusionQueries, object, 0);
+    vkCmdDraw(commandBuffer, BOX_STRIP_VERTICES, 1, 0, object);
+    vkCmdEndQuery(commandBuffer, frame.occlusionQueries, object);
+  }
+
+  vkCmdEndRenderPass(commandBuffer);
+
+  // Stays on the GPU: the next frame's cull reads the copy, the CPU never waits on it
+  vkCmdCopyQueryPoolResults(
+    commandBuffer,
+    frame.occlusionQueries,
+    0,
+    m_objectCount,
+    m_views[frame.view].visibilityBuffer,
+    0,
+    sizeof(uint32_t),
+    VK_QUERY_RESULT_WAIT_BIT);
+}
+
+//----------------------------------------------------------------------------------------
+uint32_t
+GpuDrivenRenderer::occludedCount(size_t view) const
+{
+  if (!m_occlusionCulling || view >= m_views.size())
+  {
+    return 0;
+  }
+  const uint32_t* visible = m_views[view].visibilityMapped;
+  return static_cast<uint32_t>(std::count(visible, visible + m_objectCount, 0u));
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::updateScene(float spin)
+{
+  // Spin up to SPINNING_GROUPS groups spread over the scene, in alternate directions
+  const size_t stride = std::max<size_t>(1, m_groups.size() / SPINNING_GROUPS);
+  for (size_t g = 0; g < m_groups.size(); g += stride)
+  {
+    const float angle = ((g / stride) % 2 == 0) ? spin : -spin;
+    m_transforms.setRotation(
+      m_groups[g], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+  }
+
+  // Every frame's buffer needs the change, each is written when it is next drawn
+  const std::vector<TransformRange>& updated = m_transforms.update();
+  TransformRange everything;
+  everything.count = static_cast<uint32_t>(m_transforms.size());
+  for (FrameResources& frame : m_frames)
+  {
+    // Already the lot, which stays as it is until written
+    const bool allPending = frame.pendingTransforms.size() == 1
+                            && frame.pendingTransforms[0].first == 0
+                            && frame.pendingTransforms[0].count == everything.count;
+    if (allPending)
+    {
+      continue;
+    }
+    frame.pendingTransforms.insert(
+      frame.pendingTransforms.end(), updated.begin(), updated.end());
+    if (frame.pendingTransforms.size() > MAX_PENDING_TRANSFORM_RANGES)
+    {
+      frame.pendingTransforms.assign(1, everything);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::updateFrame(size_t frameIndex, const glm::mat4& viewProj)
+{
+  FrameResources& frame = m_frames[frameIndex];
+
+  // Ranges collected over several frames overlap, write each node once
+  std::sort(
+    frame.pendingTransforms.begin(),
+    frame.pendingTransforms.end(),
+    [](const TransformRange& a, const TransformRange& b) { return a.first < b.first; });
+  uint32_t written = 0;
+  for (const TransformRange& range : frame.pendingTransforms)
+  {
+    const uint32_t first = std::max(range.first, written);
+    const uint32_t end   = range.first + range.count;
+    if (first < end)
+    {
+      writeTransforms(frame, {first, end - first});
+      written = end;
+    }
+  }
+  frame.pendingTransforms.clear();
+
+  FrameUniforms uniforms = {};
+  uniforms.viewProj      = viewProj;
+  uniforms.frustum       = extractFrustum(viewProj);
+  uniforms.pageFirstDraw = pageFirstDraw();
+  uniforms.objectCount   = m_objectCount;
+
+  memcpy(frame.uniformMapped, &uniforms, sizeof(uniforms));
+}
+
+//----------------------------------------------------------------------------------------
+// Objects only use the position and uniform scale of their world matrix
+void
+GpuDrivenRenderer::writeTransforms(
+  FrameResources& frame,
+  const TransformRange& range) const
+{
+  const glm::mat4* worlds = m_transforms.worldMatrices();
+  for (uint32_t index = range.first; index < range.first + range.count; ++index)
+  {
+    const uint32_t object = m_nodeObjects[m_transforms.handle(index)];
+    if (object != NO_OBJECT)
+    {
+      const glm::mat4& world = worlds[index];
+      frame.transformMapped[object] =
+        glm::vec4(glm::vec3(world[3]), glm::length(glm::vec3(world[0])));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+glm::uvec4
+GpuDrivenRenderer::pageFirstDraw() const
+{
+  glm::uvec4 firstDraw(0);
+  for (const DrawBatch& batch : m_pageBatches)
+  {
+    firstDraw[batch.page] = batch.firstCommand;
+  }
+  return firstDraw;
+}
+
+//----------------------------------------------------------------------------------------
+float
+GpuDrivenRenderer::sceneExtent() const
+{
+  return objectGridExtent(m_objectCount, m_objectSpacing);
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::retireSwapChainResources(DeletionQueue& deletionQueue)
+{
+  deletionQueue.push([device         = m_device,
+                      frames         = std::move(m_frames),
+                      views          = std::move(m_views),
+                      descriptorPool = m_descriptorPool,
+                      drawPipeline   = m_drawPipeline]() {
+    for (auto& frame : frames)
+    {
+      vkDestroyQueryPool(device, frame.occlusionQueries, nullptr);
+      vkDestroyBuffer(device, frame.transformBuffer, nullptr);
+      freeDeviceMemory(device, frame.transformBufferMemory);
+      vkDestroyBuffer(device, frame.countBuffer, nullptr);
+      freeDeviceMemory(device, frame.countBufferMemory);
+      vkDestroyBuffer(device, frame.drawBuffer, nullptr);
+      freeDeviceMemory(device, frame.drawBufferMemory);
+      vkDestroyBuffer(device, frame.uniformBuffer, nullptr);
+      freeDeviceMemory(device, frame.uniformBufferMemory);
+    }
+    for (auto& view : views)
+    {
+      vkDestroyBuffer(device, view.visibilityBuffer, nullptr);
+      freeDeviceMemory(device, view.visibilityMemory);
+    }
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipeline(device, drawPipeline, nullptr);
+  });
+
+  m_frames.clear();
+  m_views.clear();
+  m_descriptorPool = VK_NULL_HANDLE;
+  m_drawPipeline   = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+void
+GpuDrivenRenderer::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(m_device, m_boxPipeline, nullptr);
+  vkDestroyPipeline(m_device, m_occluderPipeline, nullptr);
+  vkDestroyRenderPass(m_device, m_occlusionRenderPass, nullptr);
+  vkDestroyPipeline(m_device, m_cullPipeline, nullptr);
+  vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+
+  vkDestroyBuffer(m_device, m_objectBuffer, nullptr);
+  freeDeviceMemory(m_device, m_objectBufferMemory);
+
+  if (m_bindless)
+  {
+    m_bindless->removeStorageBuffer(m_objectBufferSlot);
+    m_bindless->removeSampler(m_samplerSlot);
+    for (BindlessIndex slot : m_textureSlots)
+    {
+      m_bindless->removeSampledImage(slot);
+    }
+    m_textureSlots.clear();
+    m_objectBufferSlot = INVALID_BINDLESS_INDEX;
+    m_samplerSlot      = INVALID_BINDLESS_INDEX;
+  }
+  for (TextureHandle texture : m_textures)
+  {
+    m_textureManager->destroyTexture(texture);
+  }
+  m_textures.clear();
+
+  for (MeshHandle mesh : m_meshes)
+  {
+    m_geometry->removeMesh(mesh);
+  }
+  m_meshes.clear();
+  m_device = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "BindlessDescriptors.h"
+#include "DeletionQueue.h"
+#include "GeometryPacker.h"
+#include "Scene.h"
+#include "TextureManager.h"
+#include "TransformHierarchy.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Draw commands are written per geometry page, so each page needs one buffer bind
+constexpr uint32_t MAX_GEOMETRY_PAGES = 4;
+
+// Mirrors `FrameData` in object.vert and cull.comp (std140)
+struct FrameUniforms
+{
+  glm::mat4 viewProj;
+  Frustum frustum;
+  glm::uvec4 pageFirstDraw;    // first draw command slot of each page
+  uint32_t objectCount;
+  uint32_t padding[3];
+};
+
+// Mirrors `BindlessIndices` in object.vert and object.frag (built with -DBINDLESS)
+struct BindlessPushConstants
+{
+  BindlessIndex objectBuffer;
+  BindlessIndex sampler;
+};
+
+//----------------------------------------------------------------------------------------
+// GPU driven rendering of many objects:
+//  - meshes live in the shared GeometryPacker pages, objects are sorted by page
+//  - per object draw data lives in a device local storage buffer
+//  - objects are leaves of a TransformHierarchy under group nodes of 64 objects; a few
+//    groups spin, and only the world bounds of their objects are recomputed and
+//    written to the per frame transform buffers
+//  - a compute pass frustum culls them and writes VkDrawIndexedIndirectCommands
+//  - the graphics pass consumes them with vkCmdDrawIndexedIndirectCount, or with
+//    vkCmdDrawIndexedIndirect over every object (culled ones have instanceCount = 0)
+//  - in bindless mode each object picks its texture by index and the shaders find the
+//    object buffer and sampler through push constants, so nothing is bound per draw
+//  - with occlusion culling, a depth only pass draws what the cull kept (the objects
+//    visible last frame) as occluders, then a bounding box of every object inside an
+//    occlusion query. The results are copied on the GPU to the view's visibility
+//    buffer and the next frame's cull skips the objects whose box had no samples
+// Commands are recorded once; per frame the CPU only writes the frame uniforms and
+// the moved objects' world bounds.
+//----------------------------------------------------------------------------------------
+class GpuDrivenRenderer
+{
+  // Resources owned per swap chain image of every window (command buffers use them
+  // concurrently)
+  struct FrameResources
+  {
+    uint32_t view                        = 0;
+    VkBuffer uniformBuffer               = VK_NULL_HANDLE;
+    VkDeviceMemory uniformBufferMemory   = VK_NULL_HANDLE;
+    void* uniformMapped                  = nullptr;
+    VkBuffer drawBuffer                  = VK_NULL_HANDLE;
+    VkDeviceMemory drawBufferMemory      = VK_NULL_HANDLE;
+    VkBuffer countBuffer                 = VK_NULL_HANDLE;
+    VkDeviceMemory countBufferMemory     = VK_NULL_HANDLE;
+    VkBuffer transformBuffer             = VK_NULL_HANDLE;
+    VkDeviceMemory transformBufferMemory = VK_NULL_HANDLE;
+    glm::vec4* transformMapped           = nullptr;    // world sphere per object
+    VkDescriptorSet descriptorSet        = VK_NULL_HANDLE;
+    VkQueryPool occlusionQueries         = VK_NULL_HANDLE;    // one per object
+    std::vector<TransformRange> pendingTransforms;    // changed since last written
+  };
+
+  // Per window: the occlusion results of its last frame, whichever image drew it
+  struct ViewResources
+  {
+    VkBuffer visibilityBuffer        = VK_NULL_HANDLE;    // a sample count per object
+    VkDeviceMemory visibilityMemory  = VK_NULL_HANDLE;
+    const uint32_t* visibilityMapped = nullptr;
+  };
+
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkDevice m_device                 = VK_NULL_HANDLE;
+  GeometryPacker* m_geometry        = nullptr;
+  TextureManager* m_textureManager  = nullptr;
+  BindlessDescriptors* m_bindless   = nullptr;    // null: per renderer texture binding
+  uint32_t m_objectCount            = 0;
+  bool m_multiDrawIndirect          = false;
+  bool m_occlusionCulling           = false;
+  float m_objectSpacing             = 0.0f;    // between grid cells
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+
+  std::vector<MeshHandle> m_meshes;
+  std::vector<DrawBatch> m_pageBatches;    // draw slots of each page's objects
+  VkBuffer m_objectBuffer             = VK_NULL_HANDLE;
+  VkDeviceMemory m_objectBufferMemory = VK_NULL_HANDLE;
+  std::vector<TextureHandle> m_textures;
+
+  TransformHierarchy m_transforms;
+  std::vector<TransformHandle> m_groups;
+  std::vector<uint32_t> m_nodeObjects;    // object index by node handle (~0u: group)
+
+  // Bindless slots (objects index m_textureSlots through ObjectData::textureIndex)
+  std::vector<BindlessIndex> m_textureSlots;
+  BindlessIndex m_objectBufferSlot = INVALID_BINDLESS_INDEX;
+  BindlessIndex m_samplerSlot      = INVALID_BINDLESS_INDEX;
+
+  VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_pipelineLayout           = VK_NULL_HANDLE;
+  VkPipeline m_cullPipeline                   = VK_NULL_HANDLE;
+
+  // Occlusion culling only
+  VkFormat m_depthFormat             = VK_FORMAT_UNDEFINED;
+  VkRenderPass m_occlusionRenderPass = VK_NULL_HANDLE;
+  VkPipeline m_occluderPipeline      = VK_NULL_HANDLE;    // depth only objects
+  VkPipeline m_boxPipeline           = VK_NULL_HANDLE;    // query bounding boxes
+
+  // Swap chain dependent
+  VkPipeline m_drawPipeline         = VK_NULL_HANDLE;
+  VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+  std::vector<FrameResources> m_frames;
+  std::vector<ViewResources> m_views;
+
+private:
+  void
+  createGeometry(VkCommandPool commandPool, VkQueue queue, const std::string& meshPath);
+  void createTextures(const std::string& texturePath);
+  void createTransforms(const std::vector<ObjectData>& objects);
+  void writeTransforms(FrameResources& frame, const TransformRange& range) const;
+  glm::uvec4 pageFirstDraw() const;
+  void createDescriptorSetLayout();
+  void createDrawPipeline(VkRenderPass renderPass);
+  void createOcclusionPipelines();
+  VkPipeline createDepthPipeline(
+    const char* vertShader,
+    VkPrimitiveTopology topology,
+    bool meshVertices,
+    bool depthWrite);
+  void createFrameResources(const std::vector<uint32_t>& viewFrameCounts);
+  void createDescriptorSets();
+  void bindDrawState(
+    VkCommandBuffer commandBuffer,
+    const FrameResources& frame,
+    VkPipeline pipeline) const;
+  void recordIndirectDraws(VkCommandBuffer commandBuffer, const FrameResources& frame);
+
+  bool useDrawIndirectCount() const { return m_cmdDrawIndexedIndirectCount != nullptr; }
+
+public:
+  // meshPath: .obj / .glb file drawn by every object (empty for the built in shapes)
+  // texturePath: .ktx2 / .dds file the objects are textured with (empty for a checker)
+  // bindless: global descriptor set to take textures and the object buffer from by
+  //   index, or null to bind a single texture in the renderer's own set
+  // drawIndirectCount: the device has VK_KHR_draw_indirect_count enabled
+  // multiDrawIndirect: the device has the multiDrawIndirect feature enabled
+  // occlusionCulling: skip objects whose bounding box was hidden in the last frame
+  // dense: pack the objects so closely that they overlap, for heavy overdraw
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    GeometryPacker& geometry,
+    TextureManager& textures,
+    BindlessDescriptors* bindless,
+    VkCommandPool commandPool,
+    VkQueue queue,
+    uint32_t objectCount,
+    const std::string& meshPath,
+    const std::string& texturePath,
+    bool drawIndirectCount,
+    bool multiDrawIndirect,
+    bool occlusionCulling,
+    bool dense);
+  void cleanup();
+
+  // viewFrameCounts: swap chain images of each window; frames are numbered window by
+  // window. The draw pipeline takes its viewport and scissor from dynamic state
+  void createSwapChainResources(
+    VkRenderPass renderPass,
+    const std::vector<uint32_t>& viewFrameCounts);
+  // The old resources are destroyed once the frames in flight are done with them
+  void retireSwapChainResources(DeletionQueue& deletionQueue);
+
+  // Record outside of the render pass. The caller (the render graph's cull pass) orders
+  // it after the last frame's indirect reads and the draws after it
+  void recordCulling(VkCommandBuffer commandBuffer, size_t frameIndex);
+  // Record inside the render pass, after setting the viewport and scissor
+  void recordDraws(VkCommandBuffer commandBuffer, size_t frameIndex);
+  // Record after the culling, outside of a render pass: begins occlusionRenderPass()
+  // with the framebuffer (a depth image of the window's size) and copies the query
+  // results to the view's visibility buffer, which the next frame's culling reads
+  void recordOcclusion(
+    VkCommandBuffer commandBuffer,
+    size_t frameIndex,
+    VkFramebuffer framebuffer,
+    VkExtent2D extent);
+
+  // Once per frame. spin: radians, the spinning object groups' rotation
+  void updateScene(float spin);
+  // Once per window drawn this frame, after updateScene()
+  void updateFrame(size_t frameIndex, const glm::mat4& viewProj);
+
+  float sceneExtent() const;
+
+  bool occlusionCulling() const { return m_occlusionCulling; }
+  VkFormat occlusionDepthFormat() const { return m_depthFormat; }
+  VkRenderPass occlusionRenderPass() const { return m_occlusionRenderPass; }
+  // Objects hidden in the view's last finished frame (read from mapped memory)
+  uint32_t occludedCount(size_t view) const;
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,1043 @@
+#include <fmt/format.h>
+
+#include "Hud.h"
+#include "DeletionQueue.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+constexpr char VERTEX_SHADER[]   = "shaders/hud_vert.spv";
+constexpr char FRAGMENT_SHADER[] = "shaders/hud_frag.spv";
+
+// Built in 5x7 font from ' ' to '_' (lower case is drawn as upper case): five columns
+// per glyph, bit 0 the top row
+constexpr char FIRST_GLYPH      = ' ';
+constexpr uint32_t GLYPH_COUNT  = 64;
+constexpr uint32_t GLYPH_WIDTH  = 5;
+constexpr uint32_t GLYPH_HEIGHT = 7;
+constexpr uint8_t FONT[GLYPH_COUNT][GLYPH_WIDTH] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00},    // ' '
+  {0x00, 0x00, 0x5F, 0x00, 0x00},    // '!'
+  {0x00, 0x07, 0x00, 0x07, 0x00},    // '"'
+  {0x14, 0x7F, 0x14, 0x7F, 0x14},    // '#'
+  {0x24, 0x2A, 0x7F, 0x2A, 0x12},    // '$'
+  {0x23, 0x13, 0x08, 0x64, 0x62},    // '%'
+  {0x36, 0x49, 0x55, 0x22, 0x50},    // '&'
+  {0x00, 0x05, 0x03, 0x00, 0x00},    // '\''
+  {0x00, 0x1C, 0x22, 0x41, 0x00},    // '('
+  {0x00, 0x41, 0x22, 0x1C, 0x00},    // ')'
+  {0x08, 0x2A, 0x1C, 0x2A, 0x08},    // '*'
+  {0x08, 0x08, 0x3E, 0x08, 0x08},    // '+'
+  {0x00, 0x50, 0x30, 0x00, 0x00},    // ','
+  {0x08, 0x08, 0x08, 0x08, 0x08},    // '-'
+  {0x00, 0x60, 0x60, 0x00, 0x00},    // '.'
+  {0x20, 0x10, 0x08, 0x04, 0x02},    // '/'
+  {0x3E, 0x51, 0x49, 0x45, 0x3E},    // '0'
+  {0x00, 0x42, 0x7F, 0x40, 0x00},    // '1'
+  {0x42, 0x61, 0x51, 0x49, 0x46},    // '2'
+  {0x21, 0x41, 0x45, 0x4B, 0x31},    // '3'
+  {0x18, 0x14, 0x12, 0x7F, 0x10},    // '4'
+  {0x27, 0x45, 0x45, 0x45, 0x39},    // '5'
+  {0x3C, 0x4A, 0x49, 0x49, 0x30},    // '6'
+  {0x01, 0x71, 0x09, 0x05, 0x03},    // '7'
+  {0x36, 0x49, 0x49, 0x49, 0x36},    // '8'
+  {0x06, 0x49, 0x49, 0x29, 0x1E},    // '9'
+  {0x00, 0x36, 0x36, 0x00, 0x00},    // ':'
+  {0x00, 0x56, 0x36, 0x00, 0x00},    // ';'
+  {0x00, 0x08, 0x14, 0x22, 0x41},    // '<'
+  {0x14, 0x14, 0x14, 0x14, 0x14},    // '='
+  {0x41, 0x22, 0x14, 0x08, 0x00},    // '>'
+  {0x02, 0x01, 0x51, 0x09, 0x06},    // '?'
+  {0x32, 0x49, 0x79, 0x41, 0x3E},    // '@'
+  {0x7E, 0x11, 0x11, 0x11, 0x7E},    // 'A'
+  {0x7F, 0x49, 0x49, 0x49, 0x36},    // 'B'
+  {0x3E, 0x41, 0x41, 0x41, 0x22},    // 'C'
+  {0x7F, 0x41, 0x41, 0x22, 0x1C},    // 'D'
+  {0x7F, 0x49, 0x49, 0x49, 0x41},    // 'E'
+  {0x7F, 0x09, 0x09, 0x01, 0x01},    // 'F'
+  {0x3E, 0x41, 0x41, 0x51, 0x32},    // 'G'
+  {0x7F, 0x08, 0x08, 0x08, 0x7F},    // 'H'
+  {0x00, 0x41, 0x7F, 0x41, 0x00},    // 'I'
+  {0x20, 0x40, 0x41, 0x3F, 0x01},    // 'J'
+  {0x7F, 0x08, 0x14, 0x22, 0x41},    // 'K'
+  {0x7F, 0x40, 0x40, 0x40, 0x40},    // 'L'
+  {0x7F, 0x02, 0x04, 0x02, 0x7F},    // 'M'
+  {0x7F, 0x04, 0x08, 0x10, 0x7F},    // 'N'
+  {0x3E, 0x41, 0x41, 0x41, 0x3E},    // 'O'
+  {0x7F, 0x09, 0x09, 0x09, 0x06},    // 'P'
+  {0x3E, 0x41, 0x51, 0x21, 0x5E},    // 'Q'
+  {0x7F, 0x09, 0x19, 0x29, 0x46},    // 'R'
+  {0x46, 0x49, 0x49, 0x49, 0x31},    // 'S'
+  {0x01, 0x01, 0x7F, 0x01, 0x01},    // 'T'
+  {0x3F, 0x40, 0x40, 0x40, 0x3F},    // 'U'
+  {0x1F, 0x20, 0x40, 0x20, 0x1F},    // 'V'
+  {0x7F, 0x20, 0x18, 0x20, 0x7F},    // 'W'
+  {0x63, 0x14, 0x08, 0x14, 0x63},    // 'X'
+  {0x03, 0x04, 0x78, 0x04, 0x03},    // 'Y'
+  {0x61, 0x51, 0x49, 0x45, 0x43},    // 'Z'
+  {0x00, 0x00, 0x7F, 0x41, 0x41},    // '['
+  {0x02, 0x04, 0x08, 0x10, 0x20},    // '\\'
+  {0x41, 0x41, 0x7F, 0x00, 0x00},    // ']'
+  {0x04, 0x02, 0x01, 0x02, 0x04},    // '^'
+  {0x40, 0x40, 0x40, 0x40, 0x40},    // '_'
+};
+
+// The atlas: a cell per glyph, eight to a row, with a blank column and row so nothing
+// bleeds into a glyph's quad, then one white cell for the solid quads
+constexpr uint32_t CELL_WIDTH    = GLYPH_WIDTH + 1;
+constexpr uint32_t CELL_HEIGHT   = GLYPH_HEIGHT + 1;
+constexpr uint32_t ATLAS_COLUMNS = 8;
+constexpr uint32_t SOLID_CELL    = GLYPH_COUNT;
+constexpr uint32_t ATLAS_WIDTH   = ATLAS_COLUMNS * CELL_WIDTH;
+constexpr uint32_t ATLAS_HEIGHT  = (GLYPH_COUNT / ATLAS_COLUMNS + 1) * CELL_HEIGHT;
+
+// Layout in pixels: the text is drawn at TEXT_SCALE texels per pixel (nearest filtered,
+// so it stays sharp), the graphs span the text's width
+constexpr float TEXT_SCALE      = 2.0f;
+constexpr float ADVANCE         = CELL_WIDTH * TEXT_SCALE;
+constexpr float LINE_HEIGHT     = (CELL_HEIGHT + 1) * TEXT_SCALE;
+constexpr uint32_t TEXT_COLUMNS = 44;
+constexpr uint32_t TEXT_LINES   = 6;    // two above the graphs, four below
+constexpr float PANEL_LEFT      = 8.0f;
+constexpr float PANEL_TOP       = 8.0f;
+constexpr float PADDING         = 8.0f;
+constexpr float GRAPH_WIDTH     = TEXT_COLUMNS * ADVANCE;
+constexpr float GRAPH_HEIGHT    = 48.0f;
+constexpr float GRAPH_GAP       = 6.0f;
+constexpr float GRAPH_RANGE     = 1000.0f / 30.0f;    // ms at the top of a graph
+constexpr float GRAPH_TARGET    = 1000.0f / 60.0f;    // ms, marked across each graph
+constexpr float PANEL_WIDTH     = GRAPH_WIDTH + 2 * PADDING;
+constexpr float PANEL_HEIGHT =
+  TEXT_LINES * LINE_HEIGHT + 2 * (GRAPH_HEIGHT + GRAPH_GAP) + 2 * PADDING;
+
+// The panel, every character of the text, and a bar per frame plus the target line in
+// each graph; two triangles a quad, there is no index buffer
+constexpr uint32_t MAX_QUADS    = 1 + TEXT_LINES * TEXT_COLUMNS + 2 * (Hud::HISTORY + 1);
+constexpr uint32_t MAX_VERTICES = 6 * MAX_QUADS;
+
+// Timed passes averaged for each check against the budget
+constexpr uint32_t BUDGET_CHECK_PASSES = 120;
+
+// Mirrors the push constants of hud.vert
+struct PushConstants
+{
+  float invExtent[2];    // pixel to 0..1 coordinates
+};
+
+//----------------------------------------------------------------------------------------
+// RGBA8 as unpackUnorm4x8 reads it: red in the low byte
+static constexpr uint32_t
+rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+constexpr uint32_t PANEL_COLOR  = rgba(0, 0, 0, 176);
+constexpr uint32_t TEXT_COLOR   = rgba(255, 255, 255, 255);
+constexpr uint32_t CPU_COLOR    = rgba(96, 208, 96, 255);
+constexpr uint32_t GPU_COLOR    = rgba(240, 160, 48, 255);
+constexpr uint32_t TARGET_COLOR = rgba(255, 255, 255, 96);
+
+//----------------------------------------------------------------------------------------
+struct QuadRect
+{
+  float left;
+  float top;
+  float right;
+  float bottom;
+};
+
+//----------------------------------------------------------------------------------------
+// Two triangles covering position, textured from uv's corners
+static HudVertex*
+addQuad(HudVertex* out, const QuadRect& position, const QuadRect& uv, uint32_t color)
+{
+  constexpr bool CORNERS[6][2] = {
+    {false, false}, {true, false}, {true, true},
+    {false, false}, {true, true}, {false, true}};
+  for (const auto& corner : CORNERS)
+  {
+    HudVertex& vertex  = *out++;
+    vertex.position[0] = corner[0] ? position.right : position.left;
+    vertex.position[1] = corner[1] ? position.bottom : position.top;
+    vertex.uv[0]       = corner[0] ? uv.right : uv.left;
+    vertex.uv[1]       = corner[1] ? uv.bottom : uv.top;
+    vertex.color       = color;
+  }
+  return out;
+}
+
+//----------------------------------------------------------------------------------------
+// The glyph of c, unknown characters as '?'
+static QuadRect
+glyphUv(char c)
+{
+  if (c >= 'a' && c <= 'z')
+  {
+    c = static_cast<char>(c - 'a' + 'A');
+  }
+  if (c < FIRST_GLYPH || c >= FIRST_GLYPH + static_cast<int>(GLYPH_COUNT))
+  {
+    c = '?';
+  }
+  const auto cell  = static_cast<uint32_t>(c - FIRST_GLYPH);
+  const auto left  = static_cast<float>(cell % ATLAS_COLUMNS * CELL_WIDTH);
+  const auto top   = static_cast<float>(cell / ATLAS_COLUMNS * CELL_HEIGHT);
+  return {
+    left / ATLAS_WIDTH,
+    top / ATLAS_HEIGHT,
+    (left + GLYPH_WIDTH) / ATLAS_WIDTH,
+    (top + GLYPH_HEIGHT) / ATLAS_HEIGHT};
+}
+
+//----------------------------------------------------------------------------------------
+// Every corner at the middle of the white cell
+static QuadRect
+solidUv()
+{
+  const float u =
+    (SOLID_CELL % ATLAS_COLUMNS * CELL_WIDTH + 0.5f * CELL_WIDTH) / ATLAS_WIDTH;
+  const float v =
+    (SOLID_CELL / ATLAS_COLUMNS * CELL_HEIGHT + 0.5f * CELL_HEIGHT) / ATLAS_HEIGHT;
+  return {u, v, u, v};
+}
+
+//----------------------------------------------------------------------------------------
+// Nearest rank, p in 0..1 of sorted
+static float
+percentile(const std::vector<float>& sorted, float p)
+{
+  const auto rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+//----------------------------------------------------------------------------------------
+// Mean and percentiles of a time history
+static std::string
+timeSummary(const char* name, std::vector<float> times)
+{
+  if (times.empty())
+  {
+    return fmt::format("{} --", name);
+  }
+  const float mean = std::accumulate(times.begin(), times.end(), 0.0f) / times.size();
+  std::sort(times.begin(), times.end());
+  return fmt::format(
+    "{} {:6.2f} MS  P50 {:5.2f} P95 {:5.2f} P99 {:5.2f}",
+    name,
+    mean,
+    percentile(times, 0.5f),
+    percentile(times, 0.95f),
+    percentile(times, 0.99f));
+}
+
+//----------------------------------------------------------------------------------------
+static const char*
+presentModeName(VkPresentModeKHR mode)
+{
+  switch (mode)
+  {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO (VSYNC)";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO RELAXED";
+    default: return "OTHER";
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The panel clipped to an image of extent, empty when the image is within the margin
+static VkRect2D
+panelArea(VkExtent2D extent)
+{
+  const auto left   = static_cast<uint32_t>(PANEL_LEFT);
+  const auto top    = static_cast<uint32_t>(PANEL_TOP);
+  const auto width  = static_cast<uint32_t>(PANEL_WIDTH);
+  const auto height = static_cast<uint32_t>(PANEL_HEIGHT);
+
+  VkRect2D area      = {};
+  area.offset        = {static_cast<int32_t>(left), static_cast<int32_t>(top)};
+  area.extent.width  = extent.width > left ? std::min(width, extent.width - left) : 0;
+  area.extent.height = extent.height > top ? std::min(height, extent.height - top) : 0;
+  return area;
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  TextureManager& textures,
+  PipelineLayoutCache& layoutCache,
+  VkFormat outputFormat,
+  uint32_t framesInFlight,
+  float timestampPeriod,
+  uint64_t timestampMask)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+  assert(framesInFlight > 0);
+
+  m_physicalDevice  = physicalDevice;
+  m_device          = device;
+  m_textures        = &textures;
+  m_timestampPeriod = timestampPeriod;
+  m_timestampMask   = timestampMask;
+  m_vertexCounts.assign(framesInFlight, 0);
+  m_pendingQueries.assign(framesInFlight, {});
+
+  createAtlas();
+  createRenderPass(outputFormat);
+  createPipeline(layoutCache);
+  createDescriptorSet();
+
+  // The ring: MAX_VERTICES per frame in flight, mapped for good. A frame's region is
+  // only written once its fence was waited, so nothing the GPU reads is overwritten
+  const VkDeviceSize ringSize =
+    VkDeviceSize(sizeof(HudVertex)) * MAX_VERTICES * framesInFlight;
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    ringSize,
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    m_vertexBuffer,
+    m_vertexBufferMemory);
+  void* mapped = nullptr;
+  if (vkMapMemory(m_device, m_vertexBufferMemory, 0, ringSize, 0, &mapped) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to map hud vertex buffer!");
+  }
+  m_vertices = static_cast<HudVertex*>(mapped);
+
+  fmt::print(
+    "hud: up to {} quads in one draw, {:.0f} KiB vertex ring, {:.2f} ms GPU budget\n",
+    MAX_QUADS,
+    ringSize / 1024.0,
+    GPU_BUDGET);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(m_device, m_pipeline, nullptr);
+  vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+  vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+  m_pipeline       = VK_NULL_HANDLE;
+  m_descriptorPool = VK_NULL_HANDLE;
+  m_renderPass     = VK_NULL_HANDLE;
+  m_layout         = nullptr;
+
+  vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
+  freeDeviceMemory(m_device, m_vertexBufferMemory);
+  m_vertexBuffer       = VK_NULL_HANDLE;
+  m_vertexBufferMemory = VK_NULL_HANDLE;
+  m_vertices           = nullptr;
+
+  m_textures->destroyTexture(m_atlas);
+  m_atlas    = INVALID_TEXTURE;
+  m_textures = nullptr;
+  m_device   = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+// Coverage in one channel, uploaded like any other texture
+void
+Hud::createAtlas()
+{
+  std::vector<uint8_t> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+  auto texel = [&pixels](uint32_t cell, uint32_t x, uint32_t y) -> uint8_t& {
+    const uint32_t left = cell % ATLAS_COLUMNS * CELL_WIDTH;
+    const uint32_t top  = cell / ATLAS_COLUMNS * CELL_HEIGHT;
+    return pixels[(top + y) * ATLAS_WIDTH + left + x];
+  };
+
+  for (uint32_t glyph = 0; glyph < GLYPH_COUNT; ++glyph)
+  {
+    for (uint32_t x = 0; x < GLYPH_WIDTH; ++x)
+    {
+      for (uint32_t y = 0; y < GLYPH_HEIGHT; ++y)
+      {
+        if ((FONT[glyph][x] >> y) & 1)
+        {
+          texel(glyph, x, y) = 255;
+        }
+      }
+    }
+  }
+  for (uint32_t x = 0; x < CELL_WIDTH; ++x)
+  {
+    for (uint32_t y = 0; y < CELL_HEIGHT; ++y)
+    {
+      texel(SOLID_CELL, x, y) = 255;
+    }
+  }
+
+  m_atlas = m_textures->createTexture(
+    VK_FORMAT_R8_UNORM, ATLAS_WIDTH, ATLAS_HEIGHT, pixels.data());
+}
+
+//----------------------------------------------------------------------------------------
+// Blends over the swap chain image: its contents are loaded, though only within the
+// render area (the panel). The render graph transitions the image and orders the pass
+// after whatever drew it
+void
+Hud::createRenderPass(VkFormat outputFormat)
+{
+  VkAttachmentDescription colorAttachment = {};
+  colorAttachment.format                  = outputFormat;
+  colorAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_LOAD;
+  colorAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout           = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.finalLayout             = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef = {};
+  colorAttachmentRef.attachment            = 0;
+  colorAttachmentRef.layout                = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments    = &colorAttachmentRef;
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount        = 1;
+  renderPassInfo.pAttachments           = &colorAttachment;
+  renderPassInfo.subpassCount           = 1;
+  renderPassInfo.pSubpasses             = &subpass;
+  if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create hud render pass!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::createPipeline(PipelineLayoutCache& layoutCache)
+{
+  const std::vector<char> vertShaderCode = readFile(VERTEX_SHADER);
+  const std::vector<char> fragShaderCode = readFile(FRAGMENT_SHADER);
+  const ShaderReflection vertShader      = reflectShader(vertShaderCode, VERTEX_SHADER);
+  const ShaderReflection fragShader      = reflectShader(fragShaderCode, FRAGMENT_SHADER);
+  if (vertShader.pushConstantSize != sizeof(PushConstants))
+  {
+    throw std::runtime_error(fmt::format(
+      "{} declares {} bytes of push constants, the C++ side pushes {}",
+      VERTEX_SHADER,
+      vertShader.pushConstantSize,
+      sizeof(PushConstants)));
+  }
+  m_layout = &layoutCache.get({&vertShader, &fragShader});
+  if (m_layout->setLayouts.size() != 1)
+  {
+    throw std::runtime_error(
+      fmt::format("{} must use exactly descriptor set 0", FRAGMENT_SHADER));
+  }
+
+  VkShaderModule vertShaderModule = createShaderModule(m_device, vertShaderCode);
+  VkShaderModule fragShaderModule = createShaderModule(m_device, fragShaderCode);
+
+  VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+  shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+  shaderStages[0].module = vertShaderModule;
+  shaderStages[0].pName  = "main";
+  shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shaderStages[1].module = fragShaderModule;
+  shaderStages[1].pName  = "main";
+
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+  const uint32_t stride = vertexAttributes(vertShader, 0, attributeDescriptions);
+  if (stride != sizeof(HudVertex))
+  {
+    throw std::runtime_error(fmt::format(
+      "{} reads {} byte vertices, a HudVertex is {}",
+      VERTEX_SHADER,
+      stride,
+      sizeof(HudVertex)));
+  }
+
+  VkVertexInputBindingDescription bindingDescription = {};
+  bindingDescription.binding                         = 0;
+  bindingDescription.stride                          = stride;
+  bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.pVertexBindingDescriptions    = &bindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount =
+    static_cast<uint32_t>(attributeDescriptions.size());
+  vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates    = dynamicStates;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth   = 1.0f;
+  rasterizer.cullMode    = VK_CULL_MODE_NONE;
+  rasterizer.frontFace   = VK_FRONT_FACE_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading     = 1.0f;
+
+  // Alpha blended in draw order: the panel, then the graphs and text over it
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+  colorBlendAttachment.colorWriteMask
+    = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+      | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable         = VK_TRUE;
+  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable   = VK_FALSE;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments    = &colorBlendAttachment;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount          = 2;
+  pipelineInfo.pStages             = shaderStages;
+  pipelineInfo.pVertexInputState   = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState      = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState   = &multisampling;
+  pipelineInfo.pColorBlendState    = &colorBlending;
+  pipelineInfo.pDynamicState       = &dynamicState;
+  pipelineInfo.layout              = m_layout->pipelineLayout;
+  pipelineInfo.renderPass          = m_renderPass;
+  pipelineInfo.subpass             = 0;
+  pipelineInfo.basePipelineIndex   = -1;
+
+  VkResult result = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+
+  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create hud pipeline!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::createDescriptorSet()
+{
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type                 = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSize.descriptorCount      = 1;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount              = 1;
+  poolInfo.pPoolSizes                 = &poolSize;
+  poolInfo.maxSets                    = 1;
+  if (
+    vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool              = m_descriptorPool;
+  allocInfo.descriptorSetCount          = 1;
+  allocInfo.pSetLayouts                 = &m_layout->setLayouts[0];
+  if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate descriptor sets!");
+  }
+
+  // Glyphs are drawn at a whole multiple of their size, nearest keeps them crisp
+  SamplerDesc samplerDesc   = {};
+  samplerDesc.filter        = VK_FILTER_NEAREST;
+  samplerDesc.mipmapMode    = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerDesc.addressMode   = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerDesc.maxAnisotropy = 1.0f;
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.sampler               = m_textures->getSampler(samplerDesc);
+  imageInfo.imageView             = m_textures->texture(m_atlas).view;
+  imageInfo.imageLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkWriteDescriptorSet write = {};
+  write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet               = m_descriptorSet;
+  write.dstBinding           = 0;
+  write.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.descriptorCount      = 1;
+  write.pImageInfo           = &imageInfo;
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::createTargets(
+  HudTargets& targets,
+  const std::vector<VkImageView>& imageViews,
+  VkExtent2D extent)
+{
+  const auto imageCount = static_cast<uint32_t>(imageViews.size());
+
+  targets.framebuffers.resize(imageCount);
+  for (uint32_t i = 0; i < imageCount; ++i)
+  {
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass              = m_renderPass;
+    framebufferInfo.attachmentCount         = 1;
+    framebufferInfo.pAttachments            = &imageViews[i];
+    framebufferInfo.width                   = extent.width;
+    framebufferInfo.height                  = extent.height;
+    framebufferInfo.layers                  = 1;
+    if (
+      vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &targets.framebuffers[i])
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create hud framebuffer!");
+    }
+  }
+
+  const VkDeviceSize drawSize = VkDeviceSize(sizeof(VkDrawIndirectCommand)) * imageCount;
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    drawSize,
+    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    targets.drawBuffer,
+    targets.drawBufferMemory);
+  void* mapped = nullptr;
+  if (
+    vkMapMemory(m_device, targets.drawBufferMemory, 0, drawSize, 0, &mapped)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to map hud draw buffer!");
+  }
+  targets.draws = static_cast<VkDrawIndirectCommand*>(mapped);
+  for (uint32_t i = 0; i < imageCount; ++i)
+  {
+    targets.draws[i] = {0, 1, 0, 0};    // nothing until submitDraw()
+  }
+
+  if (m_timestampMask != 0)
+  {
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount            = 2 * imageCount;
+    if (
+      vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &targets.timestampPool)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::retireTargets(HudTargets& targets, DeletionQueue& deletionQueue) const
+{
+  deletionQueue.push([device           = m_device,
+                      framebuffers     = std::move(targets.framebuffers),
+                      drawBuffer       = targets.drawBuffer,
+                      drawBufferMemory = targets.drawBufferMemory,
+                      timestampPool    = targets.timestampPool]() {
+    for (auto framebuffer : framebuffers)
+    {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    vkDestroyBuffer(device, drawBuffer, nullptr);
+    freeDeviceMemory(device, drawBufferMemory);
+    vkDestroyQueryPool(device, timestampPool, nullptr);
+  });
+  targets = {};
+}
+
+//----------------------------------------------------------------------------------------
+// The draw's vertex count and offset into the ring are read from the image's indirect
+// command when the GPU gets to it
+void
+Hud::record(
+  VkCommandBuffer commandBuffer,
+  const HudTargets& targets,
+  size_t imageIndex,
+  VkExtent2D extent) const
+{
+  const auto query = static_cast<uint32_t>(2 * imageIndex);
+  if (targets.timestampPool != VK_NULL_HANDLE)
+  {
+    vkCmdResetQueryPool(commandBuffer, targets.timestampPool, query, 2);
+    vkCmdWriteTimestamp(
+      commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, targets.timestampPool, query);
+  }
+
+  const VkRect2D area = panelArea(extent);
+  if (area.extent.width > 0 && area.extent.height > 0)
+  {
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass            = m_renderPass;
+    renderPassInfo.framebuffer           = targets.framebuffers[imageIndex];
+    renderPassInfo.renderArea            = area;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport = {};
+    viewport.width      = static_cast<float>(extent.width);
+    viewport.height     = static_cast<float>(extent.height);
+    viewport.minDepth   = 0.0f;
+    viewport.maxDepth   = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &area);
+
+    PushConstants constants = {};
+    constants.invExtent[0]  = 1.0f / extent.width;
+    constants.invExtent[1]  = 1.0f / extent.height;
+
+    VkDeviceSize offset = 0;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      m_layout->pipelineLayout,
+      0,
+      1,
+      &m_descriptorSet,
+      0,
+      nullptr);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+    vkCmdPushConstants(
+      commandBuffer,
+      m_layout->pipelineLayout,
+      m_layout->pushConstantStages,
+      0,
+      sizeof(constants),
+      &constants);
+    vkCmdDrawIndirect(
+      commandBuffer,
+      targets.drawBuffer,
+      imageIndex * sizeof(VkDrawIndirectCommand),
+      1,
+      sizeof(VkDrawIndirectCommand));
+
+    vkCmdEndRenderPass(commandBuffer);
+  }
+
+  if (targets.timestampPool != VK_NULL_HANDLE)
+  {
+    vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      targets.timestampPool,
+      query + 1);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Writes straight to the mapped ring (which may be write combined), never reading it
+// back. Returns the vertex count
+uint32_t
+Hud::buildVertices(HudVertex* vertices, const HudStats& stats) const
+{
+  HudVertex* out       = vertices;
+  const QuadRect solid = solidUv();
+  const float left     = PANEL_LEFT + PADDING;
+
+  // Oldest first
+  std::vector<float> cpuTimes;
+  std::vector<float> gpuTimes;
+  for (uint32_t i = 0; i < m_historySize; ++i)
+  {
+    const uint32_t index = (m_historyNext + HISTORY - m_historySize + i) % HISTORY;
+    cpuTimes.push_back(m_cpuTimes[index]);
+    gpuTimes.push_back(m_gpuTimes[index]);
+  }
+
+  auto addText = [&out](float x, float y, const std::string& text, uint32_t color) {
+    const size_t length = std::min<size_t>(text.size(), TEXT_COLUMNS);
+    for (size_t i = 0; i < length; ++i)
+    {
+      if (text[i] != ' ')
+      {
+        const float glyphLeft = x + i * ADVANCE;
+        const QuadRect position = {
+          glyphLeft,
+          y,
+          glyphLeft + GLYPH_WIDTH * TEXT_SCALE,
+          y + GLYPH_HEIGHT * TEXT_SCALE};
+        out = addQuad(out, position, glyphUv(text[i]), color);
+      }
+    }
+  };
+
+  // Newest on the right, a line across at the 60 Hz frame time
+  auto addGraph = [&out, &solid, left](
+                    float top, const std::vector<float>& times, uint32_t color) {
+    const float barWidth = GRAPH_WIDTH / HISTORY;
+    const float bottom   = top + GRAPH_HEIGHT;
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+      const float height = std::min(times[i] / GRAPH_RANGE, 1.0f) * GRAPH_HEIGHT;
+      const float barLeft = left + (HISTORY - times.size() + i) * barWidth;
+      if (height > 0.0f)
+      {
+        out = addQuad(
+          out, {barLeft, bottom - height, barLeft + barWidth, bottom}, solid, color);
+      }
+    }
+    const float target = bottom - GRAPH_TARGET / GRAPH_RANGE * GRAPH_HEIGHT;
+    out = addQuad(
+      out, {left, target, left + GRAPH_WIDTH, target + 1.0f}, solid, TARGET_COLOR);
+  };
+
+  const QuadRect panel = {
+    PANEL_LEFT, PANEL_TOP, PANEL_LEFT + PANEL_WIDTH, PANEL_TOP + PANEL_HEIGHT};
+  out = addQuad(out, panel, solid, PANEL_COLOR);
+
+  float y = PANEL_TOP + PADDING;
+  addText(left, y, timeSummary("CPU", cpuTimes), CPU_COLOR);
+  y += LINE_HEIGHT;
+  if (m_timestampMask != 0)
+  {
+    addText(left, y, timeSummary("GPU", gpuTimes), GPU_COLOR);
+  }
+  else
+  {
+    addText(left, y, "GPU -- (NO TIMESTAMPS)", GPU_COLOR);
+  }
+  y += LINE_HEIGHT;
+
+  if (m_graphs)
+  {
+    addGraph(y + GRAPH_GAP, cpuTimes, CPU_COLOR);
+    if (m_timestampMask != 0)
+    {
+      addGraph(y + 2 * GRAPH_GAP + GRAPH_HEIGHT, gpuTimes, GPU_COLOR);
+    }
+  }
+  y += 2 * (GRAPH_HEIGHT + GRAPH_GAP);
+
+  addText(
+    left,
+    y,
+    fmt::format(
+      "DRAWS {}  OCCLUDED {}  PARTICLES {}",
+      stats.drawCount,
+      stats.occludedCount,
+      stats.particleCount),
+    TEXT_COLOR);
+  y += LINE_HEIGHT;
+
+  const double budgetShare =
+    stats.memoryBudget > 0 ? 100.0 * stats.memoryUsage / stats.memoryBudget : 0.0;
+  addText(
+    left,
+    y,
+    fmt::format(
+      "MEM {} / {} MIB ({:.0f}%)",
+      stats.memoryUsage >> 20,
+      stats.memoryBudget >> 20,
+      budgetShare),
+    TEXT_COLOR);
+  y += LINE_HEIGHT;
+
+  addText(
+    left,
+    y,
+    fmt::format(
+      "PRESENT {}  SCALE {:.0f}%",
+      presentModeName(stats.presentMode),
+      stats.resolutionScale * 100.0f),
+    TEXT_COLOR);
+  y += LINE_HEIGHT;
+
+  std::string cost = fmt::format("HUD {} QUADS", m_maxQuadCount);
+  if (m_gpuTimeCount > 0)
+  {
+    cost += fmt::format(", {:.3f} MS GPU", m_gpuTimeSum / m_gpuTimeCount);
+  }
+  if (!m_graphs)
+  {
+    cost += ", OVER BUDGET";
+  }
+  addText(left, y, cost, TEXT_COLOR);
+
+  const auto vertexCount = static_cast<uint32_t>(out - vertices);
+  assert(vertexCount <= MAX_VERTICES);
+  return vertexCount;
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::update(uint32_t frame, const HudStats& stats)
+{
+  if (stats.cpuFrameTime > 0.0f)    // nothing to time the first frame against
+  {
+    m_cpuTimes[m_historyNext] = stats.cpuFrameTime;
+    m_gpuTimes[m_historyNext] = stats.gpuFrameTime;
+    m_historyNext             = (m_historyNext + 1) % HISTORY;
+    m_historySize             = std::min(m_historySize + 1, HISTORY);
+  }
+
+  m_vertexCounts[frame] = 0;
+  if (!m_visible)
+  {
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const uint32_t vertexCount =
+    buildVertices(m_vertices + size_t(frame) * MAX_VERTICES, stats);
+  m_cpuTimeSum += std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  ++m_builtFrames;
+
+  m_vertexCounts[frame] = vertexCount;
+  m_maxQuadCount        = std::max(m_maxQuadCount, vertexCount / 6);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::submitDraw(HudTargets& targets, uint32_t imageIndex, uint32_t frame)
+{
+  VkDrawIndirectCommand& draw = targets.draws[imageIndex];
+  draw.vertexCount            = m_vertexCounts[frame];
+  draw.instanceCount          = 1;
+  draw.firstVertex            = frame * MAX_VERTICES;
+  draw.firstInstance          = 0;
+
+  // Only what is shown counts towards the cost
+  if (targets.timestampPool != VK_NULL_HANDLE && draw.vertexCount > 0)
+  {
+    m_pendingQueries[frame].push_back({targets.timestampPool, 2 * imageIndex});
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Every window's pass is timed on its own and checked against the budget. Over it, the
+// graphs go: they are most of the quads, the text stays
+void
+Hud::readTimestamps(uint32_t frame)
+{
+  for (const PendingQuery& query : m_pendingQueries[frame])
+  {
+    uint64_t timestamps[2] = {};
+    if (
+      vkGetQueryPoolResults(
+        m_device,
+        query.pool,
+        query.first,
+        2,
+        sizeof(timestamps),
+        timestamps,
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT)
+      != VK_SUCCESS)
+    {
+      continue;
+    }
+    const uint64_t start = timestamps[0] & m_timestampMask;
+    const uint64_t end   = timestamps[1] & m_timestampMask;
+    if (end < start)
+    {
+      continue;    // the counter wrapped
+    }
+
+    const double time = (end - start) * m_timestampPeriod * 1e-6;
+    m_gpuTimeSum += time;
+    ++m_gpuTimeCount;
+    m_checkTimeSum += time;
+    ++m_checkCount;
+  }
+  m_pendingQueries[frame].clear();
+
+  if (m_checkCount < BUDGET_CHECK_PASSES)
+  {
+    return;
+  }
+  m_lastGpuTime  = m_checkTimeSum / m_checkCount;
+  m_checkTimeSum = 0.0;
+  m_checkCount   = 0;
+  if (m_graphs && m_lastGpuTime > GPU_BUDGET)
+  {
+    m_graphs = false;
+    fmt::print(
+      "WARNING: the hud takes {:.3f} ms of GPU time, over its {:.2f} ms budget: graphs "
+      "off\n",
+      m_lastGpuTime,
+      GPU_BUDGET);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Hud::printSummary() const
+{
+  if (m_builtFrames == 0)
+  {
+    return;
+  }
+  fmt::print(
+    "hud: {} frames shown, {:.3f} ms CPU per frame building up to {} quads",
+    m_builtFrames,
+    m_cpuTimeSum / m_builtFrames,
+    m_maxQuadCount);
+  if (m_gpuTimeCount > 0)
+  {
+    fmt::print(
+      ", {:.3f} ms GPU per window (budget {:.2f} ms{})",
+      m_gpuTimeSum / m_gpuTimeCount,
+      GPU_BUDGET,
+      m_graphs ? "" : ", graphs dropped");
+  }
+  fmt::print("\n");
+}
+
+//----------------------------------------------------------------------------------------
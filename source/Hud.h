@@ -0,0 +1,169 @@
+#pragma once
+
+#include "ShaderReflection.h"
+#include "TextureManager.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+class DeletionQueue;
+
+//----------------------------------------------------------------------------------------
+// Mirrors the vertex input of hud.vert
+struct HudVertex
+{
+  float position[2];    // pixels from the top left corner
+  float uv[2];          // into the glyph atlas
+  uint32_t color;       // RGBA8, unpacked in the shader
+};
+
+// What the overlay shows, gathered by the Application once a frame
+struct HudStats
+{
+  float cpuFrameTime           = 0.0f;    // ms since the last frame started
+  float gpuFrameTime           = 0.0f;    // ms, the last timed frame, 0 if untimed
+  uint32_t drawCount           = 0;       // GPU driven: an indirect draw per object
+  uint32_t occludedCount       = 0;
+  uint32_t particleCount       = 0;
+  float resolutionScale        = 1.0f;
+  VkDeviceSize memoryUsage     = 0;       // device local heaps
+  VkDeviceSize memoryBudget    = 0;
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+};
+
+// Per window: the overlay's framebuffer and draw of every swap chain image
+struct HudTargets
+{
+  std::vector<VkFramebuffer> framebuffers;
+
+  // A VkDrawIndirectCommand per image, written before each submission of its command
+  // buffer (persistently mapped, host coherent)
+  VkBuffer drawBuffer             = VK_NULL_HANDLE;
+  VkDeviceMemory drawBufferMemory = VK_NULL_HANDLE;
+  VkDrawIndirectCommand* draws    = nullptr;
+
+  VkQueryPool timestampPool = VK_NULL_HANDLE;    // a start and end per image
+};
+
+//----------------------------------------------------------------------------------------
+// On-screen performance overlay: CPU and GPU frame time graphs and percentiles, what the
+// scene draws, memory against the budget and the present mode.
+//  - text comes from a glyph atlas baked at init from a built in 5x7 font; every glyph,
+//    graph bar and the panel behind them is a textured quad (solid ones sample a white
+//    cell of the atlas)
+//  - all quads go in one draw. The CPU writes them once a frame to a persistently mapped
+//    vertex ring, one region per frame in flight, and points each image's indirect draw
+//    at this frame's region, so the primaries are recorded once like everything else
+//  - the render pass loads and stores only the panel's rectangle
+//  - its own GPU time is measured with timestamps around the pass; past GPU_BUDGET the
+//    graphs (most of the quads) are dropped
+// Hidden, the draw has no vertices and nothing is built on the CPU.
+//----------------------------------------------------------------------------------------
+class Hud
+{
+public:
+  static constexpr uint32_t HISTORY = 128;     // frames in the graphs and percentiles
+  static constexpr float GPU_BUDGET = 0.2f;    // ms per window and frame
+
+private:
+  struct PendingQuery
+  {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    uint32_t first   = 0;
+  };
+
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkDevice m_device                 = VK_NULL_HANDLE;
+  TextureManager* m_textures        = nullptr;
+  float m_timestampPeriod           = 0.0f;    // ns per tick
+  uint64_t m_timestampMask          = 0;       // 0: the pass isn't timed
+
+  TextureHandle m_atlas                       = INVALID_TEXTURE;
+  const PipelineLayoutCache::Layout* m_layout = nullptr;    // owned by the layout cache
+  VkRenderPass m_renderPass                   = VK_NULL_HANDLE;
+  VkPipeline m_pipeline                       = VK_NULL_HANDLE;
+  VkDescriptorPool m_descriptorPool           = VK_NULL_HANDLE;
+  VkDescriptorSet m_descriptorSet             = VK_NULL_HANDLE;
+
+  VkBuffer m_vertexBuffer             = VK_NULL_HANDLE;
+  VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
+  HudVertex* m_vertices               = nullptr;
+  std::vector<uint32_t> m_vertexCounts;    // per frame in flight
+  std::vector<std::vector<PendingQuery>> m_pendingQueries;
+
+  bool m_visible = true;
+  bool m_graphs  = true;    // dropped for good once over budget
+
+  // Ring buffers of the last HISTORY frames
+  float m_cpuTimes[HISTORY] = {};
+  float m_gpuTimes[HISTORY] = {};
+  uint32_t m_historyNext    = 0;
+  uint32_t m_historySize    = 0;
+
+  // The overlay's own cost
+  double m_gpuTimeSum     = 0.0;    // ms, over every timed frame
+  uint64_t m_gpuTimeCount = 0;
+  double m_checkTimeSum   = 0.0;    // ms, since the last budget check
+  uint32_t m_checkCount   = 0;
+  double m_lastGpuTime    = 0.0;    // ms, average at the last budget check
+  double m_cpuTimeSum     = 0.0;    // ms, building the vertices
+  uint64_t m_builtFrames  = 0;
+  uint32_t m_maxQuadCount = 0;
+
+private:
+  void createAtlas();
+  void createRenderPass(VkFormat outputFormat);
+  void createPipeline(PipelineLayoutCache& layoutCache);
+  void createDescriptorSet();
+  uint32_t buildVertices(HudVertex* vertices, const HudStats& stats) const;
+
+public:
+  // outputFormat: the swap chain's, whose images the overlay is drawn over (blocks on
+  // the atlas upload). timestamp*: as the graphics queue reports them, a zero mask for
+  // no timing. The atlas goes through textures and the pipeline layout comes from
+  // layoutCache, both must outlive the overlay
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    TextureManager& textures,
+    PipelineLayoutCache& layoutCache,
+    VkFormat outputFormat,
+    uint32_t framesInFlight,
+    float timestampPeriod,
+    uint64_t timestampMask);
+  void cleanup();
+
+  bool enabled() const { return m_device != VK_NULL_HANDLE; }
+  bool visible() const { return m_visible; }
+  void setVisible(bool visible) { m_visible = visible; }
+
+  // For a window's swap chain images (imageViews), with its command buffers
+  void createTargets(
+    HudTargets& targets,
+    const std::vector<VkImageView>& imageViews,
+    VkExtent2D extent);
+  // Destroyed once the frames in flight are done with them
+  void retireTargets(HudTargets& targets, DeletionQueue& deletionQueue) const;
+
+  // The render graph's pass, after everything else that writes the swap chain image
+  void record(
+    VkCommandBuffer commandBuffer,
+    const HudTargets& targets,
+    size_t imageIndex,
+    VkExtent2D extent) const;
+
+  // Once a frame, after the frame in flight's fence was waited: the frame times go into
+  // the history and the quads into the frame's region of the ring
+  void update(uint32_t frame, const HudStats& stats);
+  // Every image submitted this frame, after its last submission completed: points its
+  // draw at the frame's quads
+  void submitDraw(HudTargets& targets, uint32_t imageIndex, uint32_t frame);
+  // After the frame in flight's fence was waited, before its targets can be destroyed
+  void readTimestamps(uint32_t frame);
+
+  void printSummary() const;
+};
+
+//----------------------------------------------------------------------------------------
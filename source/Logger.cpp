@@ -0,0 +1,381 @@
+#include <fmt/format.h>
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+constexpr char MESSAGE_PREFIX[] = "VALIDATION LAYER: ";
+constexpr auto IDLE_SLEEP       = std::chrono::milliseconds(1);    // when nothing queued
+constexpr size_t SUMMARY_IDS    = 5;    // performance warnings listed on exit
+
+//----------------------------------------------------------------------------------------
+static int64_t
+steadyNanoseconds()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+//----------------------------------------------------------------------------------------
+Logger::Logger()
+    : m_slots(new Slot[SLOT_COUNT])
+    , m_messages(new MessageStats[MESSAGE_IDS])
+    , m_severities(ALL_SEVERITIES)
+    , m_types(ALL_TYPES)
+{
+  for (uint32_t i = 0; i < SLOT_COUNT; ++i)
+  {
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::start(uint32_t burst, float repeatInterval)
+{
+  if (m_running)
+  {
+    return;
+  }
+
+  m_burst          = burst;
+  m_repeatInterval = static_cast<int64_t>(repeatInterval * 1e9f);
+  m_stop           = false;
+  m_thread         = std::thread(&Logger::threadLoop, this);
+  m_running.store(true, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::stop()
+{
+  if (!m_thread.joinable())
+  {
+    return;
+  }
+
+  // Whatever is logged from here on is printed by the caller
+  m_running.store(false, std::memory_order_release);
+  m_stop = true;
+  m_thread.join();
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::setFilter(
+  VkDebugUtilsMessageSeverityFlagsEXT severities,
+  VkDebugUtilsMessageTypeFlagsEXT types)
+{
+  m_severities.store(severities, std::memory_order_relaxed);
+  m_types.store(types, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::log(
+  VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+  VkDebugUtilsMessageTypeFlagsEXT types,
+  int32_t messageId,
+  const char* messageIdName,
+  const char* message)
+{
+  // Loader and general messages come without an ID; they are neither counted nor
+  // rate limited
+  MessageStats* stats = messageId != 0 ? findMessage(messageId, messageIdName) : nullptr;
+  uint32_t count      = 0;
+  if (stats != nullptr)
+  {
+    count = stats->count.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  if (types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)
+  {
+    m_performanceCount.fetch_add(1, std::memory_order_relaxed);
+    if (stats != nullptr)
+    {
+      stats->performance.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  if (
+    !(severity & m_severities.load(std::memory_order_relaxed))
+    || !(types & m_types.load(std::memory_order_relaxed)))
+  {
+    return;
+  }
+
+  // Past the burst, one message per interval gets through: the caller that moves
+  // nextAllowed on prints, everyone else adds to the suppressed count it reports
+  uint32_t suppressed = 0;
+  if (stats != nullptr && count > m_burst)
+  {
+    const int64_t now = steadyNanoseconds();
+    int64_t next      = stats->nextAllowed.load(std::memory_order_relaxed);
+    if (
+      now < next
+      || !stats->nextAllowed.compare_exchange_strong(next, now + m_repeatInterval))
+    {
+      stats->suppressed.fetch_add(1, std::memory_order_relaxed);
+      stats->totalSuppressed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    suppressed = stats->suppressed.exchange(0, std::memory_order_relaxed);
+  }
+
+  if (!m_running.load(std::memory_order_acquire))
+  {
+    fmt::print("{}{}\n", MESSAGE_PREFIX, message);
+    return;
+  }
+  push(message, suppressed);
+}
+
+//----------------------------------------------------------------------------------------
+// Finds or claims the entry of a message ID, or returns null once the table is full
+Logger::MessageStats*
+Logger::findMessage(int32_t messageId, const char* messageIdName)
+{
+  const uint64_t key = static_cast<uint32_t>(messageId) | (1ull << 32);
+  uint32_t index     = static_cast<uint32_t>(messageId) * 2654435761u;
+  for (uint32_t probe = 0; probe < MESSAGE_IDS; ++probe, ++index)
+  {
+    MessageStats& stats = m_messages[index & (MESSAGE_IDS - 1)];
+    uint64_t current    = stats.key.load(std::memory_order_acquire);
+    if (current == key)
+    {
+      return &stats;
+    }
+    if (
+      current == 0
+      && stats.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+    {
+      if (messageIdName != nullptr)
+      {
+        strncpy(stats.name, messageIdName, sizeof(stats.name) - 1);
+      }
+      return &stats;
+    }
+    if (current == key)    // claimed by another thread in the meantime
+    {
+      return &stats;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------------------
+// Claims the next slot of the ring (bounded MPMC queue after Dmitry Vyukov, with a
+// single consumer) and formats the message into it
+void
+Logger::push(const char* message, uint32_t suppressed)
+{
+  uint64_t position = m_writePosition.load(std::memory_order_relaxed);
+  Slot* slot        = nullptr;
+  for (;;)
+  {
+    slot                    = &m_slots[position & (SLOT_COUNT - 1)];
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const auto difference   = static_cast<int64_t>(sequence - position);
+    if (difference == 0)
+    {
+      if (m_writePosition.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (difference < 0)
+    {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);    // full
+      return;
+    }
+    else
+    {
+      position = m_writePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  // Leave room for the suffix and the newline when the message is cut short
+  constexpr size_t MAX_LENGTH = SLOT_SIZE - 64;
+  auto result = fmt::format_to_n(slot->text, MAX_LENGTH, "{}{}", MESSAGE_PREFIX, message);
+  char* end   = slot->text + std::min(result.size, MAX_LENGTH);
+  if (result.size > MAX_LENGTH)
+  {
+    end = fmt::format_to(end, "...");
+  }
+  if (suppressed > 0)
+  {
+    end = fmt::format_to(end, " ({} more suppressed)", suppressed);
+  }
+  *end++       = '\n';
+  slot->length = static_cast<uint32_t>(end - slot->text);
+
+  slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------
+// Prints every message queued so far; returns false if there were none
+bool
+Logger::drain()
+{
+  bool printed = false;
+  for (;;)
+  {
+    Slot& slot = m_slots[m_readPosition & (SLOT_COUNT - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != m_readPosition + 1)
+    {
+      break;
+    }
+    fwrite(slot.text, 1, slot.length, stdout);
+    slot.sequence.store(m_readPosition + SLOT_COUNT, std::memory_order_release);
+    ++m_readPosition;
+    printed = true;
+  }
+
+  const uint32_t dropped = m_dropped.load(std::memory_order_relaxed);
+  if (dropped != m_reportedDrops)
+  {
+    fmt::print("WARNING: log full, {} messages dropped\n", dropped - m_reportedDrops);
+    m_reportedDrops = dropped;
+    printed         = true;
+  }
+  if (printed)
+  {
+    fflush(stdout);
+  }
+  return printed;
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::threadLoop()
+{
+  while (!m_stop)
+  {
+    if (!drain())
+    {
+      std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+  }
+  drain();
+}
+
+//----------------------------------------------------------------------------------------
+void
+Logger::printSummary() const
+{
+  std::vector<const MessageStats*> performance;
+  uint32_t messageIds      = 0;
+  uint64_t totalSuppressed = 0;
+  for (uint32_t i = 0; i < MESSAGE_IDS; ++i)
+  {
+    const MessageStats& stats = m_messages[i];
+    if (stats.key == 0)
+    {
+      continue;
+    }
+    ++messageIds;
+    totalSuppressed += stats.totalSuppressed;
+    if (stats.performance)
+    {
+      performance.push_back(&stats);
+    }
+  }
+  if (messageIds == 0 && m_dropped == 0)
+  {
+    return;
+  }
+
+  fmt::print(
+    "log: {} message IDs, {} performance warnings, {} repeats suppressed, {} dropped\n",
+    messageIds,
+    m_performanceCount.load(),
+    totalSuppressed,
+    m_dropped.load());
+
+  std::sort(
+    performance.begin(),
+    performance.end(),
+    [](const MessageStats* a, const MessageStats* b) { return a->count > b->count; });
+  performance.resize(std::min(performance.size(), SUMMARY_IDS));
+  for (const MessageStats* stats : performance)
+  {
+    fmt::print(
+      "  {:>8} x {}\n",
+      stats->count.load(),
+      stats->name[0] != '\0' ? std::string(stats->name)
+                              : fmt::format("{:#x}", stats->key & ~0u));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+VkDebugUtilsMessageSeverityFlagsEXT
+Logger::parseSeverity(const std::string& name)
+{
+  VkDebugUtilsMessageSeverityFlagBitsEXT lowest;
+  if (name == "verbose")
+  {
+    lowest = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+  }
+  else if (name == "info")
+  {
+    lowest = VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+  }
+  else if (name == "warning")
+  {
+    lowest = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+  }
+  else if (name == "error")
+  {
+    lowest = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+  }
+  else
+  {
+    throw std::runtime_error(fmt::format("unknown log severity: {}", name));
+  }
+  // The severity bits are in increasing order
+  return ALL_SEVERITIES & ~(static_cast<VkDebugUtilsMessageSeverityFlagsEXT>(lowest) - 1);
+}
+
+//----------------------------------------------------------------------------------------
+VkDebugUtilsMessageTypeFlagsEXT
+Logger::parseTypes(const std::string& names)
+{
+  VkDebugUtilsMessageTypeFlagsEXT types = 0;
+  size_t begin                          = 0;
+  while (begin <= names.size())
+  {
+    size_t end = names.find(',', begin);
+    if (end == std::string::npos)
+    {
+      end = names.size();
+    }
+
+    const std::string name = names.substr(begin, end - begin);
+    if (name == "general")
+    {
+      types |= VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+    }
+    else if (name == "validation")
+    {
+      types |= VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+    }
+    else if (name == "performance")
+    {
+      types |= VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    }
+    else
+    {
+      throw std::runtime_error(fmt::format("unknown log message type: {}", name));
+    }
+    begin = end + 1;
+  }
+  return types;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+//----------------------------------------------------------------------------------------
+// Asynchronous log for validation layer (and other) messages. log() is safe to call from
+// any thread, including the driver's: it filters, deduplicates and formats the message
+// into a slot of a bounded lock-free ring and returns without taking a lock or touching
+// stdout. A background thread prints the slots in order.
+// Messages with the same ID are rate limited: the first few are printed, then at most
+// one per interval with the number suppressed since. When the ring is full messages are
+// dropped (and counted) rather than blocking the caller.
+// Every message ID is counted, so the performance warnings can be summarised on exit.
+//----------------------------------------------------------------------------------------
+class Logger
+{
+public:
+  // What the debug messenger reports, for setFilter() to narrow down
+  static constexpr VkDebugUtilsMessageSeverityFlagsEXT ALL_SEVERITIES =
+    VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+    | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
+    | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
+    | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+  static constexpr VkDebugUtilsMessageTypeFlagsEXT ALL_TYPES =
+    VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
+    | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
+    | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+
+private:
+  static constexpr uint32_t SLOT_COUNT  = 256;     // power of two
+  static constexpr size_t SLOT_SIZE     = 2048;    // longer messages are cut short
+  static constexpr uint32_t MESSAGE_IDS = 1024;    // power of two, distinct IDs counted
+
+  // A ring slot is free for the producer claiming position p when its sequence is p,
+  // and holds a message for the consumer when it is p + 1
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence{0};
+    uint32_t length = 0;
+    char text[SLOT_SIZE];
+  };
+
+  // Open addressed table of message IDs; entries are claimed with a CAS on key and
+  // never removed
+  struct MessageStats
+  {
+    std::atomic<uint64_t> key{0};    // 0: free, else the ID with bit 32 set
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> suppressed{0};    // since the last one printed
+    std::atomic<uint32_t> totalSuppressed{0};
+    std::atomic<int64_t> nextAllowed{0};    // steady clock ns
+    std::atomic<bool> performance{false};
+    char name[64] = {};    // written once by the claiming thread, read on exit
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::unique_ptr<MessageStats[]> m_messages;
+  alignas(64) std::atomic<uint64_t> m_writePosition{0};
+  alignas(64) uint64_t m_readPosition = 0;    // consumer only
+
+  std::atomic<uint32_t> m_severities{0};    // VkDebugUtilsMessageSeverityFlagsEXT
+  std::atomic<uint32_t> m_types{0};         // VkDebugUtilsMessageTypeFlagsEXT
+  uint32_t m_burst         = 3;
+  int64_t m_repeatInterval = 0;    // ns
+
+  std::atomic<uint32_t> m_dropped{0};
+  uint32_t m_reportedDrops = 0;    // consumer only
+  std::atomic<uint32_t> m_performanceCount{0};
+  std::atomic<bool> m_running{false};    // else log() prints straight away
+  std::atomic<bool> m_stop{false};
+  std::thread m_thread;
+
+private:
+  MessageStats* findMessage(int32_t messageId, const char* messageIdName);
+  void push(const char* message, uint32_t suppressed);
+  bool drain();
+  void threadLoop();
+
+public:
+  Logger();
+  ~Logger() { stop(); }
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // burst: messages with one ID printed before rate limiting starts
+  // repeatInterval: seconds between the rate limited ones
+  void start(uint32_t burst = 3, float repeatInterval = 1.0f);
+  // Prints what is still queued and joins the thread
+  void stop();
+
+  // Can be changed at any time; messages outside the filter are still counted
+  void setFilter(
+    VkDebugUtilsMessageSeverityFlagsEXT severities,
+    VkDebugUtilsMessageTypeFlagsEXT types);
+
+  void log(
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+    VkDebugUtilsMessageTypeFlagsEXT types,
+    int32_t messageId,
+    const char* messageIdName,
+    const char* message);
+
+  uint32_t performanceCount() const { return m_performanceCount; }
+  uint32_t droppedCount() const { return m_dropped; }
+  // Most frequent performance warnings and the messages the rate limit held back
+  void printSummary() const;
+
+  // Lowest severity to print as a mask ("verbose", "info", "warning" or "error") and a
+  // comma separated list of "general", "validation" and "performance" as a type mask;
+  // throw on anything else
+  static VkDebugUtilsMessageSeverityFlagsEXT parseSeverity(const std::string& name);
+  static VkDebugUtilsMessageTypeFlagsEXT parseTypes(const std::string& names);
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,141 @@
+// always include fmt before windows.h
+#include <fmt/format.h>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <stdexcept>
+#include <utility>
+
+//----------------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(
+    filename.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throw std::runtime_error(fmt::format("failed to open file: {}", filename));
+  }
+  m_file = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+  {
+    close();
+    throw std::runtime_error(fmt::format("failed to map empty file: {}", filename));
+  }
+  m_size = static_cast<size_t>(fileSize.QuadPart);
+
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping != nullptr)
+  {
+    m_data =
+      static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+#else
+  m_fd = open(filename.c_str(), O_RDONLY);
+  if (m_fd < 0)
+  {
+    throw std::runtime_error(fmt::format("failed to open file: {}", filename));
+  }
+
+  struct stat fileStat;
+  if (fstat(m_fd, &fileStat) != 0 || fileStat.st_size == 0)
+  {
+    close();
+    throw std::runtime_error(fmt::format("failed to map empty file: {}", filename));
+  }
+  m_size = static_cast<size_t>(fileStat.st_size);
+
+  void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (mapped != MAP_FAILED)
+  {
+    madvise(mapped, m_size, MADV_WILLNEED);    // start reading ahead for the parsers
+    m_data = static_cast<const uint8_t*>(mapped);
+  }
+#endif
+
+  if (m_data == nullptr)
+  {
+    close();
+    throw std::runtime_error(fmt::format("failed to map file: {}", filename));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+//----------------------------------------------------------------------------------------
+MappedFile&
+MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+#ifdef _WIN32
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#else
+    std::swap(m_fd, other.m_fd);
+#endif
+  }
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------
+void
+MappedFile::close()
+{
+#ifdef _WIN32
+  if (m_data != nullptr)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr)
+  {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != nullptr)
+  {
+    CloseHandle(m_file);
+  }
+  m_file    = nullptr;
+  m_mapping = nullptr;
+#else
+  if (m_data != nullptr)
+  {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+  }
+  m_fd = -1;
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+// Read only memory mapping of a whole file (throws std::runtime_error on failure)
+//----------------------------------------------------------------------------------------
+class MappedFile
+{
+  const uint8_t* m_data = nullptr;
+  size_t m_size         = 0;
+#ifdef _WIN32
+  void* m_file    = nullptr;
+  void* m_mapping = nullptr;
+#else
+  int m_fd = -1;
+#endif
+
+private:
+  void close();
+
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  const uint8_t* data() const { return m_data; }
+  size_t size() const { return m_size; }
+};
+
+//----------------------------------------------------------------------------------------
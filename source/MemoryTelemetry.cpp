@@ -0,0 +1,252 @@
+#include <fmt/format.h>
+
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <cassert>
+#include <mutex>
+#include <unordered_map>
+
+//----------------------------------------------------------------------------------------
+constexpr float REFRESH_INTERVAL = 1.0f;    // seconds between budget queries
+constexpr double MIB             = 1024.0 * 1024.0;
+
+//----------------------------------------------------------------------------------------
+// Every live vkAllocateMemory allocation in the process. Textures and meshes may be
+// loaded from other threads, hence the lock.
+struct DeviceMemoryBlock
+{
+  uint32_t memoryType           = 0;
+  VkDeviceSize size             = 0;
+  bool subAllocated             = false;
+  VkDeviceSize usedBytes        = 0;
+  VkDeviceSize largestFreeBytes = 0;
+};
+
+static std::mutex sg_blocksMutex;
+static std::unordered_map<VkDeviceMemory, DeviceMemoryBlock> sg_blocks;
+
+//----------------------------------------------------------------------------------------
+VkResult
+allocateDeviceMemory(
+  VkDevice device,
+  const VkMemoryAllocateInfo& allocInfo,
+  VkDeviceMemory& memory)
+{
+  VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+  if (result == VK_SUCCESS)
+  {
+    DeviceMemoryBlock block = {};
+    block.memoryType        = allocInfo.memoryTypeIndex;
+    block.size              = allocInfo.allocationSize;
+
+    std::lock_guard<std::mutex> lock(sg_blocksMutex);
+    sg_blocks[memory] = block;
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------
+void
+freeDeviceMemory(VkDevice device, VkDeviceMemory memory)
+{
+  if (memory == VK_NULL_HANDLE)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sg_blocksMutex);
+    sg_blocks.erase(memory);
+  }
+  vkFreeMemory(device, memory, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
+void
+reportDeviceMemoryUsage(
+  VkDeviceMemory memory,
+  VkDeviceSize usedBytes,
+  VkDeviceSize largestFreeBytes)
+{
+  std::lock_guard<std::mutex> lock(sg_blocksMutex);
+  auto it = sg_blocks.find(memory);
+  assert(it != sg_blocks.end());
+  if (it != sg_blocks.end())
+  {
+    it->second.subAllocated     = true;
+    it->second.usedBytes        = usedBytes;
+    it->second.largestFreeBytes = largestFreeBytes;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// MemoryTelemetry
+//----------------------------------------------------------------------------------------
+bool
+MemoryTelemetry::isBudgetSupported(VkPhysicalDevice physicalDevice)
+{
+  return isDeviceExtensionSupported(
+    physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+//----------------------------------------------------------------------------------------
+void
+MemoryTelemetry::init(
+  VkPhysicalDevice physicalDevice,
+  bool budgetEnabled,
+  float headroom,
+  float summaryInterval)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+
+  m_physicalDevice  = physicalDevice;
+  m_budgetEnabled   = budgetEnabled;
+  m_headroom        = headroom;
+  m_summaryInterval = summaryInterval;
+  vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+  m_heaps.assign(m_memoryProperties.memoryHeapCount, HeapTelemetry());
+  m_lowHeadroom.assign(m_memoryProperties.memoryHeapCount, false);
+  m_lastRefresh = 0.0f;
+  m_lastSummary = 0.0f;
+  refresh();
+}
+
+//----------------------------------------------------------------------------------------
+void
+MemoryTelemetry::refresh()
+{
+  std::vector<VkDeviceSize> largestFreeBytes(m_heaps.size(), 0);
+  for (uint32_t i = 0; i < m_heaps.size(); ++i)
+  {
+    const VkMemoryHeap& heap = m_memoryProperties.memoryHeaps[i];
+    m_heaps[i]               = HeapTelemetry();
+    m_heaps[i].size          = heap.size;
+    m_heaps[i].deviceLocal   = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sg_blocksMutex);
+    for (const auto& entry : sg_blocks)
+    {
+      const DeviceMemoryBlock& block = entry.second;
+      const uint32_t heapIndex =
+        m_memoryProperties.memoryTypes[block.memoryType].heapIndex;
+
+      HeapTelemetry& heap = m_heaps[heapIndex];
+      heap.allocationCount += 1;
+      heap.allocatedBytes += block.size;
+      if (block.subAllocated)
+      {
+        heap.unusedBytes += block.size - block.usedBytes;
+        largestFreeBytes[heapIndex] += block.largestFreeBytes;
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < m_heaps.size(); ++i)
+  {
+    HeapTelemetry& heap = m_heaps[i];
+    if (heap.unusedBytes > 0)
+    {
+      heap.fragmentation =
+        1.0f - static_cast<float>(largestFreeBytes[i]) / heap.unusedBytes;
+    }
+    heap.usage  = heap.allocatedBytes;
+    heap.budget = heap.size;
+  }
+
+  if (m_budgetEnabled)
+  {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budget;
+    vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &properties);
+
+    for (uint32_t i = 0; i < m_heaps.size(); ++i)
+    {
+      m_heaps[i].usage  = budget.heapUsage[i];
+      m_heaps[i].budget = budget.heapBudget[i];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+MemoryTelemetry::checkHeadroom()
+{
+  for (uint32_t i = 0; i < m_heaps.size(); ++i)
+  {
+    const HeapTelemetry& heap = m_heaps[i];
+    if (heap.budget == 0)
+    {
+      continue;
+    }
+
+    const VkDeviceSize left = heap.budget > heap.usage ? heap.budget - heap.usage : 0;
+    const bool low          = left < m_headroom * heap.budget;
+    if (low && !m_lowHeadroom[i])
+    {
+      fmt::print(
+        "WARNING: memory heap {} ({}) is at {:.1f} of {:.1f} MiB, less than {:.0f}% of "
+        "its budget left\n",
+        i,
+        heap.deviceLocal ? "device local" : "host",
+        heap.usage / MIB,
+        heap.budget / MIB,
+        m_headroom * 100.0f);
+    }
+    m_lowHeadroom[i] = low;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+MemoryTelemetry::update(float time)
+{
+  assert(m_physicalDevice != VK_NULL_HANDLE);
+
+  if (time - m_lastRefresh >= REFRESH_INTERVAL)
+  {
+    refresh();
+    checkHeadroom();
+    m_lastRefresh = time;
+  }
+
+  if (m_summaryInterval > 0.0f && time - m_lastSummary >= m_summaryInterval)
+  {
+    printSummary();
+    m_lastSummary = time;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+MemoryTelemetry::printSummary() const
+{
+  fmt::print(
+    "Device memory ({}):\n"
+    "heap  type          usage MiB  budget MiB  used  allocations  allocated MiB  "
+    "unused MiB  fragmentation\n",
+    m_budgetEnabled ? "VK_EXT_memory_budget" : "own allocations, budget = heap size");
+  for (uint32_t i = 0; i < m_heaps.size(); ++i)
+  {
+    const HeapTelemetry& heap = m_heaps[i];
+    fmt::print(
+      "{:4}  {:12}  {:9.1f}  {:10.1f}  {:3.0f}%  {:11}  {:13.1f}  {:10.1f}  {:12.0f}%\n",
+      i,
+      heap.deviceLocal ? "device local" : "host",
+      heap.usage / MIB,
+      heap.budget / MIB,
+      heap.budget > 0 ? 100.0 * heap.usage / heap.budget : 0.0,
+      heap.allocationCount,
+      heap.allocatedBytes / MIB,
+      heap.unusedBytes / MIB,
+      100.0f * heap.fragmentation);
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// All device memory is allocated and freed through these, so every allocation is
+// accounted for per memory type whether or not the driver reports a budget
+VkResult allocateDeviceMemory(
+  VkDevice device,
+  const VkMemoryAllocateInfo& allocInfo,
+  VkDeviceMemory& memory);
+void freeDeviceMemory(VkDevice device, VkDeviceMemory memory);
+
+// Sub-allocators report how many bytes of a block are handed out and the largest free
+// range left, which is what the per heap fragmentation figures are made of
+void reportDeviceMemoryUsage(
+  VkDeviceMemory memory,
+  VkDeviceSize usedBytes,
+  VkDeviceSize largestFreeBytes);
+
+//----------------------------------------------------------------------------------------
+struct HeapTelemetry
+{
+  VkDeviceSize size = 0;
+  bool deviceLocal  = false;
+
+  // From VK_EXT_memory_budget: usage counts everything the process has on the heap
+  // (driver internals and swap chain images too) and the budget is what the driver
+  // thinks we can use before it starts paging. Without it, usage is our own
+  // allocations and the budget is the heap size.
+  VkDeviceSize usage  = 0;
+  VkDeviceSize budget = 0;
+
+  // Our vkAllocateMemory calls
+  uint32_t allocationCount    = 0;
+  VkDeviceSize allocatedBytes = 0;
+
+  // Sub-allocated blocks: bytes not handed out, and the share of them that isn't in
+  // the largest free range of their block (0 = all free space is contiguous)
+  VkDeviceSize unusedBytes = 0;
+  float fragmentation      = 0.0f;
+};
+
+//----------------------------------------------------------------------------------------
+// Per heap memory usage against the budget. update() is called once a frame: it
+// re-reads the figures every second, warns once when a heap's free budget drops below
+// the headroom threshold (and again only after it has recovered) and prints a summary
+// every summaryInterval seconds.
+//----------------------------------------------------------------------------------------
+class MemoryTelemetry
+{
+  VkPhysicalDevice m_physicalDevice                   = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+  bool m_budgetEnabled                                = false;
+  float m_headroom                                    = 0.1f;
+  float m_summaryInterval                             = 0.0f;
+
+  std::vector<HeapTelemetry> m_heaps;
+  std::vector<bool> m_lowHeadroom;    // warned, waiting for the heap to recover
+  float m_lastRefresh = 0.0f;
+  float m_lastSummary = 0.0f;
+
+private:
+  void checkHeadroom();
+
+public:
+  // The device extension to enable for driver budgets (needs Vulkan 1.1)
+  static bool isBudgetSupported(VkPhysicalDevice physicalDevice);
+
+  // headroom: warn when less than this fraction of a heap's budget is left
+  // summaryInterval: seconds between summaries, 0 for none
+  void init(
+    VkPhysicalDevice physicalDevice,
+    bool budgetEnabled,
+    float headroom,
+    float summaryInterval);
+
+  void update(float time);
+  // Re-reads the budget and our allocations now
+  void refresh();
+
+  bool budgetEnabled() const { return m_budgetEnabled; }
+  const std::vector<HeapTelemetry>& heaps() const { return m_heaps; }
+  void printSummary() const;
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,1652 @@
+#include <fmt/format.h>
+
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+//----------------------------------------------------------------------------------------
+constexpr size_t OBJ_MIN_CHUNK_BYTES      = 1 << 20;    // smaller isn't worth a task
+constexpr uint32_t OBJ_CHUNKS_PER_THREAD = 4;          // slack for uneven chunks
+constexpr uint32_t GLB_TASK_ELEMENTS     = 1 << 16;
+constexpr uint32_t BENCHMARK_RUNS        = 3;
+
+constexpr uint32_t GLB_MAGIC      = 0x46546C67;    // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t GLB_CHUNK_BIN  = 0x004E4942;
+
+constexpr uint32_t GLTF_BYTE           = 5120;
+constexpr uint32_t GLTF_UNSIGNED_BYTE  = 5121;
+constexpr uint32_t GLTF_SHORT          = 5122;
+constexpr uint32_t GLTF_UNSIGNED_SHORT = 5123;
+constexpr uint32_t GLTF_UNSIGNED_INT   = 5125;
+constexpr uint32_t GLTF_FLOAT          = 5126;
+constexpr uint32_t GLTF_TRIANGLES      = 4;
+
+constexpr uint32_t JSON_MAX_DEPTH = 64;
+
+constexpr uint32_t MESH_CACHE_MAGIC        = 0x4853454D;    // "MESH"
+constexpr uint32_t MESH_CACHE_VERSION      = 1;
+constexpr const char* MESH_CACHE_EXTENSION = ".mesh";
+
+static const glm::vec3 DEFAULT_COLOR = {1.0f, 1.0f, 1.0f};
+
+using Clock = std::chrono::high_resolution_clock;
+
+//----------------------------------------------------------------------------------------
+// Text parsing (bounds checked, locale independent)
+//----------------------------------------------------------------------------------------
+static bool
+isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+//----------------------------------------------------------------------------------------
+static bool
+isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+//----------------------------------------------------------------------------------------
+static void
+skipSpaces(const char*& p, const char* end)
+{
+  while (p < end && isSpace(*p))
+  {
+    ++p;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static void
+skipToken(const char*& p, const char* end)
+{
+  while (p < end && !isSpace(*p))
+  {
+    ++p;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// [+-]digits[.digits][(e|E)[+-]digits], good to ~17 significant digits which is plenty
+// for float output; leaves p untouched and returns false when there is no number
+static bool
+parseDouble(const char*& p, const char* end, double& value)
+{
+  static const double powersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                      1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                      1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  constexpr uint64_t MANTISSA_LIMIT = 100000000000000000ull;
+
+  const char* s = p;
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    ++s;
+  }
+
+  uint64_t mantissa = 0;
+  int exponent      = 0;
+  int digits        = 0;
+  for (; s < end && isDigit(*s); ++s, ++digits)
+  {
+    if (mantissa < MANTISSA_LIMIT)
+    {
+      mantissa = mantissa * 10 + (*s - '0');
+    }
+    else
+    {
+      ++exponent;
+    }
+  }
+  if (s < end && *s == '.')
+  {
+    for (++s; s < end && isDigit(*s); ++s, ++digits)
+    {
+      if (mantissa < MANTISSA_LIMIT)
+      {
+        mantissa = mantissa * 10 + (*s - '0');
+        --exponent;
+      }
+    }
+  }
+  if (digits == 0)
+  {
+    return false;
+  }
+
+  if (s < end && (*s == 'e' || *s == 'E'))
+  {
+    const char* e         = s + 1;
+    bool negativeExponent = false;
+    if (e < end && (*e == '-' || *e == '+'))
+    {
+      negativeExponent = *e == '-';
+      ++e;
+    }
+    if (e < end && isDigit(*e))
+    {
+      int explicitExponent = 0;
+      for (; e < end && isDigit(*e); ++e)
+      {
+        if (explicitExponent < 10000)
+        {
+          explicitExponent = explicitExponent * 10 + (*e - '0');
+        }
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+      s = e;
+    }
+  }
+
+  double result = static_cast<double>(mantissa);
+  if (exponent < 0)
+  {
+    result = exponent >= -22 ? result / powersOf10[-exponent]
+                             : result * std::pow(10.0, exponent);
+  }
+  else if (exponent > 0)
+  {
+    result = exponent <= 22 ? result * powersOf10[exponent]
+                            : result * std::pow(10.0, exponent);
+  }
+
+  value = negative ? -result : result;
+  p     = s;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
+static bool
+parseFloat(const char*& p, const char* end, float& value)
+{
+  double result;
+  if (!parseDouble(p, end, result))
+  {
+    return false;
+  }
+  value = static_cast<float>(result);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
+// Saturates instead of overflowing (the caller range checks the result anyway)
+static bool
+parseInt(const char*& p, const char* end, int64_t& value)
+{
+  const char* s = p;
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    ++s;
+  }
+  if (s == end || !isDigit(*s))
+  {
+    return false;
+  }
+
+  int64_t result = 0;
+  for (; s < end && isDigit(*s); ++s)
+  {
+    if (result < (int64_t(1) << 40))
+    {
+      result = result * 10 + (*s - '0');
+    }
+  }
+
+  value = negative ? -result : result;
+  p     = s;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
+// OBJ
+//----------------------------------------------------------------------------------------
+enum class ObjLine
+{
+  Vertex,
+  Face,
+  Other,
+};
+
+// Identifies the statement and steps p past its keyword
+static ObjLine
+classifyObjLine(const char*& p, const char* lineEnd)
+{
+  skipSpaces(p, lineEnd);
+  if (lineEnd - p < 2 || !isSpace(p[1]))
+  {
+    return ObjLine::Other;
+  }
+
+  const char keyword = p[0];
+  if (keyword == 'v' || keyword == 'f')
+  {
+    p += 2;
+    return keyword == 'v' ? ObjLine::Vertex : ObjLine::Face;
+  }
+  return ObjLine::Other;
+}
+
+//----------------------------------------------------------------------------------------
+static const char*
+findLineEnd(const char* p, const char* end)
+{
+  const void* newline = memchr(p, '\n', end - p);
+  return newline ? static_cast<const char*>(newline) : end;
+}
+
+//----------------------------------------------------------------------------------------
+static void
+growBounds(MeshBounds& bounds, const glm::vec3& point)
+{
+  bounds.min = glm::min(bounds.min, point);
+  bounds.max = glm::max(bounds.max, point);
+}
+
+//----------------------------------------------------------------------------------------
+static MeshBounds
+emptyBounds()
+{
+  return {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+}
+
+//----------------------------------------------------------------------------------------
+static MeshBounds
+mergeBounds(const std::vector<MeshBounds>& bounds)
+{
+  MeshBounds result = emptyBounds();
+  for (const MeshBounds& b : bounds)
+  {
+    result.min = glm::min(result.min, b.min);
+    result.max = glm::max(result.max, b.max);
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------
+// Element counts of the tasks and their running totals must fit the 32 bit indices
+static uint32_t
+checkedCount(uint64_t count, const std::string& filename)
+{
+  if (count > std::numeric_limits<uint32_t>::max())
+  {
+    throw std::runtime_error(
+      fmt::format("{}: mesh has too many vertices or indices", filename));
+  }
+  return static_cast<uint32_t>(count);
+}
+
+//----------------------------------------------------------------------------------------
+// glTF
+//----------------------------------------------------------------------------------------
+namespace
+{
+struct JsonValue
+{
+  enum class Type
+  {
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object,
+  };
+
+  Type type     = Type::Null;
+  bool boolean  = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> elements;    // array elements, or object member values
+  std::vector<std::string> keys;      // object member names
+
+  const JsonValue* find(const char* key) const
+  {
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+      if (keys[i] == key)
+      {
+        return &elements[i];
+      }
+    }
+    return nullptr;
+  }
+};
+
+//----------------------------------------------------------------------------------------
+// Just enough of a DOM parser for glTF's JSON chunk
+class JsonParser
+{
+  const char* m_p;
+  const char* m_end;
+
+private:
+  [[noreturn]] void fail(const char* what) const
+  {
+    throw std::runtime_error(fmt::format("invalid glTF JSON: {}", what));
+  }
+
+  void skipWhitespace()
+  {
+    while (m_p < m_end && (isSpace(*m_p) || *m_p == '\n'))
+    {
+      ++m_p;
+    }
+  }
+
+  void expect(char c)
+  {
+    skipWhitespace();
+    if (m_p == m_end || *m_p != c)
+    {
+      fail("unexpected character");
+    }
+    ++m_p;
+  }
+
+  bool consumeLiteral(const char* literal)
+  {
+    const size_t length = strlen(literal);
+    if (size_t(m_end - m_p) >= length && memcmp(m_p, literal, length) == 0)
+    {
+      m_p += length;
+      return true;
+    }
+    return false;
+  }
+
+  std::string parseString()
+  {
+    expect('"');
+    std::string result;
+    for (;;)
+    {
+      if (m_p == m_end)
+      {
+        fail("unterminated string");
+      }
+      const char c = *m_p++;
+      if (c == '"')
+      {
+        return result;
+      }
+      if (c != '\\')
+      {
+        result += c;
+        continue;
+      }
+
+      if (m_p == m_end)
+      {
+        fail("unterminated string");
+      }
+      const char escaped = *m_p++;
+      switch (escaped)
+      {
+        case '"':
+        case '\\':
+        case '/': result += escaped; break;
+        case 'b': result += '\b'; break;
+        case 'f': result += '\f'; break;
+        case 'n': result += '\n'; break;
+        case 'r': result += '\r'; break;
+        case 't': result += '\t'; break;
+        case 'u':
+        {
+          // Names we look up are ASCII, so code points only need to round trip
+          if (m_end - m_p < 4)
+          {
+            fail("bad unicode escape");
+          }
+          uint32_t codePoint = 0;
+          for (int i = 0; i < 4; ++i)
+          {
+            const char h = *m_p++;
+            codePoint <<= 4;
+            if (isDigit(h))
+              codePoint |= h - '0';
+            else if (h >= 'a' && h <= 'f')
+              codePoint |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F')
+              codePoint |= h - 'A' + 10;
+            else
+              fail("bad unicode escape");
+          }
+          if (codePoint < 0x80)
+          {
+            result += static_cast<char>(codePoint);
+          }
+          else if (codePoint < 0x800)
+          {
+            result += static_cast<char>(0xC0 | (codePoint >> 6));
+            result += static_cast<char>(0x80 | (codePoint & 0x3F));
+          }
+          else
+          {
+            result += static_cast<char>(0xE0 | (codePoint >> 12));
+            result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (codePoint & 0x3F));
+          }
+          break;
+        }
+        default: fail("bad escape");
+      }
+    }
+  }
+
+  JsonValue parseValue(uint32_t depth)
+  {
+    if (depth > JSON_MAX_DEPTH)
+    {
+      fail("nested too deeply");
+    }
+
+    skipWhitespace();
+    if (m_p == m_end)
+    {
+      fail("unexpected end");
+    }
+
+    JsonValue value;
+    switch (*m_p)
+    {
+      case '{':
+        value.type = JsonValue::Type::Object;
+        ++m_p;
+        skipWhitespace();
+        if (m_p < m_end && *m_p == '}')
+        {
+          ++m_p;
+          return value;
+        }
+        for (;;)
+        {
+          value.keys.push_back(parseString());
+          expect(':');
+          value.elements.push_back(parseValue(depth + 1));
+          skipWhitespace();
+          if (m_p < m_end && *m_p == ',')
+          {
+            ++m_p;
+            continue;
+          }
+          expect('}');
+          return value;
+        }
+
+      case '[':
+        value.type = JsonValue::Type::Array;
+        ++m_p;
+        skipWhitespace();
+        if (m_p < m_end && *m_p == ']')
+        {
+          ++m_p;
+          return value;
+        }
+        for (;;)
+        {
+          value.elements.push_back(parseValue(depth + 1));
+          skipWhitespace();
+          if (m_p < m_end && *m_p == ',')
+          {
+            ++m_p;
+            continue;
+          }
+          expect(']');
+          return value;
+        }
+
+      case '"':
+        value.type   = JsonValue::Type::String;
+        value.string = parseString();
+        return value;
+
+      default:
+        if (consumeLiteral("true"))
+        {
+          value.type    = JsonValue::Type::Bool;
+          value.boolean = true;
+        }
+        else if (consumeLiteral("false"))
+        {
+          value.type = JsonValue::Type::Bool;
+        }
+        else if (consumeLiteral("null"))
+        {
+          value.type = JsonValue::Type::Null;
+        }
+        else if (parseDouble(m_p, m_end, value.number))
+        {
+          value.type = JsonValue::Type::Number;
+        }
+        else
+        {
+          fail("unexpected character");
+        }
+        return value;
+    }
+  }
+
+public:
+  JsonParser(const char* begin, const char* end)
+      : m_p(begin)
+      , m_end(end)
+  {
+  }
+
+  JsonValue parse()
+  {
+    JsonValue root = parseValue(0);
+    skipWhitespace();
+    // The chunk is padded with spaces, but tolerate trailing zeros too
+    while (m_p < m_end && *m_p == '\0')
+    {
+      ++m_p;
+    }
+    if (m_p != m_end || root.type != JsonValue::Type::Object)
+    {
+      fail("expected a single object");
+    }
+    return root;
+  }
+};
+}    // namespace
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+readU32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+componentSize(uint32_t componentType)
+{
+  switch (componentType)
+  {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE: return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT: return 4;
+    default: throw std::runtime_error("unknown glTF component type");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+componentCount(const std::string& type)
+{
+  if (type == "SCALAR")
+    return 1;
+  if (type == "VEC2")
+    return 2;
+  if (type == "VEC3")
+    return 3;
+  if (type == "VEC4")
+    return 4;
+  throw std::runtime_error(fmt::format("unsupported glTF accessor type: {}", type));
+}
+
+//----------------------------------------------------------------------------------------
+static const JsonValue&
+jsonMember(const JsonValue& object, const char* key, JsonValue::Type type)
+{
+  const JsonValue* member = object.find(key);
+  if (member == nullptr || member->type != type)
+  {
+    throw std::runtime_error(fmt::format("glTF: missing or invalid \"{}\"", key));
+  }
+  return *member;
+}
+
+//----------------------------------------------------------------------------------------
+static uint64_t
+jsonUint(const JsonValue& object, const char* key, uint64_t defaultValue)
+{
+  const JsonValue* member = object.find(key);
+  if (member == nullptr)
+  {
+    return defaultValue;
+  }
+  if (
+    member->type != JsonValue::Type::Number || member->number < 0.0
+    || member->number > 9007199254740992.0
+    || std::floor(member->number) != member->number)
+  {
+    throw std::runtime_error(
+      fmt::format("glTF: \"{}\" must be a positive integer", key));
+  }
+  return static_cast<uint64_t>(member->number);
+}
+
+//----------------------------------------------------------------------------------------
+static const JsonValue&
+jsonElement(const JsonValue& root, const char* arrayKey, uint64_t index)
+{
+  const JsonValue& array = jsonMember(root, arrayKey, JsonValue::Type::Array);
+  if (
+    index >= array.elements.size()
+    || array.elements[index].type != JsonValue::Type::Object)
+  {
+    throw std::runtime_error(
+      fmt::format("glTF: {} index {} out of range", arrayKey, index));
+  }
+  return array.elements[index];
+}
+
+//----------------------------------------------------------------------------------------
+// Validates that every element of the accessor lies inside its buffer view, and the view
+// inside the BIN chunk (sparse accessors and external buffers aren't supported)
+static void
+resolveAccessor(
+  const JsonValue& root,
+  uint64_t index,
+  const uint8_t* bin,
+  size_t binSize,
+  uint32_t& count,
+  uint32_t& stride,
+  uint32_t& type,
+  uint32_t& components,
+  const uint8_t*& data)
+{
+  const JsonValue& accessor = jsonElement(root, "accessors", index);
+  if (accessor.find("sparse") != nullptr || accessor.find("bufferView") == nullptr)
+  {
+    throw std::runtime_error("glTF: sparse accessors are not supported");
+  }
+
+  const JsonValue& view =
+    jsonElement(root, "bufferViews", jsonUint(accessor, "bufferView", 0));
+  if (jsonUint(view, "buffer", 0) != 0 || bin == nullptr)
+  {
+    throw std::runtime_error("glTF: only the embedded GLB buffer is supported");
+  }
+
+  type       = static_cast<uint32_t>(jsonUint(accessor, "componentType", 0));
+  components =
+    componentCount(jsonMember(accessor, "type", JsonValue::Type::String).string);
+  count      = static_cast<uint32_t>(std::min<uint64_t>(
+    jsonUint(accessor, "count", 0), std::numeric_limits<uint32_t>::max()));
+
+  const uint64_t elementSize    = uint64_t(componentSize(type)) * components;
+  const uint64_t viewOffset     = jsonUint(view, "byteOffset", 0);
+  const uint64_t viewLength     = jsonUint(view, "byteLength", 0);
+  const uint64_t accessorOffset = jsonUint(accessor, "byteOffset", 0);
+  const uint64_t byteStride     = jsonUint(view, "byteStride", elementSize);
+  if (byteStride < elementSize || byteStride > 252)
+  {
+    throw std::runtime_error("glTF: invalid byteStride");
+  }
+  if (viewOffset + viewLength > binSize)
+  {
+    throw std::runtime_error("glTF: buffer view lies outside the BIN chunk");
+  }
+  if (count > 0 && accessorOffset + byteStride * (count - 1) + elementSize > viewLength)
+  {
+    throw std::runtime_error("glTF: accessor lies outside its buffer view");
+  }
+
+  stride = static_cast<uint32_t>(byteStride);
+  data   = bin + viewOffset + accessorOffset;
+}
+
+//----------------------------------------------------------------------------------------
+static float
+readNormalizedComponent(const uint8_t* p, uint32_t componentType)
+{
+  switch (componentType)
+  {
+    case GLTF_UNSIGNED_BYTE: return *p / 255.0f;
+    case GLTF_UNSIGNED_SHORT:
+    {
+      uint16_t value;
+      memcpy(&value, p, sizeof(value));
+      return value / 65535.0f;
+    }
+    default:
+    {
+      float value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+readIndex(const uint8_t* p, uint32_t componentType)
+{
+  switch (componentType)
+  {
+    case GLTF_UNSIGNED_BYTE: return *p;
+    case GLTF_UNSIGNED_SHORT:
+    {
+      uint16_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    default: return readU32(p);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// MeshFile
+//----------------------------------------------------------------------------------------
+MeshFile::MeshFile(const std::string& filename)
+    : m_filename(filename)
+    , m_file(filename)
+{
+  std::string extension = filename.substr(std::min(filename.rfind('.'), filename.size()));
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+    return static_cast<char>(tolower(c));
+  });
+
+  if (extension == ".obj")
+  {
+    m_format = Format::Obj;
+  }
+  else if (extension == ".glb")
+  {
+    m_format = Format::Glb;
+  }
+  else
+  {
+    throw std::runtime_error(
+      fmt::format("{}: unsupported mesh format (expected .obj or .glb)", filename));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+MeshFile::scan(ThreadPool& pool)
+{
+  m_objChunks.clear();
+  m_glbPrimitives.clear();
+  m_vertexCount = 0;
+  m_indexCount  = 0;
+
+  if (m_format == Format::Obj)
+  {
+    scanObj(pool);
+  }
+  else
+  {
+    scanGlb();
+  }
+
+  if (m_vertexCount == 0)
+  {
+    throw std::runtime_error(fmt::format("{}: mesh has no vertices", m_filename));
+  }
+  m_scanned = true;
+}
+
+//----------------------------------------------------------------------------------------
+MeshBounds
+MeshFile::parse(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const
+{
+  if (!m_scanned)
+  {
+    throw std::runtime_error("MeshFile::parse() called before scan()");
+  }
+  return m_format == Format::Obj ? parseObj(pool, vertices, indices)
+                                 : parseGlb(pool, vertices, indices);
+}
+
+//----------------------------------------------------------------------------------------
+void
+MeshFile::scanObj(ThreadPool& pool)
+{
+  const char* text  = reinterpret_cast<const char*>(m_file.data());
+  const size_t size = m_file.size();
+
+  // Chunk boundaries are moved forward to the next line start
+  const size_t chunkCount = std::min<size_t>(
+    std::max<size_t>(size / OBJ_MIN_CHUNK_BYTES, 1),
+    size_t(pool.threadCount()) * OBJ_CHUNKS_PER_THREAD);
+  m_objChunks.resize(chunkCount);
+
+  size_t begin = 0;
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    size_t end = size;
+    if (i + 1 < chunkCount)
+    {
+      end = std::max(size * (i + 1) / chunkCount, begin);
+      end = findLineEnd(text + end, text + size) - text;
+      end = std::min(end + 1, size);
+    }
+    m_objChunks[i].begin = begin;
+    m_objChunks[i].end   = end;
+    begin                = end;
+  }
+
+  // Count in 64 bits per chunk, the totals are checked below
+  std::vector<uint64_t> counts(chunkCount * 2, 0);
+  pool.parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t chunkIndex) {
+    const ObjChunk& chunk = m_objChunks[chunkIndex];
+    const char* end       = text + chunk.end;
+    uint64_t vertexCount  = 0;
+    uint64_t indexCount   = 0;
+
+    for (const char* line = text + chunk.begin; line < end;)
+    {
+      const char* lineEnd = findLineEnd(line, end);
+      const char* p       = line;
+
+      switch (classifyObjLine(p, lineEnd))
+      {
+        case ObjLine::Vertex: ++vertexCount; break;
+        case ObjLine::Face:
+        {
+          uint32_t references = 0;
+          for (skipSpaces(p, lineEnd); p < lineEnd && *p != '#'; skipSpaces(p, lineEnd))
+          {
+            skipToken(p, lineEnd);
+            ++references;
+          }
+          if (references < 3)
+          {
+            throw std::runtime_error(
+              fmt::format("{}: face with fewer than 3 vertices", m_filename));
+          }
+          indexCount += 3 * (references - 2);
+          break;
+        }
+        case ObjLine::Other: break;
+      }
+      line = lineEnd + 1;
+    }
+
+    counts[chunkIndex * 2]     = vertexCount;
+    counts[chunkIndex * 2 + 1] = indexCount;
+  });
+
+  uint64_t vertexTotal = 0;
+  uint64_t indexTotal  = 0;
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    m_objChunks[i].firstVertex = checkedCount(vertexTotal, m_filename);
+    m_objChunks[i].firstIndex  = checkedCount(indexTotal, m_filename);
+    m_objChunks[i].vertexCount = checkedCount(counts[i * 2], m_filename);
+    m_objChunks[i].indexCount  = checkedCount(counts[i * 2 + 1], m_filename);
+    vertexTotal += counts[i * 2];
+    indexTotal += counts[i * 2 + 1];
+  }
+  m_vertexCount = checkedCount(vertexTotal, m_filename);
+  m_indexCount  = checkedCount(indexTotal, m_filename);
+}
+
+//----------------------------------------------------------------------------------------
+MeshBounds
+MeshFile::parseObj(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const
+{
+  const char* text = reinterpret_cast<const char*>(m_file.data());
+
+  std::vector<MeshBounds> chunkBounds(m_objChunks.size(), emptyBounds());
+  pool.parallelFor(static_cast<uint32_t>(m_objChunks.size()), [&](uint32_t chunkIndex) {
+    const ObjChunk& chunk = m_objChunks[chunkIndex];
+    const char* end       = text + chunk.end;
+    MeshBounds bounds     = emptyBounds();
+    uint32_t vertex       = chunk.firstVertex;    // also the count of vertices so far
+    uint32_t index        = chunk.firstIndex;
+
+    auto fail = [&](const char* what) {
+      throw std::runtime_error(fmt::format("{}: {}", m_filename, what));
+    };
+
+    for (const char* line = text + chunk.begin; line < end;)
+    {
+      const char* lineEnd = findLineEnd(line, end);
+      const char* p       = line;
+
+      switch (classifyObjLine(p, lineEnd))
+      {
+        case ObjLine::Vertex:
+        {
+          glm::vec3 position;
+          for (int i = 0; i < 3; ++i)
+          {
+            skipSpaces(p, lineEnd);
+            if (!parseFloat(p, lineEnd, position[i]))
+            {
+              fail("invalid vertex position");
+            }
+          }
+
+          // Optional "v x y z r g b" colours; a lone w component is ignored
+          glm::vec3 color = DEFAULT_COLOR;
+          glm::vec3 extra;
+          int extraCount = 0;
+          for (; extraCount < 3; ++extraCount)
+          {
+            skipSpaces(p, lineEnd);
+            if (p == lineEnd || *p == '#' || !parseFloat(p, lineEnd, extra[extraCount]))
+            {
+              break;
+            }
+          }
+          if (extraCount == 3)
+          {
+            color = extra;
+          }
+
+          vertices[vertex++] = {position, color};
+          growBounds(bounds, position);
+          break;
+        }
+
+        case ObjLine::Face:
+        {
+          // Fan triangulation of the polygon
+          uint32_t first      = 0;
+          uint32_t previous   = 0;
+          uint32_t references = 0;
+          for (skipSpaces(p, lineEnd); p < lineEnd && *p != '#'; skipSpaces(p, lineEnd))
+          {
+            int64_t reference;
+            if (!parseInt(p, lineEnd, reference))
+            {
+              fail("invalid face index");
+            }
+            skipToken(p, lineEnd);    // texcoord / normal indices
+
+            // Negative indices count back from the most recent vertex
+            const int64_t resolved =
+              reference > 0 ? reference - 1 : int64_t(vertex) + reference;
+            if (reference == 0 || resolved < 0 || resolved >= m_vertexCount)
+            {
+              fail("face index out of range");
+            }
+
+            const uint32_t current = static_cast<uint32_t>(resolved);
+            if (references == 0)
+            {
+              first = current;
+            }
+            else if (references >= 2)
+            {
+              indices[index++] = first;
+              indices[index++] = previous;
+              indices[index++] = current;
+            }
+            previous = current;
+            ++references;
+          }
+          break;
+        }
+
+        case ObjLine::Other: break;
+      }
+      line = lineEnd + 1;
+    }
+
+    chunkBounds[chunkIndex] = bounds;
+  });
+
+  return mergeBounds(chunkBounds);
+}
+
+//----------------------------------------------------------------------------------------
+void
+MeshFile::scanGlb()
+{
+  const uint8_t* data = m_file.data();
+  const size_t size   = m_file.size();
+
+  if (size < 20 || readU32(data) != GLB_MAGIC)
+  {
+    throw std::runtime_error(fmt::format("{}: not a binary glTF file", m_filename));
+  }
+  if (readU32(data + 4) != 2)
+  {
+    throw std::runtime_error(fmt::format("{}: only glTF 2.0 is supported", m_filename));
+  }
+  const size_t length = readU32(data + 8);
+  if (length > size)
+  {
+    throw std::runtime_error(fmt::format("{}: file is truncated", m_filename));
+  }
+
+  // JSON chunk first, then an optional BIN chunk (unknown chunks are skipped)
+  const char* json   = nullptr;
+  size_t jsonSize    = 0;
+  const uint8_t* bin = nullptr;
+  size_t binSize     = 0;
+  for (size_t offset = 12; offset + 8 <= length;)
+  {
+    const size_t chunkLength = readU32(data + offset);
+    const uint32_t chunkType = readU32(data + offset + 4);
+    offset += 8;
+    if (chunkLength > length - offset)
+    {
+      throw std::runtime_error(fmt::format("{}: chunk is truncated", m_filename));
+    }
+
+    if (json == nullptr)
+    {
+      if (chunkType != GLB_CHUNK_JSON)
+      {
+        throw std::runtime_error(fmt::format("{}: first chunk must be JSON", m_filename));
+      }
+      json     = reinterpret_cast<const char*>(data + offset);
+      jsonSize = chunkLength;
+    }
+    else if (chunkType == GLB_CHUNK_BIN && bin == nullptr)
+    {
+      bin     = data + offset;
+      binSize = chunkLength;
+    }
+    offset += chunkLength;
+  }
+  if (json == nullptr)
+  {
+    throw std::runtime_error(fmt::format("{}: missing JSON chunk", m_filename));
+  }
+
+  try
+  {
+    const JsonValue root = JsonParser(json, json + jsonSize).parse();
+    if (bin != nullptr && jsonElement(root, "buffers", 0).find("uri") != nullptr)
+    {
+      throw std::runtime_error("glTF: buffer 0 must be the GLB BIN chunk");
+    }
+
+    uint64_t vertexTotal    = 0;
+    uint64_t indexTotal     = 0;
+    uint32_t skipped        = 0;
+    const JsonValue& meshes = jsonMember(root, "meshes", JsonValue::Type::Array);
+    for (const JsonValue& mesh : meshes.elements)
+    {
+      const JsonValue& primitives =
+        jsonMember(mesh, "primitives", JsonValue::Type::Array);
+      for (const JsonValue& primitive : primitives.elements)
+      {
+        if (jsonUint(primitive, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES)
+        {
+          ++skipped;
+          continue;
+        }
+
+        const JsonValue& attributes =
+          jsonMember(primitive, "attributes", JsonValue::Type::Object);
+        if (attributes.find("POSITION") == nullptr)
+        {
+          throw std::runtime_error("glTF: primitive has no POSITION");
+        }
+
+        GlbPrimitive result;
+        GlbAccessor& positions = result.positions;
+        resolveAccessor(
+          root,
+          jsonUint(attributes, "POSITION", 0),
+          bin,
+          binSize,
+          positions.count,
+          positions.stride,
+          positions.componentType,
+          positions.components,
+          positions.data);
+        if (positions.componentType != GLTF_FLOAT || positions.components != 3)
+        {
+          throw std::runtime_error("glTF: POSITION must be float VEC3");
+        }
+
+        if (attributes.find("COLOR_0") != nullptr)
+        {
+          GlbAccessor& colors = result.colors;
+          resolveAccessor(
+            root,
+            jsonUint(attributes, "COLOR_0", 0),
+            bin,
+            binSize,
+            colors.count,
+            colors.stride,
+            colors.componentType,
+            colors.components,
+            colors.data);
+          if (
+            colors.count < positions.count || colors.components < 3
+            || colors.componentType == GLTF_BYTE || colors.componentType == GLTF_SHORT
+            || colors.componentType == GLTF_UNSIGNED_INT)
+          {
+            throw std::runtime_error("glTF: unsupported COLOR_0 format");
+          }
+        }
+
+        result.indexCount = positions.count;
+        if (primitive.find("indices") != nullptr)
+        {
+          GlbAccessor& indices = result.indices;
+          resolveAccessor(
+            root,
+            jsonUint(primitive, "indices", 0),
+            bin,
+            binSize,
+            indices.count,
+            indices.stride,
+            indices.componentType,
+            indices.components,
+            indices.data);
+          if (
+            indices.components != 1
+            || (indices.componentType != GLTF_UNSIGNED_BYTE
+                && indices.componentType != GLTF_UNSIGNED_SHORT
+                && indices.componentType != GLTF_UNSIGNED_INT))
+          {
+            throw std::runtime_error("glTF: invalid index accessor");
+          }
+          result.indexCount = indices.count;
+        }
+        if (result.indexCount % 3 != 0)
+        {
+          throw std::runtime_error("glTF: triangle index count isn't a multiple of 3");
+        }
+
+        result.firstVertex = static_cast<uint32_t>(vertexTotal);
+        result.firstIndex  = static_cast<uint32_t>(indexTotal);
+        vertexTotal += positions.count;
+        indexTotal += result.indexCount;
+        if (
+          vertexTotal > std::numeric_limits<uint32_t>::max()
+          || indexTotal > std::numeric_limits<uint32_t>::max())
+        {
+          throw std::runtime_error("mesh has too many vertices or indices");
+        }
+        m_glbPrimitives.push_back(result);
+      }
+    }
+
+    m_vertexCount = static_cast<uint32_t>(vertexTotal);
+    m_indexCount  = static_cast<uint32_t>(indexTotal);
+    if (skipped > 0)
+    {
+      fmt::print("{}: skipped {} non triangle list primitives\n", m_filename, skipped);
+    }
+  }
+  catch (const std::runtime_error& e)
+  {
+    throw std::runtime_error(fmt::format("{}: {}", m_filename, e.what()));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+MeshBounds
+MeshFile::parseGlb(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const
+{
+  // Primitives are cut into fixed size vertex and index ranges so big ones still spread
+  // over every thread
+  struct Task
+  {
+    const GlbPrimitive* primitive;
+    bool indices;
+    uint32_t begin;
+    uint32_t end;
+  };
+  std::vector<Task> tasks;
+  for (const GlbPrimitive& primitive : m_glbPrimitives)
+  {
+    for (uint32_t i = 0; i < primitive.positions.count; i += GLB_TASK_ELEMENTS)
+    {
+      tasks.push_back(
+        {&primitive,
+         false,
+         i,
+         std::min(primitive.positions.count - i, GLB_TASK_ELEMENTS) + i});
+    }
+    for (uint32_t i = 0; i < primitive.indexCount; i += GLB_TASK_ELEMENTS)
+    {
+      tasks.push_back(
+        {&primitive, true, i, std::min(primitive.indexCount - i, GLB_TASK_ELEMENTS) + i});
+    }
+  }
+
+  std::vector<MeshBounds> taskBounds(tasks.size(), emptyBounds());
+  pool.parallelFor(static_cast<uint32_t>(tasks.size()), [&](uint32_t taskIndex) {
+    const Task& task              = tasks[taskIndex];
+    const GlbPrimitive& primitive = *task.primitive;
+    const GlbAccessor& positions  = primitive.positions;
+
+    if (task.indices)
+    {
+      const GlbAccessor& source = primitive.indices;
+      uint32_t* destination     = indices + primitive.firstIndex;
+      for (uint32_t i = task.begin; i < task.end; ++i)
+      {
+        uint32_t index = i;
+        if (source.count > 0)
+        {
+          index =
+            readIndex(source.data + size_t(i) * source.stride, source.componentType);
+          if (index >= positions.count)
+          {
+            throw std::runtime_error(fmt::format("{}: index out of range", m_filename));
+          }
+        }
+        destination[i] = primitive.firstVertex + index;
+      }
+      return;
+    }
+
+    const GlbAccessor& colors = primitive.colors;
+    MeshBounds bounds         = emptyBounds();
+    Vertex* destination       = vertices + primitive.firstVertex;
+    for (uint32_t i = task.begin; i < task.end; ++i)
+    {
+      glm::vec3 position;
+      memcpy(
+        &position[0], positions.data + size_t(i) * positions.stride, sizeof(float) * 3);
+
+      glm::vec3 color = DEFAULT_COLOR;
+      if (colors.components > 0)
+      {
+        const uint8_t* p     = colors.data + size_t(i) * colors.stride;
+        const uint32_t bytes = componentSize(colors.componentType);
+        for (int c = 0; c < 3; ++c)
+        {
+          color[c] = readNormalizedComponent(p + c * bytes, colors.componentType);
+        }
+      }
+
+      destination[i] = {position, color};
+      growBounds(bounds, position);
+    }
+    taskBounds[taskIndex] = bounds;
+  });
+
+  return mergeBounds(taskBounds);
+}
+
+//----------------------------------------------------------------------------------------
+// Mesh cache: MeshCacheHeader, PackedVertex[vertexCount], uint32_t[indexCount], i.e.
+// exactly the staging buffer layout, so loading it is one read
+//----------------------------------------------------------------------------------------
+struct MeshCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t sourceSize;    // the cache is stale once the source file changes
+  int64_t sourceTime;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+};
+static_assert(sizeof(MeshCacheHeader) == 32, "MeshCacheHeader must not have padding");
+
+// Optimised and packed, ready to upload
+struct OptimizedMesh
+{
+  std::vector<PackedVertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+//----------------------------------------------------------------------------------------
+static std::string
+meshCachePath(const std::string& filename)
+{
+  return filename + MESH_CACHE_EXTENSION;
+}
+
+//----------------------------------------------------------------------------------------
+static MeshCacheHeader
+sourceStamp(const std::string& filename)
+{
+  const auto modified = std::filesystem::last_write_time(filename);
+
+  MeshCacheHeader header = {};
+  header.magic           = MESH_CACHE_MAGIC;
+  header.version         = MESH_CACHE_VERSION;
+  header.sourceSize      = std::filesystem::file_size(filename);
+  header.sourceTime      = modified.time_since_epoch().count();
+  return header;
+}
+
+//----------------------------------------------------------------------------------------
+// Parses, centres and scales the mesh into the unit sphere (which the packed 16 bit
+// positions rely on), then reorders it for the vertex cache and vertex fetch
+static OptimizedMesh
+importMesh(const std::string& filename, ThreadPool& pool)
+{
+  MeshFile file(filename);
+  file.scan(pool);
+
+  std::vector<Vertex> vertices(file.vertexCount());
+  std::vector<uint32_t> indices(file.indexCount());
+  const MeshBounds bounds = file.parse(pool, vertices.data(), indices.data());
+
+  const glm::vec3 centre = (bounds.min + bounds.max) * 0.5f;
+  const float radius     = glm::length(bounds.max - centre);
+  const float scale      = radius > 0.0f ? 1.0f / radius : 1.0f;
+  for (Vertex& vertex : vertices)
+  {
+    vertex.pos = (vertex.pos - centre) * scale;
+  }
+
+  const uint32_t vertexCount = file.vertexCount();
+  const float missRatioBefore =
+    averageCacheMissRatio(indices.data(), indices.size(), vertexCount);
+  optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+  optimizeVertexFetch(vertices, indices.data(), indices.size());
+  const float missRatioAfter =
+    averageCacheMissRatio(indices.data(), indices.size(), vertexCount);
+
+  OptimizedMesh mesh;
+  mesh.vertices.resize(vertices.size());
+  std::transform(vertices.begin(), vertices.end(), mesh.vertices.begin(), packVertex);
+  mesh.indices = std::move(indices);
+
+  fmt::print(
+    "Optimised {}: ACMR {:.2f} -> {:.2f}, {} -> {} bytes per vertex, {} unused vertices "
+    "dropped\n",
+    filename,
+    missRatioBefore,
+    missRatioAfter,
+    sizeof(Vertex),
+    sizeof(PackedVertex),
+    vertexCount - mesh.vertices.size());
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------
+// A missing cache only costs load time, so failing to write one isn't an error
+static void
+writeMeshCache(const std::string& filename, const OptimizedMesh& mesh)
+{
+  MeshCacheHeader header = sourceStamp(filename);
+  header.vertexCount     = static_cast<uint32_t>(mesh.vertices.size());
+  header.indexCount      = static_cast<uint32_t>(mesh.indices.size());
+
+  const std::string cachePath = meshCachePath(filename);
+  FILE* file                  = fopen(cachePath.c_str(), "wb");
+  bool written                = file != nullptr;
+  if (file != nullptr)
+  {
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t indexCount  = mesh.indices.size();
+    written &= fwrite(&header, sizeof(header), 1, file) == 1;
+    written &= fwrite(mesh.vertices.data(), sizeof(PackedVertex), vertexCount, file)
+               == vertexCount;
+    written &=
+      fwrite(mesh.indices.data(), sizeof(uint32_t), indexCount, file) == indexCount;
+    written &= fclose(file) == 0;
+  }
+
+  if (!written)
+  {
+    remove(cachePath.c_str());
+    fmt::print("failed to write mesh cache: {}\n", cachePath);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Returns INVALID_MESH when there is no up to date cache for the file
+static MeshHandle
+loadMeshCache(const std::string& filename, GeometryPacker& geometry)
+{
+  const std::string cachePath = meshCachePath(filename);
+  std::error_code error;
+  const uint64_t cacheSize = std::filesystem::file_size(cachePath, error);
+  if (error)
+  {
+    return INVALID_MESH;
+  }
+
+  FILE* file = fopen(cachePath.c_str(), "rb");
+  if (file == nullptr)
+  {
+    return INVALID_MESH;
+  }
+
+  MeshCacheHeader header;
+  const MeshCacheHeader expected = sourceStamp(filename);
+  const bool valid =
+    fread(&header, sizeof(header), 1, file) == 1 && header.magic == expected.magic
+    && header.version == expected.version && header.sourceSize == expected.sourceSize
+    && header.sourceTime == expected.sourceTime && header.vertexCount > 0
+    && header.indexCount > 0;
+  const uint64_t payloadSize = uint64_t(header.vertexCount) * sizeof(PackedVertex)
+                               + uint64_t(header.indexCount) * sizeof(uint32_t);
+  if (!valid || cacheSize != sizeof(header) + payloadSize)
+  {
+    fclose(file);
+    return INVALID_MESH;
+  }
+
+  MeshHandle mesh = INVALID_MESH;
+  try
+  {
+    mesh = geometry.addMesh(
+      header.vertexCount, header.indexCount, [&](PackedVertex* vertices, uint32_t*) {
+        // The indices follow the vertices in the staging buffer too
+        if (fread(vertices, 1, payloadSize, file) != payloadSize)
+        {
+          throw std::runtime_error(
+            fmt::format("failed to read mesh cache: {}", cachePath));
+        }
+      });
+  }
+  catch (...)
+  {
+    fclose(file);
+    throw;
+  }
+  fclose(file);
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------
+// Free functions
+//----------------------------------------------------------------------------------------
+MeshHandle
+loadMesh(const std::string& filename, GeometryPacker& geometry, ThreadPool& pool)
+{
+  const auto start = Clock::now();
+
+  const char* source = "cached";
+  MeshHandle mesh    = loadMeshCache(filename, geometry);
+  if (mesh == INVALID_MESH)
+  {
+    const OptimizedMesh optimized = importMesh(filename, pool);
+    writeMeshCache(filename, optimized);
+
+    mesh = geometry.addMesh(
+      static_cast<uint32_t>(optimized.vertices.size()),
+      static_cast<uint32_t>(optimized.indices.size()),
+      [&](PackedVertex* vertices, uint32_t* indices) {
+        std::copy(optimized.vertices.begin(), optimized.vertices.end(), vertices);
+        std::copy(optimized.indices.begin(), optimized.indices.end(), indices);
+      });
+    source = "imported";
+  }
+
+  const MeshAllocation& allocation                        = geometry.mesh(mesh);
+  const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+  fmt::print(
+    "Loaded {} ({}): {} vertices, {} triangles in {:.1f} ms\n",
+    filename,
+    source,
+    allocation.vertexCount,
+    allocation.indexCount / 3,
+    elapsed.count());
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------
+void
+buildMeshCache(const std::string& filename)
+{
+  ThreadPool pool;
+  writeMeshCache(filename, importMesh(filename, pool));
+  fmt::print("Wrote {}\n", meshCachePath(filename));
+}
+
+//----------------------------------------------------------------------------------------
+void
+runMeshLoadBenchmark(const std::string& filename)
+{
+  const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+  {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  // Output memory is allocated (and so faulted in) once, outside of the timings
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  double singleThreadMs = 0.0;
+
+  fmt::print(
+    "Mesh load benchmark: {} (best of {} runs, file cache warm after the first)\n",
+    filename,
+    BENCHMARK_RUNS);
+  fmt::print("threads   scan ms   parse ms   total ms       MB/s   speedup\n");
+  for (uint32_t threads : threadCounts)
+  {
+    ThreadPool pool(threads);
+    double bestScanMs  = std::numeric_limits<double>::max();
+    double bestParseMs = std::numeric_limits<double>::max();
+    double fileMB      = 0.0;
+
+    for (uint32_t run = 0; run < BENCHMARK_RUNS; ++run)
+    {
+      const auto start = Clock::now();
+      MeshFile file(filename);
+      file.scan(pool);
+      const auto scanned = Clock::now();
+
+      if (vertices.size() < file.vertexCount() || indices.size() < file.indexCount())
+      {
+        vertices.resize(file.vertexCount());
+        indices.resize(file.indexCount());
+      }
+      const auto parseStart = Clock::now();
+      file.parse(pool, vertices.data(), indices.data());
+      const auto parsed = Clock::now();
+
+      using Milliseconds = std::chrono::duration<double, std::milli>;
+      bestScanMs  = std::min(bestScanMs, Milliseconds(scanned - start).count());
+      bestParseMs = std::min(bestParseMs, Milliseconds(parsed - parseStart).count());
+      fileMB = file.fileSize() / (1024.0 * 1024.0);
+    }
+
+    const double totalMs = bestScanMs + bestParseMs;
+    if (threads == 1)
+    {
+      singleThreadMs = totalMs;
+    }
+    fmt::print(
+      "{:7} {:9.1f} {:10.1f} {:10.1f} {:10.1f} {:8.2f}x\n",
+      threads,
+      bestScanMs,
+      bestParseMs,
+      totalMs,
+      fileMB / (totalMs / 1000.0),
+      singleThreadMs / totalMs);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+generateObjFile(const std::string& filename, uint32_t gridSize)
+{
+  if (gridSize == 0 || gridSize >= 65535)
+  {
+    throw std::runtime_error("grid size must be between 1 and 65534");
+  }
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == nullptr)
+  {
+    throw std::runtime_error(fmt::format("failed to open file: {}", filename));
+  }
+
+  fmt::memory_buffer buffer;
+  bool failed = false;
+  auto flush  = [&](size_t threshold) {
+    if (buffer.size() >= threshold)
+    {
+      failed |= fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size();
+      buffer.clear();
+    }
+  };
+
+  // Rippled height field, coloured by position
+  const uint32_t rowLength = gridSize + 1;
+  for (uint32_t y = 0; y < rowLength; ++y)
+  {
+    for (uint32_t x = 0; x < rowLength; ++x)
+    {
+      const float u = float(x) / gridSize;
+      const float v = float(y) / gridSize;
+      const float h = 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f);
+      fmt::format_to(
+        buffer,
+        "v {:.6f} {:.6f} {:.6f} {:.3f} {:.3f} {:.3f}\n",
+        u * 2 - 1,
+        h,
+        v * 2 - 1,
+        u,
+        0.5f + h * 10,
+        v);
+      flush(1 << 20);
+    }
+  }
+
+  // Quads, so the loader's triangulation gets exercised too (OBJ indices start at 1)
+  for (uint32_t y = 0; y < gridSize; ++y)
+  {
+    for (uint32_t x = 0; x < gridSize; ++x)
+    {
+      const uint32_t corner = y * rowLength + x + 1;
+      fmt::format_to(
+        buffer,
+        "f {} {} {} {}\n",
+        corner,
+        corner + 1,
+        corner + rowLength + 1,
+        corner + rowLength);
+      flush(1 << 20);
+    }
+  }
+  flush(0);
+
+  failed |= fclose(file) != 0;
+  if (failed)
+  {
+    throw std::runtime_error(fmt::format("failed to write file: {}", filename));
+  }
+
+  const uint64_t vertexCount = uint64_t(rowLength) * rowLength;
+  fmt::print(
+    "Wrote {}: {} vertices, {} quads\n",
+    filename,
+    vertexCount,
+    uint64_t(gridSize) * gridSize);
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "GeometryPacker.h"
+#include "MappedFile.h"
+#include "Scene.h"
+
+#include <glm/vec3.hpp>
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+//----------------------------------------------------------------------------------------
+struct MeshBounds
+{
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+//----------------------------------------------------------------------------------------
+// Memory mapped Wavefront OBJ (v / f only) or binary glTF (.glb) file, loaded in two
+// parallel passes straight out of the mapping:
+//  - scan() splits the file into independent chunks (OBJ: line aligned byte ranges,
+//    glTF: primitives) and counts the vertices and indices each chunk produces, so
+//    every chunk knows where its output starts
+//  - parse() decodes the chunks on the pool into caller provided memory, e.g. mapped
+//    staging memory, without any intermediate copies
+// The whole file becomes one mesh: glTF node transforms are ignored and every
+// triangle list primitive is merged. Throws std::runtime_error on malformed input.
+//----------------------------------------------------------------------------------------
+class MeshFile
+{
+public:
+  enum class Format
+  {
+    Obj,
+    Glb,
+  };
+
+private:
+  struct ObjChunk
+  {
+    size_t begin         = 0;
+    size_t end           = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount  = 0;
+    uint32_t firstVertex = 0;
+    uint32_t firstIndex  = 0;
+  };
+
+  struct GlbAccessor
+  {
+    const uint8_t* data    = nullptr;
+    uint32_t count         = 0;
+    uint32_t stride        = 0;
+    uint32_t componentType = 0;
+    uint32_t components    = 0;
+  };
+
+  struct GlbPrimitive
+  {
+    GlbAccessor positions;
+    GlbAccessor colors;     // components == 0 when missing
+    GlbAccessor indices;    // count == 0 when not indexed
+    uint32_t firstVertex = 0;
+    uint32_t firstIndex  = 0;
+    uint32_t indexCount  = 0;
+  };
+
+  std::string m_filename;
+  MappedFile m_file;
+  Format m_format;
+
+  uint32_t m_vertexCount = 0;
+  uint32_t m_indexCount  = 0;
+  bool m_scanned         = false;
+  std::vector<ObjChunk> m_objChunks;
+  std::vector<GlbPrimitive> m_glbPrimitives;
+
+private:
+  void scanObj(ThreadPool& pool);
+  void scanGlb();
+  MeshBounds parseObj(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const;
+  MeshBounds parseGlb(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const;
+
+public:
+  // The format is picked from the extension (.obj or .glb)
+  explicit MeshFile(const std::string& filename);
+
+  void scan(ThreadPool& pool);
+
+  // Valid after scan()
+  uint32_t vertexCount() const { return m_vertexCount; }
+  uint32_t indexCount() const { return m_indexCount; }
+
+  // vertices[vertexCount()], indices[indexCount()]; returns the bounds of the vertices
+  MeshBounds parse(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const;
+
+  Format format() const { return m_format; }
+  size_t fileSize() const { return m_file.size(); }
+};
+
+//----------------------------------------------------------------------------------------
+// Loads a mesh rescaled to fit in a unit sphere around the origin (like the built in
+// meshes). The first load imports, optimises (see MeshOptimizer.h) and packs the mesh,
+// and caches the result next to the file as <filename>.mesh; later loads read the cache
+// straight into the packer's staging memory while the source file is unchanged.
+MeshHandle
+loadMesh(const std::string& filename, GeometryPacker& geometry, ThreadPool& pool);
+
+// Writes <filename>.mesh ahead of time, e.g. as a build step (no GPU needed)
+void buildMeshCache(const std::string& filename);
+
+// Times scan + parse with 1, 2, 4... threads and prints throughput and scaling
+void runMeshLoadBenchmark(const std::string& filename);
+
+// Writes a gridSize x gridSize quad height field with vertex colours, for benchmarking
+void generateObjFile(const std::string& filename, uint32_t gridSize);
+
+//----------------------------------------------------------------------------------------
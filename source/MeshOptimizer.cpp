@@ -0,0 +1,232 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------
+// Forsyth scoring constants (the values from the paper)
+constexpr uint32_t CACHE_SIZE       = 32;
+constexpr float CACHE_DECAY_POWER   = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+constexpr uint32_t NO_TRIANGLE      = ~0u;
+
+//----------------------------------------------------------------------------------------
+// cachePosition < 0 means not in the cache; valence is the number of unemitted triangles
+static float
+vertexScore(int32_t cachePosition, uint32_t valence)
+{
+  if (valence == 0)
+  {
+    return -1.0f;    // nothing left to draw with this vertex
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0)
+  {
+    if (cachePosition < 3)
+    {
+      // Just used by the last triangle: deliberately not the best, to avoid strips
+      score = LAST_TRIANGLE_SCORE;
+    }
+    else
+    {
+      const float scale = 1.0f / (CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+    }
+  }
+
+  // Favour vertices with few triangles left, so they can leave the cache for good
+  return score + VALENCE_BOOST_SCALE * std::pow(float(valence), -VALENCE_BOOST_POWER);
+}
+
+//----------------------------------------------------------------------------------------
+void
+optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  // Triangles using each vertex; the first valence[v] entries are the unemitted ones
+  std::vector<uint32_t> valence(vertexCount, 0);
+  for (size_t i = 0; i < indexCount; ++i)
+  {
+    ++valence[indices[i]];
+  }
+  std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+  for (uint32_t v = 0; v < vertexCount; ++v)
+  {
+    adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+  }
+  std::vector<uint32_t> adjacency(indexCount);
+  std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+  for (size_t i = 0; i < indexCount; ++i)
+  {
+    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<int32_t> cachePosition(vertexCount, -1);
+  std::vector<float> scores(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; ++v)
+  {
+    scores[v] = vertexScore(-1, valence[v]);
+  }
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  uint32_t bestTriangle = 0;
+  for (size_t t = 0; t < triangleCount; ++t)
+  {
+    const uint32_t* triangle = indices + t * 3;
+    triangleScores[t] = scores[triangle[0]] + scores[triangle[1]] + scores[triangle[2]];
+    if (triangleScores[t] > triangleScores[bestTriangle])
+    {
+      bestTriangle = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(indexCount);
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> newCache;
+  cache.reserve(CACHE_SIZE + 3);
+  newCache.reserve(CACHE_SIZE + 3);
+  size_t nextUnemitted = 0;
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+  {
+    if (bestTriangle == NO_TRIANGLE)
+    {
+      // Nothing in the cache has work left: carry on in the original order
+      while (emitted[nextUnemitted])
+      {
+        ++nextUnemitted;
+      }
+      bestTriangle = static_cast<uint32_t>(nextUnemitted);
+    }
+
+    const uint32_t* triangle = indices + size_t(bestTriangle) * 3;
+    output.insert(output.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    // Drop the triangle from its vertices' lists of unemitted triangles
+    newCache.clear();
+    for (int i = 0; i < 3; ++i)
+    {
+      const uint32_t v = triangle[i];
+      uint32_t* begin  = adjacency.data() + adjacencyOffset[v];
+      uint32_t* end    = begin + valence[v];
+      std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+      --valence[v];
+
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+      {
+        newCache.push_back(v);
+      }
+    }
+
+    // The triangle's vertices move to the front of the (LRU) cache
+    const size_t triangleVertexCount = newCache.size();
+    for (uint32_t v : cache)
+    {
+      const auto triangleEnd = newCache.begin() + triangleVertexCount;
+      if (std::find(newCache.begin(), triangleEnd, v) == triangleEnd)
+      {
+        newCache.push_back(v);
+      }
+    }
+
+    // Rescore everything that moved, including vertices pushed out, then pick the
+    // best triangle touching the cache
+    float bestScore = -1.0f;
+    bestTriangle    = NO_TRIANGLE;
+    for (size_t i = 0; i < newCache.size(); ++i)
+    {
+      const uint32_t v = newCache[i];
+      cachePosition[v] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+      scores[v]        = vertexScore(cachePosition[v], valence[v]);
+    }
+    for (size_t i = 0; i < newCache.size(); ++i)
+    {
+      const uint32_t v      = newCache[i];
+      const uint32_t* begin = adjacency.data() + adjacencyOffset[v];
+      for (const uint32_t* t = begin; t != begin + valence[v]; ++t)
+      {
+        const uint32_t* other = indices + size_t(*t) * 3;
+        triangleScores[*t]    = scores[other[0]] + scores[other[1]] + scores[other[2]];
+        if (triangleScores[*t] > bestScore)
+        {
+          bestScore    = triangleScores[*t];
+          bestTriangle = *t;
+        }
+      }
+    }
+
+    newCache.resize(std::min<size_t>(newCache.size(), CACHE_SIZE));
+    std::swap(cache, newCache);
+  }
+
+  std::copy(output.begin(), output.end(), indices);
+}
+
+//----------------------------------------------------------------------------------------
+void
+optimizeVertexFetch(std::vector<Vertex>& vertices, uint32_t* indices, size_t indexCount)
+{
+  constexpr uint32_t UNUSED = ~0u;
+
+  std::vector<uint32_t> remap(vertices.size(), UNUSED);
+  uint32_t nextVertex = 0;
+  for (size_t i = 0; i < indexCount; ++i)
+  {
+    uint32_t& newIndex = remap[indices[i]];
+    if (newIndex == UNUSED)
+    {
+      newIndex = nextVertex++;
+    }
+    indices[i] = newIndex;
+  }
+
+  std::vector<Vertex> reordered(nextVertex);
+  for (size_t v = 0; v < vertices.size(); ++v)
+  {
+    if (remap[v] != UNUSED)
+    {
+      reordered[remap[v]] = vertices[v];
+    }
+  }
+  vertices.swap(reordered);
+}
+
+//----------------------------------------------------------------------------------------
+float
+averageCacheMissRatio(
+  const uint32_t* indices,
+  size_t indexCount,
+  uint32_t vertexCount,
+  uint32_t cacheSize)
+{
+  if (indexCount < 3)
+  {
+    return 0.0f;
+  }
+
+  // A vertex is in the FIFO if fewer than cacheSize misses happened since it was loaded
+  std::vector<uint32_t> loadedAt(vertexCount, 0);
+  uint32_t misses = 0;
+  for (size_t i = 0; i < indexCount; ++i)
+  {
+    const uint32_t v = indices[i];
+    if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+    {
+      loadedAt[v] = ++misses;
+    }
+  }
+  return float(misses) / float(indexCount / 3);
+}
+
+//----------------------------------------------------------------------------------------
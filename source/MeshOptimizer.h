@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Offline mesh optimisation, run once at import (the result is cached, see loadMesh())
+//----------------------------------------------------------------------------------------
+
+// Reorders triangles for the post transform vertex cache (Tom Forsyth's "Linear-speed
+// vertex cache optimisation"), so neighbouring triangles reuse shaded vertices
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+// Renumbers vertices in order of first use so vertex fetches walk memory linearly
+// (unreferenced vertices are dropped)
+void optimizeVertexFetch(std::vector<Vertex>& vertices, uint32_t* indices, size_t indexCount);
+
+// Transformed vertices per triangle with a FIFO cache of cacheSize entries: 3 is the
+// worst case, ~0.5-0.7 is typical for well ordered grids
+float averageCacheMissRatio(
+  const uint32_t* indices,
+  size_t indexCount,
+  uint32_t vertexCount,
+  uint32_t cacheSize = 16);
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,375 @@
+#include <fmt/format.h>
+
+#include "ParticleSystem.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr uint32_t SIMULATE_WORKGROUP_SIZE = 256;    // local_size_x in the shader
+constexpr float TIME_STEP                  = 1.0f / 60.0f;
+
+constexpr char SIMULATE_SHADER[] = "shaders/particles_simulate.spv";
+constexpr char VERTEX_SHADER[]   = "shaders/particles_vert.spv";
+constexpr char FRAGMENT_SHADER[] = "shaders/particles_frag.spv";
+
+// Mirrors the push constants of particles_simulate.comp
+struct SimulatePushConstants
+{
+  float timeStep;
+  uint32_t particleCount;
+  uint32_t spawn;    // 1: place every particle at a random point of its life
+};
+
+// Mirrors the push constants of particles.vert
+struct DrawPushConstants
+{
+  float viewScale[2];    // aspect ratio correction
+};
+
+//----------------------------------------------------------------------------------------
+// The layouts come from the shaders, the constants pushed from the structs above
+static void
+checkPushConstants(const ShaderReflection& shader, const char* name, size_t size)
+{
+  if (shader.pushConstantSize != size)
+  {
+    throw std::runtime_error(fmt::format(
+      "{} declares {} bytes of push constants, the C++ side pushes {}",
+      name,
+      shader.pushConstantSize,
+      size));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  VkRenderPass renderPass,
+  PipelineLayoutCache& layoutCache,
+  uint32_t particleCount)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+  assert(particleCount > 0);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  const VkDeviceSize bufferSize = VkDeviceSize(sizeof(Particle)) * particleCount;
+  const uint64_t maxParticles =
+    uint64_t(properties.limits.maxComputeWorkGroupCount[0]) * SIMULATE_WORKGROUP_SIZE;
+  if (
+    bufferSize > properties.limits.maxStorageBufferRange
+    || particleCount > maxParticles)
+  {
+    throw std::runtime_error(fmt::format(
+      "{} particles don't fit in one storage buffer or dispatch (at most {})",
+      particleCount,
+      std::min<uint64_t>(
+        properties.limits.maxStorageBufferRange / sizeof(Particle), maxParticles)));
+  }
+
+  m_device        = device;
+  m_particleCount = particleCount;
+
+  createBuffer(
+    physicalDevice,
+    m_device,
+    bufferSize,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    m_buffer,
+    m_bufferMemory);
+
+  const ShaderReflection simulateShader =
+    reflectShader(readFile(SIMULATE_SHADER), SIMULATE_SHADER);
+  checkPushConstants(simulateShader, SIMULATE_SHADER, sizeof(SimulatePushConstants));
+  m_simulateLayout = &layoutCache.get({&simulateShader});
+  createDescriptorSet();
+  m_simulatePipeline = createComputePipeline(
+    m_device, m_simulateLayout->pipelineLayout, SIMULATE_SHADER);
+
+  createDrawPipeline(renderPass, layoutCache);
+
+  // The initial state is generated where it lives, rather than uploaded
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands(m_device, commandPool);
+  dispatch(commandBuffer, true);
+  endSingleTimeCommands(m_device, commandPool, queue, commandBuffer);
+
+  fmt::print(
+    "particles: {}, {:.1f} MiB\n",
+    m_particleCount,
+    bufferSize / (1024.0 * 1024.0));
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::createDescriptorSet()
+{
+  if (m_simulateLayout->setLayouts.size() != 1)
+  {
+    throw std::runtime_error(
+      fmt::format("{} must use exactly descriptor set 0", SIMULATE_SHADER));
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type                 = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount      = 1;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount              = 1;
+  poolInfo.pPoolSizes                 = &poolSize;
+  poolInfo.maxSets                    = 1;
+  if (
+    vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool              = m_descriptorPool;
+  allocInfo.descriptorSetCount          = 1;
+  allocInfo.pSetLayouts                 = &m_simulateLayout->setLayouts[0];
+  if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate descriptor sets!");
+  }
+
+  VkDescriptorBufferInfo bufferInfo = {m_buffer, 0, VK_WHOLE_SIZE};
+
+  VkWriteDescriptorSet write = {};
+  write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet               = m_descriptorSet;
+  write.dstBinding           = 0;
+  write.descriptorType       = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.descriptorCount      = 1;
+  write.pBufferInfo          = &bufferInfo;
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::createDrawPipeline(
+  VkRenderPass renderPass,
+  PipelineLayoutCache& layoutCache)
+{
+  const std::vector<char> vertShaderCode = readFile(VERTEX_SHADER);
+  const std::vector<char> fragShaderCode = readFile(FRAGMENT_SHADER);
+  const ShaderReflection vertShader      = reflectShader(vertShaderCode, VERTEX_SHADER);
+  const ShaderReflection fragShader      = reflectShader(fragShaderCode, FRAGMENT_SHADER);
+  checkPushConstants(vertShader, VERTEX_SHADER, sizeof(DrawPushConstants));
+  m_drawLayout = &layoutCache.get({&vertShader, &fragShader});
+
+  VkShaderModule vertShaderModule = createShaderModule(m_device, vertShaderCode);
+  VkShaderModule fragShaderModule = createShaderModule(m_device, fragShaderCode);
+
+  VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+  shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+  shaderStages[0].module = vertShaderModule;
+  shaderStages[0].pName  = "main";
+  shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shaderStages[1].module = fragShaderModule;
+  shaderStages[1].pName  = "main";
+
+  // The simulation's storage buffer, read as is: the inputs are the members of Particle
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+  const uint32_t stride = vertexAttributes(vertShader, 0, attributeDescriptions);
+  if (stride != sizeof(Particle))
+  {
+    throw std::runtime_error(fmt::format(
+      "{} reads {} byte vertices, a Particle is {}",
+      VERTEX_SHADER,
+      stride,
+      sizeof(Particle)));
+  }
+
+  VkVertexInputBindingDescription bindingDescription = {};
+  bindingDescription.binding                         = 0;
+  bindingDescription.stride                          = stride;
+  bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.pVertexBindingDescriptions    = &bindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount =
+    static_cast<uint32_t>(attributeDescriptions.size());
+  vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+  inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates    = dynamicStates;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth   = 1.0f;
+  rasterizer.cullMode    = VK_CULL_MODE_NONE;
+  rasterizer.frontFace   = VK_FRONT_FACE_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading     = 1.0f;
+
+  // Drawn over the scene, ignoring its depth (the GPU driven scene pass has some)
+  VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+  // Additive, so the points need no sorting and dense areas glow
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+  colorBlendAttachment.colorWriteMask
+    = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+      | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable         = VK_TRUE;
+  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable   = VK_FALSE;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments    = &colorBlendAttachment;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount          = 2;
+  pipelineInfo.pStages             = shaderStages;
+  pipelineInfo.pVertexInputState   = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState      = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState   = &multisampling;
+  pipelineInfo.pDepthStencilState  = &depthStencil;
+  pipelineInfo.pColorBlendState    = &colorBlending;
+  pipelineInfo.pDynamicState       = &dynamicState;
+  pipelineInfo.layout              = m_drawLayout->pipelineLayout;
+  pipelineInfo.renderPass          = renderPass;
+  pipelineInfo.subpass             = 0;
+  pipelineInfo.basePipelineIndex   = -1;
+
+  VkResult result = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_drawPipeline);
+
+  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create graphics pipeline!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(m_device, m_drawPipeline, nullptr);
+  vkDestroyPipeline(m_device, m_simulatePipeline, nullptr);
+  vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+  m_drawLayout     = nullptr;
+  m_simulateLayout = nullptr;
+
+  vkDestroyBuffer(m_device, m_buffer, nullptr);
+  freeDeviceMemory(m_device, m_bufferMemory);
+
+  m_particleCount = 0;
+  m_device        = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::dispatch(VkCommandBuffer commandBuffer, bool spawn) const
+{
+  SimulatePushConstants constants = {};
+  constants.timeStep              = TIME_STEP;
+  constants.particleCount         = m_particleCount;
+  constants.spawn                 = spawn ? 1 : 0;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_simulatePipeline);
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    m_simulateLayout->pipelineLayout,
+    0,
+    1,
+    &m_descriptorSet,
+    0,
+    nullptr);
+  vkCmdPushConstants(
+    commandBuffer,
+    m_simulateLayout->pipelineLayout,
+    m_simulateLayout->pushConstantStages,
+    0,
+    sizeof(constants),
+    &constants);
+  vkCmdDispatch(
+    commandBuffer,
+    (m_particleCount + SIMULATE_WORKGROUP_SIZE - 1) / SIMULATE_WORKGROUP_SIZE,
+    1,
+    1);
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::recordSimulation(VkCommandBuffer commandBuffer) const
+{
+  dispatch(commandBuffer, false);
+}
+
+//----------------------------------------------------------------------------------------
+void
+ParticleSystem::recordDraw(VkCommandBuffer commandBuffer, VkExtent2D extent) const
+{
+  DrawPushConstants constants = {};
+  constants.viewScale[0]      = std::min(extent.height / float(extent.width), 1.0f);
+  constants.viewScale[1]      = std::min(extent.width / float(extent.height), 1.0f);
+
+  VkDeviceSize offset = 0;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipeline);
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_buffer, &offset);
+  vkCmdPushConstants(
+    commandBuffer,
+    m_drawLayout->pipelineLayout,
+    m_drawLayout->pushConstantStages,
+    0,
+    sizeof(constants),
+    &constants);
+  vkCmdDraw(commandBuffer, m_particleCount, 1, 0, 0);
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------
+// Mirrors `Particle` in particles_simulate.comp and the vertex input of particles.vert
+struct Particle
+{
+  float position[4];    // xyz, w: age in seconds
+  float velocity[4];    // xyz, w: lifetime in seconds
+};
+
+//----------------------------------------------------------------------------------------
+// Compute plus graphics workload: one device local buffer of particles that a compute
+// shader integrates in place and the draw then reads straight back as its vertex
+// buffer (points, additively blended). The particles never leave the GPU; the caller
+// orders the simulation after the last draws that read the buffer and the draws after
+// the simulation (the render graph does it with a buffer it imports).
+// Command buffers are recorded once, so every simulation step advances the particles by
+// a fixed time step.
+//----------------------------------------------------------------------------------------
+class ParticleSystem
+{
+  VkDevice m_device        = VK_NULL_HANDLE;
+  uint32_t m_particleCount = 0;
+
+  VkBuffer m_buffer             = VK_NULL_HANDLE;
+  VkDeviceMemory m_bufferMemory = VK_NULL_HANDLE;
+
+  // Generated from the shaders, owned by the layout cache
+  const PipelineLayoutCache::Layout* m_simulateLayout = nullptr;
+  const PipelineLayoutCache::Layout* m_drawLayout     = nullptr;
+  VkDescriptorPool m_descriptorPool                   = VK_NULL_HANDLE;
+  VkDescriptorSet m_descriptorSet                     = VK_NULL_HANDLE;
+  VkPipeline m_simulatePipeline                       = VK_NULL_HANDLE;
+  VkPipeline m_drawPipeline                           = VK_NULL_HANDLE;
+
+private:
+  void createDescriptorSet();
+  void createDrawPipeline(VkRenderPass renderPass, PipelineLayoutCache& layoutCache);
+  void dispatch(VkCommandBuffer commandBuffer, bool spawn) const;
+
+public:
+  // Spawns the particles on the GPU (waits for the queue). The draw pipeline takes its
+  // viewport and scissor from dynamic state, so it serves every window. The pipeline
+  // layouts come from layoutCache, which must outlive the system
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkCommandPool commandPool,
+    VkQueue queue,
+    VkRenderPass renderPass,
+    PipelineLayoutCache& layoutCache,
+    uint32_t particleCount);
+  void cleanup();
+
+  bool enabled() const { return m_particleCount > 0; }
+  uint32_t particleCount() const { return m_particleCount; }
+  VkBuffer buffer() const { return m_buffer; }
+
+  // One time step; record outside of the render pass
+  void recordSimulation(VkCommandBuffer commandBuffer) const;
+  // Record inside the render pass, after setting the viewport and scissor. extent: the
+  // render area, for the aspect ratio
+  void recordDraw(VkCommandBuffer commandBuffer, VkExtent2D extent) const;
+};
+
+//----------------------------------------------------------------------------------------
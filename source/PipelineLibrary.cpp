@@ -0,0 +1,638 @@
+#include <fmt/format.h>
+
+#include "PipelineLibrary.h"
+#include "DeletionQueue.h"
+#include "ThreadPool.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+//----------------------------------------------------------------------------------------
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* PART_NAMES[] = {
+  "vertex input", "pre-rasterization", "fragment shader", "output interface"};
+
+//----------------------------------------------------------------------------------------
+static double
+millisecondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------------------
+template<typename T>
+static void
+appendKey(std::vector<uint8_t>& key, const T& value)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "keys hold plain values");
+  const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+  key.insert(key.end(), bytes, bytes + sizeof(T));
+}
+
+//----------------------------------------------------------------------------------------
+static void
+appendKey(std::vector<uint8_t>& key, const std::string& value)
+{
+  appendKey(key, static_cast<uint32_t>(value.size()));
+  key.insert(key.end(), value.begin(), value.end());
+}
+
+//----------------------------------------------------------------------------------------
+// The fixed function state of a desc, which the create infos point into
+struct FixedFunctionState
+{
+  VkPipelineVertexInputStateCreateInfo vertexInput     = {};
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  VkPipelineViewportStateCreateInfo viewport           = {};
+  VkPipelineRasterizationStateCreateInfo rasterization = {};
+  VkPipelineMultisampleStateCreateInfo multisample     = {};
+  VkPipelineDepthStencilStateCreateInfo depthStencil   = {};
+  VkPipelineColorBlendStateCreateInfo colorBlend       = {};
+  VkPipelineDynamicStateCreateInfo dynamic             = {};
+  VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+  explicit FixedFunctionState(const GraphicsPipelineDesc& desc);
+  FixedFunctionState(const FixedFunctionState&) = delete;    // points into itself
+  FixedFunctionState& operator=(const FixedFunctionState&) = delete;
+};
+
+//----------------------------------------------------------------------------------------
+FixedFunctionState::FixedFunctionState(const GraphicsPipelineDesc& desc)
+{
+  vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.bindings.size());
+  vertexInput.pVertexBindingDescriptions    = desc.bindings.data();
+  vertexInput.vertexAttributeDescriptionCount =
+    static_cast<uint32_t>(desc.attributes.size());
+  vertexInput.pVertexAttributeDescriptions = desc.attributes.data();
+
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = desc.topology;
+
+  // Viewport and scissor are dynamic, so every window (of any size) uses the pipeline
+  viewport.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport.viewportCount = 1;
+  viewport.scissorCount  = 1;
+
+  rasterization.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterization.polygonMode = desc.polygonMode;
+  rasterization.lineWidth   = 1.0f;
+  rasterization.cullMode    = desc.cullMode;
+  rasterization.frontFace   = desc.frontFace;
+
+  multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisample.minSampleShading     = 1.0f;
+
+  // Depth test off, for a subpass that has a depth attachment the pipeline doesn't use
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+  colorBlend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlend.logicOp         = VK_LOGIC_OP_COPY;
+  colorBlend.attachmentCount = 1;
+  colorBlend.pAttachments    = &desc.blend;
+
+  dynamic.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic.dynamicStateCount = 2;
+  dynamic.pDynamicStates    = dynamicStates;
+}
+
+//----------------------------------------------------------------------------------------
+static VkPipelineShaderStageCreateInfo
+shaderStage(VkShaderStageFlagBits stage, VkShaderModule module)
+{
+  VkPipelineShaderStageCreateInfo stageInfo = {};
+  stageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stageInfo.stage  = stage;
+  stageInfo.module = module;
+  stageInfo.pName  = "main";
+  return stageInfo;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+PipelineLibrary::isSupported(
+  VkPhysicalDevice physicalDevice,
+  VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& libraryFeatures)
+{
+  if (
+    !isDeviceExtensionSupported(physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+    || !isDeviceExtensionSupported(
+      physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported = {};
+  supported.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext                     = &supported;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+  libraryFeatures = {};
+  libraryFeatures.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+  libraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+  return supported.graphicsPipelineLibrary;
+}
+
+//----------------------------------------------------------------------------------------
+void
+PipelineLibrary::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  bool librariesEnabled,
+  DeletionQueue& deletionQueue)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+
+  m_device           = device;
+  m_deletionQueue    = &deletionQueue;
+  m_librariesEnabled = librariesEnabled;
+  m_stop             = false;
+  if (!m_librariesEnabled)
+  {
+    fmt::print("pipelines: compiled whole, no VK_EXT_graphics_pipeline_library\n");
+    return;
+  }
+
+  VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties = {};
+  libraryProperties.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &libraryProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+  m_fastLinking = libraryProperties.graphicsPipelineLibraryFastLinking;
+
+  fmt::print(
+    "pipelines: parts compiled as graphics pipeline libraries, linked on demand{}\n",
+    m_fastLinking ? "" : " (the driver doesn't promise fast linking)");
+  m_thread = std::thread(&PipelineLibrary::threadLoop, this);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PipelineLibrary::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  if (m_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+  }
+  m_linkJobs.clear();
+
+  // Linked pipelines first, then the libraries they were linked from
+  for (const LinkResult& result : m_linkResults)
+  {
+    vkDestroyPipeline(m_device, result.pipeline, nullptr);
+  }
+  m_linkResults.clear();
+  for (const Pipeline& pipeline : m_pipelines)
+  {
+    vkDestroyPipeline(m_device, pipeline.pipeline, nullptr);
+  }
+  m_pipelines.clear();
+  for (const auto& part : m_parts)
+  {
+    vkDestroyPipeline(m_device, part.second, nullptr);
+  }
+  m_parts.clear();
+
+  m_deletionQueue = nullptr;
+  m_device        = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+// Everything the part is compiled from, so that pipelines differing only in other parts
+// share it
+std::vector<uint8_t>
+PipelineLibrary::partKey(Part part, const GraphicsPipelineDesc& desc) const
+{
+  std::vector<uint8_t> key;
+  appendKey(key, part);
+  switch (part)
+  {
+    case PART_VERTEX_INPUT:
+      appendKey(key, static_cast<uint32_t>(desc.bindings.size()));
+      for (const VkVertexInputBindingDescription& binding : desc.bindings)
+      {
+        appendKey(key, binding);
+      }
+      for (const VkVertexInputAttributeDescription& attribute : desc.attributes)
+      {
+        appendKey(key, attribute);
+      }
+      appendKey(key, desc.topology);
+      return key;
+    case PART_PRE_RASTERIZATION:
+      appendKey(key, desc.vertexShader);
+      appendKey(key, desc.polygonMode);
+      appendKey(key, desc.cullMode);
+      appendKey(key, desc.frontFace);
+      appendKey(key, desc.layout);
+      break;
+    case PART_FRAGMENT_SHADER:
+      appendKey(key, desc.fragmentShader);
+      appendKey(key, desc.layout);
+      break;
+    case PART_OUTPUT_INTERFACE:
+      appendKey(key, desc.blend);
+      break;
+    default:
+      assert(false);
+  }
+  appendKey(key, desc.renderPass);
+  appendKey(key, desc.subpass);
+  return key;
+}
+
+//----------------------------------------------------------------------------------------
+// A library holding one part: only the state that part reads is passed
+VkPipeline
+PipelineLibrary::compilePart(Part part, const GraphicsPipelineDesc& desc) const
+{
+  const FixedFunctionState state(desc);
+
+  VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+  libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+
+  // Retaining the link time optimisation info lets the background link optimise across
+  // the parts
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext = &libraryInfo;
+  pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR
+                       | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+  pipelineInfo.basePipelineIndex = -1;
+
+  VkShaderModule shaderModule                     = VK_NULL_HANDLE;
+  VkPipelineShaderStageCreateInfo shaderStageInfo = {};
+  switch (part)
+  {
+    case PART_VERTEX_INPUT:
+      libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+      pipelineInfo.pVertexInputState   = &state.vertexInput;
+      pipelineInfo.pInputAssemblyState = &state.inputAssembly;
+      break;
+    case PART_PRE_RASTERIZATION:
+      libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+      shaderModule      = createShaderModule(m_device, readFile(desc.vertexShader));
+      shaderStageInfo   = shaderStage(VK_SHADER_STAGE_VERTEX_BIT, shaderModule);
+      pipelineInfo.stageCount          = 1;
+      pipelineInfo.pStages             = &shaderStageInfo;
+      pipelineInfo.pViewportState      = &state.viewport;
+      pipelineInfo.pRasterizationState = &state.rasterization;
+      pipelineInfo.pDynamicState       = &state.dynamic;
+      pipelineInfo.layout              = desc.layout;
+      break;
+    case PART_FRAGMENT_SHADER:
+      libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+      shaderModule      = createShaderModule(m_device, readFile(desc.fragmentShader));
+      shaderStageInfo   = shaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, shaderModule);
+      pipelineInfo.stageCount         = 1;
+      pipelineInfo.pStages            = &shaderStageInfo;
+      pipelineInfo.pMultisampleState  = &state.multisample;
+      pipelineInfo.pDepthStencilState = &state.depthStencil;
+      pipelineInfo.layout             = desc.layout;
+      break;
+    case PART_OUTPUT_INTERFACE:
+      libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+      pipelineInfo.pColorBlendState  = &state.colorBlend;
+      pipelineInfo.pMultisampleState = &state.multisample;
+      break;
+    default:
+      assert(false);
+  }
+  if (part != PART_VERTEX_INPUT)
+  {
+    pipelineInfo.renderPass = desc.renderPass;
+    pipelineInfo.subpass    = desc.subpass;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VkResult result     = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(m_device, shaderModule, nullptr);
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error(
+      fmt::format("failed to compile {} pipeline library!", PART_NAMES[part]));
+  }
+  return pipeline;
+}
+
+//----------------------------------------------------------------------------------------
+// Returns VK_NULL_HANDLE if the link failed
+VkPipeline
+PipelineLibrary::link(
+  const VkPipeline* parts,
+  VkPipelineLayout layout,
+  bool optimize) const
+{
+  VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+  libraryInfo.sType        = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+  libraryInfo.libraryCount = PART_COUNT;
+  libraryInfo.pLibraries   = parts;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType             = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext             = &libraryInfo;
+  pipelineInfo.layout            = layout;
+  pipelineInfo.basePipelineIndex = -1;
+  if (optimize)
+  {
+    pipelineInfo.flags = VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  if (
+    vkCreateGraphicsPipelines(
+      m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)
+    != VK_SUCCESS)
+  {
+    return VK_NULL_HANDLE;
+  }
+  return pipeline;
+}
+
+//----------------------------------------------------------------------------------------
+VkPipeline
+PipelineLibrary::createMonolithic(const GraphicsPipelineDesc& desc) const
+{
+  const FixedFunctionState state(desc);
+
+  VkShaderModule vertShaderModule =
+    createShaderModule(m_device, readFile(desc.vertexShader));
+  VkShaderModule fragShaderModule =
+    createShaderModule(m_device, readFile(desc.fragmentShader));
+  const VkPipelineShaderStageCreateInfo shaderStages[] = {
+    shaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule),
+    shaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule)};
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount          = 2;
+  pipelineInfo.pStages             = shaderStages;
+  pipelineInfo.pVertexInputState   = &state.vertexInput;
+  pipelineInfo.pInputAssemblyState = &state.inputAssembly;
+  pipelineInfo.pViewportState      = &state.viewport;
+  pipelineInfo.pRasterizationState = &state.rasterization;
+  pipelineInfo.pMultisampleState   = &state.multisample;
+  pipelineInfo.pDepthStencilState  = &state.depthStencil;
+  pipelineInfo.pColorBlendState    = &state.colorBlend;
+  pipelineInfo.pDynamicState       = &state.dynamic;
+  pipelineInfo.layout              = desc.layout;
+  pipelineInfo.renderPass          = desc.renderPass;
+  pipelineInfo.subpass             = desc.subpass;
+  pipelineInfo.basePipelineIndex   = -1;
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VkResult result     = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+
+  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create graphics pipeline!");
+  }
+  return pipeline;
+}
+
+//----------------------------------------------------------------------------------------
+void
+PipelineLibrary::compile(const std::vector<GraphicsPipelineDesc>& descs)
+{
+  if (!m_librariesEnabled)
+  {
+    return;
+  }
+
+  // Every part not compiled yet, once even if several descs share it
+  std::vector<std::vector<uint8_t>> keys;
+  std::vector<std::pair<Part, const GraphicsPipelineDesc*>> tasks;
+  for (const GraphicsPipelineDesc& desc : descs)
+  {
+    for (uint32_t part = 0; part < PART_COUNT; ++part)
+    {
+      std::vector<uint8_t> key = partKey(Part(part), desc);
+      if (
+        m_parts.find(key) == m_parts.end()
+        && std::find(keys.begin(), keys.end(), key) == keys.end())
+      {
+        keys.push_back(std::move(key));
+        tasks.push_back({Part(part), &desc});
+      }
+    }
+  }
+  if (tasks.empty())
+  {
+    return;
+  }
+
+  const auto taskCount = static_cast<uint32_t>(tasks.size());
+  std::vector<VkPipeline> compiled(taskCount, VK_NULL_HANDLE);
+  std::vector<double> compileTimes(taskCount, 0.0);
+  const Clock::time_point start = Clock::now();
+  try
+  {
+    const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    ThreadPool pool(std::min(taskCount, threadCount));
+    pool.parallelFor(taskCount, [&](uint32_t task) {
+      const Clock::time_point taskStart = Clock::now();
+      compiled[task]     = compilePart(tasks[task].first, *tasks[task].second);
+      compileTimes[task] = millisecondsSince(taskStart);
+    });
+  }
+  catch (...)
+  {
+    for (VkPipeline pipeline : compiled)
+    {
+      vkDestroyPipeline(m_device, pipeline, nullptr);
+    }
+    throw;
+  }
+  m_compileWallTime += millisecondsSince(start);
+
+  for (uint32_t task = 0; task < taskCount; ++task)
+  {
+    m_parts.emplace(std::move(keys[task]), compiled[task]);
+    m_partTimeSum += compileTimes[task];
+  }
+  m_partCount += taskCount;
+}
+
+//----------------------------------------------------------------------------------------
+PipelineHandle
+PipelineLibrary::create(const GraphicsPipelineDesc& desc)
+{
+  assert(m_device != VK_NULL_HANDLE);
+
+  const auto handle = static_cast<PipelineHandle>(m_pipelines.size());
+  Pipeline pipeline = {};
+  if (!m_librariesEnabled)
+  {
+    const Clock::time_point start = Clock::now();
+    pipeline.pipeline             = createMonolithic(desc);
+    pipeline.optimized            = true;
+    m_monolithicTimeSum += millisecondsSince(start);
+    ++m_monolithicCount;
+    m_pipelines.push_back(pipeline);
+    return handle;
+  }
+
+  compile({desc});
+  for (uint32_t part = 0; part < PART_COUNT; ++part)
+  {
+    pipeline.parts[part] = m_parts.at(partKey(Part(part), desc));
+  }
+
+  const Clock::time_point start = Clock::now();
+  pipeline.pipeline             = link(pipeline.parts, desc.layout, false);
+  if (pipeline.pipeline == VK_NULL_HANDLE)
+  {
+    throw std::runtime_error("failed to link graphics pipeline!");
+  }
+  const double linkTime = millisecondsSince(start);
+  m_fastLinkTimeSum += linkTime;
+  m_fastLinkTimeMax = std::max(m_fastLinkTimeMax, linkTime);
+  ++m_fastLinkCount;
+  m_pipelines.push_back(pipeline);
+
+  LinkJob job = {};
+  job.handle  = handle;
+  std::copy(std::begin(pipeline.parts), std::end(pipeline.parts), job.parts);
+  job.layout = desc.layout;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_linkJobs.push_back(job);
+  }
+  m_wake.notify_one();
+  return handle;
+}
+
+//----------------------------------------------------------------------------------------
+// Links queued by create() one at a time, with link time optimisation, until cleanup()
+void
+PipelineLibrary::threadLoop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_wake.wait(lock, [this] { return m_stop || !m_linkJobs.empty(); });
+    if (m_stop)
+    {
+      return;
+    }
+    const LinkJob job = m_linkJobs.front();
+    m_linkJobs.pop_front();
+    lock.unlock();
+
+    const Clock::time_point start = Clock::now();
+    LinkResult result             = {};
+    result.handle                 = job.handle;
+    result.pipeline               = link(job.parts, job.layout, true);
+    result.milliseconds           = millisecondsSince(start);
+
+    lock.lock();
+    m_linkResults.push_back(result);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+bool
+PipelineLibrary::update()
+{
+  if (!m_librariesEnabled)
+  {
+    return false;
+  }
+
+  std::vector<LinkResult> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_linkResults);
+  }
+
+  bool changed = false;
+  for (const LinkResult& result : results)
+  {
+    Pipeline& pipeline = m_pipelines[result.handle];
+    if (result.pipeline == VK_NULL_HANDLE)
+    {
+      fmt::print(
+        "WARNING: failed to optimise pipeline {}, the fast linked one stays\n",
+        result.handle);
+      continue;
+    }
+
+    // The frames in flight may still draw with the fast linked pipeline
+    m_deletionQueue->push([device = m_device, fastLinked = pipeline.pipeline]() {
+      vkDestroyPipeline(device, fastLinked, nullptr);
+    });
+    pipeline.pipeline  = result.pipeline;
+    pipeline.optimized = true;
+    m_optimizedLinkTimeSum += result.milliseconds;
+    ++m_optimizedLinkCount;
+    changed = true;
+  }
+  return changed;
+}
+
+//----------------------------------------------------------------------------------------
+// What creating pipelines cost: with libraries, the parts' compile time summed and from
+// the first start to the last end (in parallel), then each link on its own
+void
+PipelineLibrary::printSummary() const
+{
+  if (m_monolithicCount > 0)
+  {
+    fmt::print(
+      "pipelines: {} compiled whole, {:.2f} ms each\n",
+      m_monolithicCount,
+      m_monolithicTimeSum / m_monolithicCount);
+  }
+  if (m_fastLinkCount == 0)
+  {
+    return;
+  }
+  fmt::print(
+    "pipelines: {} parts compiled in {:.2f} ms ({:.2f} ms of compiling in parallel), "
+    "{} fast links of {:.3f} ms (at most {:.3f} ms)",
+    m_partCount,
+    m_compileWallTime,
+    m_partTimeSum,
+    m_fastLinkCount,
+    m_fastLinkTimeSum / m_fastLinkCount,
+    m_fastLinkTimeMax);
+  if (m_optimizedLinkCount > 0)
+  {
+    fmt::print(
+      ", {} optimised in the background in {:.2f} ms each",
+      m_optimizedLinkCount,
+      m_optimizedLinkTimeSum / m_optimizedLinkCount);
+  }
+  fmt::print("\n");
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DeletionQueue;
+
+using PipelineHandle = uint32_t;
+
+constexpr PipelineHandle INVALID_PIPELINE = ~0u;
+
+//----------------------------------------------------------------------------------------
+// A graphics pipeline, by the four parts VK_EXT_graphics_pipeline_library compiles on
+// their own. Viewport and scissor are always dynamic, one colour attachment, no depth
+// test (the subpass may still have a depth attachment)
+struct GraphicsPipelineDesc
+{
+  // Vertex input
+  std::vector<VkVertexInputBindingDescription> bindings;
+  std::vector<VkVertexInputAttributeDescription> attributes;
+  VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  // Pre-rasterization
+  std::string vertexShader;    // SPIR-V file
+  VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+  VkCullModeFlags cullMode  = VK_CULL_MODE_BACK_BIT;
+  VkFrontFace frontFace     = VK_FRONT_FACE_CLOCKWISE;
+
+  // Fragment shader
+  std::string fragmentShader;    // SPIR-V file
+
+  // Fragment output interface
+  VkPipelineColorBlendAttachmentState blend = {};
+
+  // Shared by the parts
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  uint32_t subpass        = 0;
+};
+
+//----------------------------------------------------------------------------------------
+// Creates graphics pipelines without a first use stall, with VK_EXT_graphics_pipeline_
+// library when the device has it.
+//  - every part (vertex input, pre-rasterization, fragment shader, output interface) is
+//    compiled once as a library, the missing parts of a pipeline in parallel, and shared
+//    by every pipeline using the same state; compile() does it ahead of time
+//  - create() links the parts without link time optimisation, which is cheap, and queues
+//    an optimised link on a background thread; update() swaps the optimised pipeline in
+//    once it is done and retires the fast linked one
+// Without the extension create() compiles the whole pipeline in one go, as before.
+// Only the thread that creates and swaps pipelines may use this class; the background
+// thread only links.
+//----------------------------------------------------------------------------------------
+class PipelineLibrary
+{
+  enum Part : uint32_t
+  {
+    PART_VERTEX_INPUT,
+    PART_PRE_RASTERIZATION,
+    PART_FRAGMENT_SHADER,
+    PART_OUTPUT_INTERFACE,
+    PART_COUNT
+  };
+
+  struct Pipeline
+  {
+    VkPipeline pipeline          = VK_NULL_HANDLE;    // what pipeline() hands out
+    VkPipeline parts[PART_COUNT] = {};
+    bool optimized               = false;
+  };
+
+  // An optimised link of a pipeline's parts (which outlive the thread)
+  struct LinkJob
+  {
+    PipelineHandle handle        = INVALID_PIPELINE;
+    VkPipeline parts[PART_COUNT] = {};
+    VkPipelineLayout layout      = VK_NULL_HANDLE;
+  };
+
+  struct LinkResult
+  {
+    PipelineHandle handle = INVALID_PIPELINE;
+    VkPipeline pipeline   = VK_NULL_HANDLE;
+    double milliseconds   = 0.0;
+  };
+
+  VkDevice m_device              = VK_NULL_HANDLE;
+  DeletionQueue* m_deletionQueue = nullptr;
+  bool m_librariesEnabled        = false;
+  bool m_fastLinking             = false;    // the driver says linking is cheap
+
+  std::map<std::vector<uint8_t>, VkPipeline> m_parts;    // by the state compiled in
+  std::vector<Pipeline> m_pipelines;
+
+  // Optimised links, done one at a time on m_thread
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<LinkJob> m_linkJobs;
+  std::vector<LinkResult> m_linkResults;
+  bool m_stop = false;
+
+  // Timings, ms
+  uint32_t m_partCount          = 0;
+  double m_partTimeSum          = 0.0;    // each part's own compile time
+  double m_compileWallTime      = 0.0;    // the parallel compiles, start to end
+  uint32_t m_fastLinkCount      = 0;
+  double m_fastLinkTimeSum      = 0.0;
+  double m_fastLinkTimeMax      = 0.0;
+  uint32_t m_optimizedLinkCount = 0;
+  double m_optimizedLinkTimeSum = 0.0;
+  uint32_t m_monolithicCount    = 0;
+  double m_monolithicTimeSum    = 0.0;
+
+private:
+  std::vector<uint8_t> partKey(Part part, const GraphicsPipelineDesc& desc) const;
+  // Thread safe: only touches the device
+  VkPipeline compilePart(Part part, const GraphicsPipelineDesc& desc) const;
+  VkPipeline link(const VkPipeline* parts, VkPipelineLayout layout, bool optimize) const;
+  VkPipeline createMonolithic(const GraphicsPipelineDesc& desc) const;
+  void threadLoop();
+
+public:
+  PipelineLibrary() = default;
+  ~PipelineLibrary() { cleanup(); }
+
+  PipelineLibrary(const PipelineLibrary&) = delete;
+  PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+  // Fills `libraryFeatures` to chain into VkDeviceCreateInfo, with
+  // VK_KHR_pipeline_library and VK_EXT_graphics_pipeline_library enabled. Returns false
+  // if the device lacks them
+  static bool isSupported(
+    VkPhysicalDevice physicalDevice,
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& libraryFeatures);
+
+  // librariesEnabled: the device was created as isSupported() says, otherwise every
+  // pipeline is compiled whole. Fast linked pipelines are retired through deletionQueue
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    bool librariesEnabled,
+    DeletionQueue& deletionQueue);
+  // Stops the background thread; the device must be idle
+  void cleanup();
+
+  bool librariesEnabled() const { return m_librariesEnabled; }
+
+  // Compiles the parts of every desc that aren't yet, in parallel (a no-op without the
+  // extension), so that create() only links
+  void compile(const std::vector<GraphicsPipelineDesc>& descs);
+  // Usable straight away; the parts are compiled first if compile() didn't
+  PipelineHandle create(const GraphicsPipelineDesc& desc);
+  // The latest pipeline of handle, which changes when update() swaps one in
+  VkPipeline pipeline(PipelineHandle handle) const
+  {
+    return m_pipelines[handle].pipeline;
+  }
+
+  // Once a frame: swaps in the optimised links that are done. Returns true if any
+  // pipeline changed, command buffers binding it must be recorded again
+  bool update();
+
+  void printSummary() const;
+};
+
+//----------------------------------------------------------------------------------------
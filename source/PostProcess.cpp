@@ -0,0 +1,765 @@
+#include <fmt/format.h>
+
+#include "PostProcess.h"
+#include "DeletionQueue.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <cassert>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr char VERTEX_SHADER[]           = "shaders/fullscreen_vert.spv";
+constexpr char SAMPLED_FRAGMENT_SHADER[] = "shaders/post_frag.spv";
+constexpr char SUBPASS_FRAGMENT_SHADER[] = "shaders/post_subpass_frag.spv";
+
+// Bytes per texel of SCENE_FORMAT and of the 8 bit swap chain formats, for the traffic
+// estimate
+constexpr uint64_t SCENE_TEXEL_SIZE  = 8;
+constexpr uint64_t OUTPUT_TEXEL_SIZE = 4;
+
+// Mirrors the push constants of post.frag
+struct PushConstants
+{
+  float invExtent[2];    // pixel to 0..1 coordinates
+};
+
+//----------------------------------------------------------------------------------------
+// Lazily allocated memory where the device has it: a tiling GPU only backs it with
+// memory if the attachment ever has to leave the tile
+static uint32_t
+findTransientMemoryType(
+  VkPhysicalDevice physicalDevice,
+  uint32_t typeFilter,
+  bool& lazilyAllocated)
+{
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+  {
+    if (
+      (typeFilter & (1u << i))
+      && (memProperties.memoryTypes[i].propertyFlags
+          & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+    {
+      lazilyAllocated = true;
+      return i;
+    }
+  }
+  lazilyAllocated = false;
+  return findMemoryType(physicalDevice, typeFilter, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+//----------------------------------------------------------------------------------------
+const char*
+PostProcess::effectName(uint32_t effect)
+{
+  switch (effect)
+  {
+    case 0: return "tonemap";
+    case 1: return "colour grade";
+    case 2: return "vignette";
+  }
+  return "?";
+}
+
+//----------------------------------------------------------------------------------------
+PostProcessMode
+PostProcess::parseMode(const std::string& name)
+{
+  if (name == "subpasses")
+  {
+    return PostProcessMode::Subpasses;
+  }
+  if (name == "passes")
+  {
+    return PostProcessMode::Passes;
+  }
+  throw std::runtime_error(fmt::format("unknown post-processing mode: {}", name));
+}
+
+//----------------------------------------------------------------------------------------
+const char*
+PostProcess::modeName(PostProcessMode mode)
+{
+  switch (mode)
+  {
+    case PostProcessMode::Off: return "off";
+    case PostProcessMode::Subpasses: return "subpasses";
+    case PostProcessMode::Passes: return "passes";
+  }
+  return "?";
+}
+
+//----------------------------------------------------------------------------------------
+// Attachment i is written by subpass i and read by subpass i + 1 as its input
+// attachment, the last one is the swap chain image. BY_REGION dependencies only order
+// each pixel after the same pixel of the previous subpass, which is all an input
+// attachment can read, so a tiler runs the whole chain tile by tile
+VkRenderPass
+PostProcess::createSubpassRenderPass(
+  VkDevice device,
+  VkFormat outputFormat,
+  VkFormat depthFormat)
+{
+  std::vector<VkAttachmentDescription> attachments(EFFECT_COUNT + 1);
+  for (uint32_t i = 0; i < attachments.size(); ++i)
+  {
+    VkAttachmentDescription& attachment = attachments[i];
+    attachment.format         = i == 0 ? SCENE_FORMAT : outputFormat;
+    attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;     // fully overwritten
+    attachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;    // consumed on chip
+    attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  }
+  attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+  // The swap chain image, as in the single subpass render pass: the render graph
+  // transitions it into and out of the pass
+  VkAttachmentDescription& output = attachments.back();
+  output.storeOp                  = VK_ATTACHMENT_STORE_OP_STORE;
+  output.initialLayout            = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  output.finalLayout              = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  // The scene's depth goes after it, a render graph image as well, only the scene's
+  // subpass uses it
+  VkAttachmentReference depthRef = {};
+  if (depthFormat != VK_FORMAT_UNDEFINED)
+  {
+    VkAttachmentDescription depth = {};
+    depth.format                  = depthFormat;
+    depth.samples                 = VK_SAMPLE_COUNT_1_BIT;
+    depth.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth.storeOp                 = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth.initialLayout           = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth.finalLayout             = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthRef = {EFFECT_COUNT + 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    attachments.push_back(depth);
+  }
+
+  std::vector<VkAttachmentReference> colorRefs(EFFECT_COUNT + 1);
+  std::vector<VkAttachmentReference> inputRefs(EFFECT_COUNT);
+  std::vector<VkSubpassDescription> subpasses(EFFECT_COUNT + 1);
+  for (uint32_t i = 0; i < subpasses.size(); ++i)
+  {
+    colorRefs[i] = {i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription& subpass = subpasses[i];
+    subpass.pipelineBindPoint     = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount  = 1;
+    subpass.pColorAttachments     = &colorRefs[i];
+    if (i > 0)
+    {
+      inputRefs[i - 1]             = {i - 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+      subpass.inputAttachmentCount = 1;
+      subpass.pInputAttachments    = &inputRefs[i - 1];
+    }
+  }
+  if (depthFormat != VK_FORMAT_UNDEFINED)
+  {
+    subpasses[0].pDepthStencilAttachment = &depthRef;
+  }
+
+  // The transient attachments are reused every frame: their first writes wait for the
+  // last frame's reads and writes
+  std::vector<VkSubpassDependency> dependencies(EFFECT_COUNT + 1);
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstAccessMask =
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  for (uint32_t i = 1; i < dependencies.size(); ++i)
+  {
+    VkSubpassDependency& dependency = dependencies[i];
+    dependency.srcSubpass           = i - 1;
+    dependency.dstSubpass           = i;
+    dependency.srcStageMask         = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask         = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependency.srcAccessMask        = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask        = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependency.dependencyFlags      = VK_DEPENDENCY_BY_REGION_BIT;
+  }
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount        = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments           = attachments.data();
+  renderPassInfo.subpassCount           = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses             = subpasses.data();
+  renderPassInfo.dependencyCount        = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies          = dependencies.data();
+
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create post-processing render pass!");
+  }
+  return renderPass;
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  PipelineLayoutCache& layoutCache,
+  PostProcessMode mode,
+  VkFormat outputFormat,
+  VkRenderPass sceneRenderPass)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+  assert(mode != PostProcessMode::Off);
+
+  m_physicalDevice = physicalDevice;
+  m_device         = device;
+  m_mode           = mode;
+  m_outputFormat   = outputFormat;
+
+  if (m_mode == PostProcessMode::Passes)
+  {
+    createEffectRenderPass();
+
+    // Every effect reads its own pixel with texelFetch, which ignores the filter
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType               = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter           = VK_FILTER_NEAREST;
+    samplerInfo.minFilter           = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode          = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create post-processing sampler!");
+    }
+  }
+  createPipelines(
+    m_mode == PostProcessMode::Subpasses ? sceneRenderPass : m_effectRenderPass,
+    layoutCache);
+
+  fmt::print("post-processing: {} effects as {}\n", EFFECT_COUNT, modeName(m_mode));
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  for (VkPipeline& pipeline : m_pipelines)
+  {
+    vkDestroyPipeline(m_device, pipeline, nullptr);
+    pipeline = VK_NULL_HANDLE;
+  }
+  vkDestroySampler(m_device, m_sampler, nullptr);
+  vkDestroyRenderPass(m_device, m_effectRenderPass, nullptr);
+  m_sampler          = VK_NULL_HANDLE;
+  m_effectRenderPass = VK_NULL_HANDLE;
+  m_layout           = nullptr;
+
+  m_mode   = PostProcessMode::Off;
+  m_device = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+// Writes the swap chain format, every pixel: nothing to load
+void
+PostProcess::createEffectRenderPass()
+{
+  VkAttachmentDescription colorAttachment = {};
+  colorAttachment.format                  = m_outputFormat;
+  colorAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout           = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.finalLayout             = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef = {};
+  colorAttachmentRef.attachment            = 0;
+  colorAttachmentRef.layout                = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments    = &colorAttachmentRef;
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount        = 1;
+  renderPassInfo.pAttachments           = &colorAttachment;
+  renderPassInfo.subpassCount           = 1;
+  renderPassInfo.pSubpasses             = &subpass;
+  if (
+    vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_effectRenderPass)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create post-processing render pass!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// One pipeline per effect from the same shaders, the effect picked by a specialization
+// constant. Subpasses: effect i runs in subpass i + 1 of the scene render pass
+void
+PostProcess::createPipelines(
+  VkRenderPass sceneRenderPass,
+  PipelineLayoutCache& layoutCache)
+{
+  const char* fragmentShader = m_mode == PostProcessMode::Subpasses
+                                 ? SUBPASS_FRAGMENT_SHADER
+                                 : SAMPLED_FRAGMENT_SHADER;
+  const std::vector<char> vertShaderCode = readFile(VERTEX_SHADER);
+  const std::vector<char> fragShaderCode = readFile(fragmentShader);
+  const ShaderReflection vertShader      = reflectShader(vertShaderCode, VERTEX_SHADER);
+  const ShaderReflection fragShader      = reflectShader(fragShaderCode, fragmentShader);
+  if (fragShader.pushConstantSize != sizeof(PushConstants))
+  {
+    throw std::runtime_error(fmt::format(
+      "{} declares {} bytes of push constants, the C++ side pushes {}",
+      fragmentShader,
+      fragShader.pushConstantSize,
+      sizeof(PushConstants)));
+  }
+  m_layout = &layoutCache.get({&vertShader, &fragShader});
+  if (m_layout->setLayouts.size() != 1)
+  {
+    throw std::runtime_error(
+      fmt::format("{} must use exactly descriptor set 0", fragmentShader));
+  }
+
+  VkShaderModule vertShaderModule = createShaderModule(m_device, vertShaderCode);
+  VkShaderModule fragShaderModule = createShaderModule(m_device, fragShaderCode);
+
+  // Full screen triangle from gl_VertexIndex, no vertex input
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates    = dynamicStates;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth   = 1.0f;
+  rasterizer.cullMode    = VK_CULL_MODE_NONE;
+  rasterizer.frontFace   = VK_FRONT_FACE_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading     = 1.0f;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+  colorBlendAttachment.colorWriteMask
+    = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+      | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable = VK_FALSE;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable   = VK_FALSE;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments    = &colorBlendAttachment;
+
+  const bool subpassed = m_mode == PostProcessMode::Subpasses;
+
+  VkSpecializationMapEntry specializationEntry = {0, 0, sizeof(int32_t)};
+  int32_t effects[EFFECT_COUNT];
+  VkSpecializationInfo specializations[EFFECT_COUNT]            = {};
+  VkPipelineShaderStageCreateInfo shaderStages[EFFECT_COUNT][2] = {};
+  VkGraphicsPipelineCreateInfo pipelineInfos[EFFECT_COUNT]      = {};
+  for (uint32_t effect = 0; effect < EFFECT_COUNT; ++effect)
+  {
+    effects[effect] = static_cast<int32_t>(effect);
+
+    VkSpecializationInfo& specialization = specializations[effect];
+    specialization.mapEntryCount         = 1;
+    specialization.pMapEntries           = &specializationEntry;
+    specialization.dataSize              = sizeof(int32_t);
+    specialization.pData                 = &effects[effect];
+
+    VkPipelineShaderStageCreateInfo* stages = shaderStages[effect];
+    stages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertShaderModule;
+    stages[0].pName  = "main";
+    stages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragShaderModule;
+    stages[1].pName  = "main";
+
+    stages[1].pSpecializationInfo = &specialization;
+
+    VkGraphicsPipelineCreateInfo& pipelineInfo = pipelineInfos[effect];
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 2;
+    pipelineInfo.pStages             = stages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_layout->pipelineLayout;
+    pipelineInfo.renderPass          = sceneRenderPass;
+    pipelineInfo.subpass             = subpassed ? effect + 1 : 0;
+    pipelineInfo.basePipelineIndex   = -1;
+  }
+
+  VkResult result = vkCreateGraphicsPipelines(
+    m_device, VK_NULL_HANDLE, EFFECT_COUNT, pipelineInfos, nullptr, m_pipelines);
+
+  vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create post-processing pipelines!");
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// One set per effect, reading inputs[effect]
+void
+PostProcess::createDescriptorSets(
+  PostProcessTargets& targets,
+  const std::vector<VkImageView>& inputs,
+  VkDescriptorType type,
+  VkImageLayout layout)
+{
+  assert(inputs.size() == EFFECT_COUNT);
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type                 = type;
+  poolSize.descriptorCount      = EFFECT_COUNT;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount              = 1;
+  poolInfo.pPoolSizes                 = &poolSize;
+  poolInfo.maxSets                    = EFFECT_COUNT;
+  if (
+    vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &targets.descriptorPool)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+
+  const std::vector<VkDescriptorSetLayout> setLayouts(
+    EFFECT_COUNT, m_layout->setLayouts[0]);
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool              = targets.descriptorPool;
+  allocInfo.descriptorSetCount          = EFFECT_COUNT;
+  allocInfo.pSetLayouts                 = setLayouts.data();
+  targets.descriptorSets.resize(EFFECT_COUNT);
+  if (
+    vkAllocateDescriptorSets(m_device, &allocInfo, targets.descriptorSets.data())
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate descriptor sets!");
+  }
+
+  std::vector<VkDescriptorImageInfo> imageInfos(EFFECT_COUNT);
+  std::vector<VkWriteDescriptorSet> writes(EFFECT_COUNT);
+  for (uint32_t effect = 0; effect < EFFECT_COUNT; ++effect)
+  {
+    imageInfos[effect] = {m_sampler, inputs[effect], layout};
+
+    VkWriteDescriptorSet& write = writes[effect];
+    write.sType                 = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet                = targets.descriptorSets[effect];
+    write.dstBinding            = 0;
+    write.descriptorType        = type;
+    write.descriptorCount       = 1;
+    write.pImageInfo            = &imageInfos[effect];
+  }
+  vkUpdateDescriptorSets(
+    m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::createAttachments(PostProcessTargets& targets, VkExtent2D extent)
+{
+  assert(m_mode == PostProcessMode::Subpasses);
+
+  targets.images.resize(EFFECT_COUNT);
+  targets.imageMemory.resize(EFFECT_COUNT);
+  targets.imageViews.resize(EFFECT_COUNT);
+  targets.memorySize = 0;
+  for (uint32_t i = 0; i < EFFECT_COUNT; ++i)
+  {
+    const VkFormat format = i == 0 ? SCENE_FORMAT : m_outputFormat;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+    imageInfo.format            = format;
+    imageInfo.extent            = {extent.width, extent.height, 1};
+    imageInfo.mipLevels         = 1;
+    imageInfo.arrayLayers       = 1;
+    imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                      | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
+                      | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &targets.images[i]) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create post-processing attachment!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device, targets.images[i], &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memRequirements.size;
+    allocInfo.memoryTypeIndex      = findTransientMemoryType(
+      m_physicalDevice, memRequirements.memoryTypeBits, targets.lazilyAllocated);
+    if (
+      allocateDeviceMemory(m_device, allocInfo, targets.imageMemory[i]) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to allocate post-processing attachment memory!");
+    }
+    vkBindImageMemory(m_device, targets.images[i], targets.imageMemory[i], 0);
+    targets.memorySize += memRequirements.size;
+
+    VkImageViewCreateInfo viewInfo           = {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = targets.images[i];
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = format;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+    if (
+      vkCreateImageView(m_device, &viewInfo, nullptr, &targets.imageViews[i])
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create image views!");
+    }
+  }
+
+  createDescriptorSets(
+    targets,
+    targets.imageViews,
+    VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::createPassTargets(
+  PostProcessTargets& targets,
+  const std::vector<VkImageView>& inputs,
+  VkExtent2D extent)
+{
+  assert(m_mode == PostProcessMode::Passes);
+  assert(inputs.size() == EFFECT_COUNT);
+
+  targets.framebuffers.resize(EFFECT_COUNT - 1);
+  for (uint32_t effect = 0; effect + 1 < EFFECT_COUNT; ++effect)
+  {
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass              = m_effectRenderPass;
+    framebufferInfo.attachmentCount         = 1;
+    framebufferInfo.pAttachments            = &inputs[effect + 1];
+    framebufferInfo.width                   = extent.width;
+    framebufferInfo.height                  = extent.height;
+    framebufferInfo.layers                  = 1;
+    if (
+      vkCreateFramebuffer(
+        m_device, &framebufferInfo, nullptr, &targets.framebuffers[effect])
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
+  }
+
+  createDescriptorSets(
+    targets,
+    inputs,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::retireTargets(
+  PostProcessTargets& targets,
+  DeletionQueue& deletionQueue) const
+{
+  deletionQueue.push([device         = m_device,
+                      framebuffers   = std::move(targets.framebuffers),
+                      descriptorPool = targets.descriptorPool,
+                      imageViews     = std::move(targets.imageViews),
+                      images         = std::move(targets.images),
+                      imageMemory    = std::move(targets.imageMemory)]() {
+    for (auto framebuffer : framebuffers)
+    {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    for (auto imageView : imageViews)
+    {
+      vkDestroyImageView(device, imageView, nullptr);
+    }
+    for (auto image : images)
+    {
+      vkDestroyImage(device, image, nullptr);
+    }
+    for (auto memory : imageMemory)
+    {
+      freeDeviceMemory(device, memory);
+    }
+  });
+  targets = {};
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::draw(
+  VkCommandBuffer commandBuffer,
+  uint32_t effect,
+  const PostProcessTargets& targets,
+  VkExtent2D extent) const
+{
+  VkViewport viewport = {};
+  viewport.width      = static_cast<float>(extent.width);
+  viewport.height     = static_cast<float>(extent.height);
+  viewport.minDepth   = 0.0f;
+  viewport.maxDepth   = 1.0f;
+  VkRect2D scissor    = {{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  PushConstants constants = {};
+  constants.invExtent[0]  = 1.0f / extent.width;
+  constants.invExtent[1]  = 1.0f / extent.height;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[effect]);
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_GRAPHICS,
+    m_layout->pipelineLayout,
+    0,
+    1,
+    &targets.descriptorSets[effect],
+    0,
+    nullptr);
+  vkCmdPushConstants(
+    commandBuffer,
+    m_layout->pipelineLayout,
+    m_layout->pushConstantStages,
+    0,
+    sizeof(constants),
+    &constants);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::recordSubpasses(
+  VkCommandBuffer commandBuffer,
+  const PostProcessTargets& targets,
+  VkExtent2D extent) const
+{
+  assert(m_mode == PostProcessMode::Subpasses);
+
+  // The scene's subpass executed secondaries, which leave no dynamic state behind
+  for (uint32_t effect = 0; effect < EFFECT_COUNT; ++effect)
+  {
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    draw(commandBuffer, effect, targets, extent);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+PostProcess::recordPass(
+  VkCommandBuffer commandBuffer,
+  uint32_t effect,
+  const PostProcessTargets& targets,
+  VkFramebuffer framebuffer,
+  VkExtent2D extent) const
+{
+  assert(m_mode == PostProcessMode::Passes);
+
+  VkRenderPassBeginInfo renderPassInfo = {};
+  renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass            = m_effectRenderPass;
+  renderPassInfo.framebuffer           = framebuffer;
+  renderPassInfo.renderArea.offset     = {0, 0};
+  renderPassInfo.renderArea.extent     = extent;
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  draw(commandBuffer, effect, targets, extent);
+  vkCmdEndRenderPass(commandBuffer);
+}
+
+//----------------------------------------------------------------------------------------
+uint64_t
+PostProcess::estimatedTraffic(VkExtent2D extent) const
+{
+  const uint64_t pixels = uint64_t(extent.width) * extent.height;
+  if (m_mode == PostProcessMode::Subpasses)
+  {
+    return pixels * OUTPUT_TEXEL_SIZE;    // only the final image leaves the chip
+  }
+  // The scene is stored and read back, so is every effect's result but the last
+  const uint64_t intermediates = 2 * (EFFECT_COUNT - 1) * OUTPUT_TEXEL_SIZE;
+  return pixels * (2 * SCENE_TEXEL_SIZE + intermediates + OUTPUT_TEXEL_SIZE);
+}
+
+//----------------------------------------------------------------------------------------
+VkDeviceSize
+PostProcess::committedMemory(const PostProcessTargets& targets) const
+{
+  if (!targets.lazilyAllocated)
+  {
+    return targets.memorySize;
+  }
+
+  VkDeviceSize committed = 0;
+  for (VkDeviceMemory memory : targets.imageMemory)
+  {
+    VkDeviceSize bytes = 0;
+    vkGetDeviceMemoryCommitment(m_device, memory, &bytes);
+    committed += bytes;
+  }
+  return committed;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class DeletionQueue;
+
+//----------------------------------------------------------------------------------------
+enum class PostProcessMode
+{
+  Off,
+  Subpasses,    // the effects are later subpasses of the scene render pass
+  Passes        // each effect is a render graph pass of its own
+};
+
+// Per window: whatever the chain needs besides the swap chain image
+struct PostProcessTargets
+{
+  // Subpasses: transient attachments (the scene, then every effect's result but the
+  // last), sized like the swap chain
+  std::vector<VkImage> images;
+  std::vector<VkDeviceMemory> imageMemory;
+  std::vector<VkImageView> imageViews;
+  VkDeviceSize memorySize = 0;
+  bool lazilyAllocated    = false;
+
+  // Each effect's input; passes also have each effect's framebuffer but the last one's
+  // (which writes the swap chain image)
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> descriptorSets;
+  std::vector<VkFramebuffer> framebuffers;
+};
+
+//----------------------------------------------------------------------------------------
+// Tonemap, colour grade and vignette, each a full screen triangle reading the previous
+// result at its own pixel, run one of two ways:
+//  - subpasses: the scene render pass gets one subpass per effect, each reading the
+//    previous subpass's colour attachment as an input attachment with a BY_REGION
+//    dependency. The intermediate attachments are transient, in lazily allocated memory
+//    where the device has it, so a tiling GPU can keep them on chip and only ever
+//    writes the final image to memory
+//  - passes: the fallback, every effect is a render pass that samples the previous
+//    result, which the render graph stores, transitions and aliases like any other
+//    transient image
+// The scene is drawn in SCENE_FORMAT (HDR) either way, the effects' results in the
+// swap chain format.
+//----------------------------------------------------------------------------------------
+class PostProcess
+{
+public:
+  static constexpr VkFormat SCENE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+  static constexpr uint32_t EFFECT_COUNT = 3;
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkDevice m_device                 = VK_NULL_HANDLE;
+  PostProcessMode m_mode            = PostProcessMode::Off;
+  VkFormat m_outputFormat           = VK_FORMAT_UNDEFINED;
+
+  const PipelineLayoutCache::Layout* m_layout = nullptr;    // owned by the layout cache
+  VkRenderPass m_effectRenderPass             = VK_NULL_HANDLE;    // passes only
+  VkSampler m_sampler                         = VK_NULL_HANDLE;    // passes only
+  VkPipeline m_pipelines[EFFECT_COUNT]        = {};
+
+private:
+  void createEffectRenderPass();
+  void createPipelines(VkRenderPass sceneRenderPass, PipelineLayoutCache& layoutCache);
+  void createDescriptorSets(
+    PostProcessTargets& targets,
+    const std::vector<VkImageView>& inputs,
+    VkDescriptorType type,
+    VkImageLayout layout);
+  void draw(
+    VkCommandBuffer commandBuffer,
+    uint32_t effect,
+    const PostProcessTargets& targets,
+    VkExtent2D extent) const;
+
+public:
+  // The scene render pass of the subpasses mode: the scene in subpass 0, then the
+  // effects, ending in outputFormat. A depthFormat other than VK_FORMAT_UNDEFINED adds
+  // the scene's depth attachment, after the swap chain image. The caller owns it
+  static VkRenderPass createSubpassRenderPass(
+    VkDevice device,
+    VkFormat outputFormat,
+    VkFormat depthFormat);
+
+  // sceneRenderPass: the scene's (subpasses: from createSubpassRenderPass()). The
+  // pipeline layout comes from layoutCache, which must outlive the chain
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    PipelineLayoutCache& layoutCache,
+    PostProcessMode mode,
+    VkFormat outputFormat,
+    VkRenderPass sceneRenderPass);
+  void cleanup();
+
+  static const char* effectName(uint32_t effect);
+  // "subpasses" or "passes" (throws std::runtime_error on anything else)
+  static PostProcessMode parseMode(const std::string& name);
+  static const char* modeName(PostProcessMode mode);
+
+  bool enabled() const { return m_mode != PostProcessMode::Off; }
+  PostProcessMode mode() const { return m_mode; }
+  // Passes: the render pass of every effect (a compatible one writes the swap chain)
+  VkRenderPass effectRenderPass() const { return m_effectRenderPass; }
+
+  // Subpasses: the transient attachments, with the swap chain. imageViews returns them
+  // in attachment order, the swap chain image goes after them (and the depth image, if
+  // any, after that)
+  void createAttachments(PostProcessTargets& targets, VkExtent2D extent);
+  // Passes: inputs are the scene and each effect's result but the last, as the render
+  // graph created them; the framebuffers write inputs[1..]
+  void createPassTargets(
+    PostProcessTargets& targets,
+    const std::vector<VkImageView>& inputs,
+    VkExtent2D extent);
+  // Destroyed once the frames in flight are done with them
+  void retireTargets(PostProcessTargets& targets, DeletionQueue& deletionQueue) const;
+
+  // Subpasses: record right after the scene's subpass, inside the render pass
+  void recordSubpasses(
+    VkCommandBuffer commandBuffer,
+    const PostProcessTargets& targets,
+    VkExtent2D extent) const;
+  // Passes: one effect's render pass, writing framebuffer
+  void recordPass(
+    VkCommandBuffer commandBuffer,
+    uint32_t effect,
+    const PostProcessTargets& targets,
+    VkFramebuffer framebuffer,
+    VkExtent2D extent) const;
+
+  // Estimated bytes of attachment and texture memory traffic per frame at extent, from
+  // the load and store ops, assuming transient attachments stay on chip
+  uint64_t estimatedTraffic(VkExtent2D extent) const;
+  // Memory actually committed to the transient attachments (lazily allocated memory
+  // only commits what the device needed; elsewhere this is their size)
+  VkDeviceSize committedMemory(const PostProcessTargets& targets) const;
+};
+
+//----------------------------------------------------------------------------------------
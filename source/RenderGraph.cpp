@@ -0,0 +1,863 @@
+#include <fmt/format.h>
+
+#include "RenderGraph.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr VkAccessFlags WRITE_ACCESS =
+  VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+  | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+  | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// Without a device, transient images are assumed to need this alignment
+constexpr VkDeviceSize ESTIMATED_IMAGE_ALIGNMENT = 64 * 1024;
+
+//----------------------------------------------------------------------------------------
+static VkDeviceSize
+alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+//----------------------------------------------------------------------------------------
+static VkDeviceSize
+estimatedTexelSize(VkFormat format)
+{
+  switch (format)
+  {
+    case VK_FORMAT_R8_UNORM: return 1;
+    case VK_FORMAT_R16_SFLOAT: return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D24_UNORM_S8_UINT: return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+    default:
+      throw std::runtime_error(
+        fmt::format("no size estimate for image format {}!", static_cast<int>(format)));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+RenderResource
+RenderGraph::importImage(
+  const std::string& name,
+  const RenderImageDesc& desc,
+  const ResourceAccess& initial,
+  const ResourceAccess& final)
+{
+  Resource resource;
+  resource.name     = name;
+  resource.isImage  = true;
+  resource.imported = true;
+  resource.desc     = desc;
+  resource.initial  = initial;
+  resource.final    = final;
+  m_resources.push_back(resource);
+  return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+RenderResource
+RenderGraph::importBuffer(const std::string& name, const ResourceAccess& initial)
+{
+  Resource resource;
+  resource.name     = name;
+  resource.imported = true;
+  resource.initial  = initial;
+  m_resources.push_back(resource);
+  return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+RenderResource
+RenderGraph::createImage(const std::string& name, const RenderImageDesc& desc)
+{
+  Resource resource;
+  resource.name    = name;
+  resource.isImage = true;
+  resource.desc    = desc;
+  m_resources.push_back(resource);
+  return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::markOutput(RenderResource resource)
+{
+  m_resources[resource].output = true;
+}
+
+//----------------------------------------------------------------------------------------
+RenderPassHandle
+RenderGraph::addPass(const std::string& name, ExecuteFunction execute)
+{
+  Pass pass;
+  pass.name    = name;
+  pass.execute = std::move(execute);
+  m_passes.push_back(std::move(pass));
+  return static_cast<RenderPassHandle>(m_passes.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+// A pass uses each resource once: repeated uses are merged, so a pass that reads and
+// writes a resource gets one barrier for both
+void
+RenderGraph::addUse(
+  RenderPassHandle pass,
+  RenderResource resource,
+  const ResourceAccess& access,
+  bool write)
+{
+  assert(!m_compiled);
+  for (Use& use : m_passes[pass].uses)
+  {
+    if (use.resource == resource)
+    {
+      if (m_resources[resource].isImage && use.access.layout != access.layout)
+      {
+        throw std::runtime_error(fmt::format(
+          "pass {} uses {} in two layouts!",
+          m_passes[pass].name,
+          m_resources[resource].name));
+      }
+      use.access.stages |= access.stages;
+      use.access.access |= access.access;
+      use.read  = use.read || !write;
+      use.write = use.write || write;
+      return;
+    }
+  }
+  m_passes[pass].uses.push_back({resource, access, !write, write});
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::read(
+  RenderPassHandle pass,
+  RenderResource resource,
+  const ResourceAccess& access)
+{
+  addUse(pass, resource, access, false);
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::write(
+  RenderPassHandle pass,
+  RenderResource resource,
+  const ResourceAccess& access)
+{
+  addUse(pass, resource, access, true);
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::setSideEffects(RenderPassHandle pass)
+{
+  m_passes[pass].sideEffects = true;
+}
+
+//----------------------------------------------------------------------------------------
+// Walking backwards, a pass is live if it writes something still needed (or has side
+// effects), which makes everything it reads needed
+void
+RenderGraph::cullPasses()
+{
+  std::vector<bool> needed(m_resources.size());
+  for (size_t i = 0; i < m_resources.size(); ++i)
+  {
+    needed[i] = m_resources[i].output;
+  }
+
+  std::vector<bool> live(m_passes.size(), false);
+  for (size_t p = m_passes.size(); p-- > 0;)
+  {
+    const Pass& pass = m_passes[p];
+    live[p]          = pass.sideEffects;
+    for (const Use& use : pass.uses)
+    {
+      live[p] = live[p] || (use.write && needed[use.resource]);
+    }
+    if (!live[p])
+    {
+      continue;
+    }
+    for (const Use& use : pass.uses)
+    {
+      if (use.read)
+      {
+        needed[use.resource] = true;
+      }
+    }
+  }
+
+  m_passOrder.clear();
+  for (uint32_t p = 0; p < m_passes.size(); ++p)
+  {
+    if (live[p])
+    {
+      m_passOrder.push_back(p);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::computeLifetimes()
+{
+  for (uint32_t order = 0; order < m_passOrder.size(); ++order)
+  {
+    for (const Use& use : m_passes[m_passOrder[order]].uses)
+    {
+      Resource& resource = m_resources[use.resource];
+      resource.firstPass = std::min(resource.firstPass, order);
+      resource.lastPass  = std::max(resource.lastPass, order);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Creates the transient images (unbound) to learn their memory requirements
+void
+RenderGraph::measureTransients()
+{
+  for (Resource& resource : m_resources)
+  {
+    if (resource.imported || resource.firstPass == ~0u)
+    {
+      continue;
+    }
+
+    if (m_device == VK_NULL_HANDLE)
+    {
+      const VkDeviceSize texels =
+        VkDeviceSize(resource.desc.extent.width) * resource.desc.extent.height;
+      resource.size      = texels * estimatedTexelSize(resource.desc.format);
+      resource.alignment = ESTIMATED_IMAGE_ALIGNMENT;
+      continue;
+    }
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+    imageInfo.format            = resource.desc.format;
+    imageInfo.extent.width      = resource.desc.extent.width;
+    imageInfo.extent.height     = resource.desc.extent.height;
+    imageInfo.extent.depth      = 1;
+    imageInfo.mipLevels         = 1;
+    imageInfo.arrayLayers       = 1;
+    imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage             = resource.desc.usage;
+    imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+    {
+      throw std::runtime_error(
+        fmt::format("failed to create render graph image {}!", resource.name));
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, resource.image, &requirements);
+    resource.size           = requirements.size;
+    resource.alignment      = requirements.alignment;
+    resource.memoryTypeBits = requirements.memoryTypeBits;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Largest first, each image goes at the lowest offset that doesn't overlap an image
+// already placed whose lifetime overlaps its own
+void
+RenderGraph::placeTransients()
+{
+  std::vector<RenderResource> transients;
+  m_unaliasedSize = 0;
+  for (RenderResource r = 0; r < m_resources.size(); ++r)
+  {
+    const Resource& resource = m_resources[r];
+    if (!resource.imported && resource.firstPass != ~0u)
+    {
+      transients.push_back(r);
+      m_unaliasedSize = alignUp(m_unaliasedSize, resource.alignment) + resource.size;
+    }
+  }
+  std::stable_sort(
+    transients.begin(), transients.end(), [this](RenderResource a, RenderResource b) {
+      return m_resources[a].size > m_resources[b].size;
+    });
+
+  m_transientSize = 0;
+  std::vector<RenderResource> placed;
+  for (RenderResource r : transients)
+  {
+    Resource& resource = m_resources[r];
+    auto livesWith     = [&resource](const Resource& other) {
+      return other.firstPass <= resource.lastPass && resource.firstPass <= other.lastPass;
+    };
+
+    std::vector<VkDeviceSize> candidates = {0};
+    for (RenderResource other : placed)
+    {
+      if (livesWith(m_resources[other]))
+      {
+        candidates.push_back(m_resources[other].memoryOffset + m_resources[other].size);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (VkDeviceSize candidate : candidates)
+    {
+      const VkDeviceSize offset = alignUp(candidate, resource.alignment);
+      bool fits                 = true;
+      for (RenderResource other : placed)
+      {
+        const Resource& o = m_resources[other];
+        if (
+          livesWith(o) && offset < o.memoryOffset + o.size
+          && o.memoryOffset < offset + resource.size)
+        {
+          fits = false;
+          break;
+        }
+      }
+      if (fits)
+      {
+        resource.memoryOffset = offset;
+        break;
+      }
+    }
+    m_transientSize = std::max(m_transientSize, resource.memoryOffset + resource.size);
+    placed.push_back(r);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::allocateTransients(VkPhysicalDevice physicalDevice)
+{
+  if (m_transientSize == 0)
+  {
+    return;
+  }
+
+  uint32_t memoryTypeBits = ~0u;
+  for (const Resource& resource : m_resources)
+  {
+    if (resource.image != VK_NULL_HANDLE && !resource.imported)
+    {
+      memoryTypeBits &= resource.memoryTypeBits;
+    }
+  }
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize       = m_transientSize;
+  allocInfo.memoryTypeIndex =
+    findMemoryType(physicalDevice, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (allocateDeviceMemory(m_device, allocInfo, m_transientMemory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate render graph memory!");
+  }
+
+  for (Resource& resource : m_resources)
+  {
+    if (resource.image == VK_NULL_HANDLE || resource.imported)
+    {
+      continue;
+    }
+    vkBindImageMemory(m_device, resource.image, m_transientMemory, resource.memoryOffset);
+
+    VkImageViewCreateInfo viewInfo           = {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = resource.image;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = resource.desc.format;
+    viewInfo.subresourceRange.aspectMask     = resource.desc.aspect;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+    if (
+      vkCreateImageView(m_device, &viewInfo, nullptr, &resource.imageView)
+      != VK_SUCCESS)
+    {
+      throw std::runtime_error(
+        fmt::format("failed to create render graph image view {}!", resource.name));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Before its first use a transient image must wait for the last use of every image
+// sharing its memory (including itself), which may be in the previous frame
+ResourceAccess
+RenderGraph::transientInitialAccess(RenderResource r) const
+{
+  const Resource& resource = m_resources[r];
+
+  ResourceAccess initial;
+  for (const Resource& other : m_resources)
+  {
+    if (
+      other.imported || other.firstPass == ~0u
+      || other.memoryOffset >= resource.memoryOffset + resource.size
+      || resource.memoryOffset >= other.memoryOffset + other.size)
+    {
+      continue;
+    }
+    const auto otherIndex = static_cast<RenderResource>(&other - m_resources.data());
+    for (const Use& use : m_passes[m_passOrder[other.lastPass]].uses)
+    {
+      if (use.resource == otherIndex)
+      {
+        initial.stages |= use.access.stages;
+        initial.access |= use.access.access;
+      }
+    }
+  }
+  initial.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  return initial;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::planBarriers()
+{
+  struct State
+  {
+    VkPipelineStageFlags writeStages   = 0;    // last write (or layout transition)
+    VkAccessFlags writeAccess          = 0;
+    VkPipelineStageFlags readStages    = 0;    // reads since then
+    VkPipelineStageFlags visibleStages = 0;    // reads already synchronised with it
+    VkAccessFlags visibleAccess        = 0;
+    VkImageLayout layout               = VK_IMAGE_LAYOUT_UNDEFINED;
+  };
+
+  std::vector<State> states(m_resources.size());
+  for (RenderResource r = 0; r < m_resources.size(); ++r)
+  {
+    const Resource& resource = m_resources[r];
+    if (!resource.imported && resource.firstPass == ~0u)
+    {
+      continue;
+    }
+    const ResourceAccess initial =
+      resource.imported ? resource.initial : transientInitialAccess(r);
+    states[r].writeStages = initial.stages;
+    states[r].writeAccess = initial.access & WRITE_ACCESS;
+    states[r].layout      = initial.layout;
+  }
+
+  auto access = [this, &states](
+                  BarrierBatch& batch,
+                  RenderResource r,
+                  const ResourceAccess& next,
+                  bool write) {
+    State& state            = states[r];
+    const bool layoutChange = m_resources[r].isImage && next.layout != state.layout;
+
+    if (layoutChange || write)
+    {
+      // Everything since the last write must finish first, its writes made available
+      const VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+      if (layoutChange)
+      {
+        batch.transitions.push_back(
+          {r, state.layout, next.layout, state.writeAccess, next.access});
+        batch.srcStages |= srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        batch.dstStages |= next.stages;
+      }
+      else if (srcStages != 0)
+      {
+        batch.srcStages |= srcStages;
+        batch.dstStages |= next.stages;
+        if (state.writeAccess != 0)
+        {
+          batch.srcAccess |= state.writeAccess;
+          batch.dstAccess |= next.access;
+        }
+      }
+      state.writeStages   = next.stages;
+      state.writeAccess   = write ? (next.access & WRITE_ACCESS) : 0;
+      state.readStages    = 0;
+      state.visibleStages = write ? 0 : next.stages;
+      state.visibleAccess = write ? 0 : next.access;
+      state.layout        = next.layout;
+      return;
+    }
+
+    // Read after read needs nothing, read after write needs the write made visible
+    const bool synchronised = (next.stages & ~state.visibleStages) == 0
+                              && (next.access & ~state.visibleAccess) == 0;
+    if (state.writeStages != 0 && !synchronised)
+    {
+      batch.srcStages |= state.writeStages;
+      batch.srcAccess |= state.writeAccess;
+      batch.dstStages |= next.stages;
+      batch.dstAccess |= next.access;
+      state.visibleStages |= next.stages;
+      state.visibleAccess |= next.access;
+    }
+    state.readStages |= next.stages;
+  };
+
+  for (uint32_t p : m_passOrder)
+  {
+    Pass& pass    = m_passes[p];
+    pass.barriers = {};
+    for (const Use& use : pass.uses)
+    {
+      access(pass.barriers, use.resource, use.access, use.write);
+    }
+  }
+
+  m_finalBarriers = {};
+  for (RenderResource r = 0; r < m_resources.size(); ++r)
+  {
+    if (m_resources[r].imported && m_resources[r].final.stages != 0)
+    {
+      access(m_finalBarriers, r, m_resources[r].final, false);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::compile(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+  assert(!m_compiled);
+  m_device = device;
+
+  cullPasses();
+  computeLifetimes();
+  measureTransients();
+  placeTransients();
+  if (m_device != VK_NULL_HANDLE)
+  {
+    allocateTransients(physicalDevice);
+  }
+  planBarriers();
+  m_compiled = true;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::cleanup()
+{
+  if (m_device != VK_NULL_HANDLE)
+  {
+    for (Resource& resource : m_resources)
+    {
+      if (!resource.imported)
+      {
+        vkDestroyImageView(m_device, resource.imageView, nullptr);
+        vkDestroyImage(m_device, resource.image, nullptr);
+      }
+    }
+    freeDeviceMemory(m_device, m_transientMemory);
+  }
+
+  m_resources.clear();
+  m_passes.clear();
+  m_passOrder.clear();
+  m_finalBarriers   = {};
+  m_transientMemory = VK_NULL_HANDLE;
+  m_transientSize   = 0;
+  m_unaliasedSize   = 0;
+  m_compiled        = false;
+  m_device          = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::retire(DeletionQueue& deletionQueue)
+{
+  auto retired = std::make_shared<RenderGraph>(std::move(*this));
+  *this        = RenderGraph();
+  deletionQueue.push([retired]() { retired->cleanup(); });
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::bindImage(RenderResource resource, VkImage image, VkImageView imageView)
+{
+  assert(m_resources[resource].imported && m_resources[resource].isImage);
+  m_resources[resource].image     = image;
+  m_resources[resource].imageView = imageView;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::recordBarriers(
+  VkCommandBuffer commandBuffer,
+  const BarrierBatch& batch) const
+{
+  if (batch.empty())
+  {
+    return;
+  }
+
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  for (const ImageTransition& transition : batch.transitions)
+  {
+    const Resource& resource = m_resources[transition.resource];
+    assert(resource.image != VK_NULL_HANDLE);
+
+    VkImageMemoryBarrier barrier            = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = transition.srcAccess;
+    barrier.dstAccessMask                   = transition.dstAccess;
+    barrier.oldLayout                       = transition.oldLayout;
+    barrier.newLayout                       = transition.newLayout;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = resource.image;
+    barrier.subresourceRange.aspectMask     = resource.desc.aspect;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+    imageBarriers.push_back(barrier);
+  }
+
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask   = batch.srcAccess;
+  memoryBarrier.dstAccessMask   = batch.dstAccess;
+  const bool hasMemoryBarrier   = batch.srcAccess != 0 || batch.dstAccess != 0;
+
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    batch.srcStages ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    batch.dstStages ? batch.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0,
+    hasMemoryBarrier ? 1 : 0,
+    &memoryBarrier,
+    0,
+    nullptr,
+    static_cast<uint32_t>(imageBarriers.size()),
+    imageBarriers.data());
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::execute(VkCommandBuffer commandBuffer, size_t index) const
+{
+  assert(m_compiled);
+  for (uint32_t p : m_passOrder)
+  {
+    recordBarriers(commandBuffer, m_passes[p].barriers);
+    m_passes[p].execute(commandBuffer, index);
+  }
+  recordBarriers(commandBuffer, m_finalBarriers);
+}
+
+//----------------------------------------------------------------------------------------
+uint32_t
+RenderGraph::barrierCount() const
+{
+  uint32_t count = m_finalBarriers.empty() ? 0 : 1;
+  for (uint32_t p : m_passOrder)
+  {
+    count += m_passes[p].barriers.empty() ? 0 : 1;
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+void
+RenderGraph::printSummary() const
+{
+  constexpr double MIB = 1024.0 * 1024.0;
+
+  std::string culled;
+  for (uint32_t p = 0; p < m_passes.size(); ++p)
+  {
+    if (std::find(m_passOrder.begin(), m_passOrder.end(), p) == m_passOrder.end())
+    {
+      culled += (culled.empty() ? " (culled: " : ", ") + m_passes[p].name;
+    }
+  }
+  if (!culled.empty())
+  {
+    culled += ")";
+  }
+
+  fmt::print(
+    "Render graph: {} of {} passes{}, {} barriers, transient images {:.1f} MiB "
+    "({:.1f} MiB without aliasing)\n",
+    livePassCount(),
+    passCount(),
+    culled,
+    barrierCount(),
+    m_transientSize / MIB,
+    m_unaliasedSize / MIB);
+}
+
+//----------------------------------------------------------------------------------------
+// Depth prepass, G-buffer, SSAO, lighting, a bloom chain and tonemapping, plus a debug
+// view and a histogram nobody reads (both culled)
+static void
+buildDeferredFrame(RenderGraph& graph, VkExtent2D extent)
+{
+  const VkImageUsageFlags colorUsage =
+    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  const VkImageUsageFlags storageUsage =
+    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  auto scaled = [extent](uint32_t divisor) {
+    return VkExtent2D{
+      std::max(extent.width / divisor, 1u), std::max(extent.height / divisor, 1u)};
+  };
+  auto image = [&graph](const char* name, VkFormat format, VkExtent2D size,
+                        VkImageUsageFlags usage) {
+    RenderImageDesc desc;
+    desc.format = format;
+    desc.extent = size;
+    desc.usage  = usage;
+    if (format == VK_FORMAT_D32_SFLOAT)
+    {
+      desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+    return graph.createImage(name, desc);
+  };
+  auto noop = [](VkCommandBuffer, size_t) {};
+
+  RenderImageDesc backbufferDesc;
+  backbufferDesc.format = VK_FORMAT_B8G8R8A8_SRGB;
+  backbufferDesc.extent = extent;
+  backbufferDesc.usage  = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  const RenderResource backbuffer = graph.importImage(
+    "backbuffer", backbufferDesc, ACCESS_ACQUIRED_IMAGE, ACCESS_PRESENT);
+  graph.markOutput(backbuffer);
+
+  const RenderResource depth = image(
+    "depth",
+    VK_FORMAT_D32_SFLOAT,
+    extent,
+    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+  const RenderResource albedo =
+    image("albedo", VK_FORMAT_R8G8B8A8_SRGB, extent, colorUsage);
+  const RenderResource normal =
+    image("normal", VK_FORMAT_R16G16B16A16_SFLOAT, extent, colorUsage);
+  const RenderResource material =
+    image("material", VK_FORMAT_R8G8B8A8_UNORM, extent, colorUsage);
+  const RenderResource ao = image("ao", VK_FORMAT_R8_UNORM, extent, storageUsage);
+  const RenderResource aoBlurred =
+    image("ao blurred", VK_FORMAT_R8_UNORM, extent, storageUsage);
+  const RenderResource hdr =
+    image("hdr", VK_FORMAT_R16G16B16A16_SFLOAT, extent, colorUsage);
+  const RenderResource debugView =
+    image("debug view", VK_FORMAT_R8G8B8A8_UNORM, extent, colorUsage);
+  const RenderResource histogram = graph.importBuffer("histogram", ACCESS_COMPUTE_READ);
+
+  RenderPassHandle pass = graph.addPass("depth prepass", noop);
+  graph.write(pass, depth, ACCESS_DEPTH_ATTACHMENT);
+
+  pass = graph.addPass("g-buffer", noop);
+  graph.read(pass, depth, ACCESS_DEPTH_ATTACHMENT_READ);
+  graph.write(pass, albedo, ACCESS_COLOR_ATTACHMENT);
+  graph.write(pass, normal, ACCESS_COLOR_ATTACHMENT);
+  graph.write(pass, material, ACCESS_COLOR_ATTACHMENT);
+
+  pass = graph.addPass("debug view", noop);
+  graph.read(pass, normal, ACCESS_FRAGMENT_SAMPLED);
+  graph.write(pass, debugView, ACCESS_COLOR_ATTACHMENT);
+
+  pass = graph.addPass("ssao", noop);
+  graph.read(pass, depth, ACCESS_COMPUTE_SAMPLED);
+  graph.read(pass, normal, ACCESS_COMPUTE_SAMPLED);
+  graph.write(pass, ao, ACCESS_COMPUTE_WRITE);
+
+  pass = graph.addPass("ssao blur", noop);
+  graph.read(pass, ao, ACCESS_COMPUTE_READ);
+  graph.write(pass, aoBlurred, ACCESS_COMPUTE_WRITE);
+
+  pass = graph.addPass("lighting", noop);
+  for (RenderResource input : {depth, albedo, normal, material, aoBlurred})
+  {
+    graph.read(pass, input, ACCESS_FRAGMENT_SAMPLED);
+  }
+  graph.write(pass, hdr, ACCESS_COLOR_ATTACHMENT);
+
+  pass = graph.addPass("luminance histogram", noop);
+  graph.read(pass, hdr, ACCESS_COMPUTE_SAMPLED);
+  graph.write(pass, histogram, ACCESS_COMPUTE_WRITE);
+
+  // Bloom: down to 1/2, 1/4, 1/8 then back up, each level a new image
+  RenderResource bloom = hdr;
+  const char* downNames[] = {"bloom 1/2", "bloom 1/4", "bloom 1/8"};
+  for (uint32_t level = 0; level < 3; ++level)
+  {
+    const RenderResource next = image(
+      downNames[level],
+      VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+      scaled(2u << level),
+      colorUsage);
+    pass = graph.addPass(downNames[level], noop);
+    graph.read(pass, bloom, ACCESS_FRAGMENT_SAMPLED);
+    graph.write(pass, next, ACCESS_COLOR_ATTACHMENT);
+    bloom = next;
+  }
+  const char* upNames[] = {"bloom up 1/4", "bloom up 1/2"};
+  for (uint32_t level = 0; level < 2; ++level)
+  {
+    const RenderResource next = image(
+      upNames[level],
+      VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+      scaled(4u >> level),
+      colorUsage);
+    pass = graph.addPass(upNames[level], noop);
+    graph.read(pass, bloom, ACCESS_FRAGMENT_SAMPLED);
+    graph.write(pass, next, ACCESS_COLOR_ATTACHMENT);
+    bloom = next;
+  }
+
+  pass = graph.addPass("tonemap", noop);
+  graph.read(pass, hdr, ACCESS_FRAGMENT_SAMPLED);
+  graph.read(pass, bloom, ACCESS_FRAGMENT_SAMPLED);
+  graph.write(pass, backbuffer, ACCESS_COLOR_ATTACHMENT);
+}
+
+//----------------------------------------------------------------------------------------
+void
+runRenderGraphReport()
+{
+  constexpr double MIB = 1024.0 * 1024.0;
+
+  fmt::print("Deferred frame render graph (transient sizes estimated, no device)\n");
+  fmt::print("resolution  passes  barriers  aliased MiB  unaliased MiB  saved\n");
+  for (VkExtent2D extent : {VkExtent2D{1920, 1080}, VkExtent2D{3840, 2160}})
+  {
+    RenderGraph graph;
+    buildDeferredFrame(graph, extent);
+    graph.compile();
+
+    const double aliased   = graph.transientMemorySize() / MIB;
+    const double unaliased = graph.unaliasedTransientMemorySize() / MIB;
+    fmt::print(
+      "{:>10}  {:>2}/{:<3}  {:8}  {:11.1f}  {:13.1f}  {:4.0f}%\n",
+      fmt::format("{}x{}", extent.width, extent.height),
+      graph.livePassCount(),
+      graph.passCount(),
+      graph.barrierCount(),
+      aliased,
+      unaliased,
+      100.0 * (1.0 - aliased / unaliased));
+  }
+}
+
+//----------------------------------------------------------------------------------------
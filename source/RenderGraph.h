@@ -0,0 +1,256 @@
+#pragma once
+
+#include "DeletionQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+using RenderResource                             = uint32_t;
+using RenderPassHandle                           = uint32_t;
+constexpr RenderResource INVALID_RENDER_RESOURCE = ~0u;
+
+// How a pass (or whoever used it before or after the graph) touches a resource; the
+// layout only matters for images
+struct ResourceAccess
+{
+  VkPipelineStageFlags stages = 0;
+  VkAccessFlags access        = 0;
+  VkImageLayout layout        = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+constexpr ResourceAccess ACCESS_COLOR_ATTACHMENT = {
+  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+  VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+constexpr ResourceAccess ACCESS_DEPTH_ATTACHMENT = {
+  VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+    | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+  VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+constexpr ResourceAccess ACCESS_DEPTH_ATTACHMENT_READ = {
+  VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+  VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+constexpr ResourceAccess ACCESS_FRAGMENT_SAMPLED = {
+  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+  VK_ACCESS_SHADER_READ_BIT,
+  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+constexpr ResourceAccess ACCESS_COMPUTE_SAMPLED = {
+  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+  VK_ACCESS_SHADER_READ_BIT,
+  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+constexpr ResourceAccess ACCESS_COMPUTE_READ = {
+  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+  VK_ACCESS_SHADER_READ_BIT,
+  VK_IMAGE_LAYOUT_GENERAL};
+constexpr ResourceAccess ACCESS_COMPUTE_WRITE = {
+  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  VK_IMAGE_LAYOUT_GENERAL};
+constexpr ResourceAccess ACCESS_VERTEX_SHADER_READ = {
+  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+  VK_ACCESS_SHADER_READ_BIT,
+  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+constexpr ResourceAccess ACCESS_VERTEX_ATTRIBUTE_READ = {
+  VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+  VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+  VK_IMAGE_LAYOUT_UNDEFINED};
+constexpr ResourceAccess ACCESS_INDIRECT_READ = {
+  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+  VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+  VK_IMAGE_LAYOUT_UNDEFINED};
+constexpr ResourceAccess ACCESS_TRANSFER_READ = {
+  VK_PIPELINE_STAGE_TRANSFER_BIT,
+  VK_ACCESS_TRANSFER_READ_BIT,
+  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+constexpr ResourceAccess ACCESS_TRANSFER_WRITE = {
+  VK_PIPELINE_STAGE_TRANSFER_BIT,
+  VK_ACCESS_TRANSFER_WRITE_BIT,
+  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+constexpr ResourceAccess ACCESS_PRESENT = {
+  VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+  0,
+  VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+
+// A swap chain image as it comes out of vkAcquireNextImageKHR: the acquire semaphore
+// is waited on at the colour output stage and the old contents are discarded
+constexpr ResourceAccess ACCESS_ACQUIRED_IMAGE = {
+  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+  0,
+  VK_IMAGE_LAYOUT_UNDEFINED};
+
+struct RenderImageDesc
+{
+  VkFormat format           = VK_FORMAT_UNDEFINED;
+  VkExtent2D extent         = {0, 0};
+  VkImageUsageFlags usage   = 0;
+  VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+//----------------------------------------------------------------------------------------
+// Frame graph: passes declare what they read and write, then compile():
+//  1. culls passes whose results never reach an output (or have no side effects)
+//  2. gives each transient image a lifetime (first to last live pass using it) and
+//     places them in one device memory block, sharing memory between images whose
+//     lifetimes don't overlap
+//  3. works out the hazards between consecutive uses of each resource and batches all
+//     the barriers a pass needs into one vkCmdPipelineBarrier: layout transitions as
+//     image barriers, everything else as a single global memory barrier. Reads after
+//     reads need nothing, writes after reads only an execution dependency.
+// Buffers are tracked by name only (global memory barriers need no handle). Imported
+// images are bound per execute(), so one compiled graph records every swap chain
+// image's command buffer.
+// Barriers in a command buffer also order against earlier submissions, so a transient
+// image's first use waits for the last use of its memory in the previous frame.
+//----------------------------------------------------------------------------------------
+class RenderGraph
+{
+public:
+  using ExecuteFunction =
+    std::function<void(VkCommandBuffer commandBuffer, size_t index)>;
+
+private:
+  struct Resource
+  {
+    std::string name;
+    bool isImage  = false;
+    bool imported = false;
+    bool output   = false;
+    RenderImageDesc desc;
+    ResourceAccess initial;
+    ResourceAccess final;    // stages == 0: left as the last pass used it
+
+    // Imported images: bound per execute()
+    VkImage image         = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+
+    // Transient images
+    uint32_t firstPass        = ~0u;    // index into m_passOrder
+    uint32_t lastPass         = 0;
+    VkDeviceSize size         = 0;
+    VkDeviceSize alignment    = 0;
+    uint32_t memoryTypeBits   = ~0u;
+    VkDeviceSize memoryOffset = 0;
+  };
+
+  struct Use
+  {
+    RenderResource resource;
+    ResourceAccess access;
+    bool read;
+    bool write;
+  };
+
+  struct ImageTransition
+  {
+    RenderResource resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+  };
+
+  struct BarrierBatch
+  {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkAccessFlags srcAccess        = 0;    // global memory barrier
+    VkAccessFlags dstAccess        = 0;
+    std::vector<ImageTransition> transitions;
+
+    bool empty() const { return srcStages == 0 && dstStages == 0; }
+  };
+
+  struct Pass
+  {
+    std::string name;
+    ExecuteFunction execute;
+    std::vector<Use> uses;
+    bool sideEffects = false;
+    BarrierBatch barriers;
+  };
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  std::vector<Resource> m_resources;
+  std::vector<Pass> m_passes;
+  std::vector<uint32_t> m_passOrder;    // live passes in declaration order
+  BarrierBatch m_finalBarriers;
+
+  VkDeviceMemory m_transientMemory = VK_NULL_HANDLE;
+  VkDeviceSize m_transientSize     = 0;    // aliased
+  VkDeviceSize m_unaliasedSize     = 0;
+  bool m_compiled                  = false;
+
+private:
+  void addUse(
+    RenderPassHandle pass,
+    RenderResource resource,
+    const ResourceAccess& access,
+    bool write);
+  void cullPasses();
+  void computeLifetimes();
+  void measureTransients();
+  void placeTransients();
+  void allocateTransients(VkPhysicalDevice physicalDevice);
+  void planBarriers();
+  ResourceAccess transientInitialAccess(RenderResource resource) const;
+  void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const;
+
+public:
+  RenderResource importImage(
+    const std::string& name,
+    const RenderImageDesc& desc,
+    const ResourceAccess& initial,
+    const ResourceAccess& final);
+  // initial: the last use before the graph runs (usually its own last use last frame)
+  RenderResource importBuffer(const std::string& name, const ResourceAccess& initial);
+  // Created and owned by the graph, contents don't survive between frames
+  RenderResource createImage(const std::string& name, const RenderImageDesc& desc);
+  // Resources that must be produced; passes that don't contribute to them are culled
+  void markOutput(RenderResource resource);
+
+  RenderPassHandle addPass(const std::string& name, ExecuteFunction execute);
+  void read(RenderPassHandle pass, RenderResource resource, const ResourceAccess& access);
+  void
+  write(RenderPassHandle pass, RenderResource resource, const ResourceAccess& access);
+  // Never culled (e.g. writes to host visible memory the graph doesn't know about)
+  void setSideEffects(RenderPassHandle pass);
+
+  // Without a device, nothing is created and transient sizes are estimated from the
+  // image descriptions (for reports)
+  void compile(
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE,
+    VkDevice device                 = VK_NULL_HANDLE);
+  // Destroys the graph's images and forgets every pass and resource
+  void cleanup();
+  // Same, but the images are destroyed once the frames in flight are done with them
+  void retire(DeletionQueue& deletionQueue);
+
+  void bindImage(RenderResource resource, VkImage image, VkImageView imageView);
+  VkImage image(RenderResource resource) const { return m_resources[resource].image; }
+  VkImageView imageView(RenderResource resource) const
+  {
+    return m_resources[resource].imageView;
+  }
+
+  // index is passed through to the passes (e.g. the swap chain image index)
+  void execute(VkCommandBuffer commandBuffer, size_t index) const;
+
+  uint32_t livePassCount() const { return static_cast<uint32_t>(m_passOrder.size()); }
+  uint32_t passCount() const { return static_cast<uint32_t>(m_passes.size()); }
+  uint32_t barrierCount() const;    // vkCmdPipelineBarrier calls per execute()
+  VkDeviceSize transientMemorySize() const { return m_transientSize; }
+  VkDeviceSize unaliasedTransientMemorySize() const { return m_unaliasedSize; }
+  void printSummary() const;
+};
+
+// Builds a deferred shading frame at 1080p and 4K without a device and reports the
+// culled passes, barriers and transient memory with and without aliasing
+void runRenderGraphReport();
+
+//----------------------------------------------------------------------------------------
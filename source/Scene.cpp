@@ -0,0 +1,156 @@
+#include "Scene.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+//----------------------------------------------------------------------------------------
+VkVertexInputBindingDescription
+Vertex::getBindingDescription()
+{
+  VkVertexInputBindingDescription bindingDescription = {};
+  bindingDescription.binding                         = 0;
+  bindingDescription.stride                          = sizeof(Vertex);
+  bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescription;
+}
+
+//----------------------------------------------------------------------------------------
+std::array<VkVertexInputAttributeDescription, 2>
+Vertex::getAttributeDescriptions()
+{
+  std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+  attributeDescriptions[0].binding  = 0;
+  attributeDescriptions[0].location = 0;
+  attributeDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
+  attributeDescriptions[0].offset   = offsetof(Vertex, pos);
+
+  attributeDescriptions[1].binding  = 0;
+  attributeDescriptions[1].location = 1;
+  attributeDescriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
+  attributeDescriptions[1].offset   = offsetof(Vertex, color);
+
+  return attributeDescriptions;
+}
+
+//----------------------------------------------------------------------------------------
+VkVertexInputBindingDescription
+PackedVertex::getBindingDescription()
+{
+  VkVertexInputBindingDescription bindingDescription = {};
+  bindingDescription.binding                         = 0;
+  bindingDescription.stride                          = sizeof(PackedVertex);
+  bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescription;
+}
+
+//----------------------------------------------------------------------------------------
+std::array<VkVertexInputAttributeDescription, 2>
+PackedVertex::getAttributeDescriptions()
+{
+  std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+  attributeDescriptions[0].binding  = 0;
+  attributeDescriptions[0].location = 0;
+  attributeDescriptions[0].format   = VK_FORMAT_R16G16B16A16_SNORM;
+  attributeDescriptions[0].offset   = offsetof(PackedVertex, pos);
+
+  attributeDescriptions[1].binding  = 0;
+  attributeDescriptions[1].location = 1;
+  attributeDescriptions[1].format   = VK_FORMAT_R8G8B8A8_UNORM;
+  attributeDescriptions[1].offset   = offsetof(PackedVertex, color);
+
+  return attributeDescriptions;
+}
+
+//----------------------------------------------------------------------------------------
+PackedVertex
+packVertex(const Vertex& vertex)
+{
+  PackedVertex packed;
+  for (int i = 0; i < 3; ++i)
+  {
+    const float position = glm::clamp(vertex.pos[i], -1.0f, 1.0f);
+    const float color    = glm::clamp(vertex.color[i], 0.0f, 1.0f);
+    packed.pos[i]        = static_cast<int16_t>(std::round(position * 32767.0f));
+    packed.color[i]      = static_cast<uint8_t>(std::round(color * 255.0f));
+  }
+  packed.pos[3]   = 0;
+  packed.color[3] = 255;
+  return packed;
+}
+
+//----------------------------------------------------------------------------------------
+// Gribb/Hartmann plane extraction (for a [0, 1] clip space depth range)
+Frustum
+extractFrustum(const glm::mat4& viewProj)
+{
+  auto row = [&viewProj](int i) {
+    return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+  };
+
+  Frustum frustum;
+  frustum.planes[0] = row(3) + row(0);    // left
+  frustum.planes[1] = row(3) - row(0);    // right
+  frustum.planes[2] = row(3) + row(1);    // bottom
+  frustum.planes[3] = row(3) - row(1);    // top
+  frustum.planes[4] = row(2);             // near
+  frustum.planes[5] = row(3) - row(2);    // far
+
+  for (auto& plane : frustum.planes)
+  {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+gridSide(uint32_t objectCount)
+{
+  auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(objectCount))));
+  return std::max(side, 1u);
+}
+
+//----------------------------------------------------------------------------------------
+float
+objectGridExtent(uint32_t objectCount, float spacing)
+{
+  return gridSide(objectCount) * spacing;
+}
+
+//----------------------------------------------------------------------------------------
+std::vector<ObjectData>
+createObjectGrid(uint32_t objectCount, float spacing)
+{
+  const uint32_t side    = gridSide(objectCount);
+  const float halfExtent = 0.5f * objectGridExtent(objectCount, spacing);
+
+  std::vector<ObjectData> objects(objectCount);
+  for (uint32_t i = 0; i < objectCount; ++i)
+  {
+    const uint32_t x = i % side;
+    const uint32_t y = (i / side) % side;
+    const uint32_t z = i / (side * side);
+
+    const glm::vec3 cell = glm::vec3(x, y, z) / static_cast<float>(side);
+    const glm::vec3 centre
+      = glm::vec3(x, y, z) * spacing - glm::vec3(halfExtent - 0.5f * spacing);
+
+    ObjectData& object    = objects[i];
+    object.boundingSphere = glm::vec4(centre, 1.0f);
+    object.color          = glm::vec4(0.25f + 0.75f * cell, 1.0f);
+    object.indexCount     = 0;
+    object.firstIndex     = 0;
+    object.vertexOffset   = 0;
+    object.page           = 0;
+    object.textureIndex   = 0;
+  }
+  return objects;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+struct Vertex
+{
+  glm::vec3 pos;
+  glm::vec3 color;
+
+  static VkVertexInputBindingDescription getBindingDescription();
+  static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
+};
+
+//----------------------------------------------------------------------------------------
+// What the GPU actually reads: 12 instead of 24 bytes per vertex. Mesh positions are
+// within the unit sphere (objects are scaled by their bounding sphere radius), so 16 bit
+// snorm keeps 1/32767 of the object radius. The w/a channels are unused padding, 3
+// component 16 and 8 bit vertex formats are poorly supported.
+struct PackedVertex
+{
+  int16_t pos[4];      // VK_FORMAT_R16G16B16A16_SNORM
+  uint8_t color[4];    // VK_FORMAT_R8G8B8A8_UNORM
+
+  static VkVertexInputBindingDescription getBindingDescription();
+  static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must be tightly packed");
+
+PackedVertex packVertex(const Vertex& vertex);
+
+//----------------------------------------------------------------------------------------
+// Per object data as consumed by the GPU (std430, see object.vert and cull.comp)
+struct ObjectData
+{
+  glm::vec4 boundingSphere;    // xyz = initial centre, w = radius (also the scale)
+  glm::vec4 color;
+  uint32_t indexCount;
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  uint32_t page;            // GeometryPacker page holding the mesh
+  uint32_t textureIndex;    // bindless sampled image slot
+  uint32_t padding[3];
+};
+static_assert(sizeof(ObjectData) == 64, "ObjectData must match the std430 shader layout");
+
+//----------------------------------------------------------------------------------------
+// Planes are stored as (normal, distance) with normals pointing into the frustum
+struct Frustum
+{
+  glm::vec4 planes[6];
+};
+
+Frustum extractFrustum(const glm::mat4& viewProj);
+
+//----------------------------------------------------------------------------------------
+// Lays out objectCount unit radius objects in a cube shaped grid (mesh and texture
+// fields are left for the caller to fill in)
+std::vector<ObjectData> createObjectGrid(uint32_t objectCount, float spacing);
+
+// Side length of the grid created by createObjectGrid() (in world units)
+float objectGridExtent(uint32_t objectCount, float spacing);
+
+//----------------------------------------------------------------------------------------
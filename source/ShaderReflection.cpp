@@ -0,0 +1,627 @@
+#include <fmt/format.h>
+
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+// The parts of the SPIR-V specification the reflection reads
+constexpr uint32_t SPIRV_MAGIC      = 0x07230203;
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+constexpr uint32_t OP_ENTRY_POINT        = 15;
+constexpr uint32_t OP_TYPE_VOID          = 19;
+constexpr uint32_t OP_TYPE_BOOL          = 20;
+constexpr uint32_t OP_TYPE_INT           = 21;
+constexpr uint32_t OP_TYPE_FLOAT         = 22;
+constexpr uint32_t OP_TYPE_VECTOR        = 23;
+constexpr uint32_t OP_TYPE_MATRIX        = 24;
+constexpr uint32_t OP_TYPE_IMAGE         = 25;
+constexpr uint32_t OP_TYPE_SAMPLER       = 26;
+constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+constexpr uint32_t OP_TYPE_ARRAY         = 28;
+constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+constexpr uint32_t OP_TYPE_STRUCT        = 30;
+constexpr uint32_t OP_TYPE_POINTER       = 32;
+constexpr uint32_t OP_CONSTANT           = 43;
+constexpr uint32_t OP_SPEC_CONSTANT      = 50;
+constexpr uint32_t OP_VARIABLE           = 59;
+constexpr uint32_t OP_DECORATE           = 71;
+constexpr uint32_t OP_MEMBER_DECORATE    = 72;
+
+constexpr uint32_t DECORATION_BUFFER_BLOCK   = 3;
+constexpr uint32_t DECORATION_ARRAY_STRIDE   = 6;
+constexpr uint32_t DECORATION_MATRIX_STRIDE  = 7;
+constexpr uint32_t DECORATION_BUILT_IN       = 11;
+constexpr uint32_t DECORATION_LOCATION       = 30;
+constexpr uint32_t DECORATION_BINDING        = 33;
+constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+constexpr uint32_t DECORATION_OFFSET         = 35;
+
+constexpr uint32_t STORAGE_CLASS_UNIFORM_CONSTANT = 0;
+constexpr uint32_t STORAGE_CLASS_INPUT            = 1;
+constexpr uint32_t STORAGE_CLASS_UNIFORM          = 2;
+constexpr uint32_t STORAGE_CLASS_PUSH_CONSTANT    = 9;
+constexpr uint32_t STORAGE_CLASS_STORAGE_BUFFER   = 12;
+
+constexpr uint32_t DIM_BUFFER       = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+constexpr uint32_t NOT_DECORATED = ~0u;
+
+//----------------------------------------------------------------------------------------
+namespace
+{
+struct Decorations
+{
+  uint32_t set         = NOT_DECORATED;
+  uint32_t binding     = NOT_DECORATED;
+  uint32_t location    = NOT_DECORATED;
+  uint32_t arrayStride = 0;
+  bool bufferBlock     = false;
+  bool builtIn         = false;
+};
+
+struct MemberDecorations
+{
+  uint32_t offset       = 0;
+  uint32_t matrixStride = 0;
+};
+
+// Instructions point into the module's words
+struct SpirvModule
+{
+  std::string name;
+  std::unordered_map<uint32_t, const uint32_t*> types;
+  std::unordered_map<uint32_t, uint32_t> constants;
+  std::unordered_map<uint32_t, Decorations> decorations;
+  std::unordered_map<uint32_t, std::vector<MemberDecorations>> members;
+  std::vector<const uint32_t*> variables;
+
+  const uint32_t* type(uint32_t id) const
+  {
+    auto found = types.find(id);
+    if (found == types.end())
+    {
+      throw std::runtime_error(fmt::format("{}: type {} is not declared", name, id));
+    }
+    return found->second;
+  }
+
+  uint32_t constant(uint32_t id) const
+  {
+    auto found = constants.find(id);
+    if (found == constants.end())
+    {
+      throw std::runtime_error(fmt::format("{}: constant {} is not declared", name, id));
+    }
+    return found->second;
+  }
+
+  Decorations decorationsOf(uint32_t id) const
+  {
+    auto found = decorations.find(id);
+    return found != decorations.end() ? found->second : Decorations();
+  }
+};
+}    // namespace
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+opcode(const uint32_t* instruction)
+{
+  return instruction[0] & 0xffff;
+}
+
+//----------------------------------------------------------------------------------------
+static VkShaderStageFlagBits
+shaderStage(uint32_t executionModel, const std::string& name)
+{
+  switch (executionModel)
+  {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+      throw std::runtime_error(
+        fmt::format("{}: unsupported execution model {}", name, executionModel));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// In bytes, as laid out by the explicit offsets and strides (push constants)
+static uint32_t
+typeSize(const SpirvModule& module, uint32_t typeId, uint32_t matrixStride)
+{
+  const uint32_t* type = module.type(typeId);
+  switch (opcode(type))
+  {
+    case OP_TYPE_BOOL: return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT: return type[2] / 8;
+    case OP_TYPE_VECTOR: return type[3] * typeSize(module, type[2], 0);
+    case OP_TYPE_MATRIX:
+      return type[3] * (matrixStride > 0 ? matrixStride : typeSize(module, type[2], 0));
+    case OP_TYPE_ARRAY:
+    {
+      const uint32_t stride = module.decorationsOf(typeId).arrayStride;
+      return module.constant(type[3])
+             * (stride > 0 ? stride : typeSize(module, type[2], 0));
+    }
+    case OP_TYPE_STRUCT:
+    {
+      const uint32_t memberCount = (type[0] >> 16) - 2;
+      auto found                 = module.members.find(typeId);
+      uint32_t size              = 0;
+      for (uint32_t i = 0; i < memberCount; ++i)
+      {
+        MemberDecorations member;
+        if (found != module.members.end() && i < found->second.size())
+        {
+          member = found->second[i];
+        }
+        size = std::max(
+          size, member.offset + typeSize(module, type[2 + i], member.matrixStride));
+      }
+      return size;
+    }
+    default:
+      throw std::runtime_error(fmt::format(
+        "{}: can't size type {} (opcode {})", module.name, typeId, opcode(type)));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+static VkDescriptorType
+descriptorType(const SpirvModule& module, uint32_t storageClass, uint32_t typeId)
+{
+  const uint32_t* type = module.type(typeId);
+  switch (storageClass)
+  {
+    case STORAGE_CLASS_UNIFORM:
+      // SPIR-V 1.0 marks storage buffers as BufferBlock structs in the Uniform class
+      return module.decorationsOf(typeId).bufferBlock
+               ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+               : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    case STORAGE_CLASS_STORAGE_BUFFER: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case STORAGE_CLASS_UNIFORM_CONSTANT:
+      switch (opcode(type))
+      {
+        case OP_TYPE_SAMPLER: return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OP_TYPE_SAMPLED_IMAGE: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OP_TYPE_IMAGE:
+        {
+          // Sampled: 1 with a sampler, 2 for storage
+          const uint32_t dim = type[3];
+          const bool storage = type[7] == 2;
+          if (dim == DIM_SUBPASS_DATA)
+          {
+            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+          }
+          if (dim == DIM_BUFFER)
+          {
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                           : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+          }
+          return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                         : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        default: break;
+      }
+      break;
+    default: break;
+  }
+  throw std::runtime_error(fmt::format(
+    "{}: no descriptor type for type {} in storage class {}",
+    module.name,
+    typeId,
+    storageClass));
+}
+
+//----------------------------------------------------------------------------------------
+static ShaderVertexInput
+vertexInput(const SpirvModule& module, uint32_t location, uint32_t typeId)
+{
+  static const VkFormat FLOAT_FORMATS[] = {
+    VK_FORMAT_R32_SFLOAT,
+    VK_FORMAT_R32G32_SFLOAT,
+    VK_FORMAT_R32G32B32_SFLOAT,
+    VK_FORMAT_R32G32B32A32_SFLOAT};
+  static const VkFormat SINT_FORMATS[] = {
+    VK_FORMAT_R32_SINT,
+    VK_FORMAT_R32G32_SINT,
+    VK_FORMAT_R32G32B32_SINT,
+    VK_FORMAT_R32G32B32A32_SINT};
+  static const VkFormat UINT_FORMATS[] = {
+    VK_FORMAT_R32_UINT,
+    VK_FORMAT_R32G32_UINT,
+    VK_FORMAT_R32G32B32_UINT,
+    VK_FORMAT_R32G32B32A32_UINT};
+
+  const uint32_t* scalar = module.type(typeId);
+  uint32_t components    = 1;
+  if (opcode(scalar) == OP_TYPE_VECTOR)
+  {
+    components = scalar[3];
+    scalar     = module.type(scalar[2]);
+  }
+  if (
+    (opcode(scalar) != OP_TYPE_FLOAT && opcode(scalar) != OP_TYPE_INT)
+    || scalar[2] != 32 || components < 1 || components > 4)
+  {
+    throw std::runtime_error(fmt::format(
+      "{}: the input at location {} isn't a 32 bit scalar or vector",
+      module.name,
+      location));
+  }
+
+  ShaderVertexInput input = {};
+  input.location          = location;
+  input.size              = components * 4;
+  if (opcode(scalar) == OP_TYPE_FLOAT)
+  {
+    input.format = FLOAT_FORMATS[components - 1];
+  }
+  else
+  {
+    const bool isSigned = scalar[3] != 0;
+    input.format = isSigned ? SINT_FORMATS[components - 1] : UINT_FORMATS[components - 1];
+  }
+  return input;
+}
+
+//----------------------------------------------------------------------------------------
+ShaderReflection
+reflectShader(const std::vector<char>& code, const std::string& name)
+{
+  std::vector<uint32_t> words(code.size() / 4);
+  std::memcpy(words.data(), code.data(), words.size() * 4);
+  if (
+    code.size() % 4 != 0 || words.size() < SPIRV_HEADER_WORDS
+    || words[0] != SPIRV_MAGIC)
+  {
+    throw std::runtime_error(fmt::format("{} is not a SPIR-V module", name));
+  }
+
+  SpirvModule module;
+  module.name = name;
+  ShaderReflection reflection;
+  bool hasEntryPoint = false;
+  for (size_t i = SPIRV_HEADER_WORDS; i < words.size();)
+  {
+    const uint32_t* instruction = &words[i];
+    const uint32_t wordCount    = instruction[0] >> 16;
+    if (wordCount == 0 || i + wordCount > words.size())
+    {
+      throw std::runtime_error(fmt::format("{} is truncated", name));
+    }
+
+    const uint32_t op = opcode(instruction);
+    if (op == OP_ENTRY_POINT)
+    {
+      if (hasEntryPoint)
+      {
+        throw std::runtime_error(fmt::format("{} has more than one entry point", name));
+      }
+      reflection.stage = shaderStage(instruction[1], name);
+      hasEntryPoint    = true;
+    }
+    else if (op == OP_DECORATE && wordCount >= 3)
+    {
+      Decorations& decorations = module.decorations[instruction[1]];
+      const uint32_t value     = wordCount > 3 ? instruction[3] : 0;
+      switch (instruction[2])
+      {
+        case DECORATION_BUFFER_BLOCK: decorations.bufferBlock = true; break;
+        case DECORATION_ARRAY_STRIDE: decorations.arrayStride = value; break;
+        case DECORATION_BUILT_IN: decorations.builtIn = true; break;
+        case DECORATION_LOCATION: decorations.location = value; break;
+        case DECORATION_BINDING: decorations.binding = value; break;
+        case DECORATION_DESCRIPTOR_SET: decorations.set = value; break;
+        default: break;
+      }
+    }
+    else if (op == OP_MEMBER_DECORATE && wordCount > 4)
+    {
+      std::vector<MemberDecorations>& members = module.members[instruction[1]];
+      members.resize(std::max<size_t>(members.size(), instruction[2] + 1));
+      if (instruction[3] == DECORATION_OFFSET)
+      {
+        members[instruction[2]].offset = instruction[4];
+      }
+      else if (instruction[3] == DECORATION_MATRIX_STRIDE)
+      {
+        members[instruction[2]].matrixStride = instruction[4];
+      }
+    }
+    else if ((op == OP_CONSTANT || op == OP_SPEC_CONSTANT) && wordCount > 3)
+    {
+      // Spec constant array lengths count at their default
+      module.constants[instruction[2]] = instruction[3];
+    }
+    else if (op == OP_VARIABLE)
+    {
+      module.variables.push_back(instruction);
+    }
+    else if (op >= OP_TYPE_VOID && op <= OP_TYPE_POINTER)
+    {
+      module.types[instruction[1]] = instruction;
+    }
+    i += wordCount;
+  }
+  if (!hasEntryPoint)
+  {
+    throw std::runtime_error(fmt::format("{} has no entry point", name));
+  }
+
+  for (const uint32_t* variable : module.variables)
+  {
+    const uint32_t storageClass   = variable[3];
+    uint32_t typeId               = module.type(variable[1])[3];    // the pointee
+    const Decorations decorations = module.decorationsOf(variable[2]);
+
+    if (storageClass == STORAGE_CLASS_PUSH_CONSTANT)
+    {
+      reflection.pushConstantSize = typeSize(module, typeId, 0);
+    }
+    else if (storageClass == STORAGE_CLASS_INPUT)
+    {
+      if (
+        reflection.stage == VK_SHADER_STAGE_VERTEX_BIT && !decorations.builtIn
+        && decorations.location != NOT_DECORATED)
+      {
+        reflection.vertexInputs.push_back(
+          vertexInput(module, decorations.location, typeId));
+      }
+    }
+    else if (
+      decorations.set != NOT_DECORATED && decorations.binding != NOT_DECORATED
+      && (storageClass == STORAGE_CLASS_UNIFORM_CONSTANT
+          || storageClass == STORAGE_CLASS_UNIFORM
+          || storageClass == STORAGE_CLASS_STORAGE_BUFFER))
+    {
+      ShaderBinding binding = {};
+      binding.set           = decorations.set;
+      binding.binding       = decorations.binding;
+      binding.count         = 1;
+      binding.stageFlags    = reflection.stage;
+
+      const uint32_t* type = module.type(typeId);
+      if (opcode(type) == OP_TYPE_RUNTIME_ARRAY)
+      {
+        throw std::runtime_error(fmt::format(
+          "{}: set {} binding {} is a runtime sized array, its layout must be "
+          "written by hand",
+          name,
+          binding.set,
+          binding.binding));
+      }
+      if (opcode(type) == OP_TYPE_ARRAY)
+      {
+        binding.count = module.constant(type[3]);
+        typeId        = type[2];
+      }
+      binding.type = descriptorType(module, storageClass, typeId);
+      reflection.bindings.push_back(binding);
+    }
+  }
+
+  std::sort(
+    reflection.bindings.begin(),
+    reflection.bindings.end(),
+    [](const ShaderBinding& a, const ShaderBinding& b) {
+      return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+  std::sort(
+    reflection.vertexInputs.begin(),
+    reflection.vertexInputs.end(),
+    [](const ShaderVertexInput& a, const ShaderVertexInput& b) {
+      return a.location < b.location;
+    });
+  return reflection;
+}
+
+//----------------------------------------------------------------------------------------
+uint32_t
+vertexAttributes(
+  const ShaderReflection& shader,
+  uint32_t binding,
+  std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+  uint32_t offset = 0;
+  for (const ShaderVertexInput& input : shader.vertexInputs)
+  {
+    VkVertexInputAttributeDescription attribute = {};
+    attribute.location                          = input.location;
+    attribute.binding                           = binding;
+    attribute.format                            = input.format;
+    attribute.offset                            = offset;
+    attributes.push_back(attribute);
+    offset += input.size;
+  }
+  return offset;
+}
+
+//----------------------------------------------------------------------------------------
+// FNV-1a, a word at a time
+size_t
+PipelineLayoutCache::KeyHash::operator()(const Key& key) const
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (uint32_t word : key)
+  {
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  return static_cast<size_t>(hash);
+}
+
+//----------------------------------------------------------------------------------------
+void
+PipelineLayoutCache::init(VkDevice device)
+{
+  m_device = device;
+}
+
+//----------------------------------------------------------------------------------------
+void
+PipelineLayoutCache::cleanup()
+{
+  for (const auto& layout : m_layouts)
+  {
+    vkDestroyPipelineLayout(m_device, layout.second.pipelineLayout, nullptr);
+  }
+  for (const auto& setLayout : m_setLayouts)
+  {
+    vkDestroyDescriptorSetLayout(m_device, setLayout.second, nullptr);
+  }
+  m_layouts.clear();
+  m_setLayouts.clear();
+}
+
+//----------------------------------------------------------------------------------------
+VkDescriptorSetLayout
+PipelineLayoutCache::getSetLayout(const std::vector<ShaderBinding>& bindings)
+{
+  Key key;
+  for (const ShaderBinding& binding : bindings)
+  {
+    key.insert(
+      key.end(),
+      {binding.binding, uint32_t(binding.type), binding.count, binding.stageFlags});
+  }
+  auto found = m_setLayouts.find(key);
+  if (found != m_setLayouts.end())
+  {
+    return found->second;
+  }
+
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  for (const ShaderBinding& binding : bindings)
+  {
+    VkDescriptorSetLayoutBinding layoutBinding = {};
+    layoutBinding.binding                      = binding.binding;
+    layoutBinding.descriptorType               = binding.type;
+    layoutBinding.descriptorCount              = binding.count;
+    layoutBinding.stageFlags                   = binding.stageFlags;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+  layoutInfo.pBindings    = layoutBindings.data();
+
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  if (
+    vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &setLayout)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor set layout!");
+  }
+  m_setLayouts.emplace(std::move(key), setLayout);
+  return setLayout;
+}
+
+//----------------------------------------------------------------------------------------
+const PipelineLayoutCache::Layout&
+PipelineLayoutCache::get(const std::vector<const ShaderReflection*>& stages)
+{
+  std::vector<ShaderBinding> bindings;
+  VkShaderStageFlags pushConstantStages = 0;
+  uint32_t pushConstantSize             = 0;
+  for (const ShaderReflection* stage : stages)
+  {
+    for (const ShaderBinding& binding : stage->bindings)
+    {
+      auto found =
+        std::find_if(bindings.begin(), bindings.end(), [&](const ShaderBinding& other) {
+          return other.set == binding.set && other.binding == binding.binding;
+        });
+      if (found == bindings.end())
+      {
+        bindings.push_back(binding);
+      }
+      else if (found->type != binding.type || found->count != binding.count)
+      {
+        throw std::runtime_error(fmt::format(
+          "set {} binding {} is declared differently by two stages",
+          binding.set,
+          binding.binding));
+      }
+      else
+      {
+        found->stageFlags |= binding.stageFlags;
+      }
+    }
+    // One range over every stage's constants; the stages read what they declare
+    if (stage->pushConstantSize > 0)
+    {
+      pushConstantStages |= stage->stage;
+      pushConstantSize = std::max(pushConstantSize, stage->pushConstantSize);
+    }
+  }
+  std::sort(
+    bindings.begin(), bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+      return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+  Key key = {pushConstantStages, pushConstantSize};
+  for (const ShaderBinding& binding : bindings)
+  {
+    key.insert(
+      key.end(),
+      {binding.set,
+       binding.binding,
+       uint32_t(binding.type),
+       binding.count,
+       binding.stageFlags});
+  }
+  auto found = m_layouts.find(key);
+  if (found != m_layouts.end())
+  {
+    return found->second;
+  }
+
+  Layout layout             = {};
+  layout.pushConstantStages = pushConstantStages;
+  layout.pushConstantSize   = pushConstantSize;
+  const uint32_t setCount   = bindings.empty() ? 0 : bindings.back().set + 1;
+  for (uint32_t set = 0; set < setCount; ++set)
+  {
+    std::vector<ShaderBinding> setBindings;
+    for (const ShaderBinding& binding : bindings)
+    {
+      if (binding.set == set)
+      {
+        setBindings.push_back(binding);
+      }
+    }
+    layout.setLayouts.push_back(getSetLayout(setBindings));
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags          = pushConstantStages;
+  pushConstantRange.size                = pushConstantSize;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = setCount;
+  pipelineLayoutInfo.pSetLayouts    = layout.setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  if (
+    vkCreatePipelineLayout(
+      m_device, &pipelineLayoutInfo, nullptr, &layout.pipelineLayout)
+    != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+  return m_layouts.emplace(std::move(key), std::move(layout)).first->second;
+}
+
+//----------------------------------------------------------------------------------------
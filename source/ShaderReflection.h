@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+struct ShaderBinding
+{
+  uint32_t set                  = 0;
+  uint32_t binding              = 0;
+  VkDescriptorType type         = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+  uint32_t count                = 1;
+  VkShaderStageFlags stageFlags = 0;
+};
+
+struct ShaderVertexInput
+{
+  uint32_t location = 0;
+  VkFormat format   = VK_FORMAT_UNDEFINED;
+  uint32_t size     = 0;    // bytes
+};
+
+//----------------------------------------------------------------------------------------
+// What a SPIR-V module expects from its pipeline layout and vertex input, read from the
+// module's own decorations. It describes the binary that actually runs, after the
+// optimiser removed whatever the shader doesn't use
+struct ShaderReflection
+{
+  VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+  std::vector<ShaderBinding> bindings;            // sorted by set, then binding
+  uint32_t pushConstantSize = 0;                  // bytes from offset 0, 0: none
+  std::vector<ShaderVertexInput> vertexInputs;    // vertex shaders, sorted by location
+};
+
+// name: for error messages. Throws on what a generated layout can't express, e.g.
+// runtime sized descriptor arrays
+ShaderReflection reflectShader(const std::vector<char>& code, const std::string& name);
+
+// The attribute descriptions for a vertex buffer binding holding the shader's inputs back
+// to back in location order; returns the stride
+uint32_t vertexAttributes(
+  const ShaderReflection& shader,
+  uint32_t binding,
+  std::vector<VkVertexInputAttributeDescription>& attributes);
+
+//----------------------------------------------------------------------------------------
+// Pipeline layouts generated from the reflection of their stages. A layout is created
+// once per distinct interface (the merged bindings and push constants) and found again by
+// a hash of it, and descriptor set layouts are shared the same way, so pipelines with
+// the same interface get the same, compatible layouts. Everything lives until cleanup().
+// Layouts that need more than the shaders say (update-after-bind or partially bound
+// bindings, sets shared with other pipelines that use more of them) stay hand-written.
+//----------------------------------------------------------------------------------------
+class PipelineLayoutCache
+{
+public:
+  struct Layout
+  {
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> setLayouts;    // by set number, gaps left empty
+    VkShaderStageFlags pushConstantStages = 0;        // pass to vkCmdPushConstants
+    uint32_t pushConstantSize             = 0;
+  };
+
+private:
+  using Key = std::vector<uint32_t>;
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const;
+  };
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> m_setLayouts;
+  std::unordered_map<Key, Layout, KeyHash> m_layouts;
+
+private:
+  VkDescriptorSetLayout getSetLayout(const std::vector<ShaderBinding>& bindings);
+
+public:
+  void init(VkDevice device);
+  // The device must be idle
+  void cleanup();
+
+  // A binding used by several stages must have the same type and count in each. The
+  // reference stays valid until cleanup()
+  const Layout& get(const std::vector<const ShaderReflection*>& stages);
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,165 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------
+constexpr float TWO_PI = 6.28318531f;
+
+// Radians per second
+constexpr float SPIN_RATE   = 1.0f;
+constexpr float CAMERA_RATE = 0.25f;
+
+//----------------------------------------------------------------------------------------
+static float
+wrapAngle(float angle)
+{
+  angle = std::fmod(angle, TWO_PI);
+  return angle < 0.0f ? angle + TWO_PI : angle;
+}
+
+//----------------------------------------------------------------------------------------
+static float
+interpolateAngle(float a, float b, float t)
+{
+  float delta = b - a;
+  if (delta > 0.5f * TWO_PI)
+  {
+    delta -= TWO_PI;
+  }
+  else if (delta < -0.5f * TWO_PI)
+  {
+    delta += TWO_PI;
+  }
+  return wrapAngle(a + delta * t);
+}
+
+//----------------------------------------------------------------------------------------
+SceneState
+interpolate(const SceneState& a, const SceneState& b, float t)
+{
+  SceneState state = {};
+  state.spin       = interpolateAngle(a.spin, b.spin, t);
+  state.cameraYaw  = interpolateAngle(a.cameraYaw, b.cameraYaw, t);
+  return state;
+}
+
+//----------------------------------------------------------------------------------------
+void
+Simulation::start(float tickRate)
+{
+  assert(tickRate > 0.0f);
+  stop();
+
+  m_tickLength = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1.0 / tickRate));
+  m_state        = {};
+  m_tickCount    = 0;
+  m_droppedTicks = 0;
+  m_stop         = false;
+
+  // The initial state is tick 0, at start
+  const Clock::time_point start = Clock::now();
+  Snapshot& snapshot            = m_snapshots.back();
+  snapshot.previous             = m_state;
+  snapshot.current              = m_state;
+  snapshot.currentTime          = start;
+  m_snapshots.publish();
+
+  m_thread = std::thread(&Simulation::threadLoop, this, start);
+}
+
+//----------------------------------------------------------------------------------------
+void
+Simulation::stop()
+{
+  if (!m_thread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_thread.join();
+}
+
+//----------------------------------------------------------------------------------------
+float
+Simulation::tickRate() const
+{
+  return static_cast<float>(1.0 / std::chrono::duration<double>(m_tickLength).count());
+}
+
+//----------------------------------------------------------------------------------------
+// Tick n is the state at start + n ticks, published once that time has come
+void
+Simulation::threadLoop(Clock::time_point start)
+{
+  const float seconds   = std::chrono::duration<float>(m_tickLength).count();
+  Clock::time_point due = start;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    due += m_tickLength;
+    if (m_wake.wait_until(lock, due, [this] { return m_stop; }))
+    {
+      return;
+    }
+    lock.unlock();
+
+    // Overran: catch up back to back, or give up on the time beyond a few ticks
+    const Clock::time_point now = Clock::now();
+    const int64_t behind        = (now - due) / m_tickLength;
+    if (behind > static_cast<int64_t>(MAX_CATCH_UP_TICKS))
+    {
+      const int64_t dropped = behind - MAX_CATCH_UP_TICKS;
+      due += dropped * m_tickLength;
+      m_droppedTicks += static_cast<uint64_t>(dropped);
+    }
+
+    const SceneState previous = m_state;
+    tick(seconds);
+    ++m_tickCount;
+
+    Snapshot& snapshot   = m_snapshots.back();
+    snapshot.previous    = previous;
+    snapshot.current     = m_state;
+    snapshot.currentTime = due;
+    m_snapshots.publish();
+
+    lock.lock();
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// One fixed step of the scene
+void
+Simulation::tick(float seconds)
+{
+  m_state.spin      = wrapAngle(m_state.spin + SPIN_RATE * seconds);
+  m_state.cameraYaw = wrapAngle(m_state.cameraYaw + CAMERA_RATE * seconds);
+}
+
+//----------------------------------------------------------------------------------------
+// current is the state at currentTime, previous one tick earlier: now - 1 tick falls
+// between them until the next tick is published. A late tick holds the newest state
+// rather than extrapolating
+SceneState
+Simulation::sample(Clock::time_point now)
+{
+  if (!running())
+  {
+    return {};
+  }
+  m_snapshots.update();
+
+  const Snapshot& snapshot                    = m_snapshots.front();
+  const std::chrono::duration<float> sinceTick = now - snapshot.currentTime;
+  const float t = sinceTick / std::chrono::duration<float>(m_tickLength);
+  return interpolate(snapshot.previous, snapshot.current, std::clamp(t, 0.0f, 1.0f));
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "TripleBuffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+//----------------------------------------------------------------------------------------
+// What the scene looks like at one moment: everything the simulation advances and the
+// renderer draws. Angles are kept in [0, 2 pi) so they don't lose precision over a long
+// run, as a float of seconds since start would
+struct SceneState
+{
+  float spin      = 0.0f;    // radians, of the spinning groups (every other one reversed)
+  float cameraYaw = 0.0f;    // radians
+};
+
+// a at t = 0 to b at t = 1, angles the short way round
+SceneState interpolate(const SceneState& a, const SceneState& b, float t);
+
+//----------------------------------------------------------------------------------------
+// Advances the scene at a fixed tick rate on a thread of its own, whatever the render
+// rate. After every tick it publishes the last two states with the time the newer one
+// is for; the renderer draws a blend of the two for the current time, one tick behind,
+// so motion stays smooth at any frame rate and a slow frame or a slow tick only delays
+// its own thread.
+// A tick that overruns is caught up by running the next ones back to back, up to
+// MAX_CATCH_UP_TICKS, beyond which the lost time is dropped (the scene slows down rather
+// than the thread spiralling).
+//----------------------------------------------------------------------------------------
+class Simulation
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint32_t MAX_CATCH_UP_TICKS = 5;
+
+private:
+  struct Snapshot
+  {
+    SceneState previous;
+    SceneState current;
+    Clock::time_point currentTime;    // what current is the state at
+  };
+
+  Clock::duration m_tickLength = {};
+  SceneState m_state;                   // simulation thread only
+  TripleBuffer<Snapshot> m_snapshots;    // simulation thread to the renderer
+  uint64_t m_tickCount    = 0;
+  uint64_t m_droppedTicks = 0;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+
+private:
+  void threadLoop(Clock::time_point start);
+  void tick(float seconds);
+
+public:
+  Simulation() = default;
+  ~Simulation() { stop(); }
+
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  // Starts ticking tickRate times per second from the initial state
+  void start(float tickRate);
+  // Joins the thread, the tick counts are final after it
+  void stop();
+
+  bool running() const { return m_thread.joinable(); }
+  float tickRate() const;
+  uint64_t tickCount() const { return m_tickCount; }
+  uint64_t droppedTicks() const { return m_droppedTicks; }
+
+  // Renderer only: the scene at now, interpolated between the last two ticks. The
+  // initial state when not running
+  SceneState sample(Clock::time_point now);
+};
+
+//----------------------------------------------------------------------------------------
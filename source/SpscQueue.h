@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------
+// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+// Each side only writes its own index, so neither ever waits on the other: push() fails
+// when the queue is full and pop() when it is empty, and the caller decides what to do.
+// Capacity must be a power of two.
+//----------------------------------------------------------------------------------------
+template<typename T, uint32_t Capacity>
+class SpscQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+  T m_items[Capacity] = {};
+  alignas(64) std::atomic<uint32_t> m_head{0};    // next to pop, consumer only writes
+  alignas(64) std::atomic<uint32_t> m_tail{0};    // next to push, producer only writes
+
+public:
+  // Producer only
+  bool push(const T& item);
+  // Consumer only
+  bool pop(T& item);
+};
+
+//----------------------------------------------------------------------------------------
+template<typename T, uint32_t Capacity>
+bool
+SpscQueue<T, Capacity>::push(const T& item)
+{
+  const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+  {
+    return false;
+  }
+  m_items[tail & (Capacity - 1)] = item;
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
+template<typename T, uint32_t Capacity>
+bool
+SpscQueue<T, Capacity>::pop(T& item)
+{
+  const uint32_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  item = m_items[head & (Capacity - 1)];
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
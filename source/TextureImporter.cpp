@@ -0,0 +1,345 @@
+#include <fmt/format.h>
+
+#include "TextureImporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr uint8_t KTX2_IDENTIFIER[12] = {
+  0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr size_t KTX2_HEADER_SIZE      = 80;    // identifier, header and index
+constexpr size_t KTX2_LEVEL_INDEX_SIZE = 24;
+
+constexpr uint32_t
+makeFourCC(char a, char b, char c, char d)
+{
+  return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16)
+         | (uint32_t(uint8_t(d)) << 24);
+}
+
+constexpr uint32_t DDS_MAGIC            = makeFourCC('D', 'D', 'S', ' ');
+constexpr size_t DDS_HEADER_END         = 128;    // magic + DDS_HEADER
+constexpr size_t DDS_DX10_HEADER_END    = DDS_HEADER_END + 20;
+constexpr uint32_t DDSD_MIPMAPCOUNT     = 0x20000;
+constexpr uint32_t DDPF_FOURCC          = 0x4;
+constexpr uint32_t DDPF_RGB             = 0x40;
+constexpr uint32_t DDSCAPS2_CUBEMAP     = 0x200;
+constexpr uint32_t DDSCAPS2_VOLUME      = 0x200000;
+constexpr uint32_t DDS_DIMENSION_2D     = 3;
+constexpr uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+readU32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+//----------------------------------------------------------------------------------------
+static uint64_t
+readU64(const uint8_t* p)
+{
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+//----------------------------------------------------------------------------------------
+FormatBlock
+formatBlock(VkFormat format)
+{
+  switch (format)
+  {
+    case VK_FORMAT_R8_UNORM: return {1, 1, 1};
+    case VK_FORMAT_R8G8_UNORM: return {1, 1, 2};
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB: return {1, 1, 4};
+    case VK_FORMAT_R16G16B16A16_SFLOAT: return {1, 1, 8};
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK: return {4, 4, 8};
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK: return {4, 4, 16};
+
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return {4, 4, 16};
+    case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x5_SRGB_BLOCK: return {5, 5, 16};
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK: return {6, 6, 16};
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK: return {8, 8, 16};
+
+    default:
+      throw std::runtime_error(fmt::format("unsupported texture format {}", int(format)));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+size_t
+imageSize(VkFormat format, uint32_t width, uint32_t height)
+{
+  const FormatBlock block = formatBlock(format);
+  const size_t blocksX    = (width + block.width - 1) / block.width;
+  const size_t blocksY    = (height + block.height - 1) / block.height;
+  return blocksX * blocksY * block.bytes;
+}
+
+//----------------------------------------------------------------------------------------
+// DXGI_FORMAT values from the DX10 header extension
+static VkFormat
+dxgiToVkFormat(uint32_t dxgiFormat)
+{
+  switch (dxgiFormat)
+  {
+    case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+    case 49: return VK_FORMAT_R8G8_UNORM;
+    case 61: return VK_FORMAT_R8_UNORM;
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+    case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+    case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+    case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default:
+      throw std::runtime_error(fmt::format("unsupported DXGI format {}", dxgiFormat));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+TextureFile::TextureFile(const std::string& filename)
+    : m_filename(filename)
+    , m_file(filename)
+{
+  std::string extension = filename.substr(std::min(filename.rfind('.'), filename.size()));
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+    return static_cast<char>(tolower(c));
+  });
+
+  try
+  {
+    if (extension == ".ktx2")
+    {
+      parseKtx2();
+    }
+    else if (extension == ".dds")
+    {
+      parseDds();
+    }
+    else
+    {
+      throw std::runtime_error("unsupported texture file (expected .ktx2 or .dds)");
+    }
+  }
+  catch (const std::runtime_error& e)
+  {
+    throw std::runtime_error(fmt::format("{}: {}", filename, e.what()));
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureFile::parseKtx2()
+{
+  const uint8_t* data = m_file.data();
+  const size_t size   = m_file.size();
+  if (
+    size < KTX2_HEADER_SIZE
+    || memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+  {
+    throw std::runtime_error("not a KTX2 file");
+  }
+
+  m_data.format                   = static_cast<VkFormat>(readU32(data + 12));
+  m_data.width                    = readU32(data + 20);
+  m_data.height                   = readU32(data + 24);
+  const uint32_t depth            = readU32(data + 28);
+  const uint32_t layerCount       = readU32(data + 32);
+  const uint32_t faceCount        = readU32(data + 36);
+  const uint32_t levelCount       = readU32(data + 40);
+  const uint32_t supercompression = readU32(data + 44);
+
+  if (m_data.format == VK_FORMAT_UNDEFINED || supercompression != 0)
+  {
+    throw std::runtime_error("Basis Universal / supercompressed KTX2 isn't supported");
+  }
+  if (
+    m_data.width == 0 || m_data.height == 0 || depth > 1 || layerCount > 1
+    || faceCount != 1)
+  {
+    throw std::runtime_error("only single 2D textures are supported");
+  }
+
+  // levelCount 0 asks the loader to generate the mips
+  const uint32_t storedLevels = std::max(levelCount, 1u);
+  if (storedLevels > 32 || KTX2_HEADER_SIZE + storedLevels * KTX2_LEVEL_INDEX_SIZE > size)
+  {
+    throw std::runtime_error("invalid level index");
+  }
+
+  for (uint32_t level = 0; level < storedLevels; ++level)
+  {
+    const uint8_t* entry  = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+    const uint64_t offset = readU64(entry);
+    const uint64_t length = readU64(entry + 8);
+
+    TextureLevel textureLevel;
+    textureLevel.width  = std::max(m_data.width >> level, 1u);
+    textureLevel.height = std::max(m_data.height >> level, 1u);
+    textureLevel.size =
+      imageSize(m_data.format, textureLevel.width, textureLevel.height);
+    if (offset > size || length > size - offset || length < textureLevel.size)
+    {
+      throw std::runtime_error(fmt::format("level {} lies outside the file", level));
+    }
+    textureLevel.data = data + offset;
+    m_data.levels.push_back(textureLevel);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureFile::parseDds()
+{
+  const uint8_t* data = m_file.data();
+  const size_t size   = m_file.size();
+  if (size < DDS_HEADER_END || readU32(data) != DDS_MAGIC || readU32(data + 4) != 124)
+  {
+    throw std::runtime_error("not a DDS file");
+  }
+
+  const uint32_t flags      = readU32(data + 8);
+  m_data.height             = readU32(data + 12);
+  m_data.width              = readU32(data + 16);
+  const uint32_t mipCount   = readU32(data + 28);
+  const uint32_t pixelFlags = readU32(data + 80);
+  const uint32_t fourCC     = readU32(data + 84);
+  const uint32_t bitCount   = readU32(data + 88);
+  const uint32_t redMask    = readU32(data + 92);
+  const uint32_t blueMask   = readU32(data + 100);
+  const uint32_t caps2      = readU32(data + 112);
+  size_t dataOffset         = DDS_HEADER_END;
+
+  if (
+    m_data.width == 0 || m_data.height == 0
+    || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+  {
+    throw std::runtime_error("only single 2D textures are supported");
+  }
+
+  if ((pixelFlags & DDPF_FOURCC) && fourCC == makeFourCC('D', 'X', '1', '0'))
+  {
+    if (size < DDS_DX10_HEADER_END)
+    {
+      throw std::runtime_error("truncated DX10 header");
+    }
+    m_data.format = dxgiToVkFormat(readU32(data + DDS_HEADER_END));
+    if (
+      readU32(data + DDS_HEADER_END + 4) != DDS_DIMENSION_2D
+      || (readU32(data + DDS_HEADER_END + 8) & DDS_MISC_TEXTURECUBE)
+      || readU32(data + DDS_HEADER_END + 12) > 1)
+    {
+      throw std::runtime_error("only single 2D textures are supported");
+    }
+    dataOffset = DDS_DX10_HEADER_END;
+  }
+  else if (pixelFlags & DDPF_FOURCC)
+  {
+    switch (fourCC)
+    {
+      case makeFourCC('D', 'X', 'T', '1'):
+        m_data.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        break;
+      case makeFourCC('D', 'X', 'T', '3'):
+        m_data.format = VK_FORMAT_BC2_UNORM_BLOCK;
+        break;
+      case makeFourCC('D', 'X', 'T', '5'):
+        m_data.format = VK_FORMAT_BC3_UNORM_BLOCK;
+        break;
+      case makeFourCC('A', 'T', 'I', '1'):
+      case makeFourCC('B', 'C', '4', 'U'):
+        m_data.format = VK_FORMAT_BC4_UNORM_BLOCK;
+        break;
+      case makeFourCC('A', 'T', 'I', '2'):
+      case makeFourCC('B', 'C', '5', 'U'):
+        m_data.format = VK_FORMAT_BC5_UNORM_BLOCK;
+        break;
+      default: throw std::runtime_error("unsupported DDS FourCC");
+    }
+  }
+  else if ((pixelFlags & DDPF_RGB) && bitCount == 32 && redMask == 0x000000FF)
+  {
+    m_data.format = VK_FORMAT_R8G8B8A8_UNORM;
+  }
+  else if ((pixelFlags & DDPF_RGB) && bitCount == 32 && blueMask == 0x000000FF)
+  {
+    m_data.format = VK_FORMAT_B8G8R8A8_UNORM;
+  }
+  else
+  {
+    throw std::runtime_error("unsupported DDS pixel format");
+  }
+
+  // Levels are stored back to back, largest first
+  const uint32_t levelCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(mipCount, 1u) : 1u;
+  if (levelCount > 32)
+  {
+    throw std::runtime_error("invalid mip count");
+  }
+  addLevels(data + dataOffset, size - dataOffset, levelCount);
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureFile::addLevels(const uint8_t* data, size_t size, uint32_t levelCount)
+{
+  size_t offset = 0;
+  for (uint32_t level = 0; level < levelCount; ++level)
+  {
+    TextureLevel textureLevel;
+    textureLevel.width  = std::max(m_data.width >> level, 1u);
+    textureLevel.height = std::max(m_data.height >> level, 1u);
+    textureLevel.size =
+      imageSize(m_data.format, textureLevel.width, textureLevel.height);
+    if (textureLevel.size > size - offset)
+    {
+      throw std::runtime_error(fmt::format("level {} lies outside the file", level));
+    }
+    textureLevel.data = data + offset;
+    offset += textureLevel.size;
+    m_data.levels.push_back(textureLevel);
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Texel block of a format: 1x1 for uncompressed formats, 4x4 for BCn, NxM for ASTC
+struct FormatBlock
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes;
+};
+
+// Throws std::runtime_error for formats the texture code doesn't know
+FormatBlock formatBlock(VkFormat format);
+
+// Bytes of one tightly packed width x height image
+size_t imageSize(VkFormat format, uint32_t width, uint32_t height);
+
+//----------------------------------------------------------------------------------------
+struct TextureLevel
+{
+  const uint8_t* data = nullptr;
+  size_t size         = 0;
+  uint32_t width      = 0;
+  uint32_t height     = 0;
+};
+
+// A 2D texture as stored in the file; levels point into the file mapping
+struct TextureData
+{
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t width  = 0;
+  uint32_t height = 0;
+  std::vector<TextureLevel> levels;    // base level first
+};
+
+//----------------------------------------------------------------------------------------
+// Memory mapped KTX2 (.ktx2, no supercompression) or DDS (.dds, incl. the DX10 header)
+// 2D texture. Level data is validated against the file size but not copied, so the file
+// must outlive any use of data(). Throws std::runtime_error on unsupported files.
+//----------------------------------------------------------------------------------------
+class TextureFile
+{
+  std::string m_filename;
+  MappedFile m_file;
+  TextureData m_data;
+
+private:
+  void parseKtx2();
+  void parseDds();
+  void addLevels(const uint8_t* data, size_t size, uint32_t levelCount);
+
+public:
+  explicit TextureFile(const std::string& filename);
+
+  const TextureData& data() const { return m_data; }
+};
+
+//----------------------------------------------------------------------------------------
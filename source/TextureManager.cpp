@@ -0,0 +1,501 @@
+#include <fmt/format.h>
+
+#include "TextureManager.h"
+#include "MemoryTelemetry.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+//----------------------------------------------------------------------------------------
+// vkCmdCopyBufferToImage offsets must be a multiple of 4 and of the texel block size
+constexpr VkDeviceSize STAGING_LEVEL_ALIGNMENT = 16;
+
+//----------------------------------------------------------------------------------------
+bool
+SamplerDesc::operator<(const SamplerDesc& other) const
+{
+  return std::tie(filter, mipmapMode, addressMode, maxAnisotropy)
+         < std::tie(
+           other.filter, other.mipmapMode, other.addressMode, other.maxAnisotropy);
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureManager::init(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  const VkPhysicalDeviceFeatures& enabledFeatures)
+{
+  assert(physicalDevice != VK_NULL_HANDLE);
+  assert(device != VK_NULL_HANDLE);
+
+  m_physicalDevice = physicalDevice;
+  m_device         = device;
+  m_commandPool    = commandPool;
+  m_queue          = queue;
+  m_features       = enabledFeatures;
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+  m_maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureManager::cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  for (TextureHandle handle = 0; handle < m_textures.size(); ++handle)
+  {
+    if (m_textures[handle].image != VK_NULL_HANDLE)
+    {
+      destroyTexture(handle);
+    }
+  }
+  m_textures.clear();
+  m_freeHandles.clear();
+
+  for (auto& sampler : m_samplers)
+  {
+    vkDestroySampler(m_device, sampler.second, nullptr);
+  }
+  m_samplers.clear();
+  m_device = VK_NULL_HANDLE;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+TextureManager::isFormatSupported(VkFormat format) const
+{
+  formatBlock(format);    // throws for formats the uploader can't size
+
+  // Compressed formats also need their device feature enabled, not just format support
+  const bool isBC =
+    format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+  const bool isASTC =
+    format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+  if ((isBC && !m_features.textureCompressionBC)
+      || (isASTC && !m_features.textureCompressionASTC_LDR))
+  {
+    return false;
+  }
+
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+  return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+TextureManager::canGenerateMips(VkFormat format) const
+{
+  if (formatBlock(format).width != 1)
+  {
+    return false;    // blits can't write compressed blocks
+  }
+
+  const VkFormatFeatureFlags required =
+    VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+    | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+  return (properties.optimalTilingFeatures & required) == required;
+}
+
+//----------------------------------------------------------------------------------------
+TextureHandle
+TextureManager::loadTexture(const std::string& filename)
+{
+  TextureFile file(filename);
+  TextureHandle handle = createTexture(file.data());
+
+  const Texture& loaded = texture(handle);
+  fmt::print(
+    "Loaded {}: {}x{}, VkFormat {}, {} mip levels ({} from the file)\n",
+    filename,
+    loaded.width,
+    loaded.height,
+    int(loaded.format),
+    loaded.mipLevels,
+    file.data().levels.size());
+  return handle;
+}
+
+//----------------------------------------------------------------------------------------
+TextureHandle
+TextureManager::createTexture(
+  VkFormat format,
+  uint32_t width,
+  uint32_t height,
+  const void* pixels)
+{
+  TextureLevel level;
+  level.data   = static_cast<const uint8_t*>(pixels);
+  level.size   = imageSize(format, width, height);
+  level.width  = width;
+  level.height = height;
+
+  TextureData data;
+  data.format = format;
+  data.width  = width;
+  data.height = height;
+  data.levels.push_back(level);
+  return createTexture(data);
+}
+
+//----------------------------------------------------------------------------------------
+TextureHandle
+TextureManager::createTexture(const TextureData& data)
+{
+  assert(m_device != VK_NULL_HANDLE);
+  assert(!data.levels.empty());
+
+  if (!isFormatSupported(data.format))
+  {
+    throw std::runtime_error(
+      fmt::format("texture format {} isn't supported by this device", int(data.format)));
+  }
+
+  const bool generateMips = data.levels.size() == 1 && canGenerateMips(data.format);
+
+  Texture texture;
+  texture.format    = data.format;
+  texture.width     = data.width;
+  texture.height    = data.height;
+  texture.mipLevels = static_cast<uint32_t>(data.levels.size());
+  if (generateMips)
+  {
+    texture.mipLevels =
+      static_cast<uint32_t>(std::floor(std::log2(std::max(data.width, data.height)))) + 1;
+  }
+
+  VkImageCreateInfo imageInfo = {};
+  imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+  imageInfo.format            = texture.format;
+  imageInfo.extent            = {texture.width, texture.height, 1};
+  imageInfo.mipLevels         = texture.mipLevels;
+  imageInfo.arrayLayers       = 1;
+  imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+                    | (generateMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+  imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (vkCreateImage(m_device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create texture image!");
+  }
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(m_device, texture.image, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize       = memRequirements.size;
+  allocInfo.memoryTypeIndex      = findMemoryType(
+    m_physicalDevice,
+    memRequirements.memoryTypeBits,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if (allocateDeviceMemory(m_device, allocInfo, texture.memory) != VK_SUCCESS)
+  {
+    vkDestroyImage(m_device, texture.image, nullptr);
+    throw std::runtime_error("failed to allocate texture image memory!");
+  }
+  vkBindImageMemory(m_device, texture.image, texture.memory, 0);
+
+  // Every level the file has goes into one staging buffer, one copy region each
+  std::vector<VkBufferImageCopy> regions(data.levels.size());
+  VkDeviceSize stagingSize = 0;
+  for (size_t level = 0; level < data.levels.size(); ++level)
+  {
+    VkBufferImageCopy& region              = regions[level];
+    region.bufferOffset                    = stagingSize;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = static_cast<uint32_t>(level);
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent = {data.levels[level].width, data.levels[level].height, 1};
+
+    stagingSize += data.levels[level].size;
+    stagingSize = (stagingSize + STAGING_LEVEL_ALIGNMENT - 1)
+                  & ~(STAGING_LEVEL_ALIGNMENT - 1);
+  }
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  createBuffer(
+    m_physicalDevice,
+    m_device,
+    stagingSize,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    stagingBuffer,
+    stagingBufferMemory);
+
+  void* mapped;
+  vkMapMemory(m_device, stagingBufferMemory, 0, stagingSize, 0, &mapped);
+  for (size_t level = 0; level < data.levels.size(); ++level)
+  {
+    memcpy(
+      static_cast<uint8_t*>(mapped) + regions[level].bufferOffset,
+      data.levels[level].data,
+      data.levels[level].size);
+  }
+  vkUnmapMemory(m_device, stagingBufferMemory);
+
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands(m_device, m_commandPool);
+
+  VkImageMemoryBarrier barrier            = {};
+  barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask                   = 0;
+  barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image                           = texture.image;
+  barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel   = 0;
+  barrier.subresourceRange.levelCount     = texture.mipLevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount     = 1;
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0,
+    0,
+    nullptr,
+    0,
+    nullptr,
+    1,
+    &barrier);
+
+  vkCmdCopyBufferToImage(
+    commandBuffer,
+    stagingBuffer,
+    texture.image,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    static_cast<uint32_t>(regions.size()),
+    regions.data());
+
+  if (generateMips)
+  {
+    recordMipGeneration(commandBuffer, texture);
+  }
+  else
+  {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+  }
+
+  endSingleTimeCommands(m_device, m_commandPool, m_queue, commandBuffer);
+
+  vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+  freeDeviceMemory(m_device, stagingBufferMemory);
+
+  VkImageViewCreateInfo viewInfo           = {};
+  viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image                           = texture.image;
+  viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format                          = texture.format;
+  viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel   = 0;
+  viewInfo.subresourceRange.levelCount     = texture.mipLevels;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount     = 1;
+
+  if (vkCreateImageView(m_device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+  {
+    vkDestroyImage(m_device, texture.image, nullptr);
+    freeDeviceMemory(m_device, texture.memory);
+    throw std::runtime_error("failed to create texture image view!");
+  }
+
+  if (!m_freeHandles.empty())
+  {
+    TextureHandle handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+    m_textures[handle] = texture;
+    return handle;
+  }
+  m_textures.push_back(texture);
+  return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+//----------------------------------------------------------------------------------------
+// Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled in; each level is
+// blitted from the one above it, and all of them end up SHADER_READ_ONLY_OPTIMAL
+void
+TextureManager::recordMipGeneration(VkCommandBuffer commandBuffer, const Texture& texture)
+{
+  VkImageMemoryBarrier barrier            = {};
+  barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image                           = texture.image;
+  barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount     = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount     = 1;
+
+  auto transition = [&](
+                      uint32_t level,
+                      VkImageLayout oldLayout,
+                      VkImageLayout newLayout,
+                      VkAccessFlags srcAccess,
+                      VkAccessFlags dstAccess,
+                      VkPipelineStageFlags dstStage) {
+    barrier.subresourceRange.baseMipLevel = level;
+    barrier.oldLayout                     = oldLayout;
+    barrier.newLayout                     = newLayout;
+    barrier.srcAccessMask                 = srcAccess;
+    barrier.dstAccessMask                 = dstAccess;
+    vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      dstStage,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+  };
+
+  int32_t width  = static_cast<int32_t>(texture.width);
+  int32_t height = static_cast<int32_t>(texture.height);
+  for (uint32_t level = 1; level < texture.mipLevels; ++level)
+  {
+    transition(
+      level - 1,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    const int32_t nextWidth  = std::max(width / 2, 1);
+    const int32_t nextHeight = std::max(height / 2, 1);
+
+    VkImageBlit blit                   = {};
+    blit.srcOffsets[1]                 = {width, height, 1};
+    blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel       = level - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount     = 1;
+    blit.dstOffsets[1]                 = {nextWidth, nextHeight, 1};
+    blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.mipLevel       = level;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount     = 1;
+    vkCmdBlitImage(
+      commandBuffer,
+      texture.image,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      texture.image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &blit,
+      VK_FILTER_LINEAR);
+
+    transition(
+      level - 1,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    width  = nextWidth;
+    height = nextHeight;
+  }
+
+  transition(
+    texture.mipLevels - 1,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_ACCESS_SHADER_READ_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+//----------------------------------------------------------------------------------------
+void
+TextureManager::destroyTexture(TextureHandle handle)
+{
+  Texture& texture = m_textures[handle];
+  vkDestroyImageView(m_device, texture.view, nullptr);
+  vkDestroyImage(m_device, texture.image, nullptr);
+  freeDeviceMemory(m_device, texture.memory);
+  texture = {};
+  m_freeHandles.push_back(handle);
+}
+
+//----------------------------------------------------------------------------------------
+VkSampler
+TextureManager::getSampler(const SamplerDesc& desc)
+{
+  assert(m_device != VK_NULL_HANDLE);
+
+  auto found = m_samplers.find(desc);
+  if (found != m_samplers.end())
+  {
+    return found->second;
+  }
+
+  VkSamplerCreateInfo samplerInfo     = {};
+  samplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter               = desc.filter;
+  samplerInfo.minFilter               = desc.filter;
+  samplerInfo.mipmapMode              = desc.mipmapMode;
+  samplerInfo.addressModeU            = desc.addressMode;
+  samplerInfo.addressModeV            = desc.addressMode;
+  samplerInfo.addressModeW            = desc.addressMode;
+  samplerInfo.anisotropyEnable =
+    m_features.samplerAnisotropy && desc.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+  samplerInfo.maxAnisotropy           = std::min(desc.maxAnisotropy, m_maxAnisotropy);
+  samplerInfo.compareEnable           = VK_FALSE;
+  samplerInfo.minLod                  = 0.0f;
+  samplerInfo.maxLod                  = VK_LOD_CLAMP_NONE;
+  samplerInfo.borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+  VkSampler sampler;
+  if (vkCreateSampler(m_device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create texture sampler!");
+  }
+  m_samplers[desc] = sampler;
+  return sampler;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "TextureImporter.h"
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+using TextureHandle                     = uint32_t;
+constexpr TextureHandle INVALID_TEXTURE = ~0u;
+
+struct Texture
+{
+  VkImage image         = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkImageView view      = VK_NULL_HANDLE;
+  VkFormat format       = VK_FORMAT_UNDEFINED;
+  uint32_t width        = 0;
+  uint32_t height       = 0;
+  uint32_t mipLevels    = 0;
+};
+
+// Sampler state; identical states share one VkSampler
+struct SamplerDesc
+{
+  VkFilter filter                  = VK_FILTER_LINEAR;
+  VkSamplerMipmapMode mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  float maxAnisotropy              = 16.0f;    // <= 1 disables, clamped to the device
+
+  bool operator<(const SamplerDesc& other) const;
+};
+
+//----------------------------------------------------------------------------------------
+// Owns sampled 2D textures and the samplers used with them.
+//  - Files keep their (block compressed) format and mips; they are copied from the file
+//    mapping into one staging buffer and uploaded with a copy per level.
+//  - When a texture only has its base level the rest of the mip chain is generated on
+//    the GPU with vkCmdBlitImage (not possible for compressed formats, which then stay
+//    at one level).
+//  - Formats are checked against the device, including the compression features.
+//----------------------------------------------------------------------------------------
+class TextureManager
+{
+  VkPhysicalDevice m_physicalDevice   = VK_NULL_HANDLE;
+  VkDevice m_device                   = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool         = VK_NULL_HANDLE;
+  VkQueue m_queue                     = VK_NULL_HANDLE;
+  VkPhysicalDeviceFeatures m_features = {};
+  float m_maxAnisotropy               = 1.0f;
+
+  std::vector<Texture> m_textures;
+  std::vector<TextureHandle> m_freeHandles;
+  std::map<SamplerDesc, VkSampler> m_samplers;
+
+private:
+  bool isFormatSupported(VkFormat format) const;
+  bool canGenerateMips(VkFormat format) const;
+  TextureHandle createTexture(const TextureData& data);
+  void recordMipGeneration(VkCommandBuffer commandBuffer, const Texture& texture);
+
+public:
+  // enabledFeatures: what the device was created with (texture compression, anisotropy)
+  void init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkCommandPool commandPool,
+    VkQueue queue,
+    const VkPhysicalDeviceFeatures& enabledFeatures);
+  void cleanup();
+
+  // .ktx2 or .dds (blocks on the upload)
+  TextureHandle loadTexture(const std::string& filename);
+  // Single level of tightly packed pixels, mips generated when possible
+  TextureHandle
+  createTexture(VkFormat format, uint32_t width, uint32_t height, const void* pixels);
+
+  // The caller must make sure no in flight frame still uses the texture
+  void destroyTexture(TextureHandle texture);
+
+  const Texture& texture(TextureHandle handle) const { return m_textures[handle]; }
+
+  VkSampler getSampler(const SamplerDesc& desc = {});
+};
+
+//----------------------------------------------------------------------------------------
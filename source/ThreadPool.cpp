@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  for (uint32_t i = 1; i < threadCount; ++i)
+  {
+    m_workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_workAvailable.notify_all();
+
+  for (auto& worker : m_workers)
+  {
+    worker.join();
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+ThreadPool::workerLoop()
+{
+  uint64_t seenGeneration = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workAvailable.wait(
+        lock, [&] { return m_stop || m_generation != seenGeneration; });
+      if (m_stop)
+      {
+        return;
+      }
+      seenGeneration = m_generation;
+    }
+
+    runTasks();
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busyWorkers == 0)
+      {
+        m_workDone.notify_all();
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+ThreadPool::runTasks()
+{
+  for (;;)
+  {
+    const uint32_t task = m_nextTask.fetch_add(1);
+    if (task >= m_taskCount)
+    {
+      return;
+    }
+
+    try
+    {
+      (*m_task)(task);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_error)
+      {
+        m_error = std::current_exception();
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+ThreadPool::parallelFor(
+  uint32_t taskCount,
+  const std::function<void(uint32_t task)>& task)
+{
+  if (taskCount == 0)
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task        = &task;
+    m_taskCount   = taskCount;
+    m_nextTask    = 0;
+    m_busyWorkers = static_cast<uint32_t>(m_workers.size());
+    m_error       = nullptr;
+    ++m_generation;
+  }
+  m_workAvailable.notify_all();
+
+  runTasks();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+    std::swap(error, m_error);
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+//----------------------------------------------------------------------------------------
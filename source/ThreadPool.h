@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Fixed set of worker threads for data parallel work. parallelFor() hands out task
+// indices to the workers and the calling thread, and returns once every task is done
+// (rethrowing the first exception any task threw). Not reentrant.
+//----------------------------------------------------------------------------------------
+class ThreadPool
+{
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_workAvailable;
+  std::condition_variable m_workDone;
+
+  const std::function<void(uint32_t)>* m_task = nullptr;
+  uint32_t m_taskCount                        = 0;
+  std::atomic<uint32_t> m_nextTask{0};
+  uint32_t m_busyWorkers                      = 0;
+  uint64_t m_generation                       = 0;
+  bool m_stop                                 = false;
+  std::exception_ptr m_error;
+
+private:
+  void workerLoop();
+  void runTasks();
+
+public:
+  // threadCount includes the calling thread; 0 uses every hardware thread
+  explicit ThreadPool(uint32_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  uint32_t threadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+  void parallelFor(uint32_t taskCount, const std::function<void(uint32_t task)>& task);
+};
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,411 @@
+#include <fmt/format.h>
+
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+constexpr uint32_t BENCHMARK_RUNS = 5;
+
+using Clock = std::chrono::high_resolution_clock;
+
+//----------------------------------------------------------------------------------------
+static glm::mat4
+localMatrix(const glm::vec3& position, const glm::quat& rotation, float scale)
+{
+  glm::mat4 local = glm::mat4_cast(rotation);
+  local[0] *= scale;
+  local[1] *= scale;
+  local[2] *= scale;
+  local[3] = glm::vec4(position, 1.0f);
+  return local;
+}
+
+//----------------------------------------------------------------------------------------
+TransformHandle
+TransformHierarchy::create(const Transform& local, TransformHandle parent)
+{
+  const auto index = static_cast<uint32_t>(m_handles.size());
+  const auto node  = static_cast<TransformHandle>(m_indices.size());
+
+  uint32_t parentIndex = INVALID_NODE;
+  if (parent != INVALID_NODE)
+  {
+    if (parent >= m_indices.size())
+    {
+      throw std::runtime_error("invalid parent transform!");
+    }
+    parentIndex = m_indices[parent];
+
+    // Appending only keeps the depth first order if the parent's subtree is the last
+    // one, in which case every ancestor's subtree ends here as well
+    if (m_depthFirst && m_subtreeEnds[parentIndex] == index)
+    {
+      for (uint32_t ancestor = parentIndex; ancestor != INVALID_NODE;
+           ancestor          = m_parents[ancestor])
+      {
+        m_subtreeEnds[ancestor]++;
+      }
+    }
+    else
+    {
+      m_depthFirst = false;
+    }
+  }
+
+  m_positions.push_back(local.position);
+  m_rotations.push_back(local.rotation);
+  m_scales.push_back(local.scale);
+  m_parents.push_back(parentIndex);
+  m_subtreeEnds.push_back(index + 1);
+  m_worlds.emplace_back(1.0f);
+  m_dirty.push_back(1);
+  m_handles.push_back(node);
+  m_indices.push_back(index);
+  m_dirtyNodes.push_back(index);
+  return node;
+}
+
+//----------------------------------------------------------------------------------------
+void
+TransformHierarchy::reserve(size_t count)
+{
+  m_positions.reserve(count);
+  m_rotations.reserve(count);
+  m_scales.reserve(count);
+  m_parents.reserve(count);
+  m_subtreeEnds.reserve(count);
+  m_worlds.reserve(count);
+  m_dirty.reserve(count);
+  m_handles.reserve(count);
+  m_indices.reserve(count);
+}
+
+//----------------------------------------------------------------------------------------
+Transform
+TransformHierarchy::local(TransformHandle node) const
+{
+  const uint32_t index = m_indices[node];
+
+  Transform transform;
+  transform.position = m_positions[index];
+  transform.rotation = m_rotations[index];
+  transform.scale    = m_scales[index];
+  return transform;
+}
+
+//----------------------------------------------------------------------------------------
+void
+TransformHierarchy::setLocal(TransformHandle node, const Transform& local)
+{
+  const uint32_t index = m_indices[node];
+  m_positions[index]   = local.position;
+  m_rotations[index]   = local.rotation;
+  m_scales[index]      = local.scale;
+  if (!m_dirty[index])
+  {
+    m_dirty[index] = 1;
+    m_dirtyNodes.push_back(index);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+TransformHierarchy::setRotation(TransformHandle node, const glm::quat& rotation)
+{
+  const uint32_t index = m_indices[node];
+  m_rotations[index]   = rotation;
+  if (!m_dirty[index])
+  {
+    m_dirty[index] = 1;
+    m_dirtyNodes.push_back(index);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+void
+TransformHierarchy::markAllDirty()
+{
+  std::fill(m_dirty.begin(), m_dirty.end(), uint8_t(1));
+  m_dirtyNodes.clear();
+  for (uint32_t index = 0; index < m_handles.size(); ++index)
+  {
+    m_dirtyNodes.push_back(index);
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Parents always precede their children (a parent exists before its children are
+// created), only the subtrees may be interleaved
+void
+TransformHierarchy::sortDepthFirst()
+{
+  const auto count = static_cast<uint32_t>(m_handles.size());
+
+  // Children of each node in creation order (counting sort by parent)
+  std::vector<uint32_t> childStart(count + 1, 0);
+  for (uint32_t parent : m_parents)
+  {
+    if (parent != INVALID_NODE)
+    {
+      childStart[parent + 1]++;
+    }
+  }
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    childStart[i + 1] += childStart[i];
+  }
+  std::vector<uint32_t> children(childStart[count]);
+  std::vector<uint32_t> childFill(childStart.begin(), childStart.end() - 1);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (m_parents[i] != INVALID_NODE)
+    {
+      children[childFill[m_parents[i]]++] = i;
+    }
+  }
+
+  // Depth first walk from each root (children pushed in reverse to keep their order)
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> stack;
+  order.reserve(count);
+  for (uint32_t root = 0; root < count; ++root)
+  {
+    if (m_parents[root] != INVALID_NODE)
+    {
+      continue;
+    }
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+      const uint32_t node = stack.back();
+      stack.pop_back();
+      order.push_back(node);
+      for (uint32_t c = childStart[node + 1]; c > childStart[node]; --c)
+      {
+        stack.push_back(children[c - 1]);
+      }
+    }
+  }
+  assert(order.size() == count);
+
+  std::vector<uint32_t> newIndex(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    newIndex[order[i]] = i;
+  }
+  auto permute = [&order](auto& values) {
+    auto sorted = values;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+      sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+  };
+  permute(m_positions);
+  permute(m_rotations);
+  permute(m_scales);
+  permute(m_parents);
+  permute(m_handles);
+  for (uint32_t& parent : m_parents)
+  {
+    parent = (parent == INVALID_NODE) ? INVALID_NODE : newIndex[parent];
+  }
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    m_indices[m_handles[i]] = i;
+  }
+
+  // Children come after their parent, so walking backwards finishes them first
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    m_subtreeEnds[i] = i + 1;
+  }
+  for (uint32_t i = count; i-- > 0;)
+  {
+    if (m_parents[i] != INVALID_NODE)
+    {
+      uint32_t& parentEnd = m_subtreeEnds[m_parents[i]];
+      parentEnd           = std::max(parentEnd, m_subtreeEnds[i]);
+    }
+  }
+  m_depthFirst = true;
+}
+
+//----------------------------------------------------------------------------------------
+void
+TransformHierarchy::computeWorlds(uint32_t begin, uint32_t end)
+{
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const glm::mat4 local = localMatrix(m_positions[i], m_rotations[i], m_scales[i]);
+    const uint32_t parent = m_parents[i];
+    m_worlds[i]           = (parent == INVALID_NODE) ? local : m_worlds[parent] * local;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+const std::vector<TransformRange>&
+TransformHierarchy::update()
+{
+  m_updated.clear();
+  if (!m_depthFirst)
+  {
+    sortDepthFirst();
+    markAllDirty();
+  }
+
+  // In ascending order a dirty node is either inside the subtree just recomputed or
+  // starts a new one whose parent is already up to date
+  std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+  uint32_t end = 0;
+  for (uint32_t index : m_dirtyNodes)
+  {
+    m_dirty[index] = 0;
+    if (index < end)
+    {
+      continue;
+    }
+    end = m_subtreeEnds[index];
+    computeWorlds(index, end);
+
+    if (!m_updated.empty() && m_updated.back().first + m_updated.back().count == index)
+    {
+      m_updated.back().count += end - index;
+    }
+    else
+    {
+      m_updated.push_back({index, end - index});
+    }
+  }
+  m_dirtyNodes.clear();
+  return m_updated;
+}
+
+//----------------------------------------------------------------------------------------
+// Best time of BENCHMARK_RUNS in milliseconds
+template<typename Function>
+static double
+timeBest(const Function& function)
+{
+  double bestMs = std::numeric_limits<double>::max();
+  for (uint32_t run = 0; run < BENCHMARK_RUNS; ++run)
+  {
+    const auto start = Clock::now();
+    function();
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    bestMs = std::min(bestMs, elapsed.count());
+  }
+  return bestMs;
+}
+
+//----------------------------------------------------------------------------------------
+static uint32_t
+countNodes(const std::vector<TransformRange>& ranges)
+{
+  uint32_t count = 0;
+  for (const TransformRange& range : ranges)
+  {
+    count += range.count;
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------
+// 1000 roots, each with 10 groups of 99 leaves: 1,001,000 nodes
+void
+runTransformBenchmark()
+{
+  constexpr uint32_t ROOTS           = 1000;
+  constexpr uint32_t GROUPS_PER_ROOT = 10;
+  constexpr uint32_t LEAVES_PER_ROOT = 99;
+
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+  auto randomTransform = [&] {
+    Transform transform;
+    transform.position = glm::vec3(offset(random), offset(random), offset(random));
+    transform.rotation = glm::angleAxis(angle(random), glm::vec3(0.0f, 1.0f, 0.0f));
+    transform.scale    = 0.9f;
+    return transform;
+  };
+
+  TransformHierarchy hierarchy;
+  hierarchy.reserve(ROOTS * (1 + GROUPS_PER_ROOT * (1 + LEAVES_PER_ROOT)));
+  std::vector<TransformHandle> groups;
+  std::vector<TransformHandle> leaves;
+  for (uint32_t r = 0; r < ROOTS; ++r)
+  {
+    const TransformHandle root = hierarchy.create(randomTransform());
+    for (uint32_t g = 0; g < GROUPS_PER_ROOT; ++g)
+    {
+      groups.push_back(hierarchy.create(randomTransform(), root));
+      for (uint32_t l = 0; l < LEAVES_PER_ROOT; ++l)
+      {
+        leaves.push_back(hierarchy.create(randomTransform(), groups.back()));
+      }
+    }
+  }
+
+  fmt::print(
+    "Transform update benchmark, {} nodes (best of {} runs)\n",
+    hierarchy.size(),
+    BENCHMARK_RUNS);
+  fmt::print("changed nodes          recomputed        ms   ns/node\n");
+
+  auto report = [&](const char* name, uint32_t recomputed, double ms) {
+    fmt::print(
+      "{:22} {:10} {:9.3f} {:9.1f}\n", name, recomputed, ms, ms * 1e6 / recomputed);
+  };
+
+  uint32_t recomputed = 0;
+  double ms           = timeBest([&] {
+    hierarchy.markAllDirty();
+    recomputed = countNodes(hierarchy.update());
+  });
+  report("all", recomputed, ms);
+
+  std::vector<glm::mat4> incremental;
+  auto animate = [&](const char* name, const std::vector<TransformHandle>& nodes,
+                     uint32_t count) {
+    std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+    std::vector<TransformHandle> moved(count);
+    for (TransformHandle& node : moved)
+    {
+      node = nodes[pick(random)];
+    }
+    float time = 0.0f;
+    ms         = timeBest([&] {
+      time += 0.01f;
+      for (TransformHandle node : moved)
+      {
+        hierarchy.setRotation(node, glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f)));
+      }
+      recomputed = countNodes(hierarchy.update());
+    });
+    report(fmt::format("{} {}", count, name).c_str(), recomputed, ms);
+
+    // The incremental result must match recomputing everything
+    const glm::mat4* worlds = hierarchy.worldMatrices();
+    incremental.assign(worlds, worlds + hierarchy.size());
+    hierarchy.markAllDirty();
+    hierarchy.update();
+    if (memcmp(incremental.data(), worlds, incremental.size() * sizeof(glm::mat4)) != 0)
+    {
+      throw std::runtime_error("incremental transform update differs from a full one!");
+    }
+  };
+  animate("leaves", leaves, 1000);
+  animate("leaves", leaves, 4000);
+  animate("leaves", leaves, 16000);
+  animate("groups (x100 nodes)", groups, 40);
+}
+
+//----------------------------------------------------------------------------------------
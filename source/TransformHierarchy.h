@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+using TransformHandle                  = uint32_t;
+constexpr TransformHandle INVALID_NODE = ~0u;
+
+// Local transform relative to the parent node (uniform scale only)
+struct Transform
+{
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  float scale        = 1.0f;
+};
+
+// A run of nodes [first, first + count) in update order whose world matrices changed
+struct TransformRange
+{
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+//----------------------------------------------------------------------------------------
+// Scene graph transforms in structure of arrays layout, ordered depth first so every
+// parent comes before its children and each subtree is one contiguous run of nodes.
+//  - Changing a node's local transform marks it dirty. update() recomputes the world
+//    matrices of the dirty subtrees only, each as one linear pass (the parent's matrix
+//    is always already up to date), so the cost follows the number of moved nodes and
+//    not the size of the scene.
+//  - update() returns the runs of nodes it recomputed, so callers can copy just those
+//    into their upload buffers.
+//  - Nodes are addressed by stable handles. Adding a child anywhere but at the end of
+//    the depth first order triggers a one off reorder on the next update().
+//  - Nodes can't be removed.
+//----------------------------------------------------------------------------------------
+class TransformHierarchy
+{
+  // Indexed by node (depth first order)
+  std::vector<glm::vec3> m_positions;
+  std::vector<glm::quat> m_rotations;
+  std::vector<float> m_scales;
+  std::vector<uint32_t> m_parents;        // node index or INVALID_NODE for roots
+  std::vector<uint32_t> m_subtreeEnds;    // one past the node's last descendant
+  std::vector<glm::mat4> m_worlds;
+  std::vector<uint8_t> m_dirty;
+  std::vector<TransformHandle> m_handles;
+
+  std::vector<uint32_t> m_indices;       // handle -> node index
+  std::vector<uint32_t> m_dirtyNodes;    // node indices, unsorted
+  std::vector<TransformRange> m_updated;
+  bool m_depthFirst = true;
+
+private:
+  void sortDepthFirst();
+  void computeWorlds(uint32_t begin, uint32_t end);
+
+public:
+  TransformHandle create(const Transform& local, TransformHandle parent = INVALID_NODE);
+  void reserve(size_t count);
+  size_t size() const { return m_handles.size(); }
+
+  Transform local(TransformHandle node) const;
+  void setLocal(TransformHandle node, const Transform& local);
+  void setRotation(TransformHandle node, const glm::quat& rotation);
+
+  // Returns the world matrices changed since the last call (every node on the first)
+  const std::vector<TransformRange>& update();
+  // Recomputes every node on the next update()
+  void markAllDirty();
+
+  // Indices only change when update() reorders the nodes; world matrices are current
+  // as of the last update()
+  uint32_t index(TransformHandle node) const { return m_indices[node]; }
+  TransformHandle handle(uint32_t index) const { return m_handles[index]; }
+  const glm::mat4& world(TransformHandle node) const { return m_worlds[m_indices[node]]; }
+  const glm::mat4* worldMatrices() const { return m_worlds.data(); }
+};
+
+// Times incremental updates of a few thousand nodes in a 1M node scene against a full
+// update, checking the incremental result against the full one
+void runTransformBenchmark();
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------
+// Hands the latest value from one writer thread to one reader thread without either
+// waiting or copying. The writer fills back() and publishes it; the reader's update()
+// switches front() to the most recently published value, skipping any it missed. Of
+// the three buffers one is being written, one read, and the third holds the latest
+// published value until either side swaps it for its own.
+// A published buffer comes back to the writer later with an old value in it, so the
+// writer must set all of back() before every publish().
+//----------------------------------------------------------------------------------------
+template<typename T>
+class TripleBuffer
+{
+  static constexpr uint8_t INDEX_MASK = 3;
+  static constexpr uint8_t FRESH      = 4;    // the middle buffer hasn't been read
+
+  T m_buffers[3];
+  uint8_t m_back  = 0;    // writer only
+  uint8_t m_front = 1;    // reader only
+  std::atomic<uint8_t> m_middle{2};
+
+public:
+  // Writer only
+  T& back() { return m_buffers[m_back]; }
+  void publish();
+
+  // Reader only. Returns false, keeping front(), when nothing was published since
+  bool update();
+  const T& front() const { return m_buffers[m_front]; }
+};
+
+//----------------------------------------------------------------------------------------
+template<typename T>
+void
+TripleBuffer<T>::publish()
+{
+  m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+//----------------------------------------------------------------------------------------
+template<typename T>
+bool
+TripleBuffer<T>::update()
+{
+  if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+  {
+    return false;
+  }
+  m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,291 @@
+#include <fmt/format.h>
+
+#include "VulkanHelpers.h"
+#include "MemoryTelemetry.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------------------
+std::vector<char>
+readFile(const std::string& filename)
+{
+  std::ifstream file(filename, std::ios::ate | std::ios::binary);
+  if (!file.is_open())
+  {
+    throw std::runtime_error(fmt::format("failed to open file: {}", filename));
+  }
+
+  size_t fileSize = file.tellg();
+  std::vector<char> buffer(fileSize);
+  file.seekg(0);
+  file.read(buffer.data(), fileSize);
+  return buffer;
+}
+
+//----------------------------------------------------------------------------------------
+VkShaderModule
+createShaderModule(VkDevice device, const std::vector<char>& code)
+{
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize                 = code.size();
+  createInfo.pCode                    = reinterpret_cast<const uint32_t*>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create shader module!");
+  }
+  return shaderModule;
+}
+
+//----------------------------------------------------------------------------------------
+uint32_t
+findMemoryType(
+  VkPhysicalDevice physicalDevice,
+  uint32_t typeFilter,
+  VkMemoryPropertyFlags properties)
+{
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+  {
+    if (
+      (typeFilter & (1 << i))
+      && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+    {
+      return i;
+    }
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+//----------------------------------------------------------------------------------------
+void
+createBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkDeviceSize size,
+  VkBufferUsageFlags usage,
+  VkMemoryPropertyFlags properties,
+  VkBuffer& buffer,
+  VkDeviceMemory& bufferMemory)
+{
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size               = size;
+  bufferInfo.usage              = usage;
+  bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create buffer!");
+  }
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize       = memRequirements.size;
+  allocInfo.memoryTypeIndex
+    = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+
+  if (allocateDeviceMemory(device, allocInfo, bufferMemory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate buffer memory!");
+  }
+
+  vkBindBufferMemory(device, buffer, bufferMemory, 0);
+}
+
+//----------------------------------------------------------------------------------------
+VkCommandBuffer
+beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool)
+{
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool                 = commandPool;
+  allocInfo.commandBufferCount          = 1;
+
+  VkCommandBuffer commandBuffer;
+  if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  return commandBuffer;
+}
+
+//----------------------------------------------------------------------------------------
+void
+endSingleTimeCommands(
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  VkCommandBuffer commandBuffer)
+{
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo       = {};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &commandBuffer;
+
+  if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to submit single time commands!");
+  }
+  vkQueueWaitIdle(queue);
+
+  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
+//----------------------------------------------------------------------------------------
+void
+uploadToBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  VkBuffer dstBuffer,
+  VkDeviceSize dstOffset,
+  const void* data,
+  VkDeviceSize size)
+{
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  createBuffer(
+    physicalDevice,
+    device,
+    size,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    stagingBuffer,
+    stagingBufferMemory);
+
+  void* mapped;
+  vkMapMemory(device, stagingBufferMemory, 0, size, 0, &mapped);
+  memcpy(mapped, data, static_cast<size_t>(size));
+  vkUnmapMemory(device, stagingBufferMemory);
+
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+  VkBufferCopy copyRegion       = {};
+  copyRegion.dstOffset          = dstOffset;
+  copyRegion.size               = size;
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+  endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+  vkDestroyBuffer(device, stagingBuffer, nullptr);
+  freeDeviceMemory(device, stagingBufferMemory);
+}
+
+//----------------------------------------------------------------------------------------
+void
+createDeviceLocalBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  const void* data,
+  VkDeviceSize size,
+  VkBufferUsageFlags usage,
+  VkBuffer& buffer,
+  VkDeviceMemory& bufferMemory)
+{
+  createBuffer(
+    physicalDevice,
+    device,
+    size,
+    usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    buffer,
+    bufferMemory);
+
+  uploadToBuffer(
+    physicalDevice, device, commandPool, queue, buffer, 0, data, size);
+}
+
+//----------------------------------------------------------------------------------------
+VkPipeline
+createComputePipeline(
+  VkDevice device,
+  VkPipelineLayout layout,
+  const std::string& shaderFilename,
+  const VkSpecializationInfo* specialization)
+{
+  VkShaderModule shaderModule = createShaderModule(device, readFile(shaderFilename));
+
+  VkPipelineShaderStageCreateInfo stageInfo = {};
+  stageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stageInfo.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+  stageInfo.module              = shaderModule;
+  stageInfo.pName               = "main";
+  stageInfo.pSpecializationInfo = specialization;
+
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage              = stageInfo;
+  pipelineInfo.layout             = layout;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+  pipelineInfo.basePipelineIndex  = -1;
+
+  VkPipeline pipeline;
+  VkResult result = vkCreateComputePipelines(
+    device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error(
+      fmt::format("failed to create compute pipeline: {}", shaderFilename));
+  }
+  return pipeline;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extension)
+{
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+    physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+  for (const auto& available : availableExtensions)
+  {
+    if (strcmp(available.extensionName, extension) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------
+VkFormat
+findDepthFormat(VkPhysicalDevice physicalDevice)
+{
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &properties);
+  if (
+    (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+    == 0)
+  {
+    return VK_FORMAT_X8_D24_UNORM_PACK32;
+  }
+  return VK_FORMAT_D32_SFLOAT;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Small free functions shared by the Application and the renderer subsystems.
+// They all throw std::runtime_error on failure, like the Application itself.
+//----------------------------------------------------------------------------------------
+std::vector<char> readFile(const std::string& filename);
+
+VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
+
+uint32_t findMemoryType(
+  VkPhysicalDevice physicalDevice,
+  uint32_t typeFilter,
+  VkMemoryPropertyFlags properties);
+
+void createBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkDeviceSize size,
+  VkBufferUsageFlags usage,
+  VkMemoryPropertyFlags properties,
+  VkBuffer& buffer,
+  VkDeviceMemory& bufferMemory);
+
+VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
+void endSingleTimeCommands(
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  VkCommandBuffer commandBuffer);
+
+// Copies data into an existing (device local) buffer through a temporary staging buffer
+void uploadToBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  VkBuffer dstBuffer,
+  VkDeviceSize dstOffset,
+  const void* data,
+  VkDeviceSize size);
+
+// Creates a device local buffer and fills it through a temporary staging buffer
+void createDeviceLocalBuffer(
+  VkPhysicalDevice physicalDevice,
+  VkDevice device,
+  VkCommandPool commandPool,
+  VkQueue queue,
+  const void* data,
+  VkDeviceSize size,
+  VkBufferUsageFlags usage,
+  VkBuffer& buffer,
+  VkDeviceMemory& bufferMemory);
+
+VkPipeline createComputePipeline(
+  VkDevice device,
+  VkPipelineLayout layout,
+  const std::string& shaderFilename,
+  const VkSpecializationInfo* specialization = nullptr);
+
+bool isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extension);
+
+// D32_SFLOAT, or X8_D24 where the device can't render to it with optimal tiling
+VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
+
+//----------------------------------------------------------------------------------------
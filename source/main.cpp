@@ -1,14 +1,371 @@
 // always include fmt before Application.h (includes windows.h and so does glfw)
 #include <fmt/format.h>
 #include "Application.h"
+#include "FrustumCuller.h"
+#include "MeshImporter.h"
+#include "RenderGraph.h"
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+constexpr char DEVICE_VARIABLE[]          = "HELLO_TRIANGLE_DEVICE";
+constexpr uint32_t SWEEP_BENCHMARK_FRAMES = 500;
+
+//----------------------------------------------------------------------------------------
+static void
+printUsage()
+{
+  fmt::print(
+    "usage: vulkan-hello-triangle [options]\n"
+    "  --gpu-driven                 cull and draw many objects with compute + indirect "
+    "draws\n"
+    "  --bindless                   index resources from one global descriptor set\n"
+    "  --objects <count>            number of objects in the GPU driven scene "
+    "(default {})\n"
+    "  --mesh <file>                .obj or .glb mesh drawn by the GPU driven scene\n"
+    "  --texture <file>             .ktx2 or .dds texture used by the GPU driven scene\n"
+    "  --occlusion                  skip GPU driven objects hidden behind others\n"
+    "  --dense                      pack the GPU driven objects so they overdraw each "
+    "other\n"
+    "  --memory-headroom <percent>  warn below this much free memory budget "
+    "(default {:.0f})\n"
+    "  --memory-summary <seconds>   print memory usage this often, 0 for never "
+    "(default {:.0f})\n"
+    "  --windows <count>            render to this many windows from one device\n"
+    "  --particles <count>          simulate particles in a compute shader and draw "
+    "them\n"
+    "  --dynamic-resolution <ms>    scale the scene resolution to hold this GPU time\n"
+    "  --resolution-scale <min> <max>  dynamic resolution scale range "
+    "(default {} {})\n"
+    "  --tick-rate <hz>             simulation steps per second (default {:.0f})\n"
+    "  --post-process <mode>        tonemap, grade and vignette as subpasses of the "
+    "scene pass or as separate passes: subpasses or passes\n"
+    "  --hud                        show frame times, draws and memory on screen "
+    "(F1 hides)\n"
+    "  --no-pipeline-library        compile pipelines whole even where graphics "
+    "pipeline libraries are supported\n"
+    "  --log-severity <level>       lowest validation message severity printed: "
+    "verbose, info, warning or error\n"
+    "  --log-types <types>          validation message types printed, comma separated: "
+    "general, validation, performance\n"
+    "  --device <index|uuid>        use this device (or set {}), default: best rated\n"
+    "  --benchmark <frames>         time this many frames after a warm up, then exit\n"
+    "  --bench-devices              benchmark the scene on every device and compare "
+    "(default {} frames)\n"
+    "  --capture <file>             record every frame's inputs for --replay\n"
+    "  --replay <file>              draw a capture's frames headless, as fast as "
+    "possible, and time them (uses the capture's scene options)\n"
+    "\n"
+    "tools (run instead of the renderer):\n"
+    "  --bench-mesh-load <file>           time mesh loading with 1..N threads\n"
+    "  --optimize-mesh <file>             write the optimised <file>.mesh cache\n"
+    "  --generate-obj <file> <grid size>  write a grid size^2 quad test mesh\n"
+    "  --bench-culling                    time the CPU frustum culling kernels\n"
+    "  --bench-transforms                 time incremental transform updates\n"
+    "  --bench-render-graph               report render graph culling and aliasing\n",
+    ApplicationConfig{}.objectCount,
+    ApplicationConfig{}.memoryHeadroom * 100.0f,
+    ApplicationConfig{}.memorySummaryInterval,
+    ApplicationConfig{}.minResolutionScale,
+    ApplicationConfig{}.maxResolutionScale,
+    ApplicationConfig{}.tickRate,
+    DEVICE_VARIABLE,
+    SWEEP_BENCHMARK_FRAMES);
+}
+
+//----------------------------------------------------------------------------------------
+static ApplicationConfig
+parseCommandLine(int argc, char* argv[])
+{
+  ApplicationConfig config;
+  if (const char* device = std::getenv(DEVICE_VARIABLE))
+  {
+    config.device = device;    // the command line wins
+  }
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--gpu-driven") == 0)
+    {
+      config.gpuDriven = true;
+    }
+    else if (strcmp(argv[i], "--bindless") == 0)
+    {
+      config.bindless = true;
+    }
+    else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+    {
+      config.meshPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+    {
+      config.texturePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--occlusion") == 0)
+    {
+      config.occlusionCulling = true;
+    }
+    else if (strcmp(argv[i], "--dense") == 0)
+    {
+      config.denseScene = true;
+    }
+    else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+    {
+      config.objectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+      if (config.objectCount == 0)
+      {
+        throw std::runtime_error("--objects must be at least 1");
+      }
+    }
+    else if (strcmp(argv[i], "--memory-headroom") == 0 && i + 1 < argc)
+    {
+      config.memoryHeadroom = std::stof(argv[++i]) / 100.0f;
+      if (config.memoryHeadroom < 0.0f || config.memoryHeadroom > 1.0f)
+      {
+        throw std::runtime_error("--memory-headroom must be between 0 and 100");
+      }
+    }
+    else if (strcmp(argv[i], "--memory-summary") == 0 && i + 1 < argc)
+    {
+      config.memorySummaryInterval = std::stof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc)
+    {
+      config.windowCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+      if (config.windowCount == 0)
+      {
+        throw std::runtime_error("--windows must be at least 1");
+      }
+    }
+    else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+    {
+      config.particleCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+    {
+      config.targetFrameTime = std::stof(argv[++i]);
+      if (config.targetFrameTime <= 0.0f)
+      {
+        throw std::runtime_error("--dynamic-resolution must be above 0 ms");
+      }
+    }
+    else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 2 < argc)
+    {
+      config.minResolutionScale = std::stof(argv[++i]);
+      config.maxResolutionScale = std::stof(argv[++i]);
+      if (config.minResolutionScale <= 0.0f ||
+          config.minResolutionScale > config.maxResolutionScale)
+      {
+        throw std::runtime_error("--resolution-scale needs 0 < min <= max");
+      }
+    }
+    else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+    {
+      config.tickRate = std::stof(argv[++i]);
+      if (config.tickRate <= 0.0f)
+      {
+        throw std::runtime_error("--tick-rate must be above 0");
+      }
+    }
+    else if (strcmp(argv[i], "--post-process") == 0 && i + 1 < argc)
+    {
+      config.postProcess = PostProcess::parseMode(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--hud") == 0)
+    {
+      config.hud = true;
+    }
+    else if (strcmp(argv[i], "--no-pipeline-library") == 0)
+    {
+      config.pipelineLibrary = false;
+    }
+    else if (strcmp(argv[i], "--log-severity") == 0 && i + 1 < argc)
+    {
+      config.logSeverities = Logger::parseSeverity(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--log-types") == 0 && i + 1 < argc)
+    {
+      config.logTypes = Logger::parseTypes(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+    {
+      config.device = argv[++i];
+    }
+    else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+    {
+      config.benchmarkFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--bench-devices") == 0)
+    {
+      config.deviceSweep = true;
+    }
+    else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+    {
+      config.capturePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+    {
+      config.replayPath = argv[++i];
+    }
+    else
+    {
+      printUsage();
+      throw std::runtime_error(fmt::format("unknown argument: {}", argv[i]));
+    }
+  }
+  if (config.occlusionCulling && !config.gpuDriven)
+  {
+    throw std::runtime_error("--occlusion needs --gpu-driven");
+  }
+  if (config.denseScene && !config.gpuDriven)
+  {
+    throw std::runtime_error("--dense needs --gpu-driven");
+  }
+  if (!config.capturePath.empty() && config.headless())
+  {
+    throw std::runtime_error("--capture and --replay can't be combined");
+  }
+  if (config.postProcess != PostProcessMode::Off && config.targetFrameTime > 0.0f)
+  {
+    throw std::runtime_error("--post-process and --dynamic-resolution can't be combined");
+  }
+  return config;
+}
+
+//----------------------------------------------------------------------------------------
+// Returns true if the command line asked for a tool rather than the renderer
+static bool
+runTool(int argc, char* argv[])
+{
+  if (argc == 3 && strcmp(argv[1], "--bench-mesh-load") == 0)
+  {
+    runMeshLoadBenchmark(argv[2]);
+    return true;
+  }
+  if (argc == 3 && strcmp(argv[1], "--optimize-mesh") == 0)
+  {
+    buildMeshCache(argv[2]);
+    return true;
+  }
+  if (argc == 4 && strcmp(argv[1], "--generate-obj") == 0)
+  {
+    generateObjFile(argv[2], static_cast<uint32_t>(std::stoul(argv[3])));
+    return true;
+  }
+  if (argc == 2 && strcmp(argv[1], "--bench-culling") == 0)
+  {
+    runCullingBenchmark();
+    return true;
+  }
+  if (argc == 2 && strcmp(argv[1], "--bench-transforms") == 0)
+  {
+    runTransformBenchmark();
+    return true;
+  }
+  if (argc == 2 && strcmp(argv[1], "--bench-render-graph") == 0)
+  {
+    runRenderGraphReport();
+    return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------
+// Runs the configured scene on every device the loader reports, software ones included,
+// and ranks them by measured frame time
+static void
+runDeviceSweep(ApplicationConfig config)
+{
+  if (config.benchmarkFrames == 0)
+  {
+    config.benchmarkFrames = SWEEP_BENCHMARK_FRAMES;
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (const PhysicalDeviceInfo& device : Application::listPhysicalDevices())
+  {
+    fmt::print(
+      "\nbenchmarking device {}: {} ({})\n", device.index, device.name, device.type);
+    config.device = std::to_string(device.index);
+    try
+    {
+      Application app(config);
+      app.init();
+      app.run();
+      if (app.benchmarkResult().frames > 0)    // else a window was closed first
+      {
+        results.push_back(app.benchmarkResult());
+      }
+    }
+    catch (const std::exception& e)
+    {
+      fmt::print("device {} skipped: {}\n", device.index, e.what());
+    }
+  }
+  if (results.empty())
+  {
+    throw std::runtime_error("no device completed the benchmark");
+  }
+
+  auto frameTime = [](const BenchmarkResult& result) {
+    return result.seconds * 1000.0 / result.frames;
+  };
+  std::sort(
+    results.begin(),
+    results.end(),
+    [&frameTime](const BenchmarkResult& a, const BenchmarkResult& b) {
+      return frameTime(a) < frameTime(b);
+    });
+
+  fmt::print(
+    "\n{:>3}  {:<40} {:<10} {:>10} {:>8} {:>8}\n",
+    "#",
+    "device",
+    "type",
+    "ms/frame",
+    "fps",
+    "speed");
+  for (const BenchmarkResult& result : results)
+  {
+    fmt::print(
+      "{:>3}  {:<40} {:<10} {:>10.3f} {:>8.1f} {:>7.2f}x{}\n",
+      result.device.index,
+      result.device.name,
+      result.device.type,
+      frameTime(result),
+      1000.0 / frameTime(result),
+      frameTime(results.back()) / frameTime(result),
+      result.vsync ? "  (vsync)" : "");
+  }
+  fmt::print(
+    "\nfastest: --device {} or {}={}\n",
+    results.front().device.uuid,
+    DEVICE_VARIABLE,
+    results.front().device.uuid);
+}
 
 //----------------------------------------------------------------------------------------
 int
-main()
+main(int argc, char* argv[])
 {
   try
   {
-    Application app;
+    if (runTool(argc, argv))
+    {
+      return EXIT_SUCCESS;
+    }
+
+    const ApplicationConfig config = parseCommandLine(argc, argv);
+    if (config.deviceSweep)
+    {
+      runDeviceSweep(config);
+      return EXIT_SUCCESS;
+    }
+
+    Application app(config);
     app.init();
     app.run();
   }
@@ -1,15 +1,30 @@
-:: Compile our shader code
+:: Compile our shader code, named as the cmake build names it, then optimise it when
+:: spirv-opt is available
 
 @echo off
+setlocal
 set BASE_PATH=%~dp0
 set VULKAN_SDK_PATH=C:\VulkanSDK\1.1.121.0\
 set SHADER_COMPILER=%VULKAN_SDK_PATH%Bin32\glslangValidator.exe
+set SHADER_OPTIMIZER=%VULKAN_SDK_PATH%Bin32\spirv-opt.exe
 
-if exist %BASE_PATH%frag.spv goto COMPILED_SHADER_EXISTS
+if exist %BASE_PATH%shader_frag.spv goto COMPILED_SHADER_EXISTS
 echo.
 echo Compiling shader files:
-call %SHADER_COMPILER% -V %BASE_PATH%shader.vert -o %BASE_PATH%vert.spv
-call %SHADER_COMPILER% -V %BASE_PATH%shader.frag -o %BASE_PATH%frag.spv
+for %%f in (%BASE_PATH%*.vert) do call %SHADER_COMPILER% -V %%f -o %BASE_PATH%%%~nf_vert.spv
+for %%f in (%BASE_PATH%*.frag) do call %SHADER_COMPILER% -V %%f -o %BASE_PATH%%%~nf_frag.spv
+for %%f in (%BASE_PATH%*.comp) do call %SHADER_COMPILER% -V %%f -o %BASE_PATH%%%~nf.spv
+
+:: Permutations
+call %SHADER_COMPILER% -V -DBINDLESS %BASE_PATH%object.vert -o %BASE_PATH%object_bindless_vert.spv
+call %SHADER_COMPILER% -V -DBINDLESS %BASE_PATH%object.frag -o %BASE_PATH%object_bindless_frag.spv
+call %SHADER_COMPILER% -V -DSUBPASS_INPUT %BASE_PATH%post.frag -o %BASE_PATH%post_subpass_frag.spv
+
+if not exist %SHADER_OPTIMIZER% goto DONE
+echo Optimising shader files:
+for %%f in (%BASE_PATH%*.spv) do call %SHADER_OPTIMIZER% -O %%f -o %%f
+
+:DONE
 exit /b ERRORLEVEL
 
 :COMPILED_SHADER_EXISTS
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The performance overlay's quads, written by the CPU every frame (see Hud.cpp)
+layout(location = 0) in vec2 inPosition;    // pixels from the top left corner
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in uint inColor;       // RGBA8
+
+layout(push_constant) uniform Target {
+  vec2 invExtent;    // pixel to 0..1 coordinates
+} target;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+  gl_Position = vec4(inPosition * target.invExtent * 2.0 - 1.0, 0.0, 1.0);
+  fragUv = inUv;
+  fragColor = unpackUnorm4x8(inColor);
+}
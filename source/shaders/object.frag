@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 1, binding = 1) uniform texture2D textures[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform BindlessIndices {
+  uint objectBuffer;
+  uint sampler;
+} indices;
+#else
+layout(set = 0, binding = 5) uniform sampler2D objectTexture;
+#endif
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
+layout(location = 2) flat in uint fragTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+#ifdef BINDLESS
+  // Objects in one multi draw can use different textures
+  vec4 texel = texture(
+    sampler2D(textures[nonuniformEXT(fragTexture)], samplers[indices.sampler]), fragUV);
+#else
+  vec4 texel = texture(objectTexture, fragUV);
+#endif
+  outColor = vec4(fragColor, 1.0) * texel;
+}
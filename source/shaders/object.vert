@@ -0,0 +1,66 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+struct ObjectData {
+  vec4 boundingSphere;
+  vec4 color;
+  uint indexCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint page;
+  uint textureIndex;
+};
+
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+
+// The object buffer is one of the global set's storage buffers
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+  ObjectData objects[];
+} objectBuffers[];
+
+layout(push_constant) uniform BindlessIndices {
+  uint objectBuffer;
+  uint sampler;
+} indices;
+
+#define OBJECTS objectBuffers[indices.objectBuffer].objects
+#else
+layout(std430, set = 0, binding = 0) readonly buffer Objects {
+  ObjectData objects[];
+};
+
+#define OBJECTS objects
+#endif
+
+layout(set = 0, binding = 1) uniform FrameData {
+  mat4 viewProj;
+  vec4 frustumPlanes[6];
+  uvec4 pageFirstDraw;
+  uint objectCount;
+} frame;
+
+// World bounding sphere of each object, from the CPU transform hierarchy
+layout(std430, set = 0, binding = 4) readonly buffer Transforms {
+  vec4 worldSpheres[];
+};
+
+// PackedVertex: R16G16B16A16_SNORM position and R8G8B8A8_UNORM colour
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragTexture;
+
+void main() {
+  // firstInstance of each indirect draw is the object index
+  ObjectData object = OBJECTS[gl_InstanceIndex];
+  vec4 sphere = worldSpheres[gl_InstanceIndex];
+  vec3 worldPos = sphere.xyz + inPosition * sphere.w;
+  gl_Position = frame.viewProj * vec4(worldPos, 1.0);
+  fragColor = inColor * object.color.rgb;
+  // Planar mapping over the mesh's unit bounding sphere
+  fragUV = inPosition.xy * 0.5 + 0.5;
+  fragTexture = object.textureIndex;
+}
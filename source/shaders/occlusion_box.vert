@@ -0,0 +1,28 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 1) uniform FrameData {
+  mat4 viewProj;
+  vec4 frustumPlanes[6];
+  uvec4 pageFirstDraw;
+  uint objectCount;
+} frame;
+
+// World bounding sphere of each object, from the CPU transform hierarchy
+layout(std430, set = 0, binding = 4) readonly buffer Transforms {
+  vec4 worldSpheres[];
+};
+
+// Unit cube as one 14 vertex triangle strip
+const vec3 CUBE_STRIP[14] = vec3[](
+  vec3(-1.0, 1.0, 1.0), vec3(1.0, 1.0, 1.0), vec3(-1.0, -1.0, 1.0), vec3(1.0, -1.0, 1.0),
+  vec3(1.0, -1.0, -1.0), vec3(1.0, 1.0, 1.0), vec3(1.0, 1.0, -1.0), vec3(-1.0, 1.0, 1.0),
+  vec3(-1.0, 1.0, -1.0), vec3(-1.0, -1.0, 1.0), vec3(-1.0, -1.0, -1.0),
+  vec3(1.0, -1.0, -1.0), vec3(-1.0, 1.0, -1.0), vec3(1.0, 1.0, -1.0));
+
+void main() {
+  // The first instance of each query's draw is the object index
+  vec4 sphere = worldSpheres[gl_InstanceIndex];
+  vec3 worldPos = sphere.xyz + CUBE_STRIP[gl_VertexIndex] * sphere.w;
+  gl_Position = frame.viewProj * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Read straight from the simulation's storage buffer (see particles_simulate.comp)
+layout(location = 0) in vec4 inPosition;    // xyz, w: age
+layout(location = 1) in vec4 inVelocity;    // xyz, w: lifetime
+
+layout(push_constant) uniform View {
+  vec2 scale;    // aspect ratio correction
+} view;
+
+layout(location = 0) out vec3 fragColor;
+
+const float CAMERA_DISTANCE = 3.0;
+const float CAMERA_TILT     = 0.35;    // radians, looking down on the ring
+
+void main() {
+  float c = cos(CAMERA_TILT);
+  float s = sin(CAMERA_TILT);
+  vec3 position = vec3(inPosition.x,
+                       c * inPosition.y - s * inPosition.z - 0.3,
+                       s * inPosition.y + c * inPosition.z + CAMERA_DISTANCE);
+
+  // Simple perspective onto the z = 1 plane, the depth is unused
+  gl_Position = vec4(position.xy * view.scale * 1.5, 0.5 * position.z, position.z);
+  gl_Position.y = -gl_Position.y;
+  gl_PointSize = 1.0;
+
+  // Slow particles are blue, fast ones orange; they fade in and out over their life
+  float speed = clamp(length(inVelocity.xyz) * 0.5, 0.0, 1.0);
+  float life  = inPosition.w / inVelocity.w;
+  float fade  = smoothstep(0.0, 0.1, life) * (1.0 - smoothstep(0.7, 1.0, life));
+  fragColor = mix(vec3(0.1, 0.3, 1.0), vec3(1.0, 0.5, 0.1), speed) * fade * 0.05;
+}
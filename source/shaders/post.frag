@@ -0,0 +1,67 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// One post-processing effect, picked when the pipeline is created (see PostProcess.cpp).
+// Every effect only reads the previous result at its own pixel, which is what lets the
+// SUBPASS_INPUT permutation read it as an input attachment
+layout(constant_id = 0) const int EFFECT = 0;
+
+const int EFFECT_TONEMAP  = 0;
+const int EFFECT_GRADE    = 1;
+const int EFFECT_VIGNETTE = 2;
+
+#ifdef SUBPASS_INPUT
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput inputColor;
+#else
+layout(set = 0, binding = 0) uniform sampler2D inputColor;
+#endif
+
+layout(push_constant) uniform Pass {
+  vec2 invExtent;    // pixel to 0..1 coordinates
+} pass;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 loadInput() {
+#ifdef SUBPASS_INPUT
+  return subpassLoad(inputColor).rgb;
+#else
+  return texelFetch(inputColor, ivec2(gl_FragCoord.xy), 0).rgb;
+#endif
+}
+
+// Narkowicz's fit of the ACES filmic curve, then gamma for the UNORM swap chain
+vec3 tonemap(vec3 color) {
+  color *= 0.6;
+  color = clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14),
+                0.0, 1.0);
+  return pow(color, vec3(1.0 / 2.2));
+}
+
+vec3 grade(vec3 color) {
+  const float SATURATION = 1.15;
+  const float CONTRAST   = 1.05;
+  const vec3 WARMTH      = vec3(1.03, 1.0, 0.96);
+
+  float luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+  color = mix(vec3(luma), color, SATURATION);
+  color = (color - 0.5) * CONTRAST + 0.5;
+  return clamp(color * WARMTH, 0.0, 1.0);
+}
+
+vec3 vignette(vec3 color) {
+  vec2 uv = gl_FragCoord.xy * pass.invExtent - 0.5;
+  return color * (1.0 - smoothstep(0.4, 0.8, length(uv)) * 0.6);
+}
+
+void main() {
+  vec3 color = loadInput();
+  if (EFFECT == EFFECT_TONEMAP) {
+    color = tonemap(color);
+  } else if (EFFECT == EFFECT_GRADE) {
+    color = grade(color);
+  } else {
+    color = vignette(color);
+  }
+  outColor = vec4(color, 1.0);
+}